@@ -20,6 +20,7 @@ statement
     | continueStmt
     | callExpr
     | freeStmt
+    | taskStmt
 ;
 
 // ----------------------------
@@ -51,7 +52,13 @@ variableDecl
     ;
 
 assignment
-    : Identifier '=' expression ';'
+    : assignTarget '=' expression ';'
+    ;
+
+assignTarget
+    : Identifier
+    | assignTarget '[' expression ']'
+    | assignTarget '.' Identifier
     ;
 
 freeStmt
@@ -62,6 +69,10 @@ returnStmt
     : 'return' expression? ';'
     ;
 
+taskStmt
+    : ('spawn' callExpr | 'await' expression) ';'
+    ;
+
 breakStmt
     : 'break' ';'
     ;
@@ -80,6 +91,7 @@ conditional
 
 loop
     : 'for' Identifier 'in' 'range' expression 'to' expression ':' block
+    | 'pfor' Identifier 'in' 'range' expression 'to' expression ':' block
     ;
 
 // ----------------------------
@@ -150,11 +162,13 @@ expression
     | expression '.' Identifier        # memberAccess
     | expression operator expression        # binaryExpression
     | operator expression              # unaryExpression
+    | 'spawn' callExpr                 # spawnExpression
+    | 'await' expression               # awaitExpression
     | '(' expression ')'            # groupExpression
     ;
 
 callExpr
-    : Identifier '(' (expression (',' expression)*)? ')'
+    : (Identifier | 'map' | 'tuple') '(' (expression (',' expression)*)? ')'
     ;
 
 // ----------------------------
@@ -187,6 +201,12 @@ literal
 
 typeName
     : 'int' | 'float' | 'str' | 'bool' | 'list' | 'map' | 'tuple' | 'any'
+    | 'list' '<' typeName '>'
+    | 'map' '<' typeName ',' typeName '>'
+    | 'tuple' '<' typeName (',' typeName)* '>'
+    | 'chan' '<' typeName '>'
+    | 'task' ('<' typeName '>')?
+    | Identifier
     ;
 
 Identifier
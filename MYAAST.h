@@ -0,0 +1,488 @@
+/**
+ * MYA Language - Abstract Syntax Tree
+ *
+ * AST produced by ASTBuilder (MYAASTBuilder.h) and consumed by the optimizer
+ * and code generator. Nodes mirror the rules in MYA.g4:
+ * - Expr: literal, identifier, call, index, member, binary and unary forms
+ * - Stmt: let, assignment, if, for, filter/pass, print, return, break,
+ *   continue, free and call statements
+ * - Program: functions (including Main), structs and top-level statements
+ *
+ * Nodes own their children through unique_ptr; passes that duplicate
+ * subtrees use clone().
+ */
+
+#ifndef MYA_AST_H
+#define MYA_AST_H
+
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include "MYAStructLayout.h"
+
+namespace MYA {
+
+struct VectorLoopPlan;  // Attached to loops by the loop vectorizer
+
+/**
+ * Type reference: a scalar/struct name with optional element type (list<T>,
+ * chan<T>, task<T>; bare `task` is a task without a result)
+ */
+struct TypeRef {
+    std::string name;
+    std::vector<TypeRef> args;
+
+    TypeRef() {}
+    explicit TypeRef(const std::string& name) : name(name) {}
+
+    bool empty() const {
+        return name.empty();
+    }
+
+    bool isList() const {
+        return name == "list";
+    }
+
+    /**
+     * Element type of a list; bare `list` holds ints
+     */
+    TypeRef element() const {
+        return args.empty() ? TypeRef("int") : args[0];
+    }
+
+    bool operator==(const TypeRef& other) const {
+        if (name != other.name) {
+            return false;
+        }
+        if (isList()) {
+            return element() == other.element();
+        }
+        if (args.size() != other.args.size()) {
+            return false;
+        }
+        for (size_t i = 0; i < args.size(); i++) {
+            if (!(args[i] == other.args[i])) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    std::string str() const {
+        if (args.empty()) {
+            return name;
+        }
+        std::string text = name + "<";
+        for (size_t i = 0; i < args.size(); i++) {
+            text += (i ? ", " : "") + args[i].str();
+        }
+        return text + ">";
+    }
+};
+
+enum class ExprKind {
+    Number,
+    String,
+    Boolean,
+    Identifier,
+    Call,
+    Index,
+    Member,
+    Binary,
+    Unary
+};
+
+struct Expr;
+using ExprPtr = std::unique_ptr<Expr>;
+
+/**
+ * Expression node
+ *
+ * `text` holds the literal spelling, identifier, callee, member name or
+ * operator. `args` holds operands: Binary [lhs, rhs], Unary [operand],
+ * Index [base, index], Member [base], Call [arguments...]. Unary
+ * operators are "-", "not", "await" and "spawn" (whose operand is a Call).
+ */
+struct Expr {
+    ExprKind kind;
+    std::string text;
+    std::vector<ExprPtr> args;
+    int line;
+
+    Expr(ExprKind kind, const std::string& text, int line) : kind(kind), text(text), line(line) {}
+
+    ExprPtr clone() const {
+        ExprPtr copy(new Expr(kind, text, line));
+        for (const auto& arg : args) {
+            copy->args.push_back(arg->clone());
+        }
+        return copy;
+    }
+
+    bool isFloatLiteral() const {
+        return kind == ExprKind::Number && text.find('.') != std::string::npos;
+    }
+
+    std::string str() const {
+        switch (kind) {
+        case ExprKind::Number:
+        case ExprKind::String:
+        case ExprKind::Boolean:
+        case ExprKind::Identifier:
+            return text;
+        case ExprKind::Call: {
+            std::string result = text + "(";
+            for (size_t i = 0; i < args.size(); i++) {
+                result += (i ? ", " : "") + args[i]->str();
+            }
+            return result + ")";
+        }
+        case ExprKind::Index:
+            return args[0]->str() + "[" + args[1]->str() + "]";
+        case ExprKind::Member:
+            return args[0]->str() + "." + text;
+        case ExprKind::Binary:
+            return "(" + args[0]->str() + " " + text + " " + args[1]->str() + ")";
+        case ExprKind::Unary:
+            return text + (text == "-" ? "" : " ") + args[0]->str();
+        }
+        return text;
+    }
+};
+
+enum class StmtKind {
+    Let,
+    Assign,
+    If,
+    For,
+    Filter,
+    Print,
+    Return,
+    Break,
+    Continue,
+    ExprStmt,
+    Free
+};
+
+/**
+ * What the optimizer proved about a filter condition (MYAFilterOptimizer.h)
+ */
+enum class FilterFact {
+    Unknown,
+    AlwaysTrue,
+    AlwaysFalse  // Pass block is type checked but not emitted
+};
+
+/**
+ * How a self-recursive call in tail position is lowered (MYATailCallOptimizer.h)
+ */
+enum class TailCall {
+    None,
+    Jump,       // return f(args) / f(args) at the end of a void function
+    Accumulate  // return e op f(args): fold e into the accumulator, then jump
+};
+
+/**
+ * Branch layout chosen from a profile (MYAProfileGuidedOptimizer.h)
+ */
+enum class BranchHint {
+    None,      // No profile: `if` stays plain, `filter` is unlikely with a cold pass block
+    Likely,
+    Unlikely,
+    Balanced   // Profiled, but taken too evenly to hint either way
+};
+
+/**
+ * What the program did at a site during profiling; see MYARuntimeProfile.h
+ */
+enum class ProfileSiteKind : uint8_t {
+    Function,
+    Branch,  // if
+    Filter,
+    Loop
+};
+
+struct ProfileSite {
+    ProfileSiteKind kind;
+    int line;
+};
+
+struct Stmt;
+using StmtPtr = std::unique_ptr<Stmt>;
+using StmtList = std::vector<StmtPtr>;
+
+/**
+ * Statement node
+ *
+ * Let: name, type, value       Assign: target, value
+ * If: value (condition), body, elseBody
+ * For: name (loop variable), value (start), limit (exclusive end), body;
+ *      parallel for `pfor` (iterations run on the runtime thread pool)
+ * Filter: value (condition), body (pass block, may be empty)
+ * Print: args                  Return: value (optional)
+ * ExprStmt: value (call)       Free: name
+ */
+struct Stmt {
+    StmtKind kind;
+    int line;
+    std::string name;
+    TypeRef type;
+    ExprPtr target;
+    ExprPtr value;
+    ExprPtr limit;
+    std::vector<ExprPtr> args;
+    StmtList body;
+    StmtList elseBody;
+    bool hasElse = false;
+    bool parallel = false;
+    std::shared_ptr<const VectorLoopPlan> vectorPlan;
+    FilterFact filterFact = FilterFact::Unknown;
+    TailCall tailCall = TailCall::None;
+    int profileSite = -1;                    // If, Filter, For: index in Program::profileSites
+    BranchHint branchHint = BranchHint::None;
+    bool coldBody = false;                   // Profiled: body / else body (almost) never ran
+    bool coldElse = false;
+    int unroll = 0;                          // For: unroll factor from the profile
+
+    Stmt(StmtKind kind, int line) : kind(kind), line(line) {}
+
+    StmtPtr clone() const {
+        StmtPtr copy(new Stmt(kind, line));
+        copy->name = name;
+        copy->type = type;
+        copy->target = target ? target->clone() : nullptr;
+        copy->value = value ? value->clone() : nullptr;
+        copy->limit = limit ? limit->clone() : nullptr;
+        for (const auto& arg : args) {
+            copy->args.push_back(arg->clone());
+        }
+        for (const auto& s : body) {
+            copy->body.push_back(s->clone());
+        }
+        for (const auto& s : elseBody) {
+            copy->elseBody.push_back(s->clone());
+        }
+        copy->hasElse = hasElse;
+        copy->parallel = parallel;
+        copy->vectorPlan = vectorPlan;
+        copy->filterFact = filterFact;
+        copy->tailCall = tailCall;
+        copy->profileSite = profileSite;
+        copy->branchHint = branchHint;
+        copy->coldBody = coldBody;
+        copy->coldElse = coldElse;
+        copy->unroll = unroll;
+        return copy;
+    }
+};
+
+struct Param {
+    std::string name;
+    TypeRef type;
+};
+
+/**
+ * How a function is emitted after profiling (MYAProfileGuidedOptimizer.h)
+ */
+enum class FunctionHeat {
+    Normal,
+    Hot,     // Called often: hot text section
+    Inline,  // Called often, small and not recursive: always inlined
+    Cold     // Never called: cold text section, not inlined
+};
+
+struct FunctionDecl {
+    std::string name;
+    std::vector<Param> params;
+    TypeRef returnType;  // Empty: no return value
+    StmtList body;
+    int line = 0;
+    bool isMain = false;
+    int tailCalls = 0;           // Self calls turned into jumps
+    std::string accumulatorOp;   // "+" or "*" after accumulator introduction
+    int profileSite = -1;        // Index in Program::profileSites
+    FunctionHeat heat = FunctionHeat::Normal;
+    bool evaluated = false;      // Every call ran at compile time: checked, not emitted
+};
+
+/**
+ * Whole-program AST
+ */
+struct Program {
+    std::vector<FunctionDecl> functions;
+    std::vector<StructDef> structs;
+    StmtList topLevel;
+    std::vector<int> renderLines;  // Lowered separately by RenderLowering
+    std::vector<int> asmLines;     // Encoded separately by the Assembler
+    std::vector<ProfileSite> profileSites;  // Numbered for --instrument / --profile-use
+
+    const FunctionDecl* findFunction(const std::string& name) const {
+        for (const auto& fn : functions) {
+            if (fn.name == name) {
+                return &fn;
+            }
+        }
+        return nullptr;
+    }
+
+    const StructDef* findStruct(const std::string& name) const {
+        for (const auto& def : structs) {
+            if (def.name == name) {
+                return &def;
+            }
+        }
+        return nullptr;
+    }
+};
+
+/**
+ * Lexically scoped variable types, shared by passes that walk function bodies.
+ * A `let` of a name that is already visible assigns to that variable.
+ */
+class ScopeStack {
+private:
+    std::vector<std::map<std::string, TypeRef>> scopes;
+
+public:
+    void push() {
+        scopes.emplace_back();
+    }
+
+    void pop() {
+        scopes.pop_back();
+    }
+
+    void declare(const std::string& name, const TypeRef& type) {
+        scopes.back()[name] = type;
+    }
+
+    const TypeRef* lookup(const std::string& name) const {
+        for (auto it = scopes.rbegin(); it != scopes.rend(); ++it) {
+            auto found = it->find(name);
+            if (found != it->end()) {
+                return &found->second;
+            }
+        }
+        return nullptr;
+    }
+};
+
+/**
+ * Optimization remark reported by --opt-report
+ */
+struct OptRemark {
+    int line;
+    std::string pass;
+    std::string message;
+    bool applied;
+};
+
+/**
+ * ASTPrinter - Indented dump of the AST (--ast)
+ */
+class ASTPrinter {
+private:
+    std::ostream& out;
+    int indentLevel = 0;
+
+    void printIndent() const {
+        for (int i = 0; i < indentLevel; i++) {
+            out << "  ";
+        }
+    }
+
+    void printBlock(const StmtList& block) {
+        indentLevel++;
+        for (const auto& stmt : block) {
+            printStmt(*stmt);
+        }
+        indentLevel--;
+    }
+
+    void printStmt(const Stmt& stmt) {
+        printIndent();
+        switch (stmt.kind) {
+        case StmtKind::Let:
+            out << "Let " << stmt.name << ": " << stmt.type.str() << " = " << stmt.value->str();
+            break;
+        case StmtKind::Assign:
+            out << "Assign " << stmt.target->str() << " = " << stmt.value->str();
+            break;
+        case StmtKind::If:
+            out << "If " << stmt.value->str();
+            break;
+        case StmtKind::For:
+            out << (stmt.parallel ? "ParallelFor " : "For ") << stmt.name << " in " << stmt.value->str() << " to " << stmt.limit->str();
+            if (stmt.vectorPlan) {
+                out << " [vectorized]";
+            }
+            break;
+        case StmtKind::Filter:
+            out << "Filter " << stmt.value->str() << (stmt.body.empty() ? "" : " pass")
+                      << (stmt.filterFact == FilterFact::AlwaysFalse ? " (removed)" : "");
+            break;
+        case StmtKind::Print:
+            out << "Print";
+            for (size_t i = 0; i < stmt.args.size(); i++) {
+                out << (i ? ", " : " ") << stmt.args[i]->str();
+            }
+            break;
+        case StmtKind::Return:
+            out << "Return" << (stmt.value ? " " + stmt.value->str() : "")
+                      << (stmt.tailCall != TailCall::None ? " (tail call)" : "");
+            break;
+        case StmtKind::Break:
+            out << "Break";
+            break;
+        case StmtKind::Continue:
+            out << "Continue";
+            break;
+        case StmtKind::ExprStmt:
+            out << "Call " << stmt.value->str() << (stmt.tailCall != TailCall::None ? " (tail call)" : "");
+            break;
+        case StmtKind::Free:
+            out << "Free " << stmt.name;
+            break;
+        }
+        out << "  (line " << stmt.line << ")" << std::endl;
+        printBlock(stmt.body);
+        if (stmt.hasElse) {
+            printIndent();
+            out << "Else" << std::endl;
+            printBlock(stmt.elseBody);
+        }
+    }
+
+public:
+    explicit ASTPrinter(std::ostream& out = std::cout) : out(out) {}
+
+    void print(const Program& program) {
+        out << "\n=== AST ===" << std::endl;
+        for (const auto& def : program.structs) {
+            out << "Struct " << def.name << " (" << def.fields.size() << " fields)" << std::endl;
+        }
+        for (const auto& fn : program.functions) {
+            out << (fn.isMain ? "Main" : "Function " + fn.name) << "(";
+            for (size_t i = 0; i < fn.params.size(); i++) {
+                out << (i ? ", " : "") << fn.params[i].name << ": " << fn.params[i].type.str();
+            }
+            out << ")";
+            if (!fn.returnType.empty()) {
+                out << " -> " << fn.returnType.str();
+            }
+            out << "  (line " << fn.line << ")" << std::endl;
+            printBlock(fn.body);
+        }
+        if (!program.topLevel.empty()) {
+            out << "Top-level statements:" << std::endl;
+            printBlock(program.topLevel);
+        }
+    }
+};
+
+} // namespace MYA
+
+#endif // MYA_AST_H
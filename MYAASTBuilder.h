@@ -0,0 +1,907 @@
+/**
+ * MYA Language - AST Builder
+ *
+ * Hand-written recursive descent parser that builds the AST (MYAAST.h)
+ * directly from the preprocessed token stream, following the rules of MYA.g4.
+ * It is the front end of the standalone compiler; MYACompilerANTLR.cpp keeps
+ * the ANTLR4 parse tree path.
+ *
+ * Recursive linear parsing walks statements in order; each `<INDENT>` opens a
+ * block that ends at the matching `<DEDENT>`. Expressions use conventional
+ * precedence (or < and < not < comparison < additive < multiplicative < unary).
+ *
+ * Error recovery collects every diagnostic in one pass:
+ * - A bad line is reported and parsing resumes with the next line; a bad
+ *   block header also discards its block
+ * - A struct/render/asm block missing `end` stops at the next top-level
+ *   `fn`/`Main`/`struct`/`render`/`asm` line (classified like the scope
+ *   ledger's scopes) instead of swallowing the rest of the file
+ * - Stray indentation is tracked with a counter, and expressions and blocks
+ *   nested beyond a fixed depth are errors, so broken input parses in
+ *   linear time without deep recursion
+ * - setErrorLimit() stops parsing after that many diagnostics
+ */
+
+#ifndef MYA_AST_BUILDER_H
+#define MYA_AST_BUILDER_H
+
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <unordered_set>
+#include <vector>
+#include "MYAIndentationPreprocessor.h"
+#include "MYAAST.h"
+
+namespace MYA {
+
+/**
+ * Parse error with source position
+ */
+struct ParseDiagnostic {
+    int line;
+    int column;
+    std::string message;
+};
+
+/**
+ * Lexeme of one preprocessed code line
+ */
+struct Lexeme {
+    enum Kind { Word, Number, String, Symbol, End } kind;
+    std::string text;
+    int column;
+};
+
+/**
+ * Keywords and built-in type names, which cannot name variables or functions
+ */
+inline bool isReservedWord(const std::string& word) {
+    static const std::unordered_set<std::string> keywords = {
+        "let", "fn", "if", "else", "for", "pfor", "in", "range", "to", "filter", "pass", "print", "return",
+        "break", "continue", "free", "struct", "end", "render", "asm", "and", "or", "not",
+        "true", "false", "int", "float", "str", "bool", "list", "map", "tuple", "any",
+        "spawn", "await", "chan", "task"
+    };
+    return keywords.count(word) != 0;
+}
+
+/**
+ * `c` is one of `chars` (strchr would also match the terminator)
+ */
+inline bool isOneOf(char c, const char* chars) {
+    return c != '\0' && std::strchr(chars, c) != nullptr;
+}
+
+/**
+ * Decode the UTF-8 sequence at `i`; returns its length in bytes, or 0 when
+ * it is malformed (truncated, overlong, a surrogate or past U+10FFFF)
+ */
+inline size_t decodeUtf8(const std::string& text, size_t i, uint32_t& codePoint) {
+    static const uint32_t minimum[] = { 0, 0, 0x80, 0x800, 0x10000 };
+    unsigned char lead = static_cast<unsigned char>(text[i]);
+    size_t length = lead < 0x80 ? 1 : (lead & 0xE0) == 0xC0 ? 2 : (lead & 0xF0) == 0xE0 ? 3 : (lead & 0xF8) == 0xF0 ? 4 : 0;
+    if (length == 0 || i + length > text.size()) {
+        return 0;
+    }
+    codePoint = length == 1 ? lead : lead & (0x7Fu >> length);
+    for (size_t k = 1; k < length; k++) {
+        unsigned char c = static_cast<unsigned char>(text[i + k]);
+        if ((c & 0xC0) != 0x80) {
+            return 0;
+        }
+        codePoint = (codePoint << 6) | (c & 0x3Fu);
+    }
+    if (codePoint < minimum[length] || codePoint > 0x10FFFF || (codePoint >= 0xD800 && codePoint <= 0xDFFF)) {
+        return 0;
+    }
+    return length;
+}
+
+/**
+ * Split one code line into lexemes; `$` starts a comment. On an error,
+ * `errorColumn` is the column of the offending character.
+ */
+inline std::vector<Lexeme> lexLine(const std::string& line, int baseColumn, std::string& error, int& errorColumn) {
+    std::vector<Lexeme> lexemes;
+    lexemes.reserve(line.size() / 2 + 1);
+    size_t i = 0;
+    while (i < line.size()) {
+        char c = line[i];
+        int column = baseColumn + static_cast<int>(i);
+        if (c == ' ' || c == '\t' || c == '\r') {
+            i++;
+        } else if (c == '$') {
+            break;
+        } else if (std::isalpha(static_cast<unsigned char>(c)) || c == '_') {
+            size_t start = i;
+            while (i < line.size() && (std::isalnum(static_cast<unsigned char>(line[i])) || line[i] == '_')) {
+                i++;
+            }
+            lexemes.push_back(Lexeme{ Lexeme::Word, line.substr(start, i - start), column });
+        } else if (std::isdigit(static_cast<unsigned char>(c))) {
+            size_t start = i;
+            while (i < line.size() && std::isdigit(static_cast<unsigned char>(line[i]))) {
+                i++;
+            }
+            if (i + 1 < line.size() && line[i] == '.' && std::isdigit(static_cast<unsigned char>(line[i + 1]))) {
+                i++;
+                while (i < line.size() && std::isdigit(static_cast<unsigned char>(line[i]))) {
+                    i++;
+                }
+            }
+            lexemes.push_back(Lexeme{ Lexeme::Number, line.substr(start, i - start), column });
+        } else if (c == '"') {
+            size_t start = i++;
+            while (i < line.size() && line[i] != '"') {
+                if (line[i] == '\\') {
+                    if (i + 1 >= line.size() || !isOneOf(line[i + 1], "'\"\\nrt")) {
+                        error = "invalid escape sequence in string";
+                        errorColumn = baseColumn + static_cast<int>(i);
+                        return lexemes;
+                    }
+                    i++;
+                }
+                i++;
+            }
+            if (i >= line.size()) {
+                error = "unterminated string literal";
+                errorColumn = column;
+                return lexemes;
+            }
+            i++;
+            lexemes.push_back(Lexeme{ Lexeme::String, line.substr(start, i - start), column });
+        } else {
+            char next = i + 1 < line.size() ? line[i + 1] : '\0';
+            size_t length = (c == '-' && next == '>') || (isOneOf(c, "=!<>") && next == '=') ? 2 : 1;
+            if (length == 1 && !isOneOf(c, "+-*/%<>=()[],:;.")) {
+                // Name the whole code point: a lone lead byte is not valid UTF-8 in JSON output
+                uint32_t codePoint = 0;
+                char name[16];
+                if (c >= 0x20 && c < 0x7F) {
+                    error = std::string("unexpected character '") + c + "'";
+                } else if (decodeUtf8(line, i, codePoint)) {
+                    std::snprintf(name, sizeof(name), "U+%04X", static_cast<unsigned>(codePoint));
+                    error = std::string("unexpected character ") + name;
+                } else {
+                    std::snprintf(name, sizeof(name), "0x%02X", static_cast<unsigned>(static_cast<unsigned char>(c)));
+                    error = std::string("invalid UTF-8 byte ") + name;
+                }
+                errorColumn = column;
+                return lexemes;
+            }
+            lexemes.push_back(Lexeme{ Lexeme::Symbol, line.substr(i, length), column });
+            i += length;
+        }
+    }
+    return lexemes;
+}
+
+inline std::vector<Lexeme> lexLine(const std::string& line, int baseColumn, std::string& error) {
+    int errorColumn = 0;
+    return lexLine(line, baseColumn, error, errorColumn);
+}
+
+/**
+ * ASTBuilder - Builds a Program from preprocessed tokens
+ */
+class ASTBuilder {
+private:
+    struct ParseError {
+        int column;
+        std::string message;
+    };
+
+    static const int kMaxNesting = 256;
+
+    const std::vector<Token>* tokens = nullptr;
+    size_t pos = 0;
+    Program* program = nullptr;
+    std::vector<ParseDiagnostic> diagnostics;
+    size_t errorLimit = 0;  // 0: unlimited
+    bool limitReached = false;
+    int nesting = 0;        // Expression depth
+    int blockDepth = 0;
+
+    // Current line
+    std::vector<Lexeme> lex;
+    size_t lp = 0;
+    int line = 0;
+    int lineEndColumn = 0;
+
+    // ----- Line-level helpers -----
+
+    /**
+     * Record a diagnostic; at the error limit, parsing stops
+     */
+    void report(int atLine, int atColumn, const std::string& message) {
+        if (limitReached) {
+            return;
+        }
+        diagnostics.push_back(ParseDiagnostic{ atLine, atColumn, message });
+        if (errorLimit && diagnostics.size() >= errorLimit) {
+            limitReached = true;
+            pos = tokens->size();
+        }
+    }
+
+    /**
+     * Bounds recursion in expressions; released when the parse returns or throws
+     */
+    struct NestingGuard {
+        int& depth;
+        NestingGuard(int& counter, int column) : depth(counter) {
+            if (++depth > kMaxNesting) {
+                --depth;
+                throw ParseError{ column, "expression nested too deeply" };
+            }
+        }
+        ~NestingGuard() {
+            --depth;
+        }
+    };
+
+    /**
+     * A column-0 line opening a function, struct, render or asm block
+     */
+    static bool isTopLevelBoundary(const Token& token) {
+        if (token.type != TokenType::CODE || token.column != 0) {
+            return false;
+        }
+        std::string type = IndentationPreprocessor::detectScopeType(token.value);
+        return type == "function" || type == "struct" || type == "render" || type == "asm";
+    }
+
+    const Token& peekToken() const {
+        return (*tokens)[pos];
+    }
+
+    bool atEnd() const {
+        return pos >= tokens->size() || peekToken().type == TokenType::END_OF_FILE;
+    }
+
+    /**
+     * Load the CODE token at `pos` as the current line
+     */
+    bool loadLine() {
+        const Token& token = (*tokens)[pos++];
+        std::string error;
+        int errorColumn = 0;
+        lex = lexLine(token.value, token.column, error, errorColumn);
+        lp = 0;
+        line = token.line;
+        lineEndColumn = token.column + static_cast<int>(token.value.size());
+        if (!error.empty()) {
+            report(line, errorColumn, error);
+            return false;
+        }
+        return true;
+    }
+
+    const Lexeme& peek(size_t ahead = 0) const {
+        static const Lexeme end{ Lexeme::End, "", 0 };
+        return lp + ahead < lex.size() ? lex[lp + ahead] : end;
+    }
+
+    bool check(const char* text, size_t ahead = 0) const {
+        const Lexeme& l = peek(ahead);
+        return l.kind != Lexeme::End && l.kind != Lexeme::String && l.text[0] == text[0] && l.text == text;
+    }
+
+    bool lineDone() const {
+        return lp >= lex.size();
+    }
+
+    bool accept(const char* text) {
+        if (check(text)) {
+            lp++;
+            return true;
+        }
+        return false;
+    }
+
+    int column() const {
+        return lineDone() ? lineEndColumn : peek().column;
+    }
+
+    void expect(const char* text, const char* context) {
+        if (!accept(text)) {
+            throw ParseError{ column(), std::string("expected '") + text + "' " + context +
+                                        (lineDone() ? "" : " but found '" + peek().text + "'") };
+        }
+    }
+
+    void expect(const char* text, const std::string& context) {
+        expect(text, context.c_str());
+    }
+
+    static bool isKeyword(const std::string& word) {
+        return isReservedWord(word);
+    }
+
+    std::string expectIdentifier(const std::string& context) {
+        const Lexeme& l = peek();
+        if (l.kind != Lexeme::Word || isKeyword(l.text)) {
+            throw ParseError{ column(), "expected identifier " + context };
+        }
+        lp++;
+        return l.text;
+    }
+
+    // ----- Types and expressions -----
+
+    TypeRef parseType() {
+        const Lexeme& l = peek();
+        if (l.kind != Lexeme::Word) {
+            throw ParseError{ column(), "expected type name" };
+        }
+        static const char* builtin[] = { "int", "float", "str", "bool", "list", "map", "tuple", "any", "chan", "task" };
+        bool known = !isKeyword(l.text);
+        for (const char* name : builtin) {
+            known = known || l.text == name;
+        }
+        if (!known) {
+            throw ParseError{ column(), "'" + l.text + "' is not a type" };
+        }
+        lp++;
+        TypeRef type(l.text);
+        if ((type.isList() || type.name == "chan" || type.name == "task") && accept("<")) {
+            type.args.push_back(parseType());
+            expect(">", "after " + type.name + " element type");
+        } else if ((type.name == "map" || type.name == "tuple") && accept("<")) {
+            do {
+                type.args.push_back(parseType());
+            } while (accept(","));
+            expect(">", "after " + type.name + " element types");
+            if (type.name == "map" && type.args.size() != 2) {
+                throw ParseError{ column(), "map needs a key and a value type, as in map<str, int>" };
+            }
+        } else if (type.name == "chan") {
+            throw ParseError{ column(), "chan needs an element type, as in chan<int>" };
+        }
+        return type;
+    }
+
+    ExprPtr makeBinary(const std::string& op, ExprPtr lhs, ExprPtr rhs) {
+        ExprPtr node(new Expr(ExprKind::Binary, op, lhs->line));
+        node->args.push_back(std::move(lhs));
+        node->args.push_back(std::move(rhs));
+        return node;
+    }
+
+    ExprPtr parseExpression() {
+        NestingGuard guard(nesting, column());
+        ExprPtr lhs = parseAnd();
+        while (accept("or")) {
+            lhs = makeBinary("or", std::move(lhs), parseAnd());
+        }
+        return lhs;
+    }
+
+    ExprPtr parseAnd() {
+        ExprPtr lhs = parseNot();
+        while (accept("and")) {
+            lhs = makeBinary("and", std::move(lhs), parseNot());
+        }
+        return lhs;
+    }
+
+    ExprPtr parseNot() {
+        if (accept("not")) {
+            NestingGuard guard(nesting, column());
+            ExprPtr node(new Expr(ExprKind::Unary, "not", line));
+            node->args.push_back(parseNot());
+            return node;
+        }
+        return parseComparison();
+    }
+
+    ExprPtr parseComparison() {
+        ExprPtr lhs = parseAdditive();
+        while (check("==") || check("!=") || check("<") || check(">") || check("<=") || check(">=")) {
+            std::string op = peek().text;
+            lp++;
+            lhs = makeBinary(op, std::move(lhs), parseAdditive());
+        }
+        return lhs;
+    }
+
+    ExprPtr parseAdditive() {
+        ExprPtr lhs = parseMultiplicative();
+        while (check("+") || check("-")) {
+            std::string op = peek().text;
+            lp++;
+            lhs = makeBinary(op, std::move(lhs), parseMultiplicative());
+        }
+        return lhs;
+    }
+
+    ExprPtr parseMultiplicative() {
+        ExprPtr lhs = parseUnary();
+        while (check("*") || check("/") || check("%")) {
+            std::string op = peek().text;
+            lp++;
+            lhs = makeBinary(op, std::move(lhs), parseUnary());
+        }
+        return lhs;
+    }
+
+    ExprPtr parseUnary() {
+        NestingGuard guard(nesting, column());
+        if (check("-") || check("+")) {
+            std::string op = peek().text;
+            lp++;
+            ExprPtr operand = parseUnary();
+            if (op == "+") {
+                return operand;
+            }
+            if (operand->kind == ExprKind::Number && operand->text[0] != '-') {
+                operand->text = "-" + operand->text;  // Fold negative literals
+                return operand;
+            }
+            ExprPtr node(new Expr(ExprKind::Unary, "-", line));
+            node->args.push_back(std::move(operand));
+            return node;
+        }
+        if (accept("await")) {
+            ExprPtr node(new Expr(ExprKind::Unary, "await", line));
+            node->args.push_back(parseUnary());
+            return node;
+        }
+        if (accept("spawn")) {
+            ExprPtr node(new Expr(ExprKind::Unary, "spawn", line));
+            node->args.push_back(parsePostfix());
+            if (node->args[0]->kind != ExprKind::Call) {
+                throw ParseError{ column(), "expected a function call after 'spawn'" };
+            }
+            return node;
+        }
+        return parsePostfix();
+    }
+
+    ExprPtr parsePostfix() {
+        ExprPtr expr = parsePrimary();
+        while (true) {
+            if (accept("[")) {
+                ExprPtr node(new Expr(ExprKind::Index, "[]", line));
+                node->args.push_back(std::move(expr));
+                node->args.push_back(parseExpression());
+                expect("]", "to close index");
+                expr = std::move(node);
+            } else if (accept(".")) {
+                ExprPtr node(new Expr(ExprKind::Member, expectIdentifier("after '.'"), line));
+                node->args.push_back(std::move(expr));
+                expr = std::move(node);
+            } else {
+                return expr;
+            }
+        }
+    }
+
+    ExprPtr parsePrimary() {
+        const Lexeme l = peek();
+        switch (l.kind) {
+        case Lexeme::Number:
+            lp++;
+            return ExprPtr(new Expr(ExprKind::Number, l.text, line));
+        case Lexeme::String:
+            lp++;
+            return ExprPtr(new Expr(ExprKind::String, l.text, line));
+        case Lexeme::Word:
+            if (l.text == "true" || l.text == "false") {
+                lp++;
+                return ExprPtr(new Expr(ExprKind::Boolean, l.text, line));
+            }
+            // map(...) and tuple(...) construct values of those types
+            if (!isKeyword(l.text) || ((l.text == "map" || l.text == "tuple") && check("(", 1))) {
+                lp++;
+                if (accept("(")) {
+                    ExprPtr call(new Expr(ExprKind::Call, l.text, line));
+                    if (!accept(")")) {
+                        do {
+                            call->args.push_back(parseExpression());
+                        } while (accept(","));
+                        expect(")", "to close argument list");
+                    }
+                    return call;
+                }
+                return ExprPtr(new Expr(ExprKind::Identifier, l.text, line));
+            }
+            break;
+        case Lexeme::Symbol:
+            if (l.text == "(") {
+                lp++;
+                ExprPtr inner = parseExpression();
+                expect(")", "to close group");
+                return inner;
+            }
+            break;
+        case Lexeme::End:
+            throw ParseError{ column(), "expected expression" };
+        }
+        throw ParseError{ column(), "unexpected '" + l.text + "' in expression" };
+    }
+
+    // ----- Statements and blocks -----
+
+    /**
+     * Parse an indented block following a header line ending in ':'
+     */
+    StmtList parseBlock(const std::string& owner) {
+        StmtList block;
+        if (atEnd() || peekToken().type != TokenType::INDENT) {
+            report(line, lineEndColumn, "expected an indented block after " + owner);
+            return block;
+        }
+        if (blockDepth >= kMaxNesting) {
+            report(line, lineEndColumn, "blocks nested too deeply");
+            skipBlock();
+            return block;
+        }
+        pos++;
+        blockDepth++;
+        parseStatements(block, true);
+        blockDepth--;
+        return block;
+    }
+
+    /**
+     * Consume an INDENT and everything up to its matching DEDENT
+     */
+    void skipBlock() {
+        int depth = 0;
+        do {
+            TokenType type = (*tokens)[pos++].type;
+            depth += type == TokenType::INDENT ? 1 : type == TokenType::DEDENT ? -1 : 0;
+        } while (depth > 0 && !atEnd());
+    }
+
+    /**
+     * Parse statements until the block's DEDENT (or EOF at top level)
+     */
+    void parseStatements(StmtList& block, bool nested) {
+        int stray = 0;  // Open unexpected INDENTs; their lines continue this block
+        while (!atEnd()) {
+            const Token& token = peekToken();
+            if (token.type == TokenType::DEDENT) {
+                pos++;
+                if (stray > 0) {
+                    stray--;
+                    continue;
+                }
+                if (nested) {
+                    return;
+                }
+                continue;
+            }
+            if (token.type == TokenType::INDENT) {
+                // Figurative indentation: a stray indent continues the same block
+                report(token.line, 0, "unexpected indentation");
+                pos++;
+                stray++;
+                continue;
+            }
+            if (token.type != TokenType::CODE) {
+                pos++;
+                continue;
+            }
+            parseLine(block, !nested && stray == 0);
+        }
+    }
+
+    /**
+     * Parse one CODE line (one or more simple statements, or a block header)
+     */
+    void parseLine(StmtList& block, bool topLevel) {
+        if (!loadLine()) {
+            skipHeaderBlock();
+            return;
+        }
+        try {
+            if (check("Main") || check("fn")) {
+                parseFunction();
+                return;
+            }
+            if (check("struct") || check("render") || check("asm")) {
+                if (!topLevel && !check("render")) {
+                    throw ParseError{ column(), "'" + peek().text + "' is only allowed at top level" };
+                }
+                parseOpaqueBlock();
+                return;
+            }
+            while (!lineDone()) {
+                StmtPtr stmt = parseStatement();
+                bool opensBlock = stmt->kind == StmtKind::If || stmt->kind == StmtKind::For ||
+                                  (stmt->kind == StmtKind::Filter && stmt->hasElse);
+                if (opensBlock) {
+                    parseStatementBlocks(*stmt);
+                    block.push_back(std::move(stmt));
+                    return;
+                }
+                block.push_back(std::move(stmt));
+            }
+        } catch (const ParseError& error) {
+            report(line, error.column, error.message);
+            skipHeaderBlock();
+        }
+    }
+
+    /**
+     * After a failed header line (one ending in ':', or a function header
+     * missing it), parse and discard its block so structure stays aligned
+     */
+    void skipHeaderBlock() {
+        bool header = !lex.empty() && (lex.back().text == ":" || lex[0].text == "fn" || lex[0].text == "Main");
+        if (header && !atEnd() && peekToken().type == TokenType::INDENT) {
+            StmtList discarded = parseBlock("header");
+        }
+    }
+
+    void parseStatementBlocks(Stmt& stmt) {
+        std::string owner = stmt.kind == StmtKind::If ? "'if'"
+                          : stmt.kind == StmtKind::For ? (stmt.parallel ? "'pfor'" : "'for'")
+                          : "'pass'";
+        stmt.body = parseBlock(owner);
+        if (stmt.kind == StmtKind::Filter) {
+            stmt.hasElse = false;  // hasElse was a parse-time marker for "pass:"
+            return;
+        }
+        if (stmt.kind == StmtKind::If && !atEnd() && peekToken().type == TokenType::CODE) {
+            std::string error;
+            std::vector<Lexeme> next = lexLine(peekToken().value, peekToken().column, error);
+            if (next.size() == 2 && next[0].text == "else" && next[1].text == ":") {
+                loadLine();
+                stmt.hasElse = true;
+                stmt.elseBody = parseBlock("'else'");
+            }
+        }
+    }
+
+    StmtPtr parseStatement() {
+        int stmtLine = line;
+        if (accept("let")) {
+            StmtPtr stmt(new Stmt(StmtKind::Let, stmtLine));
+            stmt->name = expectIdentifier("after 'let'");
+            expect(":", "after variable name");
+            stmt->type = parseType();
+            expect("=", "in variable declaration");
+            stmt->value = parseExpression();
+            expect(";", "after declaration");
+            return stmt;
+        }
+        if (accept("if")) {
+            StmtPtr stmt(new Stmt(StmtKind::If, stmtLine));
+            stmt->value = parseExpression();
+            expect(":", "after if condition");
+            requireLineEnd();
+            return stmt;
+        }
+        bool parallel = check("pfor");
+        if (accept("for") || accept("pfor")) {
+            StmtPtr stmt(new Stmt(StmtKind::For, stmtLine));
+            stmt->parallel = parallel;
+            stmt->name = expectIdentifier("as loop variable");
+            expect("in", "after loop variable");
+            expect("range", "after 'in'");
+            stmt->value = parseExpression();
+            expect("to", "in range");
+            stmt->limit = parseExpression();
+            expect(":", "after range");
+            requireLineEnd();
+            return stmt;
+        }
+        if (accept("filter")) {
+            StmtPtr stmt(new Stmt(StmtKind::Filter, stmtLine));
+            stmt->value = parseExpression();
+            if (accept("pass") && accept(":")) {
+                requireLineEnd();
+                stmt->hasElse = true;  // Marks "pass:" so the caller parses the block
+                return stmt;
+            }
+            accept(";");
+            return stmt;
+        }
+        if (accept("print")) {
+            StmtPtr stmt(new Stmt(StmtKind::Print, stmtLine));
+            do {
+                stmt->args.push_back(parseExpression());
+            } while (accept(","));
+            expect(";", "after print");
+            return stmt;
+        }
+        if (accept("return")) {
+            StmtPtr stmt(new Stmt(StmtKind::Return, stmtLine));
+            if (!check(";")) {
+                stmt->value = parseExpression();
+            }
+            expect(";", "after return");
+            return stmt;
+        }
+        if (accept("break") || accept("continue")) {
+            StmtPtr stmt(new Stmt(lex[lp - 1].text == "break" ? StmtKind::Break : StmtKind::Continue, stmtLine));
+            expect(";", "after " + lex[lp - 1].text);
+            return stmt;
+        }
+        if (accept("free")) {
+            StmtPtr stmt(new Stmt(StmtKind::Free, stmtLine));
+            stmt->name = expectIdentifier("after 'free'");
+            expect(";", "after free");
+            return stmt;
+        }
+
+        ExprPtr expr = parseExpression();
+        if (accept("=")) {
+            if (expr->kind != ExprKind::Identifier && expr->kind != ExprKind::Index && expr->kind != ExprKind::Member) {
+                throw ParseError{ column(), "invalid assignment target" };
+            }
+            StmtPtr stmt(new Stmt(StmtKind::Assign, stmtLine));
+            stmt->target = std::move(expr);
+            stmt->value = parseExpression();
+            expect(";", "after assignment");
+            return stmt;
+        }
+        bool task = expr->kind == ExprKind::Unary && (expr->text == "spawn" || expr->text == "await");
+        if (expr->kind != ExprKind::Call && !task) {
+            throw ParseError{ column(), "expression statement must be a call, spawn or await" };
+        }
+        StmtPtr stmt(new Stmt(StmtKind::ExprStmt, stmtLine));
+        stmt->value = std::move(expr);
+        expect(";", "after call");
+        return stmt;
+    }
+
+    void requireLineEnd() {
+        if (!lineDone()) {
+            throw ParseError{ column(), "unexpected '" + peek().text + "' after ':'" };
+        }
+    }
+
+    /**
+     * `Main() fn:` or `fn name(params) -> type:`
+     */
+    void parseFunction() {
+        FunctionDecl fn;
+        fn.line = line;
+        if (accept("Main")) {
+            expect("(", "after Main");
+            expect(")", "after Main(");
+            expect("fn", "after Main()");
+            fn.name = "Main";
+            fn.isMain = true;
+        } else {
+            expect("fn", "");
+            fn.name = expectIdentifier("as function name");
+            expect("(", "after function name");
+            if (!accept(")")) {
+                do {
+                    Param param;
+                    param.name = expectIdentifier("as parameter name");
+                    expect(":", "after parameter name");
+                    param.type = parseType();
+                    fn.params.push_back(param);
+                } while (accept(","));
+                expect(")", "to close parameter list");
+            }
+            if (accept("->")) {
+                fn.returnType = parseType();
+            }
+        }
+        expect(":", "after function signature");
+        requireLineEnd();
+        fn.body = parseBlock("function '" + fn.name + "'");
+        program->functions.push_back(std::move(fn));
+    }
+
+    /**
+     * struct/render/asm blocks run to a closing `end` line, or up to the
+     * next top-level boundary when `end` is missing
+     */
+    void parseOpaqueBlock() {
+        std::string kind = peek().text;
+        int startLine = line;
+        StructDef def{ "", {}, line };
+        try {
+            lp++;
+            if (kind == "struct") {
+                def.name = expectIdentifier("as struct name");
+            }
+            expect(":", "after " + kind);
+            requireLineEnd();
+        } catch (const ParseError& error) {
+            report(line, error.column, error.message);  // The body still runs to `end`
+        }
+
+        int depth = 1;
+        int level = 0;                      // INDENT/DEDENT balance since the header
+        size_t exitPos = std::string::npos;  // First DEDENT below the header's level
+        while (!atEnd()) {
+            size_t at = pos;
+            const Token& token = (*tokens)[pos++];
+            if (token.type == TokenType::INDENT || token.type == TokenType::DEDENT) {
+                level += token.type == TokenType::INDENT ? 1 : -1;
+                if (level < 0 && exitPos == std::string::npos) {
+                    exitPos = at;
+                }
+                continue;
+            }
+            if (token.type != TokenType::CODE) {
+                continue;
+            }
+            if (isTopLevelBoundary(token)) {
+                // Missing `end`: resync here, leaving the DEDENTs of enclosing blocks to their parsers
+                pos = exitPos != std::string::npos ? exitPos : at;
+                break;
+            }
+            std::string error;
+            std::vector<Lexeme> l = lexLine(token.value, token.column, error);
+            if (l.size() == 1 && l[0].text == "end") {
+                if (--depth == 0) {
+                    break;
+                }
+            } else if (kind == "render" && l.size() == 2 && l[0].text == "render" && l[1].text == ":") {
+                depth++;
+            } else if (kind == "struct" && !l.empty()) {
+                if (l.size() < 3 || l[1].text != ":" || l[0].kind != Lexeme::Word) {
+                    report(token.line, token.column, "expected 'field: type' in struct");
+                    continue;
+                }
+                std::string type = l[2].text;
+                for (size_t i = 3; i < l.size(); i++) {
+                    type += l[i].text;
+                }
+                def.fields.push_back(StructField{ l[0].text, type, token.line });
+            }
+        }
+        if (depth != 0) {
+            report(startLine, 0, "'" + kind + "' block is missing 'end'");
+        }
+
+        if (kind == "struct") {
+            program->structs.push_back(def);
+        } else if (kind == "render") {
+            program->renderLines.push_back(startLine);
+        } else {
+            program->asmLines.push_back(startLine);
+        }
+    }
+
+public:
+    /**
+     * Build the AST for a preprocessed token stream
+     */
+    Program build(const std::vector<Token>& input) {
+        Program result;
+        tokens = &input;
+        program = &result;
+        pos = 0;
+        diagnostics.clear();
+        limitReached = false;
+        nesting = 0;
+        blockDepth = 0;
+        parseStatements(result.topLevel, false);
+        tokens = nullptr;
+        program = nullptr;
+        return result;
+    }
+
+    const std::vector<ParseDiagnostic>& getDiagnostics() const {
+        return diagnostics;
+    }
+
+    /**
+     * Stop after `limit` diagnostics (0: no limit)
+     */
+    void setErrorLimit(size_t limit) {
+        errorLimit = limit;
+    }
+
+    bool errorLimitReached() const {
+        return limitReached;
+    }
+};
+
+} // namespace MYA
+
+#endif // MYA_AST_BUILDER_H
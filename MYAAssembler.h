@@ -0,0 +1,1083 @@
+/**
+ * MYA Language - Integrated x86-64 Assembler
+ *
+ * Parses and encodes `asm: ... end` bodies during compilation, writing the
+ * machine code straight into the native backend's NativeObject instead of
+ * round-tripping through an external NASM process.
+ *
+ * Supports:
+ * - Intel syntax as used in MYA examples (`mov rax, 42`, `add eax, ebx`)
+ * - Memory operands `[base + index*scale + disp]` with byte/word/dword/qword sizes
+ * - Local labels, jumps/calls (unresolved targets become REL32 relocations)
+ * - MYA variable binding: a top-level `let` name used as an operand becomes a
+ *   RIP-relative memory reference to that variable's symbol
+ * - Compile-time validation with source line numbers for every diagnostic
+ */
+
+#ifndef MYA_ASSEMBLER_H
+#define MYA_ASSEMBLER_H
+
+#include <cctype>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+#include "MYAIndentationPreprocessor.h"
+#include "MYANativeObject.h"
+
+namespace MYA {
+
+/**
+ * Assembler diagnostic tied to a MYA source line
+ */
+struct AsmDiagnostic {
+    int line;
+    std::string message;
+};
+
+/**
+ * One source line of an asm body
+ */
+struct AsmLine {
+    std::string text;
+    int line;
+};
+
+/**
+ * Body of one `asm: ... end` block
+ */
+struct AsmBlock {
+    int line;
+    std::vector<AsmLine> lines;
+};
+
+/**
+ * Encoded bytes produced by one source line (for listings)
+ */
+struct AsmListingEntry {
+    int line;
+    uint32_t offset;
+    uint32_t size;
+    std::string text;
+};
+
+/**
+ * Collect asm block bodies from the preprocessed token stream
+ */
+inline std::vector<AsmBlock> collectAsmBlocks(const std::vector<Token>& tokens) {
+    std::vector<AsmBlock> blocks;
+    bool inAsm = false;
+    for (const auto& token : tokens) {
+        if (token.type != TokenType::CODE) {
+            continue;
+        }
+        std::string text = token.value.substr(0, token.value.find('$'));
+        size_t start = text.find_first_not_of(" \t\r");
+        size_t end = text.find_last_not_of(" \t\r");
+        text = start == std::string::npos ? "" : text.substr(start, end - start + 1);
+
+        if (!inAsm) {
+            if (text == "asm:") {
+                inAsm = true;
+                blocks.push_back(AsmBlock{ token.line, {} });
+            }
+        } else if (text == "end") {
+            inAsm = false;
+        } else {
+            blocks.back().lines.push_back(AsmLine{ token.value, token.line });
+        }
+    }
+    return blocks;
+}
+
+/**
+ * Assembler - Encodes asm blocks into a NativeObject
+ */
+class Assembler {
+private:
+    struct Operand {
+        enum Kind { Register, Immediate, Memory, Symbol } kind = Immediate;
+        int reg = -1;
+        int bits = 0;  // Register size or explicit memory size (0 = unspecified)
+        int64_t imm = 0;
+        int base = -1;
+        int index = -1;
+        int scale = 1;
+        int64_t disp = 0;
+        bool ripRelative = false;
+        std::string symbol;  // Memory: RIP-relative target; Symbol: branch target
+    };
+
+    struct Fixup {
+        uint32_t field;
+        std::string label;
+        int trailingBytes;
+        int64_t addend;
+    };
+
+    NativeObject& object;
+    std::map<std::string, int> variableBits;  // Bound MYA variables
+    std::vector<AsmDiagnostic> diagnostics;
+    std::vector<AsmListingEntry> listing;
+
+    // Per-block state
+    std::set<std::string> blockLabels;
+    std::map<std::string, uint32_t> labelOffsets;
+    std::vector<Fixup> fixups;
+    bool hasPendingRip = false;
+    uint32_t pendingRipField = 0;
+    std::string pendingRipSymbol;
+    int64_t pendingRipAddend = 0;
+    std::string error;
+
+    std::vector<uint8_t>& code() {
+        return object.getText();
+    }
+
+    void emit(uint8_t byte) {
+        code().push_back(byte);
+    }
+
+    void emitImm(int64_t value, int bytes) {
+        for (int i = 0; i < bytes; i++) {
+            emit(static_cast<uint8_t>(static_cast<uint64_t>(value) >> (i * 8)));
+        }
+    }
+
+    bool fail(const std::string& message) {
+        if (error.empty()) {
+            error = message;
+        }
+        return false;
+    }
+
+    static bool fitsInt8(int64_t v) {
+        return v >= -128 && v <= 127;
+    }
+
+    static bool fitsInt32(int64_t v) {
+        return v >= INT32_MIN && v <= INT32_MAX;
+    }
+
+    static std::string lower(const std::string& text) {
+        std::string result = text;
+        for (auto& c : result) {
+            c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        }
+        return result;
+    }
+
+    static std::string trim(const std::string& text) {
+        size_t start = text.find_first_not_of(" \t\r");
+        if (start == std::string::npos) {
+            return "";
+        }
+        return text.substr(start, text.find_last_not_of(" \t\r") - start + 1);
+    }
+
+    static bool isIdentifier(const std::string& text) {
+        if (text.empty() || !(std::isalpha(static_cast<unsigned char>(text[0])) || text[0] == '_' || text[0] == '.')) {
+            return false;
+        }
+        for (char c : text) {
+            if (!(std::isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '.')) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * Look up a general-purpose register; returns false if `name` is not one
+     */
+    static bool lookupRegister(const std::string& name, int& code, int& bits) {
+        static const char* r64[] = { "rax", "rcx", "rdx", "rbx", "rsp", "rbp", "rsi", "rdi" };
+        static const char* r32[] = { "eax", "ecx", "edx", "ebx", "esp", "ebp", "esi", "edi" };
+        static const char* r16[] = { "ax", "cx", "dx", "bx", "sp", "bp", "si", "di" };
+        static const char* r8[] = { "al", "cl", "dl", "bl", "spl", "bpl", "sil", "dil" };
+        std::string n = lower(name);
+        for (int i = 0; i < 8; i++) {
+            if (n == r64[i]) { code = i; bits = 64; return true; }
+            if (n == r32[i]) { code = i; bits = 32; return true; }
+            if (n == r16[i]) { code = i; bits = 16; return true; }
+            if (n == r8[i]) { code = i; bits = 8; return true; }
+        }
+        if (n.size() >= 2 && n[0] == 'r' && std::isdigit(static_cast<unsigned char>(n[1]))) {
+            size_t pos = 1;
+            int number = 0;
+            while (pos < n.size() && std::isdigit(static_cast<unsigned char>(n[pos]))) {
+                number = number * 10 + (n[pos++] - '0');
+            }
+            std::string suffix = n.substr(pos);
+            if (number < 8 || number > 15) {
+                return false;
+            }
+            code = number;
+            if (suffix.empty()) { bits = 64; return true; }
+            if (suffix == "d") { bits = 32; return true; }
+            if (suffix == "w") { bits = 16; return true; }
+            if (suffix == "b") { bits = 8; return true; }
+        }
+        return false;
+    }
+
+    /**
+     * Parse decimal, 0x-hex, 0b-binary or NASM `h`-suffixed hex numbers
+     */
+    static bool parseNumber(const std::string& text, int64_t& value) {
+        std::string t = lower(trim(text));
+        bool negative = false;
+        if (!t.empty() && (t[0] == '-' || t[0] == '+')) {
+            negative = t[0] == '-';
+            t = trim(t.substr(1));
+        }
+        if (t.empty() || !std::isdigit(static_cast<unsigned char>(t[0]))) {
+            return false;
+        }
+        int base = 10;
+        if (t.size() > 2 && t[0] == '0' && t[1] == 'x') {
+            base = 16;
+            t = t.substr(2);
+        } else if (t.size() > 2 && t[0] == '0' && t[1] == 'b') {
+            base = 2;
+            t = t.substr(2);
+        } else if (t.back() == 'h') {
+            base = 16;
+            t.pop_back();
+        }
+        char* end = nullptr;
+        unsigned long long magnitude = std::strtoull(t.c_str(), &end, base);
+        if (t.empty() || *end != '\0') {
+            return false;
+        }
+        value = negative ? -static_cast<int64_t>(magnitude) : static_cast<int64_t>(magnitude);
+        return true;
+    }
+
+    /**
+     * Parse the inside of `[ ... ]`
+     */
+    bool parseMemory(const std::string& inner, Operand& op) {
+        op.kind = Operand::Memory;
+        std::string text = trim(inner);
+        if (lower(text).compare(0, 4, "rel ") == 0) {
+            text = trim(text.substr(4));
+        }
+
+        size_t pos = 0;
+        bool negate = false;
+        while (pos <= text.size()) {
+            size_t next = text.find_first_of("+-", pos);
+            std::string term = trim(text.substr(pos, next == std::string::npos ? std::string::npos : next - pos));
+            if (term.empty()) {
+                if (next == std::string::npos) {
+                    return fail("empty term in memory operand");
+                }
+            } else {
+                int code, bits;
+                size_t star = term.find('*');
+                int64_t number;
+                if (star != std::string::npos) {
+                    std::string left = trim(term.substr(0, star));
+                    std::string right = trim(term.substr(star + 1));
+                    int64_t scale;
+                    if (!parseNumber(right, scale)) {
+                        std::swap(left, right);
+                    }
+                    if (!parseNumber(right, scale) || !lookupRegister(left, code, bits) || bits != 64 || negate) {
+                        return fail("invalid scaled index '" + term + "'");
+                    }
+                    if (scale != 1 && scale != 2 && scale != 4 && scale != 8) {
+                        return fail("scale must be 1, 2, 4 or 8");
+                    }
+                    if (op.index >= 0 || code == 4) {
+                        return fail("invalid index register in '" + term + "'");
+                    }
+                    op.index = code;
+                    op.scale = static_cast<int>(scale);
+                } else if (lower(term) == "rip" && !negate) {
+                    op.ripRelative = true;
+                } else if (lookupRegister(term, code, bits)) {
+                    if (bits != 64 || negate) {
+                        return fail("address registers must be 64-bit: '" + term + "'");
+                    }
+                    if (op.base < 0) {
+                        op.base = code;
+                    } else if (op.index < 0 && code != 4) {
+                        op.index = code;
+                    } else {
+                        return fail("too many registers in memory operand");
+                    }
+                } else if (parseNumber(term, number)) {
+                    op.disp += negate ? -number : number;
+                } else if (isIdentifier(term) && !negate) {
+                    if (!op.symbol.empty()) {
+                        return fail("memory operand references two symbols");
+                    }
+                    auto var = variableBits.find(term);
+                    if (var != variableBits.end()) {
+                        if (op.bits == 0) {
+                            op.bits = var->second;
+                        }
+                    } else if (blockLabels.count(term) == 0) {
+                        return fail("unknown symbol '" + term + "' (not a register, label or MYA variable)");
+                    }
+                    op.symbol = term;
+                } else {
+                    return fail("invalid memory operand term '" + term + "'");
+                }
+            }
+            if (next == std::string::npos) {
+                break;
+            }
+            negate = text[next] == '-';
+            pos = next + 1;
+        }
+
+        if (!op.symbol.empty()) {
+            op.ripRelative = true;
+        }
+        if (op.ripRelative && (op.base >= 0 || op.index >= 0)) {
+            return fail("RIP-relative symbol cannot be combined with registers");
+        }
+        if (!fitsInt32(op.disp)) {
+            return fail("displacement out of 32-bit range");
+        }
+        return true;
+    }
+
+    bool parseOperand(const std::string& raw, Operand& op) {
+        std::string text = trim(raw);
+        std::string lowered = lower(text);
+
+        static const struct { const char* name; int bits; } sizes[] = {
+            { "byte", 8 }, { "word", 16 }, { "dword", 32 }, { "qword", 64 }
+        };
+        for (const auto& size : sizes) {
+            size_t n = std::strlen(size.name);
+            if (lowered.compare(0, n, size.name) == 0 && lowered.size() > n &&
+                (lowered[n] == ' ' || lowered[n] == '[')) {
+                op.bits = size.bits;
+                text = trim(text.substr(n));
+                lowered = lower(text);
+                if (lowered.compare(0, 4, "ptr ") == 0 || lowered.compare(0, 4, "ptr[") == 0) {
+                    text = trim(text.substr(3));
+                }
+                if (text.empty() || text[0] != '[') {
+                    return fail("size specifier must precede a memory operand");
+                }
+                break;
+            }
+        }
+
+        if (!text.empty() && text[0] == '[') {
+            if (text.back() != ']') {
+                return fail("missing ']' in '" + raw + "'");
+            }
+            return parseMemory(text.substr(1, text.size() - 2), op);
+        }
+
+        int code, bits;
+        if (lookupRegister(text, code, bits)) {
+            op.kind = Operand::Register;
+            op.reg = code;
+            op.bits = bits;
+            return true;
+        }
+        if (parseNumber(text, op.imm)) {
+            op.kind = Operand::Immediate;
+            return true;
+        }
+        if (isIdentifier(text)) {
+            auto var = variableBits.find(text);
+            if (var != variableBits.end()) {
+                // Bare MYA variable: memory operand at the variable's address
+                op.kind = Operand::Memory;
+                op.bits = var->second;
+                op.ripRelative = true;
+                op.symbol = text;
+                return true;
+            }
+            op.kind = Operand::Symbol;
+            op.symbol = text;
+            return true;
+        }
+        return fail("invalid operand '" + raw + "'");
+    }
+
+    static bool isByteRexRegister(const Operand& op) {
+        return op.kind == Operand::Register && op.bits == 8 && op.reg >= 4 && op.reg < 8;
+    }
+
+    /**
+     * Emit operand-size prefix and REX for an instruction with a ModRM byte
+     */
+    void emitPrefixes(int opBits, int regField, const Operand* rm, bool regIsByteRex = false) {
+        if (opBits == 16) {
+            emit(0x66);
+        }
+        uint8_t rex = 0x40;
+        if (opBits == 64) rex |= 0x08;
+        if (regField >= 8) rex |= 0x04;
+        if (rm && rm->kind == Operand::Memory) {
+            if (rm->index >= 8) rex |= 0x02;
+            if (rm->base >= 8) rex |= 0x01;
+        } else if (rm && rm->kind == Operand::Register && rm->reg >= 8) {
+            rex |= 0x01;
+        }
+        if (rex != 0x40 || regIsByteRex || (rm && isByteRexRegister(*rm))) {
+            emit(rex);
+        }
+    }
+
+    void emitModRM(int regField, const Operand& rm) {
+        uint8_t reg = static_cast<uint8_t>((regField & 7) << 3);
+        if (rm.kind == Operand::Register) {
+            emit(static_cast<uint8_t>(0xC0 | reg | (rm.reg & 7)));
+            return;
+        }
+
+        if (rm.ripRelative && rm.symbol.empty()) {
+            emit(static_cast<uint8_t>(0x05 | reg));
+            emitImm(rm.disp, 4);
+            return;
+        }
+
+        if (rm.ripRelative) {
+            // RIP-relative symbol; the displacement is resolved when the instruction ends
+            emit(static_cast<uint8_t>(0x05 | reg));
+            hasPendingRip = true;
+            pendingRipField = static_cast<uint32_t>(code().size());
+            pendingRipSymbol = rm.symbol;
+            pendingRipAddend = rm.disp;
+            emitImm(0, 4);
+            return;
+        }
+
+        if (rm.base < 0 && rm.index < 0) {
+            emit(static_cast<uint8_t>(0x04 | reg));
+            emit(0x25);
+            emitImm(rm.disp, 4);
+            return;
+        }
+
+        bool sib = rm.index >= 0 || rm.base < 0 || (rm.base & 7) == 4;
+        int mod;
+        if (rm.base < 0) {
+            mod = 0;
+        } else if (rm.disp == 0 && (rm.base & 7) != 5) {
+            mod = 0;
+        } else if (fitsInt8(rm.disp)) {
+            mod = 1;
+        } else {
+            mod = 2;
+        }
+        emit(static_cast<uint8_t>((mod << 6) | reg | (sib ? 4 : (rm.base & 7))));
+        if (sib) {
+            int scaleBits = rm.scale == 8 ? 3 : rm.scale == 4 ? 2 : rm.scale == 2 ? 1 : 0;
+            int index = rm.index < 0 ? 4 : (rm.index & 7);
+            int base = rm.base < 0 ? 5 : (rm.base & 7);
+            emit(static_cast<uint8_t>((scaleBits << 6) | (index << 3) | base));
+        }
+        if (rm.base < 0 || mod == 2) {
+            emitImm(rm.disp, 4);
+        } else if (mod == 1) {
+            emitImm(rm.disp, 1);
+        }
+    }
+
+    /**
+     * Resolve a RIP-relative reference once all trailing bytes are known
+     */
+    void finishInstruction() {
+        if (!hasPendingRip) {
+            return;
+        }
+        hasPendingRip = false;
+        int trailing = static_cast<int>(code().size() - (pendingRipField + 4));
+        if (blockLabels.count(pendingRipSymbol)) {
+            fixups.push_back(Fixup{ pendingRipField, pendingRipSymbol, trailing, pendingRipAddend });
+        } else {
+            for (int i = 0; i < 4; i++) {
+                code()[pendingRipField + i] = static_cast<uint8_t>(static_cast<uint64_t>(pendingRipAddend) >> (i * 8));
+            }
+            object.addRelocation(pendingRipField, pendingRipSymbol, trailing);
+        }
+    }
+
+    /**
+     * Determine the operation size of a two-operand instruction
+     */
+    bool operandSize(const Operand& a, const Operand& b, int& bits) {
+        bool aSized = a.kind == Operand::Register || (a.kind == Operand::Memory && a.bits);
+        bool bSized = b.kind == Operand::Register || (b.kind == Operand::Memory && b.bits);
+        if (aSized && bSized && a.bits != b.bits) {
+            return fail("operand size mismatch");
+        }
+        bits = aSized ? a.bits : bSized ? b.bits : 0;
+        if (bits == 0) {
+            return fail("operand size not specified (use byte/word/dword/qword)");
+        }
+        return true;
+    }
+
+    bool isRM(const Operand& op) const {
+        return op.kind == Operand::Register || op.kind == Operand::Memory;
+    }
+
+    /**
+     * Encode `opcode /ext` with an immediate of the operation size (imm32 max)
+     */
+    bool encodeImmediate(const Operand& imm, int bits) {
+        int bytes = bits == 8 ? 1 : bits == 16 ? 2 : 4;
+        int64_t v = imm.imm;
+        bool fits = bytes == 1 ? (v >= -128 && v <= 255)
+                  : bytes == 2 ? (v >= -32768 && v <= 65535)
+                  : bits == 64 ? fitsInt32(v) : (v >= INT32_MIN && v <= static_cast<int64_t>(UINT32_MAX));
+        if (!fits) {
+            return fail("immediate out of range for " + std::to_string(bits) + "-bit operand");
+        }
+        emitImm(v, bytes);
+        return true;
+    }
+
+    /**
+     * Emit a near (rel32) branch; targets outside the block become relocations
+     */
+    bool encodeBranch(const uint8_t* opcode, int length, const Operand& target) {
+        for (int i = 0; i < length; i++) {
+            emit(opcode[i]);
+        }
+        uint32_t field = static_cast<uint32_t>(code().size());
+        emitImm(0, 4);
+        if (blockLabels.count(target.symbol)) {
+            fixups.push_back(Fixup{ field, target.symbol, 0, 0 });
+        } else {
+            object.addRelocation(field, target.symbol, 0);
+        }
+        return true;
+    }
+
+    static int conditionCode(const std::string& cc) {
+        static const std::map<std::string, int> codes = {
+            { "o", 0 }, { "no", 1 }, { "b", 2 }, { "c", 2 }, { "nae", 2 }, { "ae", 3 }, { "nb", 3 }, { "nc", 3 },
+            { "e", 4 }, { "z", 4 }, { "ne", 5 }, { "nz", 5 }, { "be", 6 }, { "na", 6 }, { "a", 7 }, { "nbe", 7 },
+            { "s", 8 }, { "ns", 9 }, { "p", 10 }, { "pe", 10 }, { "np", 11 }, { "po", 11 },
+            { "l", 12 }, { "nge", 12 }, { "ge", 13 }, { "nl", 13 }, { "le", 14 }, { "ng", 14 }, { "g", 15 }, { "nle", 15 }
+        };
+        auto it = codes.find(cc);
+        return it == codes.end() ? -1 : it->second;
+    }
+
+    /**
+     * Encode one instruction; returns false (with `error` set) if invalid
+     */
+    bool encode(const std::string& mnemonic, std::vector<Operand>& ops) {
+        size_t n = ops.size();
+
+        // No-operand instructions
+        static const std::map<std::string, std::vector<uint8_t>> fixed = {
+            { "ret", { 0xC3 } }, { "nop", { 0x90 } }, { "int3", { 0xCC } }, { "syscall", { 0x0F, 0x05 } },
+            { "leave", { 0xC9 } }, { "hlt", { 0xF4 } }, { "cqo", { 0x48, 0x99 } }, { "cdq", { 0x99 } },
+            { "cdqe", { 0x48, 0x98 } }
+        };
+        auto f = fixed.find(mnemonic);
+        if (f != fixed.end() && n == 0) {
+            for (uint8_t b : f->second) {
+                emit(b);
+            }
+            return true;
+        }
+        if (mnemonic == "ret" && n == 1 && ops[0].kind == Operand::Immediate) {
+            emit(0xC2);
+            return encodeImmediate(ops[0], 16);
+        }
+        if (mnemonic == "int" && n == 1 && ops[0].kind == Operand::Immediate) {
+            emit(0xCD);
+            return encodeImmediate(ops[0], 8);
+        }
+
+        // Two-operand ALU group
+        static const std::map<std::string, int> alu = {
+            { "add", 0 }, { "or", 1 }, { "adc", 2 }, { "sbb", 3 }, { "and", 4 }, { "sub", 5 }, { "xor", 6 }, { "cmp", 7 }
+        };
+        auto a = alu.find(mnemonic);
+        if (a != alu.end()) {
+            if (n != 2) return fail(mnemonic + " expects 2 operands");
+            int ext = a->second, bits;
+            Operand& dst = ops[0];
+            Operand& src = ops[1];
+            if (!isRM(dst)) return fail("invalid destination operand for " + mnemonic);
+            if (src.kind == Operand::Register || (src.kind == Operand::Memory && dst.kind == Operand::Register)) {
+                if (!operandSize(dst, src, bits)) return false;
+                bool toReg = src.kind == Operand::Memory;
+                const Operand& reg = toReg ? dst : src;
+                const Operand& rm = toReg ? src : dst;
+                emitPrefixes(bits, reg.reg, &rm, isByteRexRegister(reg));
+                emit(static_cast<uint8_t>(ext * 8 + (toReg ? 2 : 0) + (bits == 8 ? 0 : 1)));
+                emitModRM(reg.reg, rm);
+                return true;
+            }
+            if (src.kind == Operand::Immediate) {
+                if (!operandSize(dst, dst, bits)) return false;
+                emitPrefixes(bits, 0, &dst);
+                if (bits == 8) {
+                    emit(0x80);
+                    emitModRM(ext, dst);
+                    return encodeImmediate(src, 8);
+                }
+                bool shortImm = fitsInt8(src.imm);
+                emit(shortImm ? 0x83 : 0x81);
+                emitModRM(ext, dst);
+                return shortImm ? (emitImm(src.imm, 1), true) : encodeImmediate(src, bits);
+            }
+            return fail("invalid operand combination for " + mnemonic);
+        }
+
+        if (mnemonic == "mov") {
+            if (n != 2) return fail("mov expects 2 operands");
+            Operand& dst = ops[0];
+            Operand& src = ops[1];
+            int bits;
+            if (!isRM(dst)) return fail("invalid destination operand for mov");
+            if (src.kind == Operand::Register || (src.kind == Operand::Memory && dst.kind == Operand::Register)) {
+                if (!operandSize(dst, src, bits)) return false;
+                bool toReg = src.kind == Operand::Memory;
+                const Operand& reg = toReg ? dst : src;
+                const Operand& rm = toReg ? src : dst;
+                emitPrefixes(bits, reg.reg, &rm, isByteRexRegister(reg));
+                emit(static_cast<uint8_t>((toReg ? 0x8A : 0x88) + (bits == 8 ? 0 : 1)));
+                emitModRM(reg.reg, rm);
+                return true;
+            }
+            if (src.kind == Operand::Immediate) {
+                if (!operandSize(dst, dst, bits)) return false;
+                if (dst.kind == Operand::Register) {
+                    if (bits == 64 && !fitsInt32(src.imm)) {
+                        if (src.imm >= 0 && src.imm <= static_cast<int64_t>(UINT32_MAX)) {
+                            bits = 32;  // mov r32, imm32 zero-extends
+                        } else {
+                            emitPrefixes(64, 0, &dst);
+                            emit(static_cast<uint8_t>(0xB8 + (dst.reg & 7)));
+                            emitImm(src.imm, 8);
+                            return true;
+                        }
+                    } else if (bits == 64) {
+                        emitPrefixes(64, 0, &dst);
+                        emit(0xC7);
+                        emitModRM(0, dst);
+                        return encodeImmediate(src, 64);
+                    }
+                    emitPrefixes(bits, 0, &dst);
+                    emit(static_cast<uint8_t>((bits == 8 ? 0xB0 : 0xB8) + (dst.reg & 7)));
+                    return encodeImmediate(src, bits);
+                }
+                emitPrefixes(bits, 0, &dst);
+                emit(bits == 8 ? 0xC6 : 0xC7);
+                emitModRM(0, dst);
+                return encodeImmediate(src, bits);
+            }
+            return fail("invalid operand combination for mov");
+        }
+
+        if (mnemonic == "test" || mnemonic == "xchg") {
+            if (n != 2 || !isRM(ops[0])) return fail(mnemonic + " expects r/m and register or immediate");
+            int bits;
+            bool isTest = mnemonic == "test";
+            if (ops[1].kind == Operand::Immediate && isTest) {
+                if (!operandSize(ops[0], ops[0], bits)) return false;
+                emitPrefixes(bits, 0, &ops[0]);
+                emit(bits == 8 ? 0xF6 : 0xF7);
+                emitModRM(0, ops[0]);
+                return encodeImmediate(ops[1], bits);
+            }
+            const Operand* reg = ops[1].kind == Operand::Register ? &ops[1] : ops[0].kind == Operand::Register ? &ops[0] : nullptr;
+            const Operand* rm = reg == &ops[1] ? &ops[0] : &ops[1];
+            if (!reg || !isRM(*rm)) return fail("invalid operand combination for " + mnemonic);
+            if (!operandSize(ops[0], ops[1], bits)) return false;
+            emitPrefixes(bits, reg->reg, rm, isByteRexRegister(*reg));
+            emit(static_cast<uint8_t>((isTest ? 0x84 : 0x86) + (bits == 8 ? 0 : 1)));
+            emitModRM(reg->reg, *rm);
+            return true;
+        }
+
+        // Unary group (F6/F7 and FE/FF)
+        static const std::map<std::string, int> unary = {
+            { "not", 2 }, { "neg", 3 }, { "mul", 4 }, { "div", 6 }, { "idiv", 7 }, { "inc", 0x10 }, { "dec", 0x11 }
+        };
+        auto u = unary.find(mnemonic);
+        if (u != unary.end() || (mnemonic == "imul" && n == 1)) {
+            if (n != 1 || !isRM(ops[0])) return fail(mnemonic + " expects one register or memory operand");
+            int ext = u != unary.end() ? u->second : 5;
+            int bits;
+            if (!operandSize(ops[0], ops[0], bits)) return false;
+            emitPrefixes(bits, 0, &ops[0]);
+            if (ext >= 0x10) {
+                emit(bits == 8 ? 0xFE : 0xFF);
+                emitModRM(ext & 1, ops[0]);
+            } else {
+                emit(bits == 8 ? 0xF6 : 0xF7);
+                emitModRM(ext, ops[0]);
+            }
+            return true;
+        }
+
+        if (mnemonic == "imul") {
+            if ((n != 2 && n != 3) || ops[0].kind != Operand::Register) return fail("imul expects a register destination");
+            Operand& dst = ops[0];
+            bool immForm = ops[n - 1].kind == Operand::Immediate;
+            const Operand& src = (n == 2 && immForm) ? dst : ops[1];
+            int bits;
+            if (!isRM(src) || !operandSize(dst, src, bits)) return fail("invalid operands for imul");
+            if (bits == 8) return fail("imul has no 8-bit two-operand form");
+            emitPrefixes(bits, dst.reg, &src);
+            if (!immForm) {
+                if (n == 3) return fail("third imul operand must be an immediate");
+                emit(0x0F);
+                emit(0xAF);
+                emitModRM(dst.reg, src);
+                return true;
+            }
+            bool shortImm = fitsInt8(ops[n - 1].imm);
+            emit(shortImm ? 0x6B : 0x69);
+            emitModRM(dst.reg, src);
+            return shortImm ? (emitImm(ops[n - 1].imm, 1), true) : encodeImmediate(ops[n - 1], bits);
+        }
+
+        if (mnemonic == "lea") {
+            if (n != 2 || ops[0].kind != Operand::Register || ops[1].kind != Operand::Memory || ops[0].bits == 8) {
+                return fail("lea expects a register and a memory operand");
+            }
+            emitPrefixes(ops[0].bits, ops[0].reg, &ops[1]);
+            emit(0x8D);
+            emitModRM(ops[0].reg, ops[1]);
+            return true;
+        }
+
+        if (mnemonic == "push" || mnemonic == "pop") {
+            bool push = mnemonic == "push";
+            if (n != 1) return fail(mnemonic + " expects 1 operand");
+            Operand& op = ops[0];
+            if (op.kind == Operand::Register) {
+                if (op.bits != 64 && op.bits != 16) return fail(mnemonic + " needs a 64-bit or 16-bit register");
+                if (op.bits == 16) emit(0x66);
+                if (op.reg >= 8) emit(0x41);
+                emit(static_cast<uint8_t>((push ? 0x50 : 0x58) + (op.reg & 7)));
+                return true;
+            }
+            if (op.kind == Operand::Immediate && push) {
+                if (fitsInt8(op.imm)) {
+                    emit(0x6A);
+                    emitImm(op.imm, 1);
+                    return true;
+                }
+                emit(0x68);
+                return encodeImmediate(op, 64);
+            }
+            if (op.kind == Operand::Memory) {
+                if (op.bits != 0 && op.bits != 64) return fail(mnemonic + " memory operand must be qword");
+                emitPrefixes(32, 0, &op);
+                emit(push ? 0xFF : 0x8F);
+                emitModRM(push ? 6 : 0, op);
+                return true;
+            }
+            return fail("invalid operand for " + mnemonic);
+        }
+
+        // Shifts and rotates
+        static const std::map<std::string, int> shifts = {
+            { "rol", 0 }, { "ror", 1 }, { "rcl", 2 }, { "rcr", 3 }, { "shl", 4 }, { "sal", 4 }, { "shr", 5 }, { "sar", 7 }
+        };
+        auto s = shifts.find(mnemonic);
+        if (s != shifts.end()) {
+            if (n != 2 || !isRM(ops[0])) return fail(mnemonic + " expects r/m and count");
+            int bits;
+            if (!operandSize(ops[0], ops[0], bits)) return false;
+            bool byCl = ops[1].kind == Operand::Register && ops[1].reg == 1 && ops[1].bits == 8;
+            if (!byCl && ops[1].kind != Operand::Immediate) return fail("shift count must be an immediate or cl");
+            if (!byCl && (ops[1].imm < 0 || ops[1].imm > 63)) return fail("shift count out of range");
+            emitPrefixes(bits, 0, &ops[0]);
+            uint8_t base = byCl ? 0xD2 : (ops[1].imm == 1 ? 0xD0 : 0xC0);
+            emit(static_cast<uint8_t>(base + (bits == 8 ? 0 : 1)));
+            emitModRM(s->second, ops[0]);
+            if (!byCl && ops[1].imm != 1) {
+                emitImm(ops[1].imm, 1);
+            }
+            return true;
+        }
+
+        if (mnemonic == "movzx" || mnemonic == "movsx" || mnemonic == "movsxd") {
+            if (n != 2 || ops[0].kind != Operand::Register || !isRM(ops[1])) return fail(mnemonic + " expects register, r/m");
+            int srcBits = ops[1].bits;
+            if (srcBits == 0) return fail("operand size not specified (use byte/word/dword)");
+            if (mnemonic == "movsxd") {
+                if (ops[0].bits != 64 || srcBits != 32) return fail("movsxd expects r64, r/m32");
+                emitPrefixes(64, ops[0].reg, &ops[1]);
+                emit(0x63);
+            } else {
+                if (srcBits > 16 || ops[0].bits <= srcBits) return fail(mnemonic + " source must be narrower byte/word");
+                emitPrefixes(ops[0].bits, ops[0].reg, &ops[1]);
+                emit(0x0F);
+                emit(static_cast<uint8_t>((mnemonic == "movzx" ? 0xB6 : 0xBE) + (srcBits == 16 ? 1 : 0)));
+            }
+            emitModRM(ops[0].reg, ops[1]);
+            return true;
+        }
+
+        if (mnemonic == "jmp" || mnemonic == "call") {
+            if (n != 1) return fail(mnemonic + " expects 1 operand");
+            bool jmp = mnemonic == "jmp";
+            if (ops[0].kind == Operand::Symbol) {
+                uint8_t op = jmp ? 0xE9 : 0xE8;
+                return encodeBranch(&op, 1, ops[0]);
+            }
+            if ((ops[0].kind == Operand::Register && ops[0].bits == 64) || ops[0].kind == Operand::Memory) {
+                emitPrefixes(32, 0, &ops[0]);
+                emit(0xFF);
+                emitModRM(jmp ? 4 : 2, ops[0]);
+                return true;
+            }
+            return fail("invalid target for " + mnemonic);
+        }
+
+        if (mnemonic.size() > 1 && mnemonic[0] == 'j') {
+            int cc = conditionCode(mnemonic.substr(1));
+            if (cc >= 0) {
+                if (n != 1 || ops[0].kind != Operand::Symbol) return fail(mnemonic + " expects a label");
+                uint8_t op[2] = { 0x0F, static_cast<uint8_t>(0x80 + cc) };
+                return encodeBranch(op, 2, ops[0]);
+            }
+        }
+
+        if (mnemonic.compare(0, 3, "set") == 0 && conditionCode(mnemonic.substr(3)) >= 0) {
+            if (n != 1 || !isRM(ops[0]) || (ops[0].bits != 8 && ops[0].bits != 0)) return fail(mnemonic + " expects an 8-bit operand");
+            emitPrefixes(8, 0, &ops[0]);
+            emit(0x0F);
+            emit(static_cast<uint8_t>(0x90 + conditionCode(mnemonic.substr(3))));
+            emitModRM(0, ops[0]);
+            return true;
+        }
+
+        if (mnemonic.compare(0, 4, "cmov") == 0 && conditionCode(mnemonic.substr(4)) >= 0) {
+            int bits;
+            if (n != 2 || ops[0].kind != Operand::Register || !isRM(ops[1])) return fail(mnemonic + " expects register, r/m");
+            if (!operandSize(ops[0], ops[1], bits)) return false;
+            if (bits == 8) return fail(mnemonic + " has no 8-bit form");
+            emitPrefixes(bits, ops[0].reg, &ops[1]);
+            emit(0x0F);
+            emit(static_cast<uint8_t>(0x40 + conditionCode(mnemonic.substr(4))));
+            emitModRM(ops[0].reg, ops[1]);
+            return true;
+        }
+
+        if (f != fixed.end()) {
+            return fail(mnemonic + " takes no operands");
+        }
+        return fail("unknown instruction '" + mnemonic + "'");
+    }
+
+    /**
+     * Split operands at top-level commas
+     */
+    static std::vector<std::string> splitOperands(const std::string& text) {
+        std::vector<std::string> parts;
+        int depth = 0;
+        size_t start = 0;
+        for (size_t i = 0; i < text.size(); i++) {
+            if (text[i] == '[') depth++;
+            else if (text[i] == ']') depth--;
+            else if (text[i] == ',' && depth == 0) {
+                parts.push_back(text.substr(start, i - start));
+                start = i + 1;
+            }
+        }
+        if (!trim(text).empty()) {
+            parts.push_back(text.substr(start));
+        }
+        return parts;
+    }
+
+    /**
+     * Strip `$` (MYA) and `;` (NASM) comments
+     */
+    static std::string stripComment(const std::string& text) {
+        size_t pos = text.find_first_of("$;");
+        return pos == std::string::npos ? text : text.substr(0, pos);
+    }
+
+    /**
+     * Split off a leading `label:`; returns the label name or ""
+     */
+    static std::string takeLabel(std::string& text) {
+        size_t colon = text.find(':');
+        if (colon == std::string::npos) {
+            return "";
+        }
+        std::string label = trim(text.substr(0, colon));
+        if (!isIdentifier(label)) {
+            return "";
+        }
+        text = text.substr(colon + 1);
+        return label;
+    }
+
+public:
+    explicit Assembler(NativeObject& object) : object(object) {}
+
+    /**
+     * Bind a MYA variable so asm operands can refer to it by name
+     */
+    void bindVariable(const std::string& name, int bits) {
+        variableBits[name] = bits;
+    }
+
+    /**
+     * Bind every top-level `let` declaration in the token stream.
+     * `int`/`float` bind as qword, `bool` as byte, reference types as
+     * qword pointers.
+     */
+    void bindProgramVariables(const std::vector<Token>& tokens) {
+        for (const auto& token : tokens) {
+            if (token.type != TokenType::CODE || token.column != 0 || token.value.compare(0, 4, "let ") != 0) {
+                continue;
+            }
+            size_t colon = token.value.find(':');
+            if (colon == std::string::npos) {
+                continue;
+            }
+            std::string name = trim(token.value.substr(4, colon - 4));
+            std::string type = trim(token.value.substr(colon + 1));
+            type = trim(type.substr(0, type.find('=')));
+            if (isIdentifier(name)) {
+                bindVariable(name, type == "bool" ? 8 : 64);
+            }
+        }
+    }
+
+    /**
+     * Assemble one block into `.text` under a global symbol.
+     * Returns false if any line failed; valid lines are still encoded so all
+     * errors in the block are reported in one pass.
+     */
+    bool assembleBlock(const AsmBlock& block, const std::string& symbolName) {
+        blockLabels.clear();
+        labelOffsets.clear();
+        fixups.clear();
+        size_t errorsBefore = diagnostics.size();
+        std::map<std::string, int> labelLines;
+
+        // Pre-pass: collect labels so forward references resolve as labels
+        for (const auto& line : block.lines) {
+            std::string text = stripComment(line.text);
+            std::string label = takeLabel(text);
+            if (!label.empty()) {
+                if (labelLines.count(label)) {
+                    diagnostics.push_back(AsmDiagnostic{ line.line, "duplicate label '" + label + "'" });
+                }
+                labelLines[label] = line.line;
+                blockLabels.insert(label);
+            }
+        }
+
+        object.defineSymbol(symbolName, static_cast<uint32_t>(code().size()));
+
+        for (const auto& line : block.lines) {
+            std::string text = stripComment(line.text);
+            std::string label = takeLabel(text);
+            if (!label.empty()) {
+                labelOffsets[label] = static_cast<uint32_t>(code().size());
+            }
+            text = trim(text);
+            if (text.empty()) {
+                continue;
+            }
+
+            size_t space = text.find_first_of(" \t");
+            std::string mnemonic = lower(text.substr(0, space));
+            std::string operandText = space == std::string::npos ? "" : text.substr(space + 1);
+
+            size_t start = code().size();
+            size_t fixupsBefore = fixups.size();
+            error.clear();
+            hasPendingRip = false;
+
+            std::vector<Operand> ops;
+            bool ok = true;
+            for (const auto& part : splitOperands(operandText)) {
+                Operand op;
+                if (!parseOperand(part, op)) {
+                    ok = false;
+                    break;
+                }
+                ops.push_back(op);
+            }
+            ok = ok && encode(mnemonic, ops);
+            if (ok) {
+                finishInstruction();
+            }
+
+            if (!ok) {
+                diagnostics.push_back(AsmDiagnostic{ line.line, error });
+                code().resize(start);
+                fixups.resize(fixupsBefore);
+                continue;
+            }
+            listing.push_back(AsmListingEntry{ line.line, static_cast<uint32_t>(start),
+                                               static_cast<uint32_t>(code().size() - start), text });
+        }
+
+        for (const auto& fixup : fixups) {
+            int64_t target = static_cast<int64_t>(labelOffsets[fixup.label]) + fixup.addend;
+            int64_t rel = target - (static_cast<int64_t>(fixup.field) + 4 + fixup.trailingBytes);
+            for (int i = 0; i < 4; i++) {
+                code()[fixup.field + i] = static_cast<uint8_t>(static_cast<uint64_t>(rel) >> (i * 8));
+            }
+        }
+        return diagnostics.size() == errorsBefore;
+    }
+
+    /**
+     * Assemble all blocks as `__mya_asm_<n>`
+     */
+    bool assembleAll(const std::vector<AsmBlock>& blocks) {
+        bool ok = true;
+        for (size_t i = 0; i < blocks.size(); i++) {
+            ok = assembleBlock(blocks[i], "__mya_asm_" + std::to_string(i)) && ok;
+        }
+        return ok;
+    }
+
+    const std::vector<AsmDiagnostic>& getDiagnostics() const {
+        return diagnostics;
+    }
+
+    /**
+     * Print the encoded bytes next to each source line
+     */
+    void printListing() const {
+        std::cout << "\n=== Assembler Listing ===" << std::endl;
+        const auto& text = object.getText();
+        for (const auto& entry : listing) {
+            std::cout << "Line " << std::setw(4) << entry.line << "  " << std::hex << std::setfill('0')
+                      << std::setw(4) << entry.offset << ": ";
+            std::string bytes;
+            for (uint32_t i = 0; i < entry.size; i++) {
+                static const char* hex = "0123456789ABCDEF";
+                bytes += hex[text[entry.offset + i] >> 4];
+                bytes += hex[text[entry.offset + i] & 0xF];
+                bytes += ' ';
+            }
+            std::cout << std::dec << std::setfill(' ') << std::left << std::setw(33) << bytes
+                      << std::right << entry.text << std::endl;
+        }
+    }
+};
+
+} // namespace MYA
+
+#endif // MYA_ASSEMBLER_H
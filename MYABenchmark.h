@@ -0,0 +1,72 @@
+/**
+ * MYA Language - Benchmark Support
+ *
+ * Minimal timing helpers shared by the compiler's built-in benchmarks
+ * (`MYACompiler.exe --bench <name> [count]`). Benchmarks live next to the
+ * component they measure; this header only provides the clock and the
+ * common report format so results from different components line up.
+ */
+
+#ifndef MYA_BENCHMARK_H
+#define MYA_BENCHMARK_H
+
+#include <chrono>
+#include <cstddef>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+namespace MYA {
+
+/**
+ * Monotonic stopwatch measuring elapsed wall time in seconds
+ */
+class Stopwatch {
+private:
+    std::chrono::steady_clock::time_point start;
+
+public:
+    Stopwatch() : start(std::chrono::steady_clock::now()) {}
+
+    void reset() {
+        start = std::chrono::steady_clock::now();
+    }
+
+    double elapsedSeconds() const {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+};
+
+/**
+ * Print one benchmark result line:
+ *   name                          12.345 ms   81.0 M items/s
+ */
+inline void reportBenchmark(const std::string& name, double seconds, std::size_t items) {
+    double rate = seconds > 0.0 ? static_cast<double>(items) / seconds / 1e6 : 0.0;
+    std::cout << "  " << std::left << std::setw(36) << name << std::right
+              << std::fixed << std::setprecision(3) << std::setw(10) << seconds * 1e3 << " ms"
+              << std::setprecision(1) << std::setw(10) << rate << " M items/s" << std::endl;
+    std::cout.unsetf(std::ios::floatfield);
+}
+
+/**
+ * Run `body` `repeats` times and return the fastest run in seconds.
+ * Taking the minimum filters out scheduler noise on short kernels.
+ */
+template <typename Body>
+double bestOf(int repeats, Body body) {
+    double best = 0.0;
+    for (int i = 0; i < repeats; i++) {
+        Stopwatch watch;
+        body();
+        double elapsed = watch.elapsedSeconds();
+        if (i == 0 || elapsed < best) {
+            best = elapsed;
+        }
+    }
+    return best;
+}
+
+} // namespace MYA
+
+#endif // MYA_BENCHMARK_H
@@ -0,0 +1,2348 @@
+/**
+ * MYA Language - C++ Code Generator
+ *
+ * Type checks the AST and emits a self-contained C++ translation unit that
+ * includes only the MYA runtime headers (MYARuntime.h, MYARuntimeSimd.h).
+ * This is the executable backend until the WASM -> NASM -> PE pipeline exists.
+ *
+ * - Functions become `mya_<name>`; Main runs after top-level statements
+ * - Lists have value semantics: list/str/struct parameters that a function
+ *   never modifies are passed by const reference, others by value
+ * - Structs are emitted with fields in the packed order computed by
+ *   StructLayoutEngine; constructors take fields in declaration order
+ * - Loops carrying a VectorLoopPlan get SSE2/AVX2 kernels with a runtime
+ *   CPU check, a hoisted bounds check and the scalar loop as epilogue
+ * - `filter cond pass:` lowers to `if (MYA_UNLIKELY(cond))` with the pass
+ *   block in the cold section; provably false filters are dropped
+ * - Self tail calls marked by TailCallOptimizer become parameter updates
+ *   and `goto mya_tail`; accumulated functions carry `mya_acc`
+ * - `pfor` bodies become a lambda over [lo, hi) chunks run by
+ *   MYA::Runtime::parallelFor; writes are checked for races first (see
+ *   checkParallelLoop) and scalar reductions get per-chunk partials
+ * - Spawned functions become frame structs deriving from
+ *   MYA::Runtime::TaskFrame whose resume() is a switch over the statements
+ *   that wait (see emitResumePoint); Main and top-level code call the
+ *   blocking versions of send/recv/await instead
+ * - print lowers to MYA::Runtime::printParts with literal arguments,
+ *   separators and the newline pre-formatted into constant text
+ * - `let x: list = zeros(n);` outside loops is allocated in the region of the
+ *   enclosing function or filter block unless `x` is returned; `free x;`
+ *   returns the storage to its pool in O(1)
+ * - Instrumented builds count every profile site through
+ *   MYA::Runtime::profileCall/profileBranch/profileLoop; with a profile,
+ *   functions, branches and loops carry the hints chosen by
+ *   ProfileGuidedOptimizer (MYA_INLINE, MYA_LIKELY, coldPath, MYA_UNROLL)
+ */
+
+#ifndef MYA_CODEGEN_H
+#define MYA_CODEGEN_H
+
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "MYAAST.h"
+#include "MYADiagnostics.h"
+#include "MYALoopVectorizer.h"
+#include "MYAStructLayout.h"
+
+namespace MYA {
+
+/**
+ * Semantic error found while generating code; the text is formatted from
+ * `message` and `args` only when the diagnostic is rendered
+ */
+struct CodegenDiagnostic {
+    int line;
+    DiagnosticMessage message;
+    std::vector<std::string> args;
+};
+
+/**
+ * CppCodegen - Emits C++ for a checked Program
+ */
+class CppCodegen {
+private:
+    const Program& program;
+    const StructLayoutEngine& layouts;
+    std::vector<CodegenDiagnostic> diagnostics;
+
+    std::ostringstream out;      // Function bodies
+    std::ostringstream kernels;  // Vector kernels, emitted before functions
+    std::set<int> emittedKernels;  // Plan ids; spawned functions are emitted twice
+    ScopeStack scope;
+    std::set<std::string> mutableNames;  // Parameters passed by value
+    const FunctionDecl* currentFunction = nullptr;
+    int indentLevel = 0;
+    int loopDepth = 0;
+    int tempCounter = 0;
+
+    std::set<const Stmt*> regionLets;        // Lists allocated in a region
+    std::set<const StmtList*> regionBlocks;  // Blocks that open a region
+    bool zerosInRegion = false;
+
+    /**
+     * Where the code being emitted runs: Main and top-level code on the main
+     * thread, other functions as plain calls, spawned functions as frames
+     */
+    enum class Context { Thread, Plain, Task };
+    Context context = Context::Thread;
+    int parallelDepth = 0;                // Inside a pfor body
+    std::set<std::string> taskFunctions;  // Spawned somewhere
+    std::set<std::string> frameOnly;      // Spawned and waiting: no plain version
+    std::ostringstream taskDecls;         // Frame structs, emitted before functions
+    std::vector<std::pair<std::string, TypeRef>> frameFields;  // Locals of the current frame
+    int resumePoints = 0;
+
+    bool instrumenting = false;  // Count profile sites (--instrument)
+    bool storing = false;        // Emitting an assignment target: map indexing inserts
+    std::string profileFile;     // Default profile path of the instrumented program
+
+    void error(int line, DiagnosticMessage message, std::vector<std::string> args) {
+        diagnostics.push_back(CodegenDiagnostic{ line, message, std::move(args) });
+    }
+
+    void error(int line, const std::string& text) {
+        error(line, DiagnosticMessage::SemanticText, { text });
+    }
+
+    void indent() {
+        for (int i = 0; i < indentLevel; i++) {
+            out << "    ";
+        }
+    }
+
+    // ----- Names and types -----
+
+    static std::string mangle(const std::string& name) {
+        static const std::set<std::string> reserved = {
+            "auto", "bool", "case", "catch", "char", "class", "const", "default", "delete", "do",
+            "double", "enum", "explicit", "extern", "goto", "inline", "int", "long", "main", "namespace",
+            "new", "operator", "private", "protected", "public", "register", "short", "signed", "sizeof",
+            "static", "struct", "switch", "template", "this", "throw", "try", "typedef", "typename",
+            "union", "unsigned", "using", "virtual", "void", "volatile", "while", "int64_t", "std", "MYA", "resume"
+        };
+        return reserved.count(name) || name.compare(0, 4, "mya_") == 0 ? name + "_" : name;
+    }
+
+    static std::string functionName(const std::string& name) {
+        return "mya_" + name;
+    }
+
+    /**
+     * Type of a struct field, spelled without spaces: map<str,list<int>>
+     */
+    static TypeRef parseTypeName(const std::string& text) {
+        size_t open = text.find('<');
+        if (open == std::string::npos) {
+            return TypeRef(text);
+        }
+        TypeRef type(text.substr(0, open));
+        size_t close = text.rfind('>'), start = open + 1;
+        int depth = 0;
+        for (size_t i = start; i < close; i++) {
+            depth += text[i] == '<' ? 1 : text[i] == '>' ? -1 : 0;
+            if (text[i] == ',' && depth == 0) {
+                type.args.push_back(parseTypeName(text.substr(start, i - start)));
+                start = i + 1;
+            }
+        }
+        type.args.push_back(parseTypeName(text.substr(start, close - start)));
+        return type;
+    }
+
+    static bool isNumeric(const TypeRef& type) {
+        return type.name == "int" || type.name == "float";
+    }
+
+    static bool isError(const TypeRef& type) {
+        return type.name == "error";
+    }
+
+    static bool isScalar(const TypeRef& type) {
+        return type.name == "int" || type.name == "float" || type.name == "bool" || type.name == "str";
+    }
+
+    static bool assignable(const TypeRef& to, const TypeRef& from) {
+        if (isError(to) || isError(from) || to == from) {
+            return true;
+        }
+        return (to.name == "float" && from.name == "int") || (to.name == "any" && isScalar(from));
+    }
+
+    /**
+     * assignable(), or an any used where a scalar is expected, which
+     * coerce() checks at run time
+     */
+    static bool convertible(const TypeRef& to, const TypeRef& from) {
+        return assignable(to, from) || (from.name == "any" && isScalar(to));
+    }
+
+    std::string coerce(const std::string& code, const TypeRef& from, const TypeRef& to, int line) {
+        if (from.name != "any" || !isScalar(to)) {
+            return code;
+        }
+        return "MYA::Runtime::as<" + cppType(to, line) + ">(" + code + ", " + std::to_string(line) + ")";
+    }
+
+    /**
+     * map keys are compared and hashed: int, float, bool, str, any and
+     * tuples of those
+     */
+    static bool hashable(const TypeRef& type) {
+        if (type.name == "tuple") {
+            for (const auto& element : type.args) {
+                if (!hashable(element)) {
+                    return false;
+                }
+            }
+            return !type.args.empty();
+        }
+        return isScalar(type) || type.name == "any" || isError(type);
+    }
+
+    /**
+     * Key and value type of a map; bare `map` maps any to any
+     */
+    static TypeRef mapKey(const TypeRef& type) {
+        return type.args.size() == 2 ? type.args[0] : TypeRef("any");
+    }
+
+    static TypeRef mapValue(const TypeRef& type) {
+        return type.args.size() == 2 ? type.args[1] : TypeRef("any");
+    }
+
+    std::string templateType(const std::string& name, const std::vector<TypeRef>& args, int line) {
+        std::string result = name + "<";
+        for (size_t i = 0; i < args.size(); i++) {
+            result += (i ? ", " : "") + cppType(args[i], line);
+        }
+        return result + (result.back() == '>' ? " >" : ">");
+    }
+
+    std::string cppType(const TypeRef& type, int line) {
+        if (type.name == "int") {
+            return "int64_t";
+        }
+        if (type.name == "any") {
+            return "MYA::Runtime::Any";
+        }
+        if (type.name == "float") {
+            return "double";
+        }
+        if (type.name == "bool") {
+            return "bool";
+        }
+        if (type.name == "str") {
+            return "std::string";
+        }
+        if (type.isList()) {
+            std::string element = cppType(type.element(), line);
+            return "MYA::Runtime::List<" + element + (element.back() == '>' ? " >" : ">");
+        }
+        if (type.name == "chan" || type.name == "task") {
+            std::string element = type.args.empty() ? "void" : cppType(type.args[0], line);
+            return std::string(type.name == "chan" ? "MYA::Runtime::Chan<" : "MYA::Runtime::Task<") + element +
+                   (element.back() == '>' ? " >" : ">");
+        }
+        if (type.name == "void") {
+            return "void";
+        }
+        if (program.findStruct(type.name)) {
+            return mangle(type.name);
+        }
+        if (type.name == "map") {
+            if (!hashable(mapKey(type))) {
+                error(line, "map key type " + mapKey(type).str() + " cannot be hashed; keys are int, float, bool, "
+                            "str, any or tuples of them");
+            }
+            return templateType("MYA::Runtime::Map", { mapKey(type), mapValue(type) }, line);
+        }
+        if (type.name == "tuple") {
+            if (!type.args.empty()) {
+                return templateType("MYA::Runtime::Tuple", type.args, line);
+            }
+            error(line, "tuple needs element types, as in tuple<int, str>");
+        } else if (!isError(type)) {
+            error(line, DiagnosticMessage::UnknownType, { type.str() });
+        }
+        return "int64_t";
+    }
+
+    /**
+     * Parameters are passed by const reference unless cheap or modified
+     */
+    std::string paramType(const Param& param, int line) {
+        std::string type = cppType(param.type, line);
+        bool byReference = param.type.isList() || param.type.name == "str" || param.type.name == "chan" ||
+                           param.type.name == "task" || param.type.name == "map" || param.type.name == "any" ||
+                           (param.type.name == "tuple" && !registerTuple(param.type));
+        if (const StructLayout* layout = layouts.layout(param.type.name)) {
+            byReference = !layout->passedInRegisters;
+        }
+        return byReference && !mutableNames.count(param.name) ? "const " + type + "&" : type;
+    }
+
+    // ----- Mutation analysis for parameters -----
+
+    /**
+     * Tuples of at most two int/float/bool elements travel in registers
+     */
+    static bool registerTuple(const TypeRef& type) {
+        if (type.args.size() > 2) {
+            return false;
+        }
+        for (const auto& element : type.args) {
+            if (element.name != "int" && element.name != "float" && element.name != "bool") {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    static const Expr* rootVariable(const Expr& expr) {
+        const Expr* node = &expr;
+        while (node->kind == ExprKind::Index || node->kind == ExprKind::Member) {
+            node = node->args[0].get();
+        }
+        return node->kind == ExprKind::Identifier ? node : nullptr;
+    }
+
+    static void collectMutations(const Expr& expr, std::set<std::string>& names) {
+        if (expr.kind == ExprKind::Call && (expr.text == "push" || expr.text == "remove") && !expr.args.empty()) {
+            if (const Expr* root = rootVariable(*expr.args[0])) {
+                names.insert(root->text);
+            }
+        }
+        for (const auto& arg : expr.args) {
+            collectMutations(*arg, names);
+        }
+    }
+
+    static void collectMutations(const StmtList& block, std::set<std::string>& names) {
+        for (const auto& stmt : block) {
+            if (stmt->kind == StmtKind::Assign) {
+                if (const Expr* root = rootVariable(*stmt->target)) {
+                    names.insert(root->text);
+                }
+            } else if (stmt->kind == StmtKind::Let || stmt->kind == StmtKind::Free) {
+                names.insert(stmt->name);
+            }
+            for (const ExprPtr* expr : { &stmt->target, &stmt->value, &stmt->limit }) {
+                if (*expr) {
+                    collectMutations(**expr, names);
+                }
+            }
+            for (const auto& arg : stmt->args) {
+                collectMutations(*arg, names);
+            }
+            collectMutations(stmt->body, names);
+            collectMutations(stmt->elseBody, names);
+        }
+    }
+
+    /**
+     * Parameters that tail jumps reassign (MYATailCallOptimizer.h)
+     */
+    static void collectTailCallParams(const StmtList& block, const FunctionDecl& fn, std::set<std::string>& names) {
+        for (const auto& stmt : block) {
+            if (stmt->tailCall != TailCall::None) {
+                const Expr& call = tailCallExpr(*stmt, fn);
+                for (size_t i = 0; i < call.args.size(); i++) {
+                    if (!isParam(*call.args[i], fn.params[i])) {
+                        names.insert(fn.params[i].name);
+                    }
+                }
+            }
+            collectTailCallParams(stmt->body, fn, names);
+            collectTailCallParams(stmt->elseBody, fn, names);
+        }
+    }
+
+    static bool isParam(const Expr& arg, const Param& param) {
+        return arg.kind == ExprKind::Identifier && arg.text == param.name;
+    }
+
+    /**
+     * The self call of a Return/ExprStmt marked as a tail call; for
+     * `return e op f(args)`, the side that calls `fn`
+     */
+    static const Expr& tailCallExpr(const Stmt& stmt, const FunctionDecl& fn) {
+        const Expr& value = *stmt.value;
+        if (stmt.tailCall == TailCall::Accumulate) {
+            return *value.args[value.args[0]->kind == ExprKind::Call && value.args[0]->text == fn.name ? 0 : 1];
+        }
+        return value;
+    }
+
+    // ----- Region allocation -----
+
+    static void collectReturnedNames(const StmtList& block, std::set<std::string>& names) {
+        for (const auto& stmt : block) {
+            if (stmt->kind == StmtKind::Return && stmt->value && stmt->value->kind == ExprKind::Identifier) {
+                names.insert(stmt->value->text);
+            }
+            collectReturnedNames(stmt->body, names);
+            collectReturnedNames(stmt->elseBody, names);
+        }
+    }
+
+    /**
+     * Place non-escaping `zeros` lists in the region of `owner` (a function
+     * or filter body). Lists created in loops stay in the pool, so a region
+     * never grows with the trip count; a filter block opens its own region.
+     */
+    void planRegions(const StmtList& owner, const StmtList& block, bool inLoop, const std::set<std::string>& returned) {
+        for (const auto& stmt : block) {
+            switch (stmt->kind) {
+            case StmtKind::Let:
+                if (!inLoop && stmt->type.isList() && stmt->value->kind == ExprKind::Call &&
+                    stmt->value->text == "zeros" && !returned.count(stmt->name)) {
+                    regionLets.insert(stmt.get());
+                    regionBlocks.insert(&owner);
+                }
+                break;
+            case StmtKind::Filter:
+                planRegions(stmt->body, stmt->body, false, returned);
+                break;
+            case StmtKind::For:
+                planRegions(owner, stmt->body, true, returned);
+                break;
+            case StmtKind::If:
+                planRegions(owner, stmt->body, inLoop, returned);
+                planRegions(owner, stmt->elseBody, inLoop, returned);
+                break;
+            default:
+                break;
+            }
+        }
+    }
+
+    void planRegions(const StmtList& body) {
+        std::set<std::string> returned;
+        collectReturnedNames(body, returned);
+        planRegions(body, body, false, returned);
+    }
+
+    // ----- Tasks and channels -----
+
+    static bool isWait(const Expr& expr) {
+        return (expr.kind == ExprKind::Call && (expr.text == "send" || expr.text == "recv")) ||
+               (expr.kind == ExprKind::Unary && expr.text == "await");
+    }
+
+    static bool waits(const Expr& expr) {
+        if (isWait(expr)) {
+            return true;
+        }
+        for (const auto& arg : expr.args) {
+            if (waits(*arg)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * Whether a function body may block on a channel or task
+     */
+    static bool waits(const StmtList& block) {
+        for (const auto& stmt : block) {
+            for (const ExprPtr* expr : { &stmt->target, &stmt->value, &stmt->limit }) {
+                if (*expr && waits(**expr)) {
+                    return true;
+                }
+            }
+            for (const auto& arg : stmt->args) {
+                if (waits(*arg)) {
+                    return true;
+                }
+            }
+            if (waits(stmt->body) || waits(stmt->elseBody)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    static void collectSpawns(const Expr& expr, std::set<std::string>& names) {
+        if (expr.kind == ExprKind::Unary && expr.text == "spawn") {
+            names.insert(expr.args[0]->text);
+        }
+        for (const auto& arg : expr.args) {
+            collectSpawns(*arg, names);
+        }
+    }
+
+    static void collectSpawns(const StmtList& block, std::set<std::string>& names) {
+        for (const auto& stmt : block) {
+            for (const ExprPtr* expr : { &stmt->target, &stmt->value, &stmt->limit }) {
+                if (*expr) {
+                    collectSpawns(**expr, names);
+                }
+            }
+            for (const auto& arg : stmt->args) {
+                collectSpawns(*arg, names);
+            }
+            collectSpawns(stmt->body, names);
+            collectSpawns(stmt->elseBody, names);
+        }
+    }
+
+    static std::string frameName(const std::string& name) {
+        return "mya_task_" + name;
+    }
+
+    /**
+     * Locals of a spawned function live in its frame so they survive
+     * suspension; true while emitting such a frame outside pfor bodies
+     */
+    bool inFrame() const {
+        return context == Context::Task && parallelDepth == 0;
+    }
+
+    void addFrameField(const std::string& name, const TypeRef& type, int line) {
+        for (const auto& field : frameFields) {
+            if (field.first == name) {
+                if (!(field.second == type) && !isError(field.second) && !isError(type)) {
+                    error(line, "'" + name + "' is both " + field.second.str() + " and " + type.str() +
+                                " in spawned function '" + currentFunction->name + "', whose locals share one frame");
+                }
+                return;
+            }
+        }
+        frameFields.emplace_back(name, type);
+    }
+
+    /**
+     * `T name = value;`, or an assignment to the frame field in a frame
+     */
+    void declareLocal(const TypeRef& type, const std::string& name, const std::string& value, int line,
+                      bool constant = false) {
+        indent();
+        if (inFrame()) {
+            addFrameField(name, type, line);
+            out << name << " = " << value << ";\n";
+            return;
+        }
+        out << (constant ? "const " : "") << cppType(type, line) << " " << name << " = " << value << ";\n";
+    }
+
+    /**
+     * Whether `what` may block here through the thread versions of the
+     * runtime calls; reports why not otherwise
+     */
+    bool canWait(int line, const std::string& what) {
+        if (parallelDepth > 0) {
+            error(line, "'" + what + "' cannot wait inside a pfor body");
+        } else if (context == Context::Plain) {
+            error(line, "'" + what + "' can wait, so it is only allowed in Main, top-level code and spawned functions");
+        } else if (context == Context::Task) {
+            error(line, "in a spawned function '" + what + "' must be a statement of its own, as in "
+                        "let x: int = recv(c); or send(c, x);");
+        } else {
+            return true;
+        }
+        return false;
+    }
+
+    // ----- Expressions -----
+
+    std::string emitCall(const Expr& expr, TypeRef& type, const TypeRef* expected) {
+        std::vector<std::string> args;
+        std::vector<TypeRef> argTypes;
+        auto emitArgs = [&](size_t first) {
+            for (size_t i = first; i < expr.args.size(); i++) {
+                TypeRef argType;
+                args.push_back(emitExpr(*expr.args[i], argType));
+                argTypes.push_back(argType);
+            }
+        };
+        auto expectArgs = [&](size_t count) {
+            if (expr.args.size() != count) {
+                error(expr.line, DiagnosticMessage::ArgumentCount,
+                      { expr.text, std::to_string(count), std::to_string(expr.args.size()) });
+                type = TypeRef("error");
+                return false;
+            }
+            return true;
+        };
+
+        // Builtins
+        if (expr.text == "len") {
+            type = TypeRef("int");
+            if (!expectArgs(1)) {
+                return "0";
+            }
+            emitArgs(0);
+            if (!argTypes[0].isList() && argTypes[0].name != "str" && argTypes[0].name != "map" &&
+                !isError(argTypes[0])) {
+                error(expr.line, "len() expects a list, map or str");
+            }
+            return "MYA::Runtime::len(" + args[0] + ")";
+        }
+        if (expr.text == "zeros") {
+            bool inRegion = zerosInRegion;
+            zerosInRegion = false;
+            type = expected && expected->isList() ? *expected : TypeRef("list");
+            if (!expectArgs(1)) {
+                return "{}";
+            }
+            emitArgs(0);
+            if (!assignable(TypeRef("int"), argTypes[0])) {
+                error(expr.line, "zeros() length must be int");
+            }
+            return "MYA::Runtime::zeros<" + cppType(type.element(), expr.line) + ">(" + args[0] + ", " +
+                   std::to_string(expr.line) + (inRegion ? ", mya_region)" : ")");
+        }
+        if (expr.text == "push") {
+            type = TypeRef("void");
+            if (!expectArgs(2)) {
+                return "";
+            }
+            TypeRef listType, valueType;
+            std::string list = emitExpr(*expr.args[0], listType);
+            if (!listType.isList()) {
+                if (!isError(listType)) {
+                    error(expr.line, "push() expects a list");
+                }
+                return "";
+            }
+            TypeRef element = listType.element();
+            std::string value = emitExpr(*expr.args[1], valueType, &element);
+            if (!convertible(element, valueType)) {
+                error(expr.line, "cannot push " + valueType.str() + " onto " + listType.str());
+            }
+            return "MYA::Runtime::push(" + list + ", " + coerce(value, valueType, element, expr.line) + ")";
+        }
+        if (expr.text == "map") {
+            type = expected && expected->name == "map" ? *expected : TypeRef("map");
+            if (expr.args.size() > 1) {
+                expectArgs(1);
+                return "{}";
+            }
+            std::string cpp = cppType(type, expr.line);  // Also checks the key type
+            if (expr.args.empty()) {
+                return cpp + "()";
+            }
+            emitArgs(0);
+            if (!assignable(TypeRef("int"), argTypes[0])) {
+                error(expr.line, "map() capacity must be int");
+            }
+            return templateType("MYA::Runtime::newMap", { mapKey(type), mapValue(type) }, expr.line) + "(" +
+                   args[0] + ", " + std::to_string(expr.line) + ")";
+        }
+        if (expr.text == "tuple") {
+            return emitTuple(expr, type, expected);
+        }
+        if (isBuiltin(expr, "has") || isBuiltin(expr, "remove")) {
+            type = TypeRef("bool");
+            if (!expectArgs(2)) {
+                return "false";
+            }
+            TypeRef mapType;
+            std::string map = emitExpr(*expr.args[0], mapType);
+            if (mapType.name != "map") {
+                if (!isError(mapType)) {
+                    error(expr.line, expr.text + "() expects a map, got " + mapType.str());
+                }
+                return "false";
+            }
+            std::string key = emitKey(*expr.args[1], mapType);
+            return "MYA::Runtime::" + expr.text + "(" + map + ", " + key + ")";
+        }
+        if (isBuiltin(expr, "keys")) {
+            if (!expectArgs(1)) {
+                return "{}";
+            }
+            emitArgs(0);
+            if (argTypes[0].name != "map") {
+                if (!isError(argTypes[0])) {
+                    error(expr.line, "keys() expects a map, got " + argTypes[0].str());
+                }
+                type = TypeRef("error");
+                return "{}";
+            }
+            type = TypeRef("list");
+            type.args.push_back(mapKey(argTypes[0]));
+            return "MYA::Runtime::keys(" + args[0] + ")";
+        }
+        if (isBuiltin(expr, "typeof")) {
+            type = TypeRef("str");
+            if (!expectArgs(1)) {
+                return "std::string()";
+            }
+            emitArgs(0);
+            if (argTypes[0].name == "any") {
+                return "MYA::Runtime::typeOf(" + args[0] + ")";
+            }
+            return "std::string(\"" + argTypes[0].str() + "\")";
+        }
+        if (expr.text == "channel") {
+            type = expected && expected->name == "chan" ? *expected : TypeRef("error");
+            if (!expectArgs(1)) {
+                return "{}";
+            }
+            emitArgs(0);
+            if (!assignable(TypeRef("int"), argTypes[0])) {
+                error(expr.line, "channel() capacity must be int");
+            }
+            if (isError(type)) {
+                error(expr.line, "channel() needs a chan type from context, as in let c: chan<int> = channel(8);");
+                return "{}";
+            }
+            return "MYA::Runtime::channel<" + cppType(type.args[0], expr.line) + ">(" + args[0] + ", " +
+                   std::to_string(expr.line) + ")";
+        }
+        if (expr.text == "send" || expr.text == "recv") {
+            bool sending = expr.text == "send";
+            type = TypeRef("void");
+            if (!expectArgs(sending ? 2 : 1)) {
+                return "";
+            }
+            TypeRef chanType, valueType;
+            std::string chan = emitExpr(*expr.args[0], chanType);
+            if (chanType.name != "chan") {
+                if (!isError(chanType)) {
+                    error(expr.line, expr.text + "() expects a chan, got " + chanType.str());
+                }
+                type = TypeRef("error");
+                return "0";
+            }
+            TypeRef element = chanType.args[0];
+            std::string line = std::to_string(expr.line);
+            if (!sending) {
+                type = element;
+                return canWait(expr.line, "recv") ? "MYA::Runtime::recv(" + chan + ", " + line + ")" : "0";
+            }
+            std::string value = emitExpr(*expr.args[1], valueType, &element);
+            if (!assignable(element, valueType)) {
+                error(expr.line, "cannot send " + valueType.str() + " on " + chanType.str());
+            }
+            return canWait(expr.line, "send") ? "MYA::Runtime::send(" + chan + ", " + value + ", " + line + ")" : "";
+        }
+
+        // Struct constructors
+        if (const StructDef* def = program.findStruct(expr.text)) {
+            type = TypeRef(def->name);
+            if (!expectArgs(def->fields.size())) {
+                return mangle(def->name) + "()";
+            }
+            std::string result = mangle(def->name) + "(";
+            for (size_t i = 0; i < expr.args.size(); i++) {
+                TypeRef fieldType = parseTypeName(def->fields[i].type), argType;
+                std::string arg = emitExpr(*expr.args[i], argType, &fieldType);
+                if (!convertible(fieldType, argType)) {
+                    error(expr.line, "field '" + def->fields[i].name + "' of " + def->name + " is " +
+                                     fieldType.str() + ", got " + argType.str());
+                }
+                result += (i ? ", " : "") + coerce(arg, argType, fieldType, expr.line);
+            }
+            return result + ")";
+        }
+
+        // User functions
+        const FunctionDecl* fn = program.findFunction(expr.text);
+        if (!fn || fn->isMain) {
+            error(expr.line, DiagnosticMessage::UndefinedFunction, { expr.text });
+            type = TypeRef("error");
+            return "0";
+        }
+        type = fn->returnType.empty() ? TypeRef("void") : fn->returnType;
+        if (frameOnly.count(fn->name)) {
+            error(expr.line, "'" + fn->name + "' waits on channels or tasks, so it can only run as a task: spawn " +
+                             fn->name + "(...)");
+        }
+        if (!expectArgs(fn->params.size())) {
+            type = fn->returnType.empty() ? TypeRef("void") : fn->returnType;
+            return functionName(fn->name) + "()";
+        }
+        return functionName(fn->name) + "(" + emitArguments(expr, *fn) + ")";
+    }
+
+    /**
+     * has/remove/keys/typeof are builtins unless the program defines a
+     * function of that name
+     */
+    bool isBuiltin(const Expr& call, const char* name) const {
+        return call.text == name && !program.findFunction(name);
+    }
+
+    /**
+     * A key of `mapType`, converted to the key type
+     */
+    std::string emitKey(const Expr& expr, const TypeRef& mapType) {
+        TypeRef keyType = mapKey(mapType), type;
+        std::string key = emitExpr(expr, type, &keyType);
+        if (!convertible(keyType, type)) {
+            error(expr.line, "key of " + mapType.str() + " must be " + keyType.str() + ", got " + type.str());
+        }
+        return coerce(key, type, keyType, expr.line);
+    }
+
+    /**
+     * tuple(a, b): element types from the arguments, or from the expected
+     * tuple type when it has as many elements
+     */
+    std::string emitTuple(const Expr& expr, TypeRef& type, const TypeRef* expected) {
+        bool typed = expected && expected->name == "tuple" && expected->args.size() == expr.args.size();
+        type = TypeRef("tuple");
+        if (expr.args.empty()) {
+            error(expr.line, "tuple() needs at least one element");
+            type = TypeRef("error");
+            return "0";
+        }
+        std::vector<std::string> elements;
+        for (size_t i = 0; i < expr.args.size(); i++) {
+            TypeRef elementType;
+            std::string element = emitExpr(*expr.args[i], elementType, typed ? &expected->args[i] : nullptr);
+            if (typed && convertible(expected->args[i], elementType)) {
+                element = coerce(element, elementType, expected->args[i], expr.line);
+                elementType = expected->args[i];
+            } else if (elementType.name == "void") {
+                error(expr.line, "tuple element " + std::to_string(i) + " has no value");
+            }
+            type.args.push_back(elementType);
+            elements.push_back(element);
+        }
+        std::string result = cppType(type, expr.line) + "(";
+        for (size_t i = 0; i < elements.size(); i++) {
+            result += (i ? ", " : "") + elements[i];
+        }
+        return result + ")";
+    }
+
+    /**
+     * t[i] with a constant i -> get<i>(t)
+     */
+    std::string emitTupleElement(const Expr& expr, const std::string& base, const TypeRef& tupleType, TypeRef& type) {
+        const Expr& index = *expr.args[1];
+        size_t position = tupleType.args.size();
+        if (index.kind == ExprKind::Number && !index.isFloatLiteral() && index.text.size() < 6) {
+            position = static_cast<size_t>(std::stoi(index.text));
+        }
+        if (position >= tupleType.args.size()) {
+            error(expr.line, "index of " + tupleType.str() + " must be a number from 0 to " +
+                             std::to_string(static_cast<int>(tupleType.args.size()) - 1));
+            type = TypeRef("error");
+            return "0";
+        }
+        type = tupleType.args[position];
+        return "MYA::Runtime::get<" + std::to_string(position) + ">(" + base + ")";
+    }
+
+    std::string emitArguments(const Expr& call, const FunctionDecl& fn) {
+        std::string result;
+        for (size_t i = 0; i < call.args.size(); i++) {
+            TypeRef argType;
+            std::string arg = emitExpr(*call.args[i], argType, &fn.params[i].type);
+            if (!convertible(fn.params[i].type, argType)) {
+                error(call.line, DiagnosticMessage::ArgumentType,
+                      { std::to_string(i + 1), fn.name, fn.params[i].type.str(), argType.str() });
+            }
+            result += (i ? ", " : "") + coerce(arg, argType, fn.params[i].type, call.line);
+        }
+        return result;
+    }
+
+    /**
+     * spawn f(args) -> spawn(new mya_task_f(args)), of type task<R>
+     */
+    std::string emitSpawn(const Expr& expr, TypeRef& type) {
+        const Expr& call = *expr.args[0];
+        const FunctionDecl* fn = program.findFunction(call.text);
+        type = TypeRef("task");
+        if (!fn || fn->isMain) {
+            error(expr.line, "cannot spawn '" + call.text + "': no such function");
+            return "{}";
+        }
+        if (!fn->returnType.empty()) {
+            type.args.push_back(fn->returnType);
+        }
+        if (call.args.size() != fn->params.size()) {
+            error(expr.line, DiagnosticMessage::ArgumentCount,
+                  { fn->name, std::to_string(fn->params.size()), std::to_string(call.args.size()) });
+            return "{}";
+        }
+        return "MYA::Runtime::spawn(new " + frameName(fn->name) + "(" + emitArguments(call, *fn) + "))";
+    }
+
+    std::string emitBinary(const Expr& expr, TypeRef& type) {
+        TypeRef lt, rt;
+        std::string lhs = emitExpr(*expr.args[0], lt);
+        std::string rhs = emitExpr(*expr.args[1], rt);
+        const std::string& op = expr.text;
+        bool errors = isError(lt) || isError(rt);
+
+        if (op == "and" || op == "or") {
+            if (!errors && (lt.name != "bool" || rt.name != "bool")) {
+                error(expr.line, "operator '" + op + "' requires bool operands");
+            }
+            type = TypeRef("bool");
+            return "(" + lhs + (op == "and" ? " && " : " || ") + rhs + ")";
+        }
+        if (op == "==" || op == "!=" || op == "<" || op == ">" || op == "<=" || op == ">=") {
+            bool equality = op == "==" || op == "!=";
+            bool comparable = (isNumeric(lt) && isNumeric(rt)) || (lt == rt && lt.name == "str") ||
+                              (lt == rt && lt.name == "bool" && equality) ||
+                              (lt == rt && lt.name == "tuple" && hashable(lt) && equality) ||
+                              (equality && ((lt.name == "any" && (isScalar(rt) || rt.name == "any")) ||
+                                            (rt.name == "any" && isScalar(lt))));
+            if (!errors && !comparable) {
+                error(expr.line, DiagnosticMessage::CannotCompare, { lt.str(), rt.str() });
+            }
+            type = TypeRef("bool");
+            return "(" + lhs + " " + op + " " + rhs + ")";
+        }
+        if (op == "+" && lt.name == "str" && rt.name == "str") {
+            type = lt;
+            return "(" + lhs + " + " + rhs + ")";
+        }
+        if (!errors && (!isNumeric(lt) || !isNumeric(rt))) {
+            error(expr.line, DiagnosticMessage::NumericOperands, { op, lt.str(), rt.str() });
+            type = TypeRef("error");
+            return "0";
+        }
+        type = TypeRef(lt.name == "float" || rt.name == "float" ? "float" : "int");
+        if (type.name == "int" && (op == "/" || op == "%")) {
+            std::string helper = op == "/" ? "divide" : "modulo";
+            return "MYA::Runtime::" + helper + "(" + lhs + ", " + rhs + ", " + std::to_string(expr.line) + ")";
+        }
+        if (op == "%") {
+            error(expr.line, "operator '%' requires int operands");
+        }
+        return "(" + lhs + " " + op + " " + rhs + ")";
+    }
+
+    /**
+     * Printed form of a literal as the body of a C++ string literal (escapes
+     * kept), matching the runtime's formatting; false for other expressions
+     */
+    static bool constantText(const Expr& expr, std::string& body) {
+        switch (expr.kind) {
+        case ExprKind::String:
+            body = expr.text.substr(1, expr.text.size() - 2);
+            return true;
+        case ExprKind::Boolean:
+            body = expr.text;
+            return true;
+        case ExprKind::Number: {
+            if (expr.isFloatLiteral()) {
+                char buffer[32];
+                std::snprintf(buffer, sizeof(buffer), "%g", std::strtod(expr.text.c_str(), nullptr));
+                body = buffer;
+                return true;
+            }
+            size_t digits = expr.text.find_first_not_of('0');
+            body = digits == std::string::npos ? "0" : expr.text.substr(digits);
+            return body.size() <= 18;  // Larger literals keep their int64 conversion
+        }
+        default:
+            return false;
+        }
+    }
+
+    /**
+     * Emit an expression and report its MYA type. `expected` types literals
+     * whose type comes from context (zeros()).
+     */
+    std::string emitExpr(const Expr& expr, TypeRef& type, const TypeRef* expected = nullptr) {
+        switch (expr.kind) {
+        case ExprKind::Number:
+            type = TypeRef(expr.isFloatLiteral() ? "float" : "int");
+            return expr.text;
+        case ExprKind::String:
+            type = TypeRef("str");
+            return "std::string(" + expr.text + ")";
+        case ExprKind::Boolean:
+            type = TypeRef("bool");
+            return expr.text;
+        case ExprKind::Identifier: {
+            const TypeRef* found = scope.lookup(expr.text);
+            if (!found) {
+                error(expr.line, DiagnosticMessage::UndefinedVariable, { expr.text });
+                type = TypeRef("error");
+                return "0";
+            }
+            type = *found;
+            return mangle(expr.text);
+        }
+        case ExprKind::Call:
+            return emitCall(expr, type, expected);
+        case ExprKind::Index: {
+            TypeRef baseType, indexType;
+            bool store = storing;
+            storing = false;
+            std::string base = emitExpr(*expr.args[0], baseType);
+            if (baseType.name == "map") {
+                type = mapValue(baseType);
+                if (store) {
+                    // m[key] = value inserts the key; reading a missing key fails
+                    return "MYA::Runtime::slot(" + base + ", " + emitKey(*expr.args[1], baseType) + ")";
+                }
+                return "MYA::Runtime::at(" + base + ", " + emitKey(*expr.args[1], baseType) + ", " +
+                       std::to_string(expr.line) + ")";
+            }
+            if (baseType.name == "tuple") {
+                return emitTupleElement(expr, base, baseType, type);
+            }
+            std::string index = emitExpr(*expr.args[1], indexType);
+            if (!isError(indexType) && indexType.name != "int") {
+                error(expr.line, "list index must be int");
+            }
+            if (!baseType.isList()) {
+                if (!isError(baseType)) {
+                    error(expr.line, "cannot index a value of type " + baseType.str());
+                }
+                type = TypeRef("error");
+                return "0";
+            }
+            type = baseType.element();
+            return "MYA::Runtime::at(" + base + ", " + index + ", " + std::to_string(expr.line) + ")";
+        }
+        case ExprKind::Member: {
+            TypeRef baseType;
+            std::string base = emitExpr(*expr.args[0], baseType);
+            const StructDef* def = program.findStruct(baseType.name);
+            if (def) {
+                for (const auto& field : def->fields) {
+                    if (field.name == expr.text) {
+                        type = parseTypeName(field.type);
+                        return base + "." + mangle(expr.text);
+                    }
+                }
+                error(expr.line, DiagnosticMessage::NoSuchField, { def->name, expr.text });
+            } else if (!isError(baseType)) {
+                error(expr.line, "cannot access '" + expr.text + "' on a value of type " + baseType.str());
+            }
+            type = TypeRef("error");
+            return "0";
+        }
+        case ExprKind::Binary:
+            return emitBinary(expr, type);
+        case ExprKind::Unary: {
+            if (expr.text == "spawn") {
+                return emitSpawn(expr, type);
+            }
+            TypeRef operand;
+            std::string value = emitExpr(*expr.args[0], operand);
+            if (expr.text == "await") {
+                if (operand.name != "task") {
+                    if (!isError(operand)) {
+                        error(expr.line, "await expects a task, got " + operand.str());
+                    }
+                    type = TypeRef("error");
+                    return "0";
+                }
+                type = operand.args.empty() ? TypeRef("void") : operand.args[0];
+                return canWait(expr.line, "await") ? "MYA::Runtime::await(" + value + ", " +
+                                                     std::to_string(expr.line) + ")" : "0";
+            }
+            if (expr.text == "not") {
+                if (!isError(operand) && operand.name != "bool") {
+                    error(expr.line, "'not' requires a bool operand");
+                }
+                type = TypeRef("bool");
+                return "(!" + value + ")";
+            }
+            if (!isError(operand) && !isNumeric(operand)) {
+                error(expr.line, "unary '-' requires a numeric operand");
+            }
+            type = operand;
+            return "(-" + value + ")";
+        }
+        }
+        type = TypeRef("error");
+        return "0";
+    }
+
+    std::string emitCondition(const Expr& expr, const std::string& what) {
+        TypeRef type;
+        std::string cond = emitExpr(expr, type);
+        if (!isError(type) && type.name != "bool") {
+            error(expr.line, what + " condition must be bool, got " + type.str());
+        }
+        if (expr.kind == ExprKind::Binary && cond.front() == '(') {
+            cond = cond.substr(1, cond.size() - 2);  // Already inside if (...)
+        }
+        return cond;
+    }
+
+    // ----- Profiles -----
+
+    bool counts(int site) const {
+        return instrumenting && site >= 0;
+    }
+
+    /**
+     * `cond` of an if/filter, counted when instrumenting and hinted from the profile
+     */
+    std::string branchCondition(const Stmt& stmt, std::string cond) const {
+        if (counts(stmt.profileSite)) {
+            cond = "MYA::Runtime::profileBranch(" + std::to_string(stmt.profileSite) + ", " + cond + ")";
+        }
+        if (stmt.branchHint == BranchHint::Likely) {
+            return "MYA_LIKELY(" + cond + ")";
+        }
+        if (stmt.branchHint == BranchHint::Unlikely) {
+            return "MYA_UNLIKELY(" + cond + ")";
+        }
+        return cond;
+    }
+
+    /**
+     * Whether `block` can leave the loop it is the body of before its last
+     * iteration: a return, or a break outside of inner loops
+     */
+    static bool exitsEarly(const StmtList& block, bool outerLoop) {
+        for (const auto& stmt : block) {
+            if (stmt->kind == StmtKind::Return || (outerLoop && stmt->kind == StmtKind::Break)) {
+                return true;
+            }
+            bool inner = outerLoop && stmt->kind != StmtKind::For;
+            if (exitsEarly(stmt->body, inner) || exitsEarly(stmt->elseBody, inner)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    static const char* functionAttributes(const FunctionDecl& fn) {
+        switch (fn.heat) {
+        case FunctionHeat::Hot:
+            return "MYA_HOT ";
+        case FunctionHeat::Inline:
+            return "MYA_INLINE ";
+        case FunctionHeat::Cold:
+            return "MYA_COLD ";
+        case FunctionHeat::Normal:
+            break;
+        }
+        return "";
+    }
+
+    /**
+     * C string literal for the profile path
+     */
+    static std::string quoted(const std::string& text) {
+        std::string result = "\"";
+        for (char c : text) {
+            if (c == '\\' || c == '"') {
+                result += '\\';
+            }
+            result += c;
+        }
+        return result + "\"";
+    }
+
+    // ----- Statements -----
+
+    /**
+     * A pass block that is only `return <call-free value>`, break or
+     * continue stays inline; anything larger is moved to the cold section
+     */
+    static bool isTrivialPassBlock(const StmtList& block) {
+        if (block.size() != 1) {
+            return false;
+        }
+        const Stmt& stmt = *block[0];
+        if (stmt.kind == StmtKind::Break || stmt.kind == StmtKind::Continue) {
+            return true;
+        }
+        return stmt.kind == StmtKind::Return && (!stmt.value || !containsCall(*stmt.value));
+    }
+
+    static bool containsCall(const Expr& expr) {
+        if (expr.kind == ExprKind::Call) {
+            return true;
+        }
+        for (const auto& arg : expr.args) {
+            if (containsCall(*arg)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void emitBlock(const StmtList& block, bool cold = false) {
+        scope.push();
+        indentLevel++;
+        if (cold) {
+            indent();
+            out << "MYA::Runtime::coldPath();\n";
+        }
+        if (regionBlocks.count(&block) && context != Context::Task) {
+            indent();
+            out << "MYA::Runtime::RegionScope mya_region;\n";
+        }
+        for (const auto& stmt : block) {
+            emitStmt(*stmt);
+        }
+        indentLevel--;
+        scope.pop();
+    }
+
+    void emitAssignment(int line, const std::string& target, const TypeRef& targetType, const Expr& value) {
+        TypeRef valueType;
+        std::string code = emitExpr(value, valueType, &targetType);
+        if (!convertible(targetType, valueType)) {
+            error(line, DiagnosticMessage::CannotAssign, { valueType.str(), targetType.str() });
+        }
+        indent();
+        out << target << " = " << coerce(code, valueType, targetType, line) << ";\n";
+    }
+
+    void emitStmt(const Stmt& stmt) {
+        if (inFrame()) {
+            if (const Expr* wait = resumePoint(stmt)) {
+                emitResumePoint(stmt, *wait);
+                return;
+            }
+        }
+        switch (stmt.kind) {
+        case StmtKind::Let: {
+            if (const TypeRef* existing = scope.lookup(stmt.name)) {
+                if (!(*existing == stmt.type)) {
+                    error(stmt.line, DiagnosticMessage::Redeclared, { stmt.name, existing->str(), stmt.type.str() });
+                }
+                emitAssignment(stmt.line, mangle(stmt.name), *existing, *stmt.value);
+                return;
+            }
+            TypeRef valueType;
+            zerosInRegion = regionLets.count(&stmt) > 0 && context != Context::Task;
+            std::string value = emitExpr(*stmt.value, valueType, &stmt.type);
+            if (!convertible(stmt.type, valueType)) {
+                error(stmt.line, DiagnosticMessage::CannotInitialize, { stmt.type.str(), stmt.name, valueType.str() });
+            }
+            scope.declare(stmt.name, stmt.type);
+            declareLocal(stmt.type, mangle(stmt.name), coerce(value, valueType, stmt.type, stmt.line), stmt.line);
+            return;
+        }
+        case StmtKind::Assign: {
+            TypeRef targetType;
+            storing = stmt.target->kind == ExprKind::Index;
+            std::string target = emitExpr(*stmt.target, targetType);
+            storing = false;
+            emitAssignment(stmt.line, target, targetType, *stmt.value);
+            return;
+        }
+        case StmtKind::If:
+            indent();
+            out << "if (" << branchCondition(stmt, emitCondition(*stmt.value, "if")) << ") {\n";
+            emitBlock(stmt.body, stmt.coldBody);
+            if (stmt.hasElse) {
+                indent();
+                out << "} else {\n";
+                emitBlock(stmt.elseBody, stmt.coldElse);
+            }
+            indent();
+            out << "}\n";
+            return;
+        case StmtKind::For:
+            emitFor(stmt);
+            return;
+        case StmtKind::Filter: {
+            std::string cond = emitCondition(*stmt.value, "filter");
+            if (stmt.filterFact == FilterFact::AlwaysFalse) {
+                std::ostringstream removed;  // Checked, not emitted
+                out.swap(removed);
+                emitBlock(stmt.body);
+                out.swap(removed);
+                return;
+            }
+            indent();
+            if (stmt.body.empty()) {
+                out << "(void)(" << branchCondition(stmt, cond) << ");\n";
+                return;
+            }
+            if (stmt.filterFact == FilterFact::AlwaysTrue) {
+                out << "if (" << branchCondition(stmt, cond) << ") {\n";
+                emitBlock(stmt.body);
+            } else if (stmt.branchHint == BranchHint::None) {
+                // Static lowering: the pass block is the rare path
+                out << "if (MYA_UNLIKELY(" << branchCondition(stmt, cond) << ")) {\n";
+                emitBlock(stmt.body, !isTrivialPassBlock(stmt.body));
+            } else {
+                out << "if (" << branchCondition(stmt, cond) << ") {\n";
+                emitBlock(stmt.body, stmt.coldBody);
+            }
+            indent();
+            out << "}\n";
+            return;
+        }
+        case StmtKind::Print: {
+            // Literals, separators and the newline are folded into constant
+            // text pieces: print "n =", n; -> printParts(text("n = "), n, text("\n"))
+            std::string args;
+            std::string pending;
+            auto flushText = [&]() {
+                if (!pending.empty()) {
+                    args += (args.empty() ? "" : ", ") + std::string("MYA::Runtime::text(\"") + pending + "\")";
+                    pending.clear();
+                }
+            };
+            for (size_t i = 0; i < stmt.args.size(); i++) {
+                TypeRef type;
+                std::string code = emitExpr(*stmt.args[i], type);
+                if (program.findStruct(type.name) || type.name == "void" || type.name == "chan" || type.name == "task") {
+                    error(stmt.line, "cannot print a value of type " + type.str());
+                }
+                if (i) {
+                    pending += " ";
+                }
+                std::string constant;
+                if (constantText(*stmt.args[i], constant)) {
+                    pending += constant;
+                } else {
+                    flushText();
+                    args += (args.empty() ? "" : ", ") + code;
+                }
+            }
+            pending += "\\n";
+            flushText();
+            indent();
+            out << "MYA::Runtime::printParts(" << args << ");\n";
+            return;
+        }
+        case StmtKind::Return: {
+            TypeRef expected = currentFunction && !currentFunction->returnType.empty() ? currentFunction->returnType : TypeRef("void");
+            if (!currentFunction) {
+                error(stmt.line, "return outside of a function");
+            }
+            indent();
+            if (!stmt.value) {
+                if (expected.name != "void") {
+                    error(stmt.line, "missing return value of type " + expected.str());
+                }
+                out << (context == Context::Task ? "return MYA::Runtime::Step::Done;\n" : "return;\n");
+                return;
+            }
+            TypeRef type;
+            size_t errors = diagnostics.size();
+            std::string value = emitExpr(*stmt.value, type, &expected);
+            if (expected.name == "void") {
+                error(stmt.line, "function '" + (currentFunction ? currentFunction->name : "") + "' does not return a value");
+            } else if (!convertible(expected, type)) {
+                error(stmt.line, DiagnosticMessage::CannotReturn, { type.str(), expected.str() });
+            } else {
+                value = coerce(value, type, expected, stmt.line);
+            }
+            if (context == Context::Task) {
+                out << "mya_result = " << value << ";\n";
+                indent();
+                out << "return MYA::Runtime::Step::Done;\n";
+                return;
+            }
+            if (stmt.tailCall != TailCall::None && diagnostics.size() == errors) {
+                emitTailJump(stmt);
+                return;
+            }
+            if (currentFunction && !currentFunction->accumulatorOp.empty()) {
+                value = accumulate(value);
+            }
+            out << "return " << value << ";\n";
+            return;
+        }
+        case StmtKind::Break:
+        case StmtKind::Continue:
+            if (loopDepth == 0) {
+                error(stmt.line, std::string(stmt.kind == StmtKind::Break ? "break" : "continue") + " outside of a loop");
+            }
+            indent();
+            out << (stmt.kind == StmtKind::Break ? "break;\n" : "continue;\n");
+            return;
+        case StmtKind::ExprStmt: {
+            TypeRef type;
+            size_t errors = diagnostics.size();
+            std::string code = emitExpr(*stmt.value, type);
+            indent();
+            if (stmt.tailCall != TailCall::None && diagnostics.size() == errors && context != Context::Task) {
+                emitTailJump(stmt);
+                return;
+            }
+            out << code << ";\n";
+            return;
+        }
+        case StmtKind::Free: {
+            const TypeRef* type = scope.lookup(stmt.name);
+            if (!type) {
+                error(stmt.line, DiagnosticMessage::UndefinedVariable, { stmt.name });
+            } else if (!type->isList() && type->name != "map") {
+                error(stmt.line, "free expects a list or map, '" + stmt.name + "' is " + type->str());
+            }
+            indent();
+            out << "MYA::Runtime::release(" << mangle(stmt.name) << ");\n";
+            return;
+        }
+        }
+    }
+
+    void emitFor(const Stmt& stmt) {
+        if (stmt.parallel) {
+            emitParallelFor(stmt);
+            return;
+        }
+        TypeRef startType, limitType;
+        std::string start = emitExpr(*stmt.value, startType);
+        std::string limit = emitExpr(*stmt.limit, limitType);
+        if ((!isError(startType) && startType.name != "int") || (!isError(limitType) && limitType.name != "int")) {
+            error(stmt.line, "range bounds must be int");
+        }
+        std::string var = mangle(stmt.name);
+        std::string end = "mya_end" + std::to_string(++tempCounter);
+        if (inFrame() && scope.lookup(stmt.name)) {
+            error(stmt.line, "loop variable '" + stmt.name + "' shadows another variable, which a spawned function "
+                             "cannot do: its locals share one frame");
+        }
+
+        indent();
+        out << "{\n";
+        indentLevel++;
+        declareLocal(TypeRef("int"), var, start, stmt.line);
+        declareLocal(TypeRef("int"), end, limit, stmt.line, true);
+        std::string condition = var + " < " + end;
+        if (counts(stmt.profileSite)) {
+            // Trips are counted up front unless the body can leave the loop early
+            bool early = !stmt.vectorPlan && exitsEarly(stmt.body, true);
+            std::string site = std::to_string(stmt.profileSite);
+            indent();
+            out << "MYA::Runtime::profileLoop(" << site << ", " << (early ? "0" : end + " - " + var) << ");\n";
+            if (early) {
+                condition = "MYA::Runtime::profileIteration(" + site + ", " + condition + ")";
+            }
+        }
+        if (stmt.vectorPlan) {
+            emitVectorDispatch(*stmt.vectorPlan, var, end);
+        }
+        if (stmt.unroll > 1) {
+            indent();
+            out << "MYA_UNROLL(" << stmt.unroll << ")\n";
+        }
+        indent();
+        out << "for (; " << condition << "; " << var << "++) {\n";
+        scope.push();
+        scope.declare(stmt.name, TypeRef("int"));
+        loopDepth++;
+        emitBlock(stmt.body);
+        loopDepth--;
+        scope.pop();
+        indent();
+        out << "}\n";
+        indentLevel--;
+        indent();
+        out << "}\n";
+    }
+
+    // ----- Parallel loops -----
+
+    /**
+     * What a pfor body does to variables declared outside it
+     */
+    struct ParallelAccess {
+        std::string loopVar;
+        int line = 0;
+        std::map<std::string, std::string> reductions;  // name -> "+" or "*"
+        std::set<std::string> writtenLists;             // Written only as xs[i]
+    };
+
+    static bool isIdentifier(const Expr& expr, const std::string& name) {
+        return expr.kind == ExprKind::Identifier && expr.text == name;
+    }
+
+    /**
+     * "+" when `s = ...` adds s once to terms that do not mention it
+     * (`s = s + e`, `s = e + s`, `s = s - a + b`), "*" for `s = s * e` and
+     * `s = e * s`, otherwise empty. `self` is set to the s operand.
+     */
+    static std::string reductionOp(const Stmt& stmt, const std::string& name, const Expr*& self) {
+        const Expr& value = *stmt.value;
+        if (value.kind == ExprKind::Binary && value.text == "*") {
+            for (int side = 0; side < 2; side++) {
+                if (isIdentifier(*value.args[side], name) && !mentionsName(*value.args[1 - side], name)) {
+                    self = value.args[side].get();
+                    return "*";
+                }
+            }
+            return "";
+        }
+        const Expr* node = &value;
+        while (node->kind == ExprKind::Binary && (node->text == "+" || node->text == "-")) {
+            bool inLeft = mentionsName(*node->args[0], name), inRight = mentionsName(*node->args[1], name);
+            if (inLeft == inRight || (inRight && node->text == "-")) {
+                return "";
+            }
+            node = node->args[inLeft ? 0 : 1].get();
+        }
+        if (node == &value || !isIdentifier(*node, name)) {
+            return "";
+        }
+        self = node;
+        return "+";
+    }
+
+    static bool mentionsName(const Expr& expr, const std::string& name) {
+        if (isIdentifier(expr, name)) {
+            return true;
+        }
+        for (const auto& arg : expr.args) {
+            if (mentionsName(*arg, name)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * `name = value` (or `let name: T = value`) for an outer scalar
+     */
+    void checkParallelScalarWrite(const Stmt& stmt, const std::string& name, ParallelAccess& access) {
+        const TypeRef* type = scope.lookup(name);
+        const Expr* self = nullptr;
+        std::string op = type && isNumeric(*type) ? reductionOp(stmt, name, self) : "";
+        auto found = access.reductions.find(name);
+        if (name == access.loopVar) {
+            error(stmt.line, "pfor loop variable '" + name + "' cannot be assigned");
+        } else if (op.empty()) {
+            error(stmt.line, "every iteration of the pfor at line " + std::to_string(access.line) +
+                  " assigns '" + name + "'; only reductions (" + name + " = " + name + " + e, " +
+                  name + " = " + name + " * e) may update outer scalars");
+        } else if (found != access.reductions.end() && found->second != op) {
+            error(stmt.line, "'" + name + "' mixes + and * reductions in a pfor");
+        } else {
+            access.reductions[name] = op;
+        }
+    }
+
+    /**
+     * Iterations may run in any order on any thread, so a pfor body may only
+     * write outer variables in ways that cannot race:
+     * - list elements at exactly the loop index (`xs[i] = ...`, `xs[i].f = ...`),
+     *   with no other read of that list except `xs[i]` and len(xs)
+     * - scalars as +, - or * reductions, which are not read anywhere else
+     * No push/free of outer lists, no return, and no break out of the pfor.
+     */
+    void checkParallelWrites(const StmtList& block, std::set<std::string> locals, ParallelAccess& access, int innerLoops) {
+        for (const auto& stmt : block) {
+            switch (stmt->kind) {
+            case StmtKind::Let:
+                // Re-declaring a visible name assigns it
+                if (stmt->name == access.loopVar || (!locals.count(stmt->name) && scope.lookup(stmt->name))) {
+                    checkParallelScalarWrite(*stmt, stmt->name, access);
+                } else {
+                    locals.insert(stmt->name);
+                }
+                break;
+            case StmtKind::Assign: {
+                const Expr* root = rootVariable(*stmt->target);
+                if (!root || (locals.count(root->text) && root->text != access.loopVar)) {
+                    break;
+                }
+                const std::string& name = root->text;
+                const TypeRef* type = scope.lookup(name);
+                if (name == access.loopVar || stmt->target.get() == root) {
+                    checkParallelScalarWrite(*stmt, name, access);
+                } else {
+                    const Expr* element = stmt->target.get();
+                    while (element->args[0].get() != root) {
+                        element = element->args[0].get();
+                    }
+                    if (type && type->name == "map") {
+                        error(stmt->line, "pfor cannot write outer map '" + name + "': inserts would race");
+                    } else if (element->kind != ExprKind::Index || !isIdentifier(*element->args[1], access.loopVar)) {
+                        error(stmt->line, "pfor writes '" + name + "' outside element [" + access.loopVar +
+                              "]; iterations would race");
+                    } else {
+                        access.writtenLists.insert(name);
+                    }
+                }
+                break;
+            }
+            case StmtKind::Free:
+                if (!locals.count(stmt->name)) {
+                    error(stmt->line, "pfor cannot free outer container '" + stmt->name + "'");
+                }
+                break;
+            case StmtKind::Return:
+                error(stmt->line, "return is not allowed in a pfor body");
+                break;
+            case StmtKind::Break:
+                if (innerLoops == 0) {
+                    error(stmt->line, "break cannot leave a pfor; use continue or a filter");
+                }
+                break;
+            case StmtKind::For: {
+                std::set<std::string> inner = locals;
+                inner.insert(stmt->name);
+                checkParallelWrites(stmt->body, inner, access, innerLoops + 1);
+                break;
+            }
+            default:
+                break;
+            }
+            for (const ExprPtr* expr : { &stmt->value, &stmt->limit }) {
+                if (*expr) {
+                    checkParallelPushes(**expr, locals);
+                }
+            }
+            for (const auto& arg : stmt->args) {
+                checkParallelPushes(*arg, locals);
+            }
+            if (stmt->kind != StmtKind::For) {
+                checkParallelWrites(stmt->body, locals, access, innerLoops);
+                checkParallelWrites(stmt->elseBody, locals, access, innerLoops);
+            }
+        }
+    }
+
+    void checkParallelPushes(const Expr& expr, const std::set<std::string>& locals) {
+        if (expr.kind == ExprKind::Call && (expr.text == "push" || expr.text == "remove") && !expr.args.empty()) {
+            const Expr* root = rootVariable(*expr.args[0]);
+            if (root && !locals.count(root->text)) {
+                error(expr.line, expr.text == "push" ? "pfor cannot push to outer list '" + root->text + "'"
+                                                     : "pfor cannot remove from outer map '" + root->text + "'");
+            }
+        }
+        for (const auto& arg : expr.args) {
+            checkParallelPushes(*arg, locals);
+        }
+    }
+
+    /**
+     * Reads of written lists and reduction variables
+     */
+    void checkParallelReads(const Expr& expr, const std::set<std::string>& locals, const ParallelAccess& access,
+                            const Expr* reduced = nullptr) {
+        if (&expr == reduced) {
+            return;
+        }
+        if (expr.kind == ExprKind::Identifier && !locals.count(expr.text)) {
+            if (access.reductions.count(expr.text)) {
+                error(expr.line, "pfor reads reduction variable '" + expr.text +
+                      "'; its value is only known after the loop");
+            } else if (access.writtenLists.count(expr.text)) {
+                error(expr.line, "pfor uses all of '" + expr.text + "' while iterations write " + expr.text +
+                      "[" + access.loopVar + "]");
+            }
+            return;
+        }
+        const Expr* base = expr.args.empty() ? nullptr : expr.args[0].get();
+        bool writtenBase = base && base->kind == ExprKind::Identifier && !locals.count(base->text) &&
+                           access.writtenLists.count(base->text);
+        if (writtenBase && expr.kind == ExprKind::Call && expr.text == "len") {
+            return;
+        }
+        if (writtenBase && expr.kind == ExprKind::Index) {
+            if (!isIdentifier(*expr.args[1], access.loopVar)) {
+                error(expr.line, "pfor reads " + expr.str() + " while iterations write " + base->text + "[" +
+                      access.loopVar + "]");
+            }
+            return;
+        }
+        for (const auto& arg : expr.args) {
+            checkParallelReads(*arg, locals, access, reduced);
+        }
+    }
+
+    void checkParallelReads(const StmtList& block, std::set<std::string> locals, const ParallelAccess& access) {
+        for (const auto& stmt : block) {
+            if (stmt->kind == StmtKind::Assign) {
+                const Expr* root = rootVariable(*stmt->target);
+                const Expr* self = nullptr;
+                if (root && stmt->target.get() == root && access.reductions.count(root->text) &&
+                    !locals.count(root->text)) {
+                    reductionOp(*stmt, root->text, self);
+                }
+                for (const Expr* node = stmt->target.get(); node != root && node; node = node->args[0].get()) {
+                    if (node->kind == ExprKind::Index) {
+                        checkParallelReads(*node->args[1], locals, access);
+                    }
+                }
+                checkParallelReads(*stmt->value, locals, access, self);
+            } else if (stmt->kind == StmtKind::Let && access.reductions.count(stmt->name) &&
+                       !locals.count(stmt->name)) {
+                const Expr* self = nullptr;
+                reductionOp(*stmt, stmt->name, self);
+                checkParallelReads(*stmt->value, locals, access, self);
+                continue;
+            } else {
+                for (const ExprPtr* expr : { &stmt->value, &stmt->limit }) {
+                    if (*expr) {
+                        checkParallelReads(**expr, locals, access);
+                    }
+                }
+                for (const auto& arg : stmt->args) {
+                    checkParallelReads(*arg, locals, access);
+                }
+            }
+            std::set<std::string> inner = locals;
+            if (stmt->kind == StmtKind::For) {
+                inner.insert(stmt->name);
+            }
+            checkParallelReads(stmt->body, inner, access);
+            checkParallelReads(stmt->elseBody, inner, access);
+            if (stmt->kind == StmtKind::Let) {
+                locals.insert(stmt->name);
+            }
+        }
+    }
+
+    ParallelAccess checkParallelLoop(const Stmt& stmt) {
+        ParallelAccess access;
+        access.loopVar = stmt.name;
+        access.line = stmt.line;
+        std::set<std::string> locals = { stmt.name };
+        checkParallelWrites(stmt.body, locals, access, 0);
+        checkParallelReads(stmt.body, locals, access);
+        return access;
+    }
+
+    /**
+     * pfor i in range a to b: body  ->
+     *
+     *     parallelFor(a, b, [&](int64_t lo, int64_t hi) {
+     *         T s = 0;                      // partial of each reduction
+     *         for (int64_t i = lo; i < hi; i++) { body }
+     *         lock; total_s = total_s + s;
+     *     });
+     */
+    void emitParallelFor(const Stmt& stmt) {
+        TypeRef startType, limitType;
+        std::string start = emitExpr(*stmt.value, startType);
+        std::string limit = emitExpr(*stmt.limit, limitType);
+        if ((!isError(startType) && startType.name != "int") || (!isError(limitType) && limitType.name != "int")) {
+            error(stmt.line, "range bounds must be int");
+        }
+        ParallelAccess access = checkParallelLoop(stmt);
+        std::string id = std::to_string(++tempCounter);
+        std::string var = mangle(stmt.name);
+        std::string begin = "mya_begin" + id, end = "mya_end" + id;
+        std::string lo = "mya_lo" + id, hi = "mya_hi" + id, lock = "mya_lock" + id;
+
+        indent();
+        out << "{\n";
+        indentLevel++;
+        indent();
+        out << "const int64_t " << begin << " = " << start << ";\n";
+        indent();
+        out << "const int64_t " << end << " = " << limit << ";\n";
+        if (!access.reductions.empty()) {
+            indent();
+            out << "std::mutex " << lock << ";\n";
+        }
+        for (const auto& reduction : access.reductions) {
+            indent();
+            out << cppType(*scope.lookup(reduction.first), stmt.line) << "& mya_total" << id << "_"
+                << reduction.first << " = " << mangle(reduction.first) << ";\n";
+        }
+        if (counts(stmt.profileSite)) {
+            indent();
+            out << "MYA::Runtime::profileLoop(" << stmt.profileSite << ", " << end << " - " << begin << ");\n";
+        }
+        indent();
+        out << "MYA::Runtime::parallelFor(" << begin << ", " << end << ", [&](int64_t " << lo << ", int64_t " << hi
+            << ") {\n";
+        indentLevel++;
+        for (const auto& reduction : access.reductions) {
+            indent();
+            out << cppType(*scope.lookup(reduction.first), stmt.line) << " " << mangle(reduction.first) << " = "
+                << (reduction.second == "*" ? "1" : "0") << ";\n";
+        }
+        indent();
+        out << "int64_t " << var << " = " << lo << ";\n";
+        if (stmt.vectorPlan) {
+            emitVectorDispatch(*stmt.vectorPlan, var, hi);  // Reductions land in the partials
+        }
+        indent();
+        out << "for (; " << var << " < " << hi << "; " << var << "++) {\n";
+        scope.push();
+        scope.declare(stmt.name, TypeRef("int"));
+        int outerLoops = loopDepth;
+        loopDepth = 1;
+        parallelDepth++;
+        emitBlock(stmt.body);
+        parallelDepth--;
+        loopDepth = outerLoops;
+        scope.pop();
+        indent();
+        out << "}\n";
+        if (!access.reductions.empty()) {
+            indent();
+            out << "std::lock_guard<std::mutex> mya_guard(" << lock << ");\n";
+            for (const auto& reduction : access.reductions) {
+                std::string total = "mya_total" + id + "_" + reduction.first;
+                indent();
+                out << total << " = " << total << " " << reduction.second << " " << mangle(reduction.first) << ";\n";
+            }
+        }
+        indentLevel--;
+        indent();
+        out << "});\n";
+        indentLevel--;
+        indent();
+        out << "}\n";
+    }
+
+    // ----- Vectorized loops -----
+
+    std::string kernelName(const VectorLoopPlan& plan, const char* isa) const {
+        return "mya_vloop" + std::to_string(plan.id) + "_" + isa;
+    }
+
+    bool writes(const VectorLoopPlan& plan, const std::string& list) const {
+        return std::find(plan.writtenLists.begin(), plan.writtenLists.end(), list) != plan.writtenLists.end();
+    }
+
+    /**
+     * Lists (read-only first), invariants, then reductions
+     */
+    std::vector<std::string> kernelLists(const VectorLoopPlan& plan) const {
+        std::vector<std::string> lists;
+        for (const auto& name : plan.readLists) {
+            if (!writes(plan, name)) {
+                lists.push_back(name);
+            }
+        }
+        lists.insert(lists.end(), plan.writtenLists.begin(), plan.writtenLists.end());
+        return lists;
+    }
+
+    std::string vectorExpr(const Expr& expr) const {
+        switch (expr.kind) {
+        case ExprKind::Number:
+            return "V::splat(" + expr.text + ")";
+        case ExprKind::Identifier:
+            return "v_" + expr.text;
+        case ExprKind::Index:
+            return "V::load(p_" + expr.args[0]->text + " + i)";
+        case ExprKind::Unary:
+            return "(V::zero() - " + vectorExpr(*expr.args[0]) + ")";
+        default:
+            return "(" + vectorExpr(*expr.args[0]) + " " + expr.text + " " + vectorExpr(*expr.args[1]) + ")";
+        }
+    }
+
+    void emitKernel(const VectorLoopPlan& plan, bool avx2) {
+        std::string element = plan.elementType == "float" ? "double" : "int64_t";
+        std::string vector = std::string(plan.elementType == "float" ? "F64x" : "I64x") + (avx2 ? "4" : "2");
+
+        kernels << (avx2 ? "MYA_TARGET_AVX2 " : "") << "static int64_t " << kernelName(plan, avx2 ? "avx2" : "sse2") << "(";
+        for (const auto& name : kernelLists(plan)) {
+            kernels << (writes(plan, name) ? "" : "const ") << element << "* p_" << name << ", ";
+        }
+        for (const auto& name : plan.invariants) {
+            kernels << cppType(*scope.lookup(name), 0) << " s_" << name << ", ";
+        }
+        for (const auto& name : plan.reductions) {
+            kernels << element << "* r_" << name << ", ";
+        }
+        kernels << "int64_t i, int64_t end) {\n";
+        kernels << "    using V = MYA::Runtime::" << vector << ";\n";
+        for (const auto& name : plan.invariants) {
+            kernels << "    const V v_" << name << " = V::splat(s_" << name << ");\n";
+        }
+        for (const auto& name : plan.reductions) {
+            kernels << "    V acc_" << name << " = V::zero();\n";
+        }
+        kernels << "    for (; i + V::width <= end; i += V::width) {\n";
+        for (const auto& op : plan.ops) {
+            if (op.reduction) {
+                kernels << "        acc_" << op.target << " = acc_" << op.target << " " << op.op << " "
+                        << vectorExpr(*op.value) << ";\n";
+            } else {
+                kernels << "        " << vectorExpr(*op.value) << ".store(p_" << op.target << " + i);\n";
+            }
+        }
+        kernels << "    }\n";
+        for (const auto& name : plan.reductions) {
+            kernels << "    *r_" << name << " += acc_" << name << ".sum();\n";
+        }
+        kernels << "    return i;\n}\n\n";
+    }
+
+    void emitVectorDispatch(const VectorLoopPlan& plan, const std::string& var, const std::string& end) {
+        if (emittedKernels.insert(plan.id).second) {
+            kernels << "#ifdef MYA_RUNTIME_SIMD\n";
+            emitKernel(plan, true);
+            emitKernel(plan, false);
+            kernels << "#endif\n\n";
+        }
+
+        std::string args;
+        for (const auto& name : kernelLists(plan)) {
+            args += mangle(name) + ".data(), ";
+        }
+        for (const auto& name : plan.invariants) {
+            args += mangle(name) + ", ";
+        }
+        for (const auto& name : plan.reductions) {
+            args += "&" + mangle(name) + ", ";
+        }
+        args += var + ", " + end;
+
+        std::string guard = end + " - " + var + " >= 4";
+        for (const auto& name : kernelLists(plan)) {
+            guard += " && MYA::Runtime::inRange(" + mangle(name) + ", " + var + ", " + end + ")";
+        }
+        out << "#ifdef MYA_RUNTIME_SIMD\n";
+        indent();
+        out << "if (" << guard << ") {\n";
+        indent();
+        out << "    " << var << " = MYA::Runtime::cpuHasAVX2() ? " << kernelName(plan, "avx2") << "(" << args
+            << ") : " << kernelName(plan, "sse2") << "(" << args << ");\n";
+        indent();
+        out << "}\n";
+        out << "#endif\n";
+    }
+
+    // ----- Declarations -----
+
+    void emitStruct(const StructDef& def, std::set<std::string>& emitted, std::ostringstream& decls) {
+        if (!emitted.insert(def.name).second) {
+            return;
+        }
+        for (const auto& field : def.fields) {
+            if (const StructDef* nested = program.findStruct(field.type)) {
+                emitStruct(*nested, emitted, decls);
+            }
+        }
+        const StructLayout* layout = layouts.layout(def.name);
+        std::string name = mangle(def.name);
+        decls << "struct " << name << " {\n";
+        std::vector<size_t> order;
+        for (size_t i = 0; i < def.fields.size(); i++) {
+            order.push_back(layout ? layout->memoryOrder[i] : i);
+        }
+        for (size_t index : order) {
+            const StructField& field = def.fields[index];
+            decls << "    " << cppType(parseTypeName(field.type), field.line) << " " << mangle(field.name) << ";\n";
+        }
+        decls << "\n    " << name << "() : ";
+        for (size_t i = 0; i < order.size(); i++) {
+            decls << (i ? ", " : "") << mangle(def.fields[order[i]].name) << "()";
+        }
+        decls << " {}\n    " << name << "(";
+        for (size_t i = 0; i < def.fields.size(); i++) {
+            decls << (i ? ", " : "") << cppType(parseTypeName(def.fields[i].type), def.fields[i].line) << " "
+                  << mangle(def.fields[i].name);
+        }
+        decls << ")\n        : ";
+        for (size_t i = 0; i < order.size(); i++) {
+            std::string field = mangle(def.fields[order[i]].name);
+            decls << (i ? ", " : "") << field << "(" << field << ")";
+        }
+        decls << " {}\n};\n\n";
+    }
+
+    std::string signature(const FunctionDecl& fn) {
+        std::string result = functionAttributes(fn) +
+                             cppType(fn.returnType.empty() ? TypeRef("void") : fn.returnType, fn.line) +
+                             " " + functionName(fn.name) + "(";
+        for (size_t i = 0; i < fn.params.size(); i++) {
+            result += (i ? ", " : "") + paramType(fn.params[i], fn.line) + " " + mangle(fn.params[i].name);
+        }
+        return result + ")";
+    }
+
+    // ----- Tail calls -----
+
+    /**
+     * `acc op value` for returns of a function with an accumulator
+     */
+    std::string accumulate(const std::string& value) const {
+        std::string helper = currentFunction->accumulatorOp == "*" ? "wrapMul" : "wrapAdd";
+        return "MYA::Runtime::" + helper + "(mya_acc, " + value + ")";
+    }
+
+    /**
+     * Lower a self tail call (already type checked, line indented) to
+     * parameter updates and a jump to the top of the function. All new
+     * values are computed before any parameter changes.
+     */
+    void emitTailJump(const Stmt& stmt) {
+        const FunctionDecl& fn = *currentFunction;
+        const Expr& call = tailCallExpr(stmt, fn);
+        out << "{\n";
+        indentLevel++;
+        if (stmt.tailCall == TailCall::Accumulate) {
+            const Expr& term = *stmt.value->args[&call == stmt.value->args[0].get() ? 1 : 0];
+            TypeRef type;
+            std::string code = emitExpr(term, type);
+            indent();
+            out << "mya_acc = " << accumulate(code) << ";\n";
+        }
+        std::vector<size_t> changed;
+        std::vector<std::string> values;
+        for (size_t i = 0; i < call.args.size(); i++) {
+            if (!isParam(*call.args[i], fn.params[i])) {
+                TypeRef type;
+                changed.push_back(i);
+                values.push_back(emitExpr(*call.args[i], type, &fn.params[i].type));
+            }
+        }
+        if (changed.size() == 1) {
+            indent();
+            out << mangle(fn.params[changed[0]].name) << " = " << values[0] << ";\n";
+        } else {
+            for (size_t k = 0; k < changed.size(); k++) {
+                indent();
+                out << cppType(fn.params[changed[k]].type, stmt.line) << " mya_arg" << changed[k] << " = " << values[k] << ";\n";
+            }
+            for (size_t k = 0; k < changed.size(); k++) {
+                const TypeRef& type = fn.params[changed[k]].type;
+                bool scalar = type.name == "int" || type.name == "float" || type.name == "bool";
+                std::string arg = "mya_arg" + std::to_string(changed[k]);
+                indent();
+                out << mangle(fn.params[changed[k]].name) << " = " << (scalar ? arg : "std::move(" + arg + ")") << ";\n";
+            }
+        }
+        indent();
+        out << "goto mya_tail;\n";
+        indentLevel--;
+        indent();
+        out << "}\n";
+    }
+
+    void emitFunction(const FunctionDecl& fn) {
+        currentFunction = &fn;
+        out << signature(fn) << " {\n";
+        if (counts(fn.profileSite)) {
+            out << "    MYA::Runtime::profileCall(" << fn.profileSite << ");\n";  // Before mya_tail: jumps are not calls
+        }
+        if (!fn.accumulatorOp.empty()) {
+            out << "    int64_t mya_acc = " << (fn.accumulatorOp == "*" ? "1" : "0") << ";\n";
+        }
+        if (fn.tailCalls > 0) {
+            out << "mya_tail:;\n";
+        }
+        scope.push();
+        for (const auto& param : fn.params) {
+            scope.declare(param.name, param.type);
+        }
+        emitBlock(fn.body);
+        scope.pop();
+        if (!fn.returnType.empty() && (fn.body.empty() || fn.body.back()->kind != StmtKind::Return)) {
+            std::string value = cppType(fn.returnType, fn.line) + "()";
+            out << "    return " << (fn.accumulatorOp.empty() ? value : accumulate(value)) << ";\n";
+        }
+        out << "}\n\n";
+        currentFunction = nullptr;
+    }
+
+    // ----- Task frames -----
+
+    /**
+     * The wait of a statement that suspends a spawned function: the
+     * recv/await of `let x: T = recv(c);`, `x = await t;`, `return recv(c);`
+     * or a `send(c, v);`, `await t;`, `recv(c);` statement
+     */
+    static const Expr* resumePoint(const Stmt& stmt) {
+        bool placed = stmt.kind == StmtKind::Let || stmt.kind == StmtKind::Assign ||
+                      stmt.kind == StmtKind::Return || stmt.kind == StmtKind::ExprStmt;
+        if (!placed || !stmt.value || !isWait(*stmt.value)) {
+            return nullptr;
+        }
+        return stmt.value->text != "send" || stmt.kind == StmtKind::ExprStmt ? stmt.value.get() : nullptr;
+    }
+
+    /**
+     * Hoist a value that must not be re-evaluated on resumption into a frame
+     * field
+     */
+    std::string frameTemp(const std::string& name, const TypeRef& type, const std::string& value, int line) {
+        declareLocal(type, name, value, line);
+        return name;
+    }
+
+    /**
+     *     mya_state = K;
+     *     // fallthrough
+     * case K:
+     *     if (!MYA::Runtime::recv(*this, c, x, line)) {
+     *         return MYA::Runtime::Step::Blocked;
+     *     }
+     *
+     * A blocked task is resumed at `case K` and retries the operation.
+     * Channel and task operands other than variables, and sent values other
+     * than variables and literals, are evaluated once into frame fields.
+     */
+    void emitResumePoint(const Stmt& stmt, const Expr& wait) {
+        const std::string& what = wait.text;
+        size_t arity = what == "send" ? 2 : 1;
+        if (wait.args.size() != arity) {
+            error(wait.line, DiagnosticMessage::ArgumentCount,
+                  { what, std::to_string(arity), std::to_string(wait.args.size()) });
+            return;
+        }
+        std::string id = std::to_string(++resumePoints);
+        std::string line = std::to_string(wait.line);
+
+        // Channel or task, and what the wait produces
+        TypeRef sourceType, valueType("error");
+        std::string source = emitExpr(*wait.args[0], sourceType);
+        std::string expected = what == "await" ? "task" : "chan";
+        if (sourceType.name == expected) {
+            valueType = sourceType.args.empty() ? TypeRef("void") : sourceType.args[0];
+            if (wait.args[0]->kind != ExprKind::Identifier) {
+                source = frameTemp("mya_wait" + id, sourceType, source, wait.line);
+            }
+        } else if (!isError(sourceType)) {
+            error(wait.line, what + (what == "await" ? "" : "()") + " expects a " + expected + ", got " +
+                             sourceType.str());
+        }
+
+        std::string call = "MYA::Runtime::" + what + "(*this, " + source;
+        if (what == "send") {
+            TypeRef sentType;
+            std::string value = emitExpr(*wait.args[1], sentType, &valueType);
+            if (!assignable(valueType, sentType)) {
+                error(wait.line, "cannot send " + sentType.str() + " on " + sourceType.str());
+            }
+            ExprKind kind = wait.args[1]->kind;
+            if (kind != ExprKind::Identifier && kind != ExprKind::Number && kind != ExprKind::Boolean &&
+                kind != ExprKind::String && !isError(valueType)) {
+                value = frameTemp("mya_send" + id, valueType, value, wait.line);
+            }
+            call += ", " + value;
+        } else if (stmt.kind != StmtKind::ExprStmt || (what == "recv" && !isError(valueType))) {
+            std::string target;
+            TypeRef targetType;
+            switch (stmt.kind) {
+            case StmtKind::Let:
+                target = mangle(stmt.name);
+                if (const TypeRef* existing = scope.lookup(stmt.name)) {
+                    if (!(*existing == stmt.type)) {
+                        error(stmt.line, DiagnosticMessage::Redeclared, { stmt.name, existing->str(), stmt.type.str() });
+                    }
+                    targetType = *existing;
+                } else {
+                    targetType = stmt.type;
+                    scope.declare(stmt.name, stmt.type);
+                    addFrameField(target, stmt.type, stmt.line);
+                }
+                break;
+            case StmtKind::Assign:
+                target = emitExpr(*stmt.target, targetType);
+                break;
+            case StmtKind::Return:
+                target = "mya_result";
+                targetType = currentFunction->returnType.empty() ? TypeRef("void") : currentFunction->returnType;
+                if (targetType.name == "void") {
+                    error(stmt.line, "function '" + currentFunction->name + "' does not return a value");
+                }
+                break;
+            default:  // `recv(c);` discards the value
+                target = "mya_recv" + id;
+                targetType = valueType;
+                addFrameField(target, valueType, wait.line);
+                break;
+            }
+            if (valueType.name == "void") {
+                error(wait.line, "awaited task has no result");
+            } else if (!assignable(targetType, valueType)) {
+                error(stmt.line, DiagnosticMessage::CannotAssign, { valueType.str(), targetType.str() });
+            }
+            call += ", " + target;
+        }
+        call += ", " + line + ")";
+
+        indent();
+        out << "mya_state = " << id << ";\n";
+        indent();
+        out << "// fallthrough\n";
+        indentLevel--;
+        indent();
+        out << "case " << id << ":\n";
+        indentLevel++;
+        indent();
+        out << "if (!" << call << ") {\n";
+        indent();
+        out << "    return MYA::Runtime::Step::Blocked;\n";
+        indent();
+        out << "}\n";
+        if (stmt.kind == StmtKind::Return) {
+            indent();
+            out << "return MYA::Runtime::Step::Done;\n";
+        }
+    }
+
+    /**
+     * A spawned function as a stackless coroutine: a frame struct holding
+     * parameters and locals, whose resume() switches to the last resume
+     * point. Tail calls and regions are not used in frames.
+     */
+    void emitTaskFrame(const FunctionDecl& fn) {
+        currentFunction = &fn;
+        context = Context::Task;
+        frameFields.clear();
+        resumePoints = 0;
+        std::string name = frameName(fn.name);
+
+        std::ostringstream body;
+        out.swap(body);
+        out << "MYA::Runtime::Step " << name << "::resume() {\n    switch (mya_state) {\n    case 0:\n";
+        indentLevel = 1;
+        scope.push();
+        for (const auto& param : fn.params) {
+            scope.declare(param.name, param.type);
+        }
+        emitBlock(fn.body);
+        scope.pop();
+        indentLevel = 0;
+        if (fn.body.empty()) {
+            out << "        break;\n";
+        }
+        out << "    }\n    return MYA::Runtime::Step::Done;\n}\n\n";
+        out.swap(body);
+        out << body.str();
+
+        std::string result = fn.returnType.empty() ? "void" : cppType(fn.returnType, fn.line);
+        taskDecls << "struct " << name << " : MYA::Runtime::TaskFrame<" << result
+                  << (result.back() == '>' ? " >" : ">") << " {\n";
+        for (const auto& param : fn.params) {
+            taskDecls << "    " << cppType(param.type, fn.line) << " " << mangle(param.name) << ";\n";
+        }
+        for (const auto& field : frameFields) {
+            taskDecls << "    " << cppType(field.second, fn.line) << " " << field.first << "{};\n";
+        }
+        taskDecls << "\n    " << (fn.params.size() == 1 ? "explicit " : "") << name << "(";
+        for (size_t i = 0; i < fn.params.size(); i++) {
+            taskDecls << (i ? ", " : "") << cppType(fn.params[i].type, fn.line) << " " << mangle(fn.params[i].name);
+        }
+        taskDecls << ")";
+        for (size_t i = 0; i < fn.params.size(); i++) {
+            std::string param = mangle(fn.params[i].name);
+            taskDecls << (i ? ", " : "\n        : ") << param << "(std::move(" << param << "))";
+        }
+        taskDecls << " {}\n\n    MYA::Runtime::Step resume() override;\n};\n\n";
+        currentFunction = nullptr;
+    }
+
+public:
+    CppCodegen(const Program& program, const StructLayoutEngine& layouts)
+        : program(program), layouts(layouts) {}
+
+    /**
+     * Count the sites numbered in program.profileSites; the program writes
+     * its profile to MYA_PROFILE_FILE or `file`
+     */
+    void setInstrumentation(const std::string& file) {
+        instrumenting = true;
+        profileFile = file;
+    }
+
+    /**
+     * Generate the translation unit; returns false on semantic errors
+     */
+    bool generate(std::string& source) {
+        std::ostringstream decls;
+        std::set<std::string> emittedStructs;
+        for (const auto& def : program.structs) {
+            emitStruct(def, emittedStructs, decls);
+        }
+
+        std::set<std::string> names;
+        const FunctionDecl* mainFn = nullptr;
+        for (const auto& fn : program.functions) {
+            if (!names.insert(fn.name).second) {
+                error(fn.line, DiagnosticMessage::DuplicateFunction, { fn.name });
+            }
+            if (program.findStruct(fn.name)) {
+                error(fn.line, "function '" + fn.name + "' has the same name as a struct");
+            }
+            if (fn.isMain) {
+                mainFn = &fn;
+            }
+        }
+
+        // Parameters that are modified are passed by value
+        std::vector<std::set<std::string>> mutated(program.functions.size());
+        for (size_t i = 0; i < program.functions.size(); i++) {
+            collectMutations(program.functions[i].body, mutated[i]);
+            collectTailCallParams(program.functions[i].body, program.functions[i], mutated[i]);
+            planRegions(program.functions[i].body);
+        }
+        planRegions(program.topLevel);
+
+        // Spawned functions that wait only exist as frames
+        for (const auto& fn : program.functions) {
+            collectSpawns(fn.body, taskFunctions);
+        }
+        collectSpawns(program.topLevel, taskFunctions);
+        for (const auto& fn : program.functions) {
+            if (taskFunctions.count(fn.name) && !fn.isMain && waits(fn.body)) {
+                frameOnly.insert(fn.name);
+            }
+        }
+
+        for (size_t i = 0; i < program.functions.size(); i++) {
+            const FunctionDecl& fn = program.functions[i];
+            if (&fn == program.findFunction(fn.name) && !frameOnly.count(fn.name) && !fn.evaluated) {
+                mutableNames = mutated[i];
+                decls << signature(fn) << ";\n";
+            }
+        }
+        decls << "\n";
+
+        for (size_t i = 0; i < program.functions.size(); i++) {
+            const FunctionDecl& fn = program.functions[i];
+            if (&fn != program.findFunction(fn.name)) {
+                continue;  // Duplicate already reported
+            }
+            mutableNames = mutated[i];
+            if (fn.evaluated) {
+                std::ostringstream removed;  // Every call was evaluated: checked, not emitted
+                out.swap(removed);
+                context = Context::Plain;
+                emitFunction(fn);
+                out.swap(removed);
+            } else if (!frameOnly.count(fn.name)) {
+                context = fn.isMain ? Context::Thread : Context::Plain;
+                emitFunction(fn);
+            }
+            if (taskFunctions.count(fn.name) && !fn.isMain) {
+                emitTaskFrame(fn);
+            }
+        }
+
+        mutableNames.clear();
+        context = Context::Thread;
+        out << "int main() {\n";
+        if (instrumenting) {
+            out << "    MYA::Runtime::startProfile(" << (program.profileSites.empty() ? "nullptr" : "mya_profile_sites")
+                << ", " << program.profileSites.size() << ", " << quoted(profileFile) << ");\n";
+        }
+        emitBlock(program.topLevel);
+        if (mainFn) {
+            out << "    " << functionName("Main") << "();\n";
+        }
+        out << "    MYA::Runtime::flush();\n    return 0;\n}\n";
+
+        std::ostringstream unit;
+        unit << "// Generated by the MYA compiler (C++ backend)\n"
+             << "#include <cstdint>\n#include <string>\n#include <utility>\n"
+             << "#include \"MYARuntime.h\"\n#include \"MYARuntimeSimd.h\"\n\n";
+        if (instrumenting && !program.profileSites.empty()) {
+            unit << "// Profile sites: kind (0 function, 1 if, 2 filter, 3 loop), line\n"
+                 << "static const MYA::Runtime::ProfileSite mya_profile_sites[] = {";
+            for (size_t i = 0; i < program.profileSites.size(); i++) {
+                unit << (i % 8 ? " " : "\n    ") << "{ " << static_cast<int>(program.profileSites[i].kind) << ", "
+                     << program.profileSites[i].line << " },";
+            }
+            unit << "\n};\n\n";
+        }
+        unit << decls.str() << taskDecls.str() << kernels.str() << out.str();
+        source = unit.str();
+        return diagnostics.empty();
+    }
+
+    const std::vector<CodegenDiagnostic>& getDiagnostics() const {
+        return diagnostics;
+    }
+};
+
+} // namespace MYA
+
+#endif // MYA_CODEGEN_H
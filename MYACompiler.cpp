@@ -8,11 +8,24 @@
  * - AST generation (placeholder for future ANTLR integration)
  */
 
+#include <algorithm>
 #include <iostream>
 #include <fstream>
 #include <string>
 #include <sstream>
+#include <cctype>
+#include <vector>
 #include "MYAIndentationPreprocessor.h"
+#include "MYARenderScene.h"
+#include "MYAAssembler.h"
+#include "MYAStructLayout.h"
+#include "MYAASTBuilder.h"
+#include "MYAOptimizer.h"
+#include "MYACodegen.h"
+#include "MYADiagnostics.h"
+#include "MYAFormatter.h"
+#include "MYAFuzz.h"
+#include "MYALanguageServer.h"
 
 using namespace MYA;
 
@@ -20,7 +33,7 @@ using namespace MYA;
  * Read file contents into string
  */
 std::string readFile(const std::string& filename) {
-    std::ifstream file(filename);
+    std::ifstream file(filename, std::ios::binary);  // Keep CRLF: the trivia table is byte-exact
     if (!file.is_open()) {
         throw std::runtime_error("Could not open file: " + filename);
     }
@@ -42,10 +55,10 @@ Main() fn:
     let y: int = 20;
     print "Starting MYA program";
     
- filter x > 0 pass:
+    filter x > 0 pass:
         print "X is positive";
     
-  for i in range 0 to 5:
+    for i in range 0 to 5:
         print "Iteration:", i;
         multiply(x, i);
 
@@ -55,11 +68,11 @@ fn multiply(a: int, b: int) -> int:
     return result;
 
 fn divide(a: int, b: int) -> int:
-  filter b == 0 pass:
+    filter b == 0 pass:
         print "Error: Division by zero";
-   return 0;
+        return 0;
     
-let result: int = a / b;
+    let result: int = a / b;
     return result;
 
 struct Point:
@@ -71,8 +84,8 @@ end
 render:
     viewport: 800x600
     camera:
-      position: 0, 0, 10
-  target: 0, 0, 0
+        position: 0, 0, 10
+        target: 0, 0, 0
     
     object: cube
         position: 0, 0, 0
@@ -86,6 +99,26 @@ asm:
 end
 )";
 
+/**
+ * Write a compilation's diagnostics to stderr as one batch, at most `limit`
+ * of them (0 for all); returns how many were written
+ */
+size_t printDiagnostics(DiagnosticEngine& engine, DiagnosticBuffer&& buffer, DiagnosticFormat format, size_t limit,
+                        bool limitReached = false) {
+    engine.merge(std::move(buffer));
+    std::vector<DiagnosticView> views = engine.collect();
+    bool truncated = limitReached || (limit && views.size() > limit);
+    if (limit && views.size() > limit) {
+        views.resize(limit);
+    }
+    std::string out = DiagnosticEngine::render(views, format);
+    if (truncated && format == DiagnosticFormat::Text) {
+        out += "Too many errors; stopped after " + std::to_string(limit) + " (see --max-errors)\n";
+    }
+    std::cerr << out << std::flush;
+    return views.size();
+}
+
 /**
  * Display usage information
  */
@@ -98,6 +131,33 @@ void printUsage() {
     std::cout << "  --test           Run with built-in test code\n";
     std::cout << "  --tokens    Display preprocessed tokens\n";
     std::cout << "  --scope-ledger   Display scope ledger for lateral parsing\n";
+    std::cout << "  --tab-width <n>  Columns per tab (default: 4, or detected when a file mixes tabs and spaces)\n";
+    std::cout << "  --format <f>     Write the source re-indented with 4 spaces per level\n";
+    std::cout << "  --render-scene   Display the lowered render scene (SoA batches)\n";
+    std::cout << "  --dump-frame <f> Rasterize the render scene headlessly to a PPM file\n";
+    std::cout << "  --asm            Display the integrated assembler listing\n";
+    std::cout << "  --emit-obj <f>   Write asm blocks as an x64 COFF object file\n";
+    std::cout << "  --ast            Display the abstract syntax tree\n";
+    std::cout << "  --emit-cpp <f>   Write the program as C++ (compile with the MYARuntime headers)\n";
+    std::cout << "  --no-vectorize   Disable the loop vectorizer\n";
+    std::cout << "  --no-tail-calls  Keep self-recursive tail calls as calls\n";
+    std::cout << "  --no-const-eval  Keep calls to pure functions and constant lets for run time\n";
+    std::cout << "  --eval-fuel <n>  Interpreter steps per compile-time call (default 100000)\n";
+    std::cout << "  --opt-report     Display optimization remarks\n";
+    std::cout << "  --instrument     Emit C++ that counts calls, branches and loop trips into <source>.myaprof\n";
+    std::cout << "  --profile-use <f>  Optimize with a profile written by an --instrument build\n";
+    std::cout << "  --struct-layout  Display computed struct layouts\n";
+    std::cout << "  --soa <struct>   Store lists of <struct> as structure-of-arrays\n";
+    std::cout << "  --max-errors <n> Stop after n errors (default 100, 0 for no limit)\n";
+    std::cout << "  --diagnostics-format <text|json|sarif>  Format of errors written to stderr\n";
+    std::cout << "  --lsp            Run as a language server on stdin/stdout\n";
+    std::cout << "  --bench <name> [n]  Run a built-in benchmark (render, struct, vector, alloc, print, filter,\n";
+    std::cout << "                      containers, tailcall, pfor, chan, lsp, diag,\n";
+    std::cout << "                      preprocess, pgo, consteval)\n";
+    std::cout << "  --fuzz <target> [n] [seed.mya]  Fuzz a front-end stage (preprocessor, format, lexer, parser,\n";
+    std::cout << "                      pipeline, diff) with n generated inputs after the seeds;\n";
+    std::cout << "                      MYA_FUZZ_SEED=<number> reproduces a run\n";
+    std::cout << "  --fuzz-budget <ms>  Report fuzz inputs slower than this (default 200)\n";
     std::cout << "  --help       Display this help message\n\n";
     std::cout << "Features:\n";
     std::cout << "  - Recursive Linear Parsing: Sequential syntactic processing\n";
@@ -114,6 +174,31 @@ int main(int argc, char* argv[]) {
     bool showTokens = false;
      bool showScopeLedger = false;
         bool useTestCode = false;
+        int tabWidth = 0;
+        std::string formatFile;
+        bool showRenderScene = false;
+        std::string frameFile;
+        bool showAsm = false;
+        std::string objectFile;
+        bool showStructLayout = false;
+        std::vector<std::string> soaStructs;
+        bool showAst = false;
+        std::string cppFile;
+        bool vectorize = true;
+        bool tailCalls = true;
+        bool evaluate = true;
+        long long evaluationFuel = 100000;
+        bool showOptReport = false;
+        bool instrument = false;
+        std::string profileFile;
+        size_t maxErrors = 100;
+        DiagnosticFormat diagnosticFormat = DiagnosticFormat::Text;
+        bool languageServer = false;
+        std::string benchName;
+        size_t benchCount = 0;
+        std::string fuzzTarget;
+        size_t fuzzCount = 10000;
+        double fuzzBudget = 200;
         std::string sourceFile;
         
         // Parse command line arguments
@@ -129,11 +214,120 @@ int main(int argc, char* argv[]) {
     showTokens = true;
             } else if (arg == "--scope-ledger") {
            showScopeLedger = true;
+            } else if (arg == "--tab-width" && i + 1 < argc) {
+                tabWidth = std::stoi(argv[++i]);
+            } else if (arg == "--format" && i + 1 < argc) {
+                formatFile = argv[++i];
+            } else if (arg == "--render-scene") {
+                showRenderScene = true;
+            } else if (arg == "--dump-frame" && i + 1 < argc) {
+                frameFile = argv[++i];
+            } else if (arg == "--asm") {
+                showAsm = true;
+            } else if (arg == "--emit-obj" && i + 1 < argc) {
+                objectFile = argv[++i];
+            } else if (arg == "--ast") {
+                showAst = true;
+            } else if (arg == "--emit-cpp" && i + 1 < argc) {
+                cppFile = argv[++i];
+            } else if (arg == "--no-vectorize") {
+                vectorize = false;
+            } else if (arg == "--no-tail-calls") {
+                tailCalls = false;
+            } else if (arg == "--no-const-eval") {
+                evaluate = false;
+            } else if (arg == "--eval-fuel" && i + 1 < argc) {
+                evaluationFuel = std::stoll(argv[++i]);
+            } else if (arg == "--opt-report") {
+                showOptReport = true;
+            } else if (arg == "--instrument") {
+                instrument = true;
+            } else if (arg == "--profile-use" && i + 1 < argc) {
+                profileFile = argv[++i];
+            } else if (arg == "--struct-layout") {
+                showStructLayout = true;
+            } else if (arg == "--soa" && i + 1 < argc) {
+                soaStructs.push_back(argv[++i]);
+            } else if (arg == "--max-errors" && i + 1 < argc) {
+                maxErrors = std::stoul(argv[++i]);
+            } else if (arg == "--diagnostics-format" && i + 1 < argc) {
+                if (!parseDiagnosticFormat(argv[++i], diagnosticFormat)) {
+                    std::cerr << "Unknown diagnostics format: " << argv[i] << " (text, json or sarif)" << std::endl;
+                    return 1;
+                }
+            } else if (arg == "--lsp") {
+                languageServer = true;
+            } else if (arg == "--fuzz" && i + 1 < argc) {
+                fuzzTarget = argv[++i];
+                if (i + 1 < argc && std::isdigit(static_cast<unsigned char>(argv[i + 1][0]))) {
+                    fuzzCount = std::stoul(argv[++i]);
+                }
+            } else if (arg == "--fuzz-budget" && i + 1 < argc) {
+                fuzzBudget = std::stod(argv[++i]);
+            } else if (arg == "--bench" && i + 1 < argc) {
+                benchName = argv[++i];
+                if (i + 1 < argc && std::isdigit(static_cast<unsigned char>(argv[i + 1][0]))) {
+                    benchCount = std::stoul(argv[++i]);
+                }
      } else if (arg[0] != '-') {
         sourceFile = arg;
  }
   }
  
+        // The language server owns stdout for the protocol
+        if (languageServer) {
+            LanguageServer server;
+            return server.run();
+        }
+
+        // The fuzzer's seeds are the built-in example and the source file, if any
+        if (!fuzzTarget.empty()) {
+            std::vector<std::string> seeds = { EXAMPLE_MYA_CODE };
+            if (!sourceFile.empty()) {
+                seeds.push_back(readFile(sourceFile));
+            }
+            return runFuzzer(fuzzTarget, fuzzCount, seeds, fuzzBudget);
+        }
+
+        // Built-in benchmarks do not need a source file
+        if (!benchName.empty()) {
+            if (benchName == "render") {
+                runRenderBenchmark(benchCount ? benchCount : 100000);
+            } else if (benchName == "struct") {
+                runStructLayoutBenchmark(benchCount ? benchCount : 1000000);
+            } else if (benchName == "vector") {
+                runVectorizeBenchmark(benchCount ? benchCount : 65536);
+            } else if (benchName == "alloc") {
+                Runtime::runAllocBenchmark(benchCount ? benchCount : 1000000);
+            } else if (benchName == "print") {
+                Runtime::runPrintBenchmark(benchCount ? benchCount : 1000000);
+            } else if (benchName == "filter") {
+                runFilterBenchmark(benchCount ? benchCount : 65536);
+            } else if (benchName == "tailcall") {
+                runTailCallBenchmark(benchCount ? benchCount : 10000000);
+            } else if (benchName == "containers") {
+                Runtime::runContainerBenchmark(benchCount ? benchCount : 1000000);
+            } else if (benchName == "pfor") {
+                Runtime::runParallelBenchmark(benchCount ? benchCount : 1000000);
+            } else if (benchName == "chan") {
+                Runtime::runChannelBenchmark(benchCount ? benchCount : 100000);
+            } else if (benchName == "lsp") {
+                runLanguageServerBenchmark(benchCount ? benchCount : 1000000);
+            } else if (benchName == "preprocess") {
+                runPreprocessorBenchmark(benchCount ? benchCount : 1000000);
+            } else if (benchName == "pgo") {
+                runProfileBenchmark(benchCount ? benchCount : 1200);
+            } else if (benchName == "consteval") {
+                runConstantEvalBenchmark(benchCount ? benchCount : 1000);
+            } else if (benchName == "diag") {
+                runDiagnosticsBenchmark(benchCount ? benchCount : 1000000);
+            } else {
+                std::cerr << "Unknown benchmark: " << benchName << std::endl;
+                return 1;
+            }
+            return 0;
+        }
+
         // Get source code
         std::string sourceCode;
         if (useTestCode) {
@@ -147,12 +341,35 @@ int main(int argc, char* argv[]) {
             return 1;
    }
         
+        // Phases record diagnostics here; they are written once, when compilation stops
+        DiagnosticEngine diagnosticEngine;
+        DiagnosticBuffer diagnostics(useTestCode ? "<test>" : sourceFile);
+        bool textDiagnostics = diagnosticFormat == DiagnosticFormat::Text;
+
         // Phase 1: Indentation Preprocessing
         std::cout << "=== Phase 1: Indentation Preprocessing ===\n";
-    IndentationPreprocessor preprocessor(4);  // 4 spaces per indent
+    IndentationPreprocessor preprocessor(tabWidth > 0 ? tabWidth : 4);  // Tab width detected unless given
+        preprocessor.setDetectTabWidth(tabWidth <= 0);
         auto tokens = preprocessor.process(sourceCode);
         
-        std::cout << "Preprocessed " << tokens.size() << " tokens.\n\n";
+        const IndentationStyle& style = preprocessor.getStyle();
+        std::cout << "Preprocessed " << tokens.size() << " tokens.\n";
+        std::cout << "Indentation: " << style.indentUnit << " columns per level, "
+                  << (style.usesTabs ? (style.usesSpaces ? "tabs and spaces" : "tabs") : "spaces") << ", tab width "
+                  << style.tabWidth << (style.tabWidthDetected ? " (detected)" : "") << ".\n\n";
+
+        if (!formatFile.empty()) {
+            std::string formatted;
+            if (!SourceFormatter().format(preprocessor, tokens, formatted)) {
+                std::cout << "Not formatted: the file has indentation errors.\n\n";
+            } else {
+                std::ofstream formatOut(formatFile, std::ios::binary);
+                if (!(formatOut << formatted)) {
+                    throw std::runtime_error("Could not write formatted source: " + formatFile);
+                }
+                std::cout << "Formatted source written to " << formatFile << "\n\n";
+            }
+        }
         
         if (showTokens) {
      preprocessor.printTokens();
@@ -166,38 +383,221 @@ int main(int argc, char* argv[]) {
         
         // Phase 2: Lexical Analysis (Future: ANTLR4 Lexer)
         std::cout << "=== Phase 2: Lexical Analysis ===\n";
-        std::cout << "Status: Awaiting ANTLR4 lexer integration\n";
+        std::cout << "Status: Code lines are tokenized by the AST builder\n";
       std::cout << "Grammar file: MYA.g4\n\n";
      
-        // Phase 3: Parsing (Future: ANTLR4 Parser)
+        // Phase 3: Parsing
         std::cout << "=== Phase 3: Recursive Linear + Lateral Parsing ===\n";
-   std::cout << "Status: Awaiting ANTLR4 parser integration\n";
-std::cout << "Parser features:\n";
-     std::cout << "  - Recursive linear parsing (sequential)\n";
-        std::cout << "  - Non-linear lateral recursion (sibling scopes)\n";
-        std::cout << "  - Scope ledger for context awareness\n\n";
+        ASTBuilder astBuilder;
+        astBuilder.setErrorLimit(maxErrors);
+        Program program = astBuilder.build(tokens);
+        std::cout << "Parsed " << program.functions.size() << " functions, " << program.structs.size()
+                  << " structs, " << program.renderLines.size() << " render and "
+                  << program.asmLines.size() << " asm blocks.\n\n";
+
+        for (const auto& diagnostic : preprocessor.getDiagnostics()) {
+            diagnostics.report(DiagnosticKind::Indentation, diagnostic.line, diagnostic.column, diagnostic.message);
+        }
+        for (const auto& diagnostic : astBuilder.getDiagnostics()) {
+            diagnostics.report(DiagnosticKind::Parse, diagnostic.line, diagnostic.column, diagnostic.message);
+        }
+        if (!diagnostics.empty()) {
+            size_t parseErrors = printDiagnostics(diagnosticEngine, std::move(diagnostics), diagnosticFormat, maxErrors,
+                                                  astBuilder.errorLimitReached());
+            if (textDiagnostics) {
+                std::cerr << "Compilation failed: " << parseErrors << " parse error(s)" << std::endl;
+            }
+            return 1;
+        }
    
-        // Phase 4: AST Generation (Future)
+        // Phase 4: AST Generation
         std::cout << "=== Phase 4: AST Generation ===\n";
-        std::cout << "Status: Pending parser completion\n\n";
-   
-   // Phase 5: Semantic Analysis (Future)
-      std::cout << "=== Phase 5: Semantic Analysis ===\n";
-        std::cout << "Status: Pending AST generation\n\n";
-        
-    // Phase 6: Code Generation (Future: WASM -> NASM -> PE)
-  std::cout << "=== Phase 6: Code Generation ===\n";
-     std::cout << "Status: Planned\n";
-     std::cout << "Target pipeline: WASM -> NASM -> PE\n\n";
+        std::cout << "Status: AST built (MYAAST.h)\n\n";
+
+        if (showAst) {
+            ASTPrinter().print(program);
+            std::cout << std::endl;
+        }
+
+        // Struct layouts and list representations
+        StructLayoutEngine structLayouts;
+        bool structsOk = structLayouts.computeAll(collectStructDefs(tokens));
+        for (const auto& diagnostic : structLayouts.getDiagnostics()) {
+            diagnostics.report(DiagnosticKind::Struct, diagnostic.line, -1, diagnostic.message);
+        }
+        for (const auto& name : soaStructs) {
+            if (!structLayouts.layout(name)) {
+                diagnostics.report(DiagnosticMessage::UnknownSoaStruct, 0, -1, { name });
+                structsOk = false;
+            }
+        }
+        std::cout << "=== Struct Layout ===\n";
+        std::cout << "Laid out " << structLayouts.getLayouts().size() << " structs.\n\n";
+
+        if (showStructLayout) {
+            structLayouts.printLayouts();
+            for (const auto& name : soaStructs) {
+                std::cout << "list of " << name << ": structure-of-arrays\n";
+            }
+            std::cout << std::endl;
+        }
+
+        if (!structsOk) {
+            printDiagnostics(diagnosticEngine, std::move(diagnostics), diagnosticFormat, maxErrors);
+            if (textDiagnostics) {
+                std::cerr << "Compilation failed: struct layout errors" << std::endl;
+            }
+            return 1;
+        }
+
+        // Phase 5: Optimization
+        std::cout << "=== Phase 5: Optimization ===\n";
+        ProfileData profileData;
+        if (!profileFile.empty() && !profileData.load(profileFile)) {
+            throw std::runtime_error("Could not read profile: " + profileFile);
+        }
+        OptimizerOptions optimizerOptions;
+        optimizerOptions.vectorize = vectorize;
+        optimizerOptions.evaluate = evaluate;
+        optimizerOptions.evaluationFuel = evaluationFuel;
+        optimizerOptions.tailCalls = tailCalls;
+        optimizerOptions.instrument = instrument;
+        optimizerOptions.profile = profileFile.empty() ? nullptr : &profileData;
+        Optimizer optimizer(optimizerOptions);
+        optimizer.run(program);
+        const ConstantEvalStats& evalStats = optimizer.getEvalStats();
+        std::cout << "Evaluated " << evalStats.callsEvaluated << " calls, " << evalStats.constantsFolded
+                  << " constants and " << evalStats.expressionsFolded << " expressions at compile time";
+        if (evaluate) {
+            std::cout << ": " << evalStats.pureFunctions << " pure functions, " << evalStats.functionsRemoved
+                      << " no longer emitted, " << evalStats.steps << " steps in "
+                      << evalStats.seconds * 1000.0 << " ms";
+        } else {
+            std::cout << " (disabled)";
+        }
+        std::cout << ".\n";
+        std::cout << "Removed " << optimizer.getFiltersRemoved() << " provably false filters.\n";
+        std::cout << "Eliminated tail recursion in " << optimizer.getTailCallFunctions() << " functions"
+                  << (tailCalls ? "" : " (disabled)") << ".\n";
+        std::cout << "Vectorized " << optimizer.getLoopsVectorized() << " loops"
+                  << (vectorize ? "" : " (vectorizer disabled)") << ".\n";
+        if (!profileFile.empty()) {
+            const ProfileGuidedStats& stats = optimizer.getProfileStats();
+            std::cout << "Applied profile " << profileFile << " (" << profileData.getRuns() << " runs): "
+                      << stats.matched << " of " << stats.sites << " sites matched"
+                      << (stats.stale ? ", recorded from a different version of the program" : "") << ".\n";
+            std::cout << "Inlined " << stats.inlined << ", hot " << stats.hot << ", cold " << stats.cold
+                      << " functions; hinted " << stats.branchesHinted << " branches, moved " << stats.coldBlocks
+                      << " blocks out of line, unrolled " << stats.loopsUnrolled << " loops.\n";
+        }
+        std::cout << "\n";
+
+        if (showOptReport) {
+            optimizer.printReport();
+            std::cout << std::endl;
+        }
+
+        // Phase 6: Code Generation (C++ backend; WASM -> NASM -> PE planned)
+        std::cout << "=== Phase 6: Code Generation ===\n";
+        CppCodegen codegen(program, structLayouts);
+        std::string instrumentedProfile;
+        if (instrument) {
+            // <source stem>.myaprof in the directory the program runs in
+            std::string stem = useTestCode ? "test" : sourceFile.substr(sourceFile.find_last_of("/\\") + 1);
+            instrumentedProfile = stem.substr(0, stem.rfind('.')) + ".myaprof";
+            codegen.setInstrumentation(instrumentedProfile);
+        }
+        std::string cppSource;
+        bool codegenOk = codegen.generate(cppSource);
+        for (const auto& diagnostic : codegen.getDiagnostics()) {
+            diagnostics.report(diagnostic.message, diagnostic.line, -1, diagnostic.args);
+        }
+        if (!codegenOk) {
+            size_t semanticErrors = printDiagnostics(diagnosticEngine, std::move(diagnostics), diagnosticFormat, maxErrors);
+            if (textDiagnostics) {
+                std::cerr << "Compilation failed: " << semanticErrors << " semantic error(s)" << std::endl;
+            }
+            return 1;
+        }
+        std::cout << "Generated " << cppSource.size() << " bytes of C++.\n";
+        if (!cppFile.empty()) {
+            std::ofstream cppOut(cppFile);
+            if (!(cppOut << cppSource)) {
+                throw std::runtime_error("Could not write C++ file: " + cppFile);
+            }
+            std::cout << "C++ written to " << cppFile << "\n";
+            if (instrument) {
+                std::cout << "Instrumented " << program.profileSites.size() << " sites; the program writes "
+                          << instrumentedProfile << " (or MYA_PROFILE_FILE)\n";
+            }
+        }
+        std::cout << std::endl;
+
+        // Render blocks are lowered straight from the token stream
+        RenderLowering renderLowering;
+        RenderScene scene = renderLowering.lower(tokens);
+        std::cout << "=== Render Lowering ===\n";
+        std::cout << "Lowered " << scene.size() << " render objects into "
+                  << scene.batches.size() << " batches.\n\n";
+
+        if (showRenderScene) {
+            scene.print();
+            std::cout << std::endl;
+        }
+
+        if (!frameFile.empty()) {
+            SoftwareRasterizer rasterizer(scene.viewportWidth, scene.viewportHeight);
+            size_t visible = rasterizer.draw(scene);
+            if (!rasterizer.writePPM(frameFile)) {
+                throw std::runtime_error("Could not write frame: " + frameFile);
+            }
+            std::cout << "Frame written to " << frameFile << " (" << visible << " objects visible)\n\n";
+        }
+
+        // Asm blocks are encoded by the integrated assembler
+        NativeObject nativeObject;
+        Assembler assembler(nativeObject);
+        assembler.bindProgramVariables(tokens);
+        auto asmBlocks = collectAsmBlocks(tokens);
+        bool asmOk = assembler.assembleAll(asmBlocks);
+        std::cout << "=== Integrated Assembler ===\n";
+        std::cout << "Assembled " << asmBlocks.size() << " asm blocks into "
+                  << nativeObject.getText().size() << " bytes.\n\n";
+
+        for (const auto& diagnostic : assembler.getDiagnostics()) {
+            diagnostics.report(DiagnosticKind::Assembler, diagnostic.line, -1, diagnostic.message);
+        }
+
+        if (showAsm) {
+            assembler.printListing();
+            nativeObject.printSummary();
+            std::cout << std::endl;
+        }
+
+        if (!asmOk) {
+            size_t asmErrors = printDiagnostics(diagnosticEngine, std::move(diagnostics), diagnosticFormat, maxErrors);
+            if (textDiagnostics) {
+                std::cerr << "Compilation failed: " << asmErrors << " assembler error(s)" << std::endl;
+            }
+            return 1;
+        }
+
+        if (!objectFile.empty()) {
+            if (!nativeObject.writeCOFF(objectFile)) {
+                throw std::runtime_error("Could not write object file: " + objectFile);
+            }
+            std::cout << "Object written to " << objectFile << "\n\n";
+        }
  
-        std::cout << "Preprocessing completed successfully!\n";
+        if (!textDiagnostics || !diagnostics.empty()) {
+            printDiagnostics(diagnosticEngine, std::move(diagnostics), diagnosticFormat, maxErrors);
+        }
+        std::cout << "Compilation completed successfully!\n";
     std::cout << "\nNext steps:\n";
      std::cout << "1. Install ANTLR4 runtime for C++\n";
         std::cout << "2. Generate lexer/parser from MYA.g4\n";
         std::cout << "3. Integrate with IndentationPreprocessor\n";
-      std::cout << "4. Implement AST visitor pattern\n";
-        std::cout << "5. Build semantic analyzer\n";
-        std::cout << "6. Implement WASM codegen backend\n";
+        std::cout << "4. Implement WASM codegen backend\n";
   
         return 0;
  
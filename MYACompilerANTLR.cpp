@@ -12,8 +12,10 @@
 
 #include <iostream>
 #include <fstream>
+#include <set>
 #include <string>
 #include <sstream>
+#include <vector>
 
 // ANTLR4 includes
 #include "antlr4-runtime.h"
@@ -24,6 +26,7 @@
 // MYA includes
 #include "MYAIndentationPreprocessor.h"
 #include "MYACustomTokenStream.h"
+#include "MYADiagnostics.h"
 
 using namespace antlr4;
 using namespace MYA;
@@ -59,21 +62,95 @@ fn add(a: int, b: int) -> int:
 
 
 /**
- * Custom error listener for better error reporting
+ * Custom error listener: records syntax errors in a DiagnosticBuffer so that
+ * one pass reports all of them; at the limit it cancels the parse, as
+ * ASTBuilder::report does, instead of recovering through the rest of the file
  */
 class MYAErrorListener : public BaseErrorListener {
 public:
+    MYAErrorListener(DiagnosticBuffer& diagnostics, size_t limit) : diagnostics(diagnostics), limit(limit) {}
+
     void syntaxError(
         Recognizer* /*recognizer*/,
-        Token* /*offendingSymbol*/,
+        antlr4::Token* /*offendingSymbol*/,
         size_t line,
         size_t charPositionInLine,
         const std::string& msg,
-      std::exception_ptr /*e*/) override {
-        
-    std::cerr << "Syntax error at line " << line << ":" << charPositionInLine 
-    << " - " << msg << std::endl;
-}
+        std::exception_ptr /*e*/) override {
+        diagnostics.report(DiagnosticKind::Parse, static_cast<int>(line), static_cast<int>(charPositionInLine), msg);
+        reported++;
+        if (limit && reported >= limit) {
+            truncated = true;
+            throw ParseCancellationException("error limit reached");
+        }
+    }
+
+    bool isTruncated() const {
+        return truncated;
+    }
+
+private:
+    DiagnosticBuffer& diagnostics;
+    size_t limit;
+    size_t reported = 0;
+    bool truncated = false;
+};
+
+/**
+ * Error strategy that resyncs at the next top-level `fn`/`Main`/`struct`/
+ * `render`/`asm` token in column 0, instead of the default single-token
+ * repairs that cascade on broken indentation. All three repair points are
+ * overridden: recoverInline and sync would otherwise insert or delete
+ * tokens before recover ever runs.
+ */
+class MYATopLevelErrorStrategy : public DefaultErrorStrategy {
+private:
+    size_t lastResync = static_cast<size_t>(-1);
+    std::set<size_t> resyncStates;  // ATN states that already recovered at lastResync
+
+    static bool isBoundary(antlr4::Token* token) {
+        if (token->getCharPositionInLine() != 0) {
+            return false;
+        }
+        const std::string text = token->getText();
+        return text == "fn" || text == "Main" || text == "struct" || text == "render" || text == "asm";
+    }
+
+public:
+    /**
+     * Skip to the boundary and leave it unconsumed, so the enclosing rules
+     * unwind to the one that can start a declaration there
+     */
+    void recover(Parser* recognizer, std::exception_ptr e) override {
+        TokenStream* stream = recognizer->getTokenStream();
+        if (stream->index() == lastResync) {
+            if (!resyncStates.insert(recognizer->getState()).second) {
+                // This state failed here before without consuming: the default always makes progress
+                DefaultErrorStrategy::recover(recognizer, e);
+            }
+            return;
+        }
+        while (stream->LA(1) != antlr4::Token::EOF && !isBoundary(stream->LT(1))) {
+            recognizer->consume();
+        }
+        lastResync = stream->index();
+        resyncStates.clear();
+        resyncStates.insert(recognizer->getState());
+    }
+
+    /**
+     * A missing or unexpected token fails the rule instead of being
+     * conjured or skipped; the rule reports it and calls recover()
+     */
+    antlr4::Token* recoverInline(Parser* recognizer) override {
+        throw InputMismatchException(recognizer);
+    }
+
+    /**
+     * No single-token deletion at loop and block entries: an unexpected
+     * token surfaces as an error in prediction or match, then recover()
+     */
+    void sync(Parser* /*recognizer*/) override {}
 };
 
 /**
@@ -168,6 +245,7 @@ void printUsage() {
     std::cout << "  --parse-tree     Display parse tree\n";
     std::cout << "  --ast            Display AST\n";
     std::cout << "  --scope-ledger   Display scope ledger\n";
+    std::cout << "  --max-errors <n> Stop after n syntax errors (default 100, 0 for no limit)\n";
     std::cout << "  --help         Display this help message\n\n";
     std::cout << "Examples:\n";
     std::cout << "  MYACompiler.exe --test --ast\n";
@@ -184,6 +262,7 @@ int main(int argc, char* argv[]) {
         bool showAST = false;
       bool showScopeLedger = false;
       bool useTestCode = false;
+        size_t maxErrors = 100;
      std::string sourceFile;
     
         // Parse command line arguments
@@ -203,6 +282,8 @@ int main(int argc, char* argv[]) {
         showAST = true;
          } else if (arg == "--scope-ledger") {
           showScopeLedger = true;
+            } else if (arg == "--max-errors" && i + 1 < argc) {
+                maxErrors = std::stoul(argv[++i]);
             } else if (arg[0] != '-') {
      sourceFile = arg;
      }
@@ -250,13 +331,35 @@ integration.getPreprocessor().printTokens();
    // Create parser
       MYAParser parser(tokenStream);
       
-        // Add custom error listener
-        MYAErrorListener errorListener;
+        // Collect errors and resync at top-level boundaries
+        DiagnosticBuffer diagnostics(sourceName);
+        for (const auto& diagnostic : integration.getPreprocessor().getDiagnostics()) {
+            diagnostics.report(DiagnosticKind::Indentation, diagnostic.line, diagnostic.column, diagnostic.message);
+        }
+        MYAErrorListener errorListener(diagnostics, maxErrors);
     parser.removeErrorListeners();
         parser.addErrorListener(&errorListener);
+        parser.setErrorHandler(std::make_shared<MYATopLevelErrorStrategy>());
     
-        // Parse the program
-        auto tree = parser.program();
+        // Parse the program; the listener cancels it at the error limit
+        MYAParser::ProgramContext* tree = nullptr;
+        try {
+            tree = parser.program();
+        } catch (const ParseCancellationException&) {
+            // Diagnostics so far are reported below
+        }
+
+        if (!diagnostics.empty()) {
+            DiagnosticEngine engine;
+            engine.merge(std::move(diagnostics));
+            std::vector<DiagnosticView> views = engine.collect();
+            std::cerr << DiagnosticEngine::render(views, DiagnosticFormat::Text);
+            if (errorListener.isTruncated()) {
+                std::cerr << "Too many errors; stopped after " << maxErrors << " (see --max-errors)\n";
+            }
+            std::cerr << "Compilation failed: " << views.size() << " syntax error(s)" << std::endl;
+            return 1;
+        }
      
         std::cout << "Parsing complete.\n\n";
         
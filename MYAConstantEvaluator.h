@@ -0,0 +1,1164 @@
+/**
+ * MYA Language - Compile-Time Evaluator
+ *
+ * Runs pure functions and folds constant `let` bindings before the other
+ * passes, so `print "5! =", factorial(5);` prints a literal 120:
+ * - Pure functions use only int, float, bool and str values, let/assign,
+ *   if/for/filter, return/break/continue and calls to pure functions: no
+ *   print, lists, structs, channels or tasks (asm and render blocks never
+ *   appear inside functions)
+ * - A call to a pure function whose arguments fold to literals is run by an
+ *   AST interpreter with fuel: every statement, loop iteration and call
+ *   costs one step. Calls that run out, nest deeper than maxDepth, divide by
+ *   zero, overflow int or produce a non-finite float stay run-time calls, so
+ *   their failures happen (and are reported) where they did before
+ * - Operators on literals fold the same way; `let x: T = e;` whose value
+ *   folds, and which is never assigned, has its reads replaced by the
+ *   literal and is removed
+ * - A pure function that only evaluated calls reach is type checked but not
+ *   emitted
+ *
+ * The interpreter checks types as it goes and gives up on anything the code
+ * generator would reject, so folding never hides an error. Results are
+ * memoized per (function, arguments) for the whole program; a memoized
+ * call is charged the fuel it first took.
+ */
+
+#ifndef MYA_CONSTANT_EVALUATOR_H
+#define MYA_CONSTANT_EVALUATOR_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+#include "MYAAST.h"
+#include "MYAASTBuilder.h"
+#include "MYABenchmark.h"
+#include "MYAIndentationPreprocessor.h"
+
+namespace MYA {
+
+/**
+ * What the evaluator did, for the phase statistics
+ */
+struct ConstantEvalStats {
+    int pureFunctions = 0;
+    int callsEvaluated = 0;
+    int constantsFolded = 0;    // `let` bindings replaced by their literal
+    int expressionsFolded = 0;  // Operators on literals
+    int functionsRemoved = 0;   // Pure functions no longer emitted
+    int64_t steps = 0;          // Fuel spent
+    double seconds = 0.0;       // Time spent in the evaluator
+};
+
+/**
+ * A compile-time int, float, bool or str
+ */
+struct ConstantValue {
+    enum Kind { Int, Float, Bool, Str } kind = Int;
+    int64_t i = 0;
+    double f = 0.0;
+    bool b = false;
+    std::string s;  // Literal body; never holds escapes
+
+    static ConstantValue ofInt(int64_t value) {
+        ConstantValue result;
+        result.i = value;
+        return result;
+    }
+
+    static ConstantValue ofFloat(double value) {
+        ConstantValue result;
+        result.kind = Float;
+        result.f = value;
+        return result;
+    }
+
+    static ConstantValue ofBool(bool value) {
+        ConstantValue result;
+        result.kind = Bool;
+        result.b = value;
+        return result;
+    }
+
+    static ConstantValue ofStr(const std::string& value) {
+        ConstantValue result;
+        result.kind = Str;
+        result.s = value;
+        return result;
+    }
+
+    bool isNumber() const {
+        return kind == Int || kind == Float;
+    }
+
+    double asFloat() const {
+        return kind == Int ? static_cast<double>(i) : f;
+    }
+
+    const char* typeName() const {
+        static const char* names[] = { "int", "float", "bool", "str" };
+        return names[kind];
+    }
+
+    /**
+     * Spelling for --opt-report
+     */
+    std::string str() const {
+        switch (kind) {
+        case Int:
+            return std::to_string(i);
+        case Float: {
+            char buffer[32];
+            std::snprintf(buffer, sizeof(buffer), "%g", f);
+            return buffer;
+        }
+        case Bool:
+            return b ? "true" : "false";
+        case Str:
+            return "\"" + s + "\"";
+        }
+        return "";
+    }
+};
+
+/**
+ * ConstantEvaluator - Interprets pure functions and folds constants
+ */
+class ConstantEvaluator {
+public:
+    static const int maxDepth = 200;        // Interpreted calls nest on the compiler's stack
+    static const size_t maxString = 1024;   // Longer results stay run-time values
+
+private:
+    /**
+     * A memoized result still costs the fuel and depth the call took, so
+     * whether a call folds does not depend on what was evaluated before it
+     */
+    struct MemoEntry {
+        ConstantValue value;
+        int64_t cost;
+        int height;  // Call levels, this one included
+    };
+
+    std::vector<OptRemark>& remarks;
+    int64_t fuelPerCall;
+    std::map<std::string, const FunctionDecl*> pure;
+    std::map<std::string, int> evaluatedCalls;  // Per callee
+    std::map<std::string, MemoEntry> memo;
+    ConstantEvalStats stats;
+
+    // Interpreter state of the call being folded
+    int64_t fuel = 0;
+    int depth = 0;
+    int deepest = 0;  // Deepest call level reached, for memo heights
+    std::string failure;
+
+    // ----- Purity -----
+
+    static bool isScalar(const TypeRef& type) {
+        return type.args.empty() && (type.name == "int" || type.name == "float" || type.name == "bool" ||
+                                     type.name == "str");
+    }
+
+    /**
+     * Builtins the code generator handles whatever the program defines
+     */
+    static bool isBuiltinCall(const std::string& name) {
+        static const std::set<std::string> builtins = {
+            "len", "zeros", "push", "map", "tuple", "channel", "send", "recv"
+        };
+        return builtins.count(name) > 0;
+    }
+
+    static bool pureExpr(const Expr& expr, std::set<std::string>& callees) {
+        switch (expr.kind) {
+        case ExprKind::Index:
+        case ExprKind::Member:
+            return false;
+        case ExprKind::Unary:
+            if (expr.text != "-" && expr.text != "not") {
+                return false;
+            }
+            break;
+        case ExprKind::Call:
+            if (isBuiltinCall(expr.text)) {
+                return false;
+            }
+            callees.insert(expr.text);
+            break;
+        default:
+            break;
+        }
+        for (const auto& arg : expr.args) {
+            if (!pureExpr(*arg, callees)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    static bool pureBlock(const StmtList& block, std::set<std::string>& callees) {
+        for (const auto& stmt : block) {
+            for (const ExprPtr* expr : { &stmt->value, &stmt->limit }) {
+                if (*expr && !pureExpr(**expr, callees)) {
+                    return false;
+                }
+            }
+            switch (stmt->kind) {
+            case StmtKind::Let:
+                if (!stmt->value || !isScalar(stmt->type)) {
+                    return false;
+                }
+                break;
+            case StmtKind::Assign:
+                if (!stmt->value || !stmt->target || stmt->target->kind != ExprKind::Identifier) {
+                    return false;
+                }
+                break;
+            case StmtKind::If:
+            case StmtKind::Filter:
+                if (!stmt->value) {
+                    return false;
+                }
+                break;
+            case StmtKind::For:
+                if (stmt->parallel || !stmt->value || !stmt->limit) {
+                    return false;
+                }
+                break;
+            case StmtKind::ExprStmt:
+                if (!stmt->value || stmt->value->kind != ExprKind::Call) {
+                    return false;
+                }
+                break;
+            case StmtKind::Return:
+            case StmtKind::Break:
+            case StmtKind::Continue:
+                break;
+            default:
+                return false;  // print, free
+            }
+            if (!pureBlock(stmt->body, callees) || !pureBlock(stmt->elseBody, callees)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * Functions that only compute on scalars and call each other
+     */
+    void findPureFunctions(const Program& program) {
+        std::map<std::string, int> definitions;
+        for (const auto& fn : program.functions) {
+            definitions[fn.name]++;
+        }
+        std::map<std::string, std::set<std::string>> callees;
+        for (const auto& fn : program.functions) {
+            bool candidate = !fn.isMain && definitions[fn.name] == 1 && isScalar(fn.returnType) &&
+                             !program.findStruct(fn.name);
+            for (const auto& param : fn.params) {
+                candidate = candidate && isScalar(param.type);
+            }
+            if (candidate && pureBlock(fn.body, callees[fn.name])) {
+                pure[fn.name] = &fn;
+            }
+        }
+        for (bool changed = true; changed;) {
+            changed = false;
+            for (auto it = pure.begin(); it != pure.end();) {
+                bool callsImpure = false;
+                for (const auto& callee : callees[it->first]) {
+                    callsImpure = callsImpure || !pure.count(callee);
+                }
+                if (callsImpure) {
+                    it = pure.erase(it);
+                    changed = true;
+                } else {
+                    ++it;
+                }
+            }
+        }
+    }
+
+    // ----- Values -----
+
+    static bool convert(const ConstantValue& value, const TypeRef& type, ConstantValue& result) {
+        if (type.name == value.typeName()) {
+            result = value;
+            return true;
+        }
+        if (type.name == "float" && value.kind == ConstantValue::Int) {
+            result = ConstantValue::ofFloat(static_cast<double>(value.i));
+            return true;
+        }
+        return false;
+    }
+
+    static ConstantValue defaultValue(const TypeRef& type) {
+        if (type.name == "float") {
+            return ConstantValue::ofFloat(0.0);
+        }
+        if (type.name == "bool") {
+            return ConstantValue::ofBool(false);
+        }
+        if (type.name == "str") {
+            return ConstantValue::ofStr("");
+        }
+        return ConstantValue::ofInt(0);
+    }
+
+    bool fail(const std::string& reason) {
+        if (failure.empty()) {
+            failure = reason;
+        }
+        return false;
+    }
+
+    bool spend() {
+        stats.steps++;
+        return --fuel >= 0 || fail("out of fuel");
+    }
+
+    /**
+     * The parser folds a leading minus into the literal. Negative values
+     * accumulate downward, since INT64_MIN has no positive counterpart.
+     */
+    static bool parseInt(const std::string& text, int64_t& value) {
+        bool negative = !text.empty() && text[0] == '-';
+        size_t start = negative ? 1 : 0;
+        value = 0;
+        for (size_t i = start; i < text.size(); i++) {
+            int digit = text[i] - '0';
+            if (digit < 0 || digit > 9 ||
+                (negative ? value < (INT64_MIN + digit) / 10 : value > (INT64_MAX - digit) / 10)) {
+                return false;
+            }
+            value = value * 10 + (negative ? -digit : digit);
+        }
+        return text.size() > start;
+    }
+
+    enum class Op {
+        And, Or, Equal, NotEqual, Less, Greater, LessEqual, GreaterEqual, Add, Subtract, Multiply, Divide,
+        Modulo, Other
+    };
+
+    /**
+     * Decoded once per evaluation instead of comparing operator strings
+     */
+    static Op binaryOp(const std::string& text) {
+        char second = text.size() > 1 ? text[1] : '\0';
+        switch (text[0]) {
+        case 'a': return text == "and" ? Op::And : Op::Other;
+        case 'o': return text == "or" ? Op::Or : Op::Other;
+        case '=': return second == '=' ? Op::Equal : Op::Other;
+        case '!': return second == '=' ? Op::NotEqual : Op::Other;
+        case '<': return second == '=' ? Op::LessEqual : Op::Less;
+        case '>': return second == '=' ? Op::GreaterEqual : Op::Greater;
+        case '+': return Op::Add;
+        case '-': return Op::Subtract;
+        case '*': return Op::Multiply;
+        case '/': return Op::Divide;
+        case '%': return Op::Modulo;
+        default: return Op::Other;
+        }
+    }
+
+    /**
+     * Two's complement arithmetic with overflow detection; the emitted C++
+     * would overflow (undefined behaviour) where this returns false
+     */
+    static bool arithmetic(Op op, int64_t a, int64_t b, int64_t& result) {
+        uint64_t ua = static_cast<uint64_t>(a), ub = static_cast<uint64_t>(b);
+        switch (op) {
+        case Op::Add:
+            result = static_cast<int64_t>(ua + ub);
+            return !((a ^ result) & (b ^ result) & INT64_MIN);
+        case Op::Subtract:
+            result = static_cast<int64_t>(ua - ub);
+            return !((a ^ b) & (a ^ result) & INT64_MIN);
+        case Op::Multiply:
+            result = static_cast<int64_t>(ua * ub);
+            if (a == 0 || b == 0) {
+                return true;
+            }
+            if ((a == -1 && b == INT64_MIN) || (b == -1 && a == INT64_MIN)) {
+                return false;
+            }
+            return result / b == a;
+        // MYA::Runtime::divide and modulo: x / -1 negates with wraparound
+        case Op::Divide:
+            result = b == -1 ? static_cast<int64_t>(0 - ua) : a / b;
+            return true;
+        default:
+            result = b == -1 ? 0 : a % b;
+            return true;
+        }
+    }
+
+    // ----- Interpreter -----
+
+    struct Variable {
+        const std::string* name;  // Names and types point into the AST
+        const TypeRef* type;
+        ConstantValue value;
+    };
+
+    /**
+     * Locals of one interpreted call, innermost last; a block drops the
+     * variables it declared when it ends
+     */
+    struct Frame {
+        std::vector<Variable> variables;
+
+        Variable* lookup(const std::string& name) {
+            for (size_t i = variables.size(); i-- > 0;) {
+                if (*variables[i].name == name) {
+                    return &variables[i];
+                }
+            }
+            return nullptr;
+        }
+
+        Variable& declare(const std::string& name, const TypeRef& type) {
+            variables.push_back(Variable{ &name, &type, ConstantValue() });
+            return variables.back();
+        }
+
+        void drop(size_t count) {
+            variables.erase(variables.begin() + static_cast<std::ptrdiff_t>(count), variables.end());
+        }
+    };
+
+    enum class Flow {
+        Next,
+        Break,
+        Continue,
+        Return,
+        Fail
+    };
+
+    bool evaluate(const Expr& expr, Frame* frame, ConstantValue& result) {
+        switch (expr.kind) {
+        case ExprKind::Number:
+            if (expr.isFloatLiteral()) {
+                result = ConstantValue::ofFloat(std::strtod(expr.text.c_str(), nullptr));
+                return true;
+            }
+            result = ConstantValue::ofInt(0);
+            return parseInt(expr.text, result.i) || fail("int literal out of range");
+        case ExprKind::String:
+            if (expr.text.size() < 2 || expr.text.find('\\') != std::string::npos) {
+                return fail("string with escapes");
+            }
+            result = ConstantValue::ofStr(expr.text.substr(1, expr.text.size() - 2));
+            return true;
+        case ExprKind::Boolean:
+            result = ConstantValue::ofBool(expr.text == "true");
+            return true;
+        case ExprKind::Identifier: {
+            Variable* variable = frame ? frame->lookup(expr.text) : nullptr;
+            if (!variable) {
+                return fail("'" + expr.text + "' is not a constant");
+            }
+            result = variable->value;
+            return true;
+        }
+        case ExprKind::Unary: {
+            ConstantValue operand;
+            if (!evaluate(*expr.args[0], frame, operand)) {
+                return false;
+            }
+            if (expr.text == "not" && operand.kind == ConstantValue::Bool) {
+                result = ConstantValue::ofBool(!operand.b);
+                return true;
+            }
+            if (expr.text == "-" && operand.kind == ConstantValue::Int && operand.i != INT64_MIN) {
+                result = ConstantValue::ofInt(-operand.i);
+                return true;
+            }
+            if (expr.text == "-" && operand.kind == ConstantValue::Float) {
+                result = ConstantValue::ofFloat(-operand.f);
+                return true;
+            }
+            return fail("'" + expr.text + "' on " + operand.typeName());
+        }
+        case ExprKind::Binary:
+            return evaluateBinary(expr, frame, result);
+        case ExprKind::Call: {
+            auto found = pure.find(expr.text);
+            if (found == pure.end()) {
+                return fail("'" + expr.text + "' is not pure");
+            }
+            std::vector<ConstantValue> args(expr.args.size());
+            for (size_t i = 0; i < args.size(); i++) {
+                if (!evaluate(*expr.args[i], frame, args[i])) {
+                    return false;
+                }
+            }
+            return call(*found->second, args, result);
+        }
+        default:
+            return fail("not a constant expression");
+        }
+    }
+
+    bool evaluateBinary(const Expr& expr, Frame* frame, ConstantValue& result) {
+        Op op = binaryOp(expr.text);
+        ConstantValue lhs, rhs;
+        if (!evaluate(*expr.args[0], frame, lhs)) {
+            return false;
+        }
+        if (op == Op::And || op == Op::Or) {
+            if (lhs.kind != ConstantValue::Bool) {
+                return fail("'" + expr.text + "' on " + lhs.typeName());
+            }
+            if (lhs.b == (op == Op::Or)) {
+                result = lhs;  // The right side is never evaluated
+                return true;
+            }
+            if (!evaluate(*expr.args[1], frame, rhs)) {
+                return false;
+            }
+            result = rhs;
+            return rhs.kind == ConstantValue::Bool || fail("'" + expr.text + "' on " + rhs.typeName());
+        }
+        if (!evaluate(*expr.args[1], frame, rhs)) {
+            return false;
+        }
+        bool numbers = lhs.isNumber() && rhs.isNumber();
+        bool ints = lhs.kind == ConstantValue::Int && rhs.kind == ConstantValue::Int;
+        bool strs = lhs.kind == ConstantValue::Str && rhs.kind == ConstantValue::Str;
+        bool bools = lhs.kind == ConstantValue::Bool && rhs.kind == ConstantValue::Bool;
+        if (op >= Op::Equal && op <= Op::GreaterEqual) {
+            int order;
+            if (ints) {
+                order = lhs.i < rhs.i ? -1 : lhs.i > rhs.i ? 1 : 0;
+            } else if (numbers) {
+                double a = lhs.asFloat(), b = rhs.asFloat();
+                order = a < b ? -1 : a > b ? 1 : 0;  // Never NaN: non-finite results are refused
+            } else if (strs) {
+                order = lhs.s.compare(rhs.s);
+            } else if (bools && (op == Op::Equal || op == Op::NotEqual)) {
+                order = lhs.b == rhs.b ? 0 : 1;
+            } else {
+                return fail(std::string("cannot compare ") + lhs.typeName() + " with " + rhs.typeName());
+            }
+            switch (op) {
+            case Op::Equal: result = ConstantValue::ofBool(order == 0); break;
+            case Op::NotEqual: result = ConstantValue::ofBool(order != 0); break;
+            case Op::Less: result = ConstantValue::ofBool(order < 0); break;
+            case Op::Greater: result = ConstantValue::ofBool(order > 0); break;
+            case Op::LessEqual: result = ConstantValue::ofBool(order <= 0); break;
+            default: result = ConstantValue::ofBool(order >= 0); break;
+            }
+            return true;
+        }
+        if (op == Op::Add && strs) {
+            if (lhs.s.size() + rhs.s.size() > maxString) {
+                return fail("string longer than " + std::to_string(maxString) + " bytes");
+            }
+            result = ConstantValue::ofStr(lhs.s + rhs.s);
+            return result.s.find("??") == std::string::npos || fail("joined string would contain a trigraph");
+        }
+        if (!numbers || op < Op::Add || op > Op::Modulo) {
+            return fail("'" + expr.text + "' on " + lhs.typeName() + " and " + rhs.typeName());
+        }
+        if (ints) {
+            if ((op == Op::Divide || op == Op::Modulo) && rhs.i == 0) {
+                return fail("division by zero");
+            }
+            result = ConstantValue::ofInt(0);
+            return arithmetic(op, lhs.i, rhs.i, result.i) || fail("int overflow");
+        }
+        if (op == Op::Modulo) {
+            return fail("'%' on float");
+        }
+        double a = lhs.asFloat(), b = rhs.asFloat();
+        double value = op == Op::Add ? a + b : op == Op::Subtract ? a - b : op == Op::Multiply ? a * b : a / b;
+        if (!std::isfinite(value)) {
+            return fail("float result is not finite");
+        }
+        result = ConstantValue::ofFloat(value);
+        return true;
+    }
+
+    bool assign(Variable& variable, const ConstantValue& value) {
+        return convert(value, *variable.type, variable.value) ||
+               fail(std::string("cannot assign ") + value.typeName() + " to " + variable.type->str());
+    }
+
+    Flow execute(const StmtList& block, Frame& frame, ConstantValue& returned) {
+        size_t declared = frame.variables.size();
+        Flow flow = Flow::Next;
+        for (size_t i = 0; i < block.size() && flow == Flow::Next; i++) {
+            flow = spend() ? executeStmt(*block[i], frame, returned) : Flow::Fail;
+        }
+        frame.drop(declared);
+        return flow;
+    }
+
+    Flow executeStmt(const Stmt& stmt, Frame& frame, ConstantValue& returned) {
+        ConstantValue value;
+        switch (stmt.kind) {
+        case StmtKind::Let: {
+            if (!evaluate(*stmt.value, &frame, value)) {
+                return Flow::Fail;
+            }
+            // A let of a visible name assigns it
+            if (Variable* existing = frame.lookup(stmt.name)) {
+                if (!(*existing->type == stmt.type)) {
+                    fail("'" + stmt.name + "' redeclared");
+                    return Flow::Fail;
+                }
+                return assign(*existing, value) ? Flow::Next : Flow::Fail;
+            }
+            return assign(frame.declare(stmt.name, stmt.type), value) ? Flow::Next : Flow::Fail;
+        }
+        case StmtKind::Assign: {
+            Variable* variable = frame.lookup(stmt.target->text);
+            if (!variable) {
+                fail("'" + stmt.target->text + "' is not declared");
+                return Flow::Fail;
+            }
+            return evaluate(*stmt.value, &frame, value) && assign(*variable, value) ? Flow::Next : Flow::Fail;
+        }
+        case StmtKind::If:
+        case StmtKind::Filter:
+            if (!evaluate(*stmt.value, &frame, value)) {
+                return Flow::Fail;
+            }
+            if (value.kind != ConstantValue::Bool) {
+                fail("condition is not bool");
+                return Flow::Fail;
+            }
+            if (value.b) {
+                return execute(stmt.body, frame, returned);
+            }
+            return stmt.kind == StmtKind::If ? execute(stmt.elseBody, frame, returned) : Flow::Next;
+        case StmtKind::For:
+            return executeFor(stmt, frame, returned);
+        case StmtKind::Return:
+            if (!stmt.value) {
+                fail("return without a value");
+                return Flow::Fail;
+            }
+            return evaluate(*stmt.value, &frame, returned) ? Flow::Return : Flow::Fail;
+        case StmtKind::Break:
+            return Flow::Break;
+        case StmtKind::Continue:
+            return Flow::Continue;
+        case StmtKind::ExprStmt:
+            return evaluate(*stmt.value, &frame, value) ? Flow::Next : Flow::Fail;
+        default:
+            fail("statement has effects");
+            return Flow::Fail;
+        }
+    }
+
+    /**
+     * `for i in range a to b:` as emitted: bounds evaluated once, i++ after
+     * each iteration, assignments to i in the body take effect
+     */
+    Flow executeFor(const Stmt& stmt, Frame& frame, ConstantValue& returned) {
+        ConstantValue start, end;
+        if (!evaluate(*stmt.value, &frame, start) || !evaluate(*stmt.limit, &frame, end)) {
+            return Flow::Fail;
+        }
+        if (start.kind != ConstantValue::Int || end.kind != ConstantValue::Int) {
+            fail("range bounds must be int");
+            return Flow::Fail;
+        }
+        static const TypeRef intType("int");
+        size_t loopVar = frame.variables.size();  // Index: the body's lets may grow the frame
+        frame.declare(stmt.name, intType).value = start;
+        Flow flow = Flow::Next;
+        while (frame.variables[loopVar].value.i < end.i) {
+            if (!spend()) {
+                flow = Flow::Fail;
+                break;
+            }
+            Flow body = execute(stmt.body, frame, returned);
+            if (body == Flow::Break) {
+                break;
+            }
+            if (body == Flow::Return || body == Flow::Fail) {
+                flow = body;
+                break;
+            }
+            frame.variables[loopVar].value.i++;  // i < end, so no overflow
+        }
+        frame.drop(loopVar);
+        return flow;
+    }
+
+    bool call(const FunctionDecl& fn, const std::vector<ConstantValue>& args, ConstantValue& result) {
+        if (args.size() != fn.params.size()) {
+            return fail("'" + fn.name + "' takes " + std::to_string(fn.params.size()) + " arguments");
+        }
+        std::string key = fn.name + "(";
+        for (const auto& arg : args) {
+            char bits[32];
+            std::snprintf(bits, sizeof(bits), "%a", arg.f);  // Exact, unlike str()
+            key += std::string(arg.typeName()) + " " + (arg.kind == ConstantValue::Float ? bits : arg.str()) + ",";
+        }
+        auto cached = memo.find(key);
+        if (cached != memo.end()) {
+            const MemoEntry& entry = cached->second;
+            if (depth + entry.height > maxDepth) {
+                return fail("recursion deeper than " + std::to_string(maxDepth) + " calls");
+            }
+            stats.steps++;
+            fuel -= entry.cost;
+            if (fuel < 0) {
+                return fail("out of fuel");
+            }
+            deepest = std::max(deepest, depth + entry.height);
+            result = entry.value;
+            return true;
+        }
+        if (depth >= maxDepth) {
+            return fail("recursion deeper than " + std::to_string(maxDepth) + " calls");
+        }
+        int64_t fuelBefore = fuel;
+        if (!spend()) {
+            return false;
+        }
+        Frame frame;
+        frame.variables.reserve(8);
+        for (size_t i = 0; i < args.size(); i++) {
+            if (!assign(frame.declare(fn.params[i].name, fn.params[i].type), args[i])) {
+                return false;
+            }
+        }
+        int outerDeepest = deepest;
+        deepest = ++depth;
+        ConstantValue returned = defaultValue(fn.returnType);
+        Flow flow = execute(fn.body, frame, returned);
+        depth--;
+        int height = deepest - depth;
+        deepest = std::max(outerDeepest, deepest);
+        if (flow == Flow::Fail) {
+            return false;
+        }
+        if (flow != Flow::Next && flow != Flow::Return) {
+            return fail("break or continue outside a loop");
+        }
+        if (!convert(returned, fn.returnType, result)) {
+            return fail("'" + fn.name + "' returns " + returned.typeName() + " as " + fn.returnType.str());
+        }
+        memo[key] = MemoEntry{ result, fuelBefore - fuel, height };
+        return true;
+    }
+
+    // ----- Folding -----
+
+    static bool isLiteral(const Expr& expr) {
+        return expr.kind == ExprKind::Number || expr.kind == ExprKind::String || expr.kind == ExprKind::Boolean ||
+               (expr.kind == ExprKind::Unary && expr.text == "-" && expr.args[0]->kind == ExprKind::Number);
+    }
+
+    /**
+     * The literal for `value`, or null when it has none (INT64_MIN, NaN)
+     */
+    static ExprPtr literal(const ConstantValue& value, int line) {
+        std::string text;
+        bool negative = false;
+        switch (value.kind) {
+        case ConstantValue::Int:
+            if (value.i == INT64_MIN) {
+                return nullptr;
+            }
+            negative = value.i < 0;
+            text = std::to_string(negative ? -value.i : value.i);
+            break;
+        case ConstantValue::Float: {
+            if (!std::isfinite(value.f)) {
+                return nullptr;
+            }
+            negative = std::signbit(value.f);
+            double magnitude = std::fabs(value.f);
+            char buffer[40];
+            for (int digits = 15; digits <= 17; digits++) {
+                std::snprintf(buffer, sizeof(buffer), "%.*g", digits, magnitude);
+                if (std::strtod(buffer, nullptr) == magnitude) {
+                    break;  // Shortest spelling that round-trips
+                }
+            }
+            text = buffer;
+            size_t exponent = text.find('e');
+            if (text.find('.') == std::string::npos) {
+                text.insert(exponent == std::string::npos ? text.size() : exponent, ".0");
+            }
+            break;
+        }
+        case ConstantValue::Bool:
+            return ExprPtr(new Expr(ExprKind::Boolean, value.b ? "true" : "false", line));
+        case ConstantValue::Str:
+            return ExprPtr(new Expr(ExprKind::String, "\"" + value.s + "\"", line));
+        }
+        ExprPtr number(new Expr(ExprKind::Number, text, line));
+        if (!negative) {
+            return number;
+        }
+        ExprPtr negated(new Expr(ExprKind::Unary, "-", line));
+        negated->args.push_back(std::move(number));
+        return negated;
+    }
+
+    /**
+     * Variables of one function that are declared by exactly one `let` and
+     * never assigned; only these can become constants
+     */
+    static void countWrites(const StmtList& block, std::map<std::string, int>& writes) {
+        for (const auto& stmt : block) {
+            if (stmt->kind == StmtKind::Let) {
+                writes[stmt->name]++;
+            } else if (stmt->kind == StmtKind::For || stmt->kind == StmtKind::Free) {
+                writes[stmt->name] += 2;
+            } else if (stmt->kind == StmtKind::Assign && stmt->target) {
+                const Expr* root = stmt->target.get();
+                while ((root->kind == ExprKind::Index || root->kind == ExprKind::Member) && !root->args.empty()) {
+                    root = root->args[0].get();
+                }
+                writes[root->text] += 2;
+            }
+            countWrites(stmt->body, writes);
+            countWrites(stmt->elseBody, writes);
+        }
+    }
+
+    typedef std::map<std::string, ConstantValue> Constants;
+
+    /**
+     * Fold `slot` bottom-up: constants become literals, operators on
+     * literals and calls to pure functions with literal arguments become
+     * their value
+     */
+    void foldExpr(ExprPtr& slot, const Constants& constants, bool foldCall = true) {
+        Expr& expr = *slot;
+        if (expr.kind == ExprKind::Identifier) {
+            auto found = constants.find(expr.text);
+            if (found != constants.end()) {
+                if (ExprPtr value = literal(found->second, expr.line)) {
+                    slot = std::move(value);
+                }
+            }
+            return;
+        }
+        bool spawn = expr.kind == ExprKind::Unary && expr.text == "spawn";
+        for (auto& arg : expr.args) {
+            foldExpr(arg, constants, !spawn);  // spawn f(args) stays a call
+        }
+        bool operation = expr.kind == ExprKind::Binary ||
+                         (expr.kind == ExprKind::Unary && (expr.text == "not" ||
+                          (expr.text == "-" && expr.args[0]->kind != ExprKind::Number)));
+        bool pureCall = foldCall && expr.kind == ExprKind::Call && pure.count(expr.text);
+        if (!operation && !pureCall) {
+            return;
+        }
+        for (const auto& arg : expr.args) {
+            if (!isLiteral(*arg)) {
+                return;
+            }
+        }
+        fuel = fuelPerCall;
+        depth = deepest = 0;
+        failure.clear();
+        ConstantValue value;
+        ExprPtr folded = evaluate(expr, nullptr, value) ? literal(value, expr.line) : nullptr;
+        if (!pureCall) {
+            if (folded) {
+                stats.expressionsFolded++;
+                slot = std::move(folded);
+            }
+            return;
+        }
+        if (!folded) {
+            remarks.push_back(OptRemark{ expr.line, "consteval", "call " + expr.str() + " left for run time: " +
+                (failure.empty() ? "result has no literal" : failure) +
+                (failure == "out of fuel" ? " after " + std::to_string(fuelPerCall) + " steps (see --eval-fuel)" : ""),
+                false });
+            return;
+        }
+        remarks.push_back(OptRemark{ expr.line, "consteval", "evaluated " + expr.str() + " = " + value.str() +
+            " in " + std::to_string(fuelPerCall - fuel) + " steps", true });
+        stats.callsEvaluated++;
+        evaluatedCalls[expr.text]++;
+        slot = std::move(folded);
+    }
+
+    void foldBlock(StmtList& block, Constants constants, const std::map<std::string, int>& writes) {
+        for (size_t i = 0; i < block.size(); i++) {
+            Stmt& stmt = *block[i];
+            if (stmt.target) {
+                for (size_t arg = 1; arg < stmt.target->args.size(); arg++) {
+                    foldExpr(stmt.target->args[arg], constants);
+                }
+                if (stmt.target->kind != ExprKind::Identifier && !stmt.target->args.empty()) {
+                    Expr* base = stmt.target->args[0].get();
+                    while ((base->kind == ExprKind::Index || base->kind == ExprKind::Member) && !base->args.empty()) {
+                        for (size_t arg = 1; arg < base->args.size(); arg++) {
+                            foldExpr(base->args[arg], constants);
+                        }
+                        base = base->args[0].get();
+                    }
+                }
+            }
+            if (stmt.value) {
+                // A call statement keeps its call
+                foldExpr(stmt.value, constants, stmt.kind != StmtKind::ExprStmt);
+            }
+            if (stmt.limit) {
+                foldExpr(stmt.limit, constants);
+            }
+            for (auto& arg : stmt.args) {
+                foldExpr(arg, constants);
+            }
+            if (stmt.kind == StmtKind::For) {
+                Constants inner = constants;
+                inner.erase(stmt.name);
+                foldBlock(stmt.body, inner, writes);
+            } else {
+                foldBlock(stmt.body, constants, writes);
+                foldBlock(stmt.elseBody, constants, writes);
+            }
+
+            // let x: T = literal; with x never written again: reads use the literal
+            auto written = writes.find(stmt.name);
+            ConstantValue value;
+            if (stmt.kind == StmtKind::Let && isScalar(stmt.type) && stmt.value && isLiteral(*stmt.value) &&
+                written != writes.end() && written->second == 1) {
+                fuel = fuelPerCall;
+                failure.clear();
+                if (evaluate(*stmt.value, nullptr, value) && convert(value, stmt.type, constants[stmt.name])) {
+                    remarks.push_back(OptRemark{ stmt.line, "consteval", "'" + stmt.name + "' is the constant " +
+                        constants[stmt.name].str() + "; its reads use the value", true });
+                    stats.constantsFolded++;
+                    block.erase(block.begin() + static_cast<std::ptrdiff_t>(i));
+                    i--;
+                }
+            }
+        }
+    }
+
+    /**
+     * A pure function whose calls were all evaluated is not emitted:
+     * nothing that still is calls or spawns it
+     */
+    static void collectCalls(const Expr& expr, std::set<std::string>& names) {
+        if (expr.kind == ExprKind::Call) {
+            names.insert(expr.text);
+        }
+        for (const auto& arg : expr.args) {
+            collectCalls(*arg, names);
+        }
+    }
+
+    static void collectCalls(const StmtList& block, std::set<std::string>& names) {
+        for (const auto& stmt : block) {
+            for (const ExprPtr* expr : { &stmt->target, &stmt->value, &stmt->limit }) {
+                if (*expr) {
+                    collectCalls(**expr, names);
+                }
+            }
+            for (const auto& arg : stmt->args) {
+                collectCalls(*arg, names);
+            }
+            collectCalls(stmt->body, names);
+            collectCalls(stmt->elseBody, names);
+        }
+    }
+
+    /**
+     * Names called from `roots`, following calls through pure functions
+     */
+    std::set<std::string> reachedFrom(std::vector<const StmtList*> pending) const {
+        std::set<std::string> reached;
+        while (!pending.empty()) {
+            std::set<std::string> calls;
+            collectCalls(*pending.back(), calls);
+            pending.pop_back();
+            for (const auto& name : calls) {
+                auto callee = pure.find(name);
+                if (reached.insert(name).second && callee != pure.end()) {
+                    pending.push_back(&callee->second->body);
+                }
+            }
+        }
+        return reached;
+    }
+
+    void removeEvaluatedFunctions(Program& program) {
+        // Pure functions an evaluated call ran, then those still reached
+        // from code that is emitted
+        std::vector<const StmtList*> evaluatedRoots;
+        for (const auto& callee : evaluatedCalls) {
+            evaluatedRoots.push_back(&pure[callee.first]->body);
+        }
+        std::set<std::string> ran = reachedFrom(evaluatedRoots);
+        for (const auto& callee : evaluatedCalls) {
+            ran.insert(callee.first);
+        }
+        std::vector<const StmtList*> keptRoots = { &program.topLevel };
+        for (const auto& fn : program.functions) {
+            if (!ran.count(fn.name)) {
+                keptRoots.push_back(&fn.body);
+            }
+        }
+        std::set<std::string> kept = reachedFrom(keptRoots);
+        for (auto& fn : program.functions) {
+            if (ran.count(fn.name) && pure.count(fn.name) && !kept.count(fn.name)) {
+                fn.evaluated = true;
+                stats.functionsRemoved++;
+                remarks.push_back(OptRemark{ fn.line, "consteval", "'" + fn.name +
+                    "' only runs in calls evaluated at compile time; it is checked but not emitted", true });
+            }
+        }
+    }
+
+public:
+    ConstantEvaluator(std::vector<OptRemark>& remarks, int64_t fuelPerCall)
+        : remarks(remarks), fuelPerCall(fuelPerCall) {}
+
+    ConstantEvalStats run(Program& program) {
+        Stopwatch watch;
+        stats = ConstantEvalStats();
+        pure.clear();
+        evaluatedCalls.clear();
+        memo.clear();
+        findPureFunctions(program);
+        stats.pureFunctions = static_cast<int>(pure.size());
+        for (auto& fn : program.functions) {
+            fn.evaluated = false;
+            std::map<std::string, int> writes;
+            countWrites(fn.body, writes);
+            for (const auto& param : fn.params) {
+                writes[param.name] += 2;
+            }
+            foldBlock(fn.body, Constants(), writes);
+        }
+        std::map<std::string, int> writes;
+        countWrites(program.topLevel, writes);
+        foldBlock(program.topLevel, Constants(), writes);
+        removeEvaluatedFunctions(program);
+        stats.seconds = watch.elapsedSeconds();
+        return stats;
+    }
+
+    /**
+     * Run `fn` on `args` as a folded call would (the benchmark's entry
+     * point); findPureFunctions must have accepted it
+     */
+    bool evaluateCall(const Program& program, const std::string& name, const std::vector<ConstantValue>& args,
+                      ConstantValue& result) {
+        if (pure.empty()) {
+            findPureFunctions(program);
+        }
+        memo.clear();
+        fuel = fuelPerCall;
+        depth = deepest = 0;
+        failure.clear();
+        auto found = pure.find(name);
+        return found != pure.end() && call(*found->second, args, result);
+    }
+
+    const ConstantEvalStats& getStats() const {
+        return stats;
+    }
+};
+
+// ----- Benchmark -----
+
+namespace ConstantEvalBench {
+
+inline const char* source() {
+    return R"(
+fn factorial(n: int) -> int:
+    filter n <= 1 pass:
+        return 1;
+    let prev: int = factorial(n - 1);
+    return n * prev;
+
+fn isPrime(n: int) -> bool:
+    filter n <= 1 pass:
+        return false;
+    for i in range 2 to n:
+        if n % i == 0:
+            return false;
+    return true;
+
+fn fib(n: int) -> int:
+    if n < 2:
+        return n;
+    return fib(n - 1) + fib(n - 2);
+
+fn mean(a: float, b: float, c: float) -> float:
+    return (a + b + c) / 3.0;
+)";
+}
+
+} // namespace ConstantEvalBench
+
+/**
+ * Interpret sample pure functions `count` times each; the rate is
+ * interpreter steps (statements, iterations and calls) per second
+ */
+inline void runConstantEvalBenchmark(size_t count) {
+    IndentationPreprocessor preprocessor(4);
+    std::vector<Token> tokens = preprocessor.process(ConstantEvalBench::source());
+    ASTBuilder builder;
+    Program program = builder.build(tokens);
+    std::vector<OptRemark> remarks;
+    ConstantEvaluator evaluator(remarks, 1000000);
+    std::cout << "Compile-time evaluation benchmark: " << count << " calls each" << std::endl;
+
+    struct Sample {
+        const char* label;
+        const char* name;
+        std::vector<ConstantValue> args;
+    };
+    const Sample samples[] = {
+        { "factorial(20)", "factorial", { ConstantValue::ofInt(20) } },
+        { "isPrime(7919)", "isPrime", { ConstantValue::ofInt(7919) } },
+        { "fib(20)", "fib", { ConstantValue::ofInt(20) } },
+        { "mean(1.5, 2.5, 4.0)", "mean", { ConstantValue::ofFloat(1.5), ConstantValue::ofFloat(2.5),
+                                           ConstantValue::ofFloat(4.0) } },
+    };
+    volatile uint64_t sink = 0;  // Unsigned: the sum wraps instead of overflowing
+    for (const auto& sample : samples) {
+        ConstantValue result;
+        int64_t steps = 0;
+        double seconds = bestOf(3, [&] {
+            int64_t before = evaluator.getStats().steps;
+            for (size_t i = 0; i < count; i++) {
+                if (evaluator.evaluateCall(program, sample.name, sample.args, result)) {
+                    uint64_t bits = static_cast<uint64_t>(result.i);
+                    if (result.kind == ConstantValue::Float) {
+                        std::memcpy(&bits, &result.f, sizeof(bits));
+                    } else if (result.kind == ConstantValue::Bool) {
+                        bits = result.b;
+                    }
+                    sink = sink + bits;
+                }
+            }
+            steps = evaluator.getStats().steps - before;
+        });
+        reportBenchmark(sample.label, seconds, static_cast<size_t>(steps));
+        std::cout << "    = " << result.str() << ", " << steps / static_cast<int64_t>(count ? count : 1)
+                  << " steps per call" << std::endl;
+    }
+}
+
+} // namespace MYA
+
+#endif // MYA_CONSTANT_EVALUATOR_H
@@ -0,0 +1,596 @@
+/**
+ * MYA Language - Diagnostics Engine
+ *
+ * Compiler phases record diagnostics as compact records (message ID, file,
+ * span and interned argument strings) in a DiagnosticBuffer owned by the
+ * thread doing the work; nothing is formatted or written while compiling.
+ * Buffers are merged into a DiagnosticEngine (the only synchronized step),
+ * which sorts them by file and position, drops duplicates, and renders the
+ * batch as text, JSON or SARIF 2.1.0 when someone actually looks at them.
+ *
+ * Each DiagnosticKind is one stable rule ID (MYA1001 ...); each
+ * DiagnosticMessage is a template of one rule whose `{0}`, `{1}` ... are
+ * filled in by the renderers. Phases that still build their own text report
+ * it through the rule's `text` message, so the text rendering matches what
+ * each phase reported before. `--bench diag [n]` times recording from every
+ * core, merging, and each rendering.
+ */
+
+#ifndef MYA_DIAGNOSTICS_H
+#define MYA_DIAGNOSTICS_H
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "MYABenchmark.h"
+#include "MYAJson.h"
+
+namespace MYA {
+
+/**
+ * Phase that produced a diagnostic; each kind is one rule
+ */
+enum class DiagnosticKind : uint8_t {
+    Indentation,
+    Parse,
+    Struct,
+    Semantic,
+    Assembler
+};
+
+enum class DiagnosticFormat {
+    Text,
+    Json,
+    Sarif
+};
+
+struct DiagnosticRule {
+    const char* id;           // Stable rule ID, as written to JSON and SARIF
+    const char* name;         // Text prefix: "<name> error at line ..."
+    const char* description;
+};
+
+inline const DiagnosticRule& diagnosticRule(DiagnosticKind kind) {
+    static const DiagnosticRule rules[] = {
+        { "MYA1001", "Indentation", "Indentation does not match an enclosing block" },
+        { "MYA1002", "Parse", "Syntax error" },
+        { "MYA2001", "Struct", "Invalid struct definition" },
+        { "MYA3001", "Semantic", "Semantic error" },
+        { "MYA4001", "Assembler", "Invalid asm block" },
+    };
+    return rules[static_cast<size_t>(kind)];
+}
+
+/**
+ * Message templates; `{n}` is the n-th argument of the diagnostic
+ */
+enum class DiagnosticMessage : uint16_t {
+    IndentationText,  // The phase's own text as {0}, one per kind
+    ParseText,
+    StructText,
+    SemanticText,
+    AssemblerText,
+    UnknownSoaStruct,
+    UnknownType,
+    UndefinedVariable,
+    UndefinedFunction,
+    DuplicateFunction,
+    ArgumentCount,
+    ArgumentType,
+    NoSuchField,
+    CannotCompare,
+    NumericOperands,
+    CannotAssign,
+    CannotInitialize,
+    Redeclared,
+    CannotReturn
+};
+
+const size_t kDiagnosticMessageCount = static_cast<size_t>(DiagnosticMessage::CannotReturn) + 1;
+const size_t kMaxDiagnosticArgs = 4;
+
+struct DiagnosticMessageInfo {
+    DiagnosticKind kind;
+    const char* id;      // Message ID within its rule, as written to JSON and SARIF
+    const char* format;
+};
+
+inline const DiagnosticMessageInfo& diagnosticMessage(DiagnosticMessage message) {
+    static const DiagnosticMessageInfo messages[] = {
+        { DiagnosticKind::Indentation, "text", "{0}" },
+        { DiagnosticKind::Parse, "text", "{0}" },
+        { DiagnosticKind::Struct, "text", "{0}" },
+        { DiagnosticKind::Semantic, "text", "{0}" },
+        { DiagnosticKind::Assembler, "text", "{0}" },
+        { DiagnosticKind::Struct, "unknownSoaStruct", "--soa names unknown struct '{0}'" },
+        { DiagnosticKind::Semantic, "unknownType", "unknown type '{0}'" },
+        { DiagnosticKind::Semantic, "undefinedVariable", "undefined variable '{0}'" },
+        { DiagnosticKind::Semantic, "undefinedFunction", "call to undefined function '{0}'" },
+        { DiagnosticKind::Semantic, "duplicateFunction", "duplicate function '{0}'" },
+        { DiagnosticKind::Semantic, "argumentCount", "'{0}' expects {1} argument(s), got {2}" },
+        { DiagnosticKind::Semantic, "argumentType", "argument {0} of '{1}' expects {2}, got {3}" },
+        { DiagnosticKind::Semantic, "noSuchField", "struct {0} has no field '{1}'" },
+        { DiagnosticKind::Semantic, "cannotCompare", "cannot compare {0} with {1}" },
+        { DiagnosticKind::Semantic, "numericOperands", "operator '{0}' requires numeric operands, got {1} and {2}" },
+        { DiagnosticKind::Semantic, "cannotAssign", "cannot assign {0} to {1}" },
+        { DiagnosticKind::Semantic, "cannotInitialize", "cannot initialize {0} '{1}' with {2}" },
+        { DiagnosticKind::Semantic, "redeclared", "'{0}' is already {1}, cannot redeclare as {2}" },
+        { DiagnosticKind::Semantic, "cannotReturn", "cannot return {0} from a function returning {1}" },
+    };
+    static_assert(sizeof(messages) / sizeof(messages[0]) == kDiagnosticMessageCount, "one entry per message");
+    return messages[static_cast<size_t>(message)];
+}
+
+/**
+ * Message for a phase's own text of the given kind
+ */
+inline DiagnosticMessage textMessage(DiagnosticKind kind) {
+    return static_cast<DiagnosticMessage>(kind);
+}
+
+inline bool parseDiagnosticFormat(const std::string& name, DiagnosticFormat& format) {
+    if (name == "text") {
+        format = DiagnosticFormat::Text;
+    } else if (name == "json") {
+        format = DiagnosticFormat::Json;
+    } else if (name == "sarif") {
+        format = DiagnosticFormat::Sarif;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+/**
+ * DiagnosticBuffer - Unsynchronized diagnostics of one thread
+ *
+ * Records are 24 bytes; file names and arguments are interned per buffer,
+ * so a cascade of identical messages stores each argument once and the
+ * message text not at all.
+ */
+class DiagnosticBuffer {
+public:
+    struct Record {
+        DiagnosticMessage message;
+        uint16_t argCount;
+        uint32_t file;  // String index
+        uint32_t args;  // First of argCount string indices in `arguments`
+        int line;       // 1-based; 0 when the diagnostic has no location
+        int column;     // 0-based; -1 when only the line is known
+        int length;     // Span length in bytes; 0 when unknown
+    };
+
+private:
+    std::vector<Record> records;
+    std::vector<uint32_t> arguments;
+    std::vector<std::string> strings;
+    std::unordered_map<std::string, uint32_t> stringIds;
+    uint32_t file = 0;
+
+    uint32_t intern(const std::string& text) {
+        auto found = stringIds.find(text);
+        if (found != stringIds.end()) {
+            return found->second;
+        }
+        uint32_t id = static_cast<uint32_t>(strings.size());
+        strings.push_back(text);
+        stringIds.emplace(text, id);
+        return id;
+    }
+
+public:
+    explicit DiagnosticBuffer(const std::string& fileName = "") {
+        file = intern(fileName);
+    }
+
+    /**
+     * File that subsequent reports belong to
+     */
+    void setFile(const std::string& fileName) {
+        file = intern(fileName);
+    }
+
+    void report(DiagnosticMessage message, int line, int column, const std::vector<std::string>& args = {},
+                int length = 0) {
+        size_t count = std::min(args.size(), kMaxDiagnosticArgs);
+        records.push_back(Record{ message, static_cast<uint16_t>(count), file, static_cast<uint32_t>(arguments.size()),
+                                  line, column, length });
+        for (size_t i = 0; i < count; i++) {
+            arguments.push_back(intern(args[i]));
+        }
+    }
+
+    /**
+     * A phase's own text, as the `text` message of its kind
+     */
+    void report(DiagnosticKind kind, int line, int column, const std::string& text, int length = 0) {
+        records.push_back(Record{ textMessage(kind), 1, file, static_cast<uint32_t>(arguments.size()), line, column,
+                                  length });
+        arguments.push_back(intern(text));
+    }
+
+    bool empty() const { return records.empty(); }
+    size_t size() const { return records.size(); }
+    const std::vector<Record>& getRecords() const { return records; }
+    const std::string& text(uint32_t id) const { return strings[id]; }
+    const std::vector<std::string>& getStrings() const { return strings; }
+    const uint32_t* argumentIds(const Record& record) const { return arguments.data() + record.args; }
+};
+
+/**
+ * One diagnostic of a merged, sorted batch; points into the engine's buffers
+ */
+struct DiagnosticView {
+    DiagnosticKind kind;
+    uint8_t argCount;
+    DiagnosticMessage message;
+    int line;
+    int column;
+    int length;
+    const std::string* file;
+    const std::vector<std::string>* strings;  // The buffer's interned strings
+    const uint32_t* args;                     // argCount indices into strings
+
+    const std::string& arg(size_t i) const {
+        return (*strings)[args[i]];
+    }
+};
+
+/**
+ * DiagnosticEngine - Merges per-thread buffers and renders them in batches
+ */
+class DiagnosticEngine {
+private:
+    mutable std::mutex mutex;
+    std::vector<DiagnosticBuffer> buffers;
+
+    static void appendInt(std::string& out, int value) {
+        char digits[12];
+        char* end = digits + sizeof(digits);
+        char* p = end;
+        unsigned magnitude = value < 0 ? 0u - static_cast<unsigned>(value) : static_cast<unsigned>(value);
+        do {
+            *--p = static_cast<char>('0' + magnitude % 10);
+            magnitude /= 10;
+        } while (magnitude);
+        if (value < 0) {
+            *--p = '-';
+        }
+        out.append(p, end);
+    }
+
+    /**
+     * Fill the view's message template with its arguments
+     */
+    static void appendMessage(const DiagnosticView& view, std::string& out) {
+        for (const char* p = diagnosticMessage(view.message).format; *p; p++) {
+            size_t slot = static_cast<size_t>(p[1] - '0');
+            if (*p == '{' && slot < view.argCount && p[2] == '}') {
+                out += view.arg(slot);
+                p += 2;
+            } else {
+                out += *p;
+            }
+        }
+    }
+
+    static std::string renderText(const std::vector<DiagnosticView>& views) {
+        bool manyFiles = false;
+        for (const auto& view : views) {
+            manyFiles = manyFiles || *view.file != *views.front().file;
+        }
+        std::string out;
+        for (const auto& view : views) {
+            if (manyFiles && !view.file->empty()) {
+                out += *view.file;
+                out += ": ";
+            }
+            out += diagnosticRule(view.kind).name;
+            out += " error";
+            if (view.line > 0) {
+                out += " at line ";
+                appendInt(out, view.line);
+                if (view.column >= 0) {
+                    out += ", column ";
+                    appendInt(out, view.column + 1);
+                }
+            }
+            out += ": ";
+            appendMessage(view, out);
+            out += '\n';
+        }
+        return out;
+    }
+
+    /**
+     * Quoted file name, escaped once per run of diagnostics in the same file
+     */
+    struct FileQuoter {
+        const std::string* file = nullptr;
+        std::string quoted;
+
+        const std::string& operator()(const std::string* next) {
+            if (next != file) {
+                file = next;
+                quoted.clear();
+                Json::writeString(*file, quoted);
+            }
+            return quoted;
+        }
+    };
+
+    // JSON and SARIF are written straight into the output string; building a
+    // Json tree first costs several allocations per diagnostic
+
+    static std::string renderJson(const std::vector<DiagnosticView>& views) {
+        std::string out = "[";
+        std::string message;
+        FileQuoter quote;
+        for (size_t i = 0; i < views.size(); i++) {
+            const DiagnosticView& view = views[i];
+            out += i ? ",{\"id\":\"" : "{\"id\":\"";
+            out += diagnosticRule(view.kind).id;
+            out += "\",\"severity\":\"error\",\"file\":";
+            out += quote(view.file);
+            if (view.line > 0) {
+                out += ",\"line\":";
+                appendInt(out, view.line);
+                if (view.column >= 0) {
+                    out += ",\"column\":";
+                    appendInt(out, view.column + 1);
+                    if (view.length > 0) {
+                        out += ",\"endColumn\":";
+                        appendInt(out, view.column + 1 + view.length);
+                    }
+                }
+            }
+            out += ",\"messageId\":\"";
+            out += diagnosticMessage(view.message).id;
+            out += "\",\"message\":";
+            message.clear();
+            appendMessage(view, message);
+            Json::writeString(message, out);
+            out += '}';
+        }
+        out += "]\n";
+        return out;
+    }
+
+    static std::string renderSarif(const std::vector<DiagnosticView>& views) {
+        const DiagnosticKind kinds[] = { DiagnosticKind::Indentation, DiagnosticKind::Parse, DiagnosticKind::Struct,
+                                         DiagnosticKind::Semantic, DiagnosticKind::Assembler };
+        Json rules = Json::array();
+        for (DiagnosticKind kind : kinds) {
+            const DiagnosticRule& rule = diagnosticRule(kind);
+            Json messageStrings = Json::object();
+            for (size_t i = 0; i < kDiagnosticMessageCount; i++) {
+                const DiagnosticMessageInfo& message = diagnosticMessage(static_cast<DiagnosticMessage>(i));
+                if (message.kind == kind) {
+                    messageStrings.set(message.id, Json::object().set("text", message.format));
+                }
+            }
+            rules.push(Json::object()
+                           .set("id", rule.id)
+                           .set("name", std::string(rule.name) + "Error")
+                           .set("shortDescription", Json::object().set("text", rule.description))
+                           .set("messageStrings", std::move(messageStrings)));
+        }
+        Json tool = Json::object().set(
+            "driver", Json::object().set("name", "mya").set("version", "0.1").set("rules", std::move(rules)));
+        std::string out = "{\"$schema\":\"https://json.schemastore.org/sarif-2.1.0.json\",\"version\":\"2.1.0\","
+                          "\"runs\":[{\"tool\":";
+        tool.write(out);
+        out += ",\"results\":[";
+        std::string message;
+        FileQuoter quote;
+        for (size_t i = 0; i < views.size(); i++) {
+            const DiagnosticView& view = views[i];
+            out += i ? ",{\"ruleId\":\"" : "{\"ruleId\":\"";
+            out += diagnosticRule(view.kind).id;
+            out += "\",\"ruleIndex\":";
+            appendInt(out, static_cast<int>(view.kind));
+            out += ",\"level\":\"error\",\"message\":{\"text\":";
+            message.clear();
+            appendMessage(view, message);
+            Json::writeString(message, out);
+            out += ",\"id\":\"";
+            out += diagnosticMessage(view.message).id;
+            out += "\",\"arguments\":[";
+            for (size_t arg = 0; arg < view.argCount; arg++) {
+                if (arg) {
+                    out += ',';
+                }
+                Json::writeString(view.arg(arg), out);
+            }
+            out += "]},\"locations\":[{\"physicalLocation\":{\"artifactLocation\":{\"uri\":";
+            out += quote(view.file);
+            out += '}';
+            if (view.line > 0) {
+                out += ",\"region\":{\"startLine\":";
+                appendInt(out, view.line);
+                if (view.column >= 0) {
+                    out += ",\"startColumn\":";
+                    appendInt(out, view.column + 1);
+                    if (view.length > 0) {
+                        out += ",\"endColumn\":";
+                        appendInt(out, view.column + 1 + view.length);
+                    }
+                }
+                out += '}';
+            }
+            out += "}}]}";
+        }
+        out += "]}]}\n";
+        return out;
+    }
+
+    static bool less(const DiagnosticView& a, const DiagnosticView& b) {
+        if (a.file != b.file) {
+            int order = a.file->compare(*b.file);
+            if (order != 0) {
+                return order < 0;
+            }
+        }
+        if (a.line != b.line) {
+            return a.line < b.line;
+        }
+        if (a.column != b.column) {
+            return a.column < b.column;
+        }
+        if (a.kind != b.kind) {
+            return a.kind < b.kind;
+        }
+        if (same(a, b)) {
+            return false;
+        }
+        return message(a) < message(b);  // Ties at one position are rare: format them
+    }
+
+    static bool same(const DiagnosticView& a, const DiagnosticView& b) {
+        if (a.line != b.line || a.column != b.column || a.message != b.message || a.argCount != b.argCount ||
+            (a.file != b.file && *a.file != *b.file)) {
+            return false;
+        }
+        for (size_t i = 0; i < a.argCount; i++) {
+            if (&a.arg(i) != &b.arg(i) && a.arg(i) != b.arg(i)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+public:
+    /**
+     * Take over a thread's buffer; safe to call from several threads
+     */
+    void merge(DiagnosticBuffer&& buffer) {
+        if (buffer.empty()) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        buffers.push_back(std::move(buffer));
+    }
+
+    /**
+     * Number of recorded diagnostics, duplicates included
+     */
+    size_t size() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        size_t total = 0;
+        for (const auto& buffer : buffers) {
+            total += buffer.size();
+        }
+        return total;
+    }
+
+    void clear() {
+        std::lock_guard<std::mutex> lock(mutex);
+        buffers.clear();
+    }
+
+    /**
+     * All diagnostics sorted by file, line and column, without duplicates.
+     * Views stay valid until the next merge or clear.
+     */
+    std::vector<DiagnosticView> collect() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::vector<DiagnosticView> views;
+        for (const auto& buffer : buffers) {
+            for (const auto& record : buffer.getRecords()) {
+                views.push_back(DiagnosticView{ diagnosticMessage(record.message).kind,
+                                                static_cast<uint8_t>(record.argCount), record.message, record.line,
+                                                record.column, record.length, &buffer.text(record.file),
+                                                &buffer.getStrings(), buffer.argumentIds(record) });
+            }
+        }
+        std::sort(views.begin(), views.end(), less);
+        auto last = std::unique(views.begin(), views.end(), same);
+        views.erase(last, views.end());
+        return views;
+    }
+
+    /**
+     * The view's message text, formatted from its template and arguments
+     */
+    static std::string message(const DiagnosticView& view) {
+        std::string text;
+        appendMessage(view, text);
+        return text;
+    }
+
+    static std::string render(const std::vector<DiagnosticView>& views, DiagnosticFormat format) {
+        switch (format) {
+        case DiagnosticFormat::Json:
+            return renderJson(views);
+        case DiagnosticFormat::Sarif:
+            return renderSarif(views);
+        default:
+            return renderText(views);
+        }
+    }
+};
+
+/**
+ * Benchmark: every hardware thread records `count` diagnostics in total
+ * (one in eight repeated, as cascades do) into its own buffer; then merge,
+ * sort/deduplicate and each rendering are timed separately
+ */
+inline void runDiagnosticsBenchmark(size_t count) {
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    std::cout << "Diagnostics benchmark: " << count << " diagnostics from " << threads << " threads" << std::endl;
+    const std::pair<DiagnosticMessage, std::vector<std::string>> messages[] = {
+        { DiagnosticMessage::ParseText, { "expected ':' after function signature" } },
+        { DiagnosticMessage::UndefinedVariable, { "total" } },
+        { DiagnosticMessage::CannotAssign, { "str", "int" } },
+        { DiagnosticMessage::IndentationText, { "unindent does not match any outer indentation level" } },
+    };
+
+    DiagnosticEngine engine;
+    double recording = bestOf(3, [&] {
+        engine.clear();
+        std::vector<std::thread> workers;
+        for (unsigned t = 0; t < threads; t++) {
+            workers.emplace_back([&, t] {
+                DiagnosticBuffer buffer("src/main.mya");
+                for (size_t i = t; i < count; i += threads) {
+                    size_t site = i % 8 == 7 ? i - 1 : i;  // Repeats the previous diagnostic
+                    const auto& message = messages[site % 4];
+                    buffer.report(message.first, static_cast<int>(site / 4) + 1, static_cast<int>(site % 40),
+                                  message.second, 3);
+                }
+                engine.merge(std::move(buffer));
+            });
+        }
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    });
+    reportBenchmark("record + merge", recording, count);
+
+    std::vector<DiagnosticView> views;
+    double collecting = bestOf(3, [&] { views = engine.collect(); });
+    reportBenchmark("sort + deduplicate", collecting, count);
+    std::cout << "    " << views.size() << " unique of " << engine.size() << std::endl;
+
+    size_t bytes = 0;
+    const std::pair<const char*, DiagnosticFormat> formats[] = {
+        { "render text", DiagnosticFormat::Text },
+        { "render JSON", DiagnosticFormat::Json },
+        { "render SARIF", DiagnosticFormat::Sarif },
+    };
+    for (const auto& format : formats) {
+        double rendering = bestOf(3, [&] { bytes = DiagnosticEngine::render(views, format.second).size(); });
+        reportBenchmark(format.first, rendering, views.size());
+        std::cout << "    " << bytes / 1024 << " KiB" << std::endl;
+    }
+}
+
+} // namespace MYA
+
+#endif // MYA_DIAGNOSTICS_H
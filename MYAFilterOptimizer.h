@@ -0,0 +1,397 @@
+/**
+ * MYA Language - Filter Optimizer
+ *
+ * `filter cond pass: block` guards a hot path: the pass block handles the
+ * rare case (a zero divisor, a recursion base case) and the code after the
+ * filter is the happy path. The code generator lowers every filter as
+ *
+ *     if (MYA_UNLIKELY(cond)) { MYA::Runtime::coldPath(); ...pass block... }
+ *
+ * so the compiler lays the happy path out as straight-line fall-through and
+ * moves the pass block into the function's cold section. Pass blocks that
+ * are a single return of a call-free value, break or continue only get the
+ * branch hint; they are smaller than the jump to a cold section.
+ *
+ * This pass proves filter conditions before code generation:
+ * - AlwaysFalse: the condition folds to false from literals, or repeats
+ *   (call-free, same spelling) a filter earlier in the same straight-line
+ *   path whose pass block always leaves it, with none of its variables
+ *   assigned since. The filter is removed; its block is still type checked.
+ * - AlwaysTrue: the condition folds to true; the pass block is emitted
+ *   without the unlikely hint.
+ */
+
+#ifndef MYA_FILTER_OPTIMIZER_H
+#define MYA_FILTER_OPTIMIZER_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <set>
+#include <string>
+#include <vector>
+#include "MYAAST.h"
+#include "MYABenchmark.h"
+#include "MYARuntime.h"
+
+namespace MYA {
+
+/**
+ * FilterOptimizer - Proves filter conditions true or false
+ */
+class FilterOptimizer {
+private:
+    /**
+     * A condition known to be false at the current point
+     */
+    struct Fact {
+        std::string condition;  // Expr::str() spelling
+        std::set<std::string> names;
+        int line;
+    };
+
+    std::vector<OptRemark>& remarks;
+    int removed = 0;
+
+    // ----- Constant conditions -----
+
+    struct Constant {
+        enum Kind { Bool, Int, Float } kind;
+        bool b;
+        int64_t i;
+        double f;
+
+        double asFloat() const {
+            return kind == Int ? static_cast<double>(i) : f;
+        }
+    };
+
+    static bool evaluate(const Expr& expr, Constant& result) {
+        switch (expr.kind) {
+        case ExprKind::Boolean:
+            result = Constant{ Constant::Bool, expr.text == "true", 0, 0.0 };
+            return true;
+        case ExprKind::Number:
+            if (expr.isFloatLiteral()) {
+                result = Constant{ Constant::Float, false, 0, std::strtod(expr.text.c_str(), nullptr) };
+                return true;
+            }
+            if (expr.text.size() > 18) {
+                return false;
+            }
+            result = Constant{ Constant::Int, false, std::strtoll(expr.text.c_str(), nullptr, 10), 0.0 };
+            return true;
+        case ExprKind::Unary: {
+            Constant operand;
+            if ((expr.text != "-" && expr.text != "not") || !evaluate(*expr.args[0], operand)) {
+                return false;
+            }
+            if (expr.text == "not") {
+                result = Constant{ Constant::Bool, !operand.b, 0, 0.0 };
+                return operand.kind == Constant::Bool;
+            }
+            result = operand;
+            result.i = -operand.i;
+            result.f = -operand.f;
+            return operand.kind != Constant::Bool;
+        }
+        case ExprKind::Binary:
+            return evaluateBinary(expr, result);
+        default:
+            return false;
+        }
+    }
+
+    static bool evaluateBinary(const Expr& expr, Constant& result) {
+        const std::string& op = expr.text;
+        Constant lhs, rhs;
+        bool lhsKnown = evaluate(*expr.args[0], lhs);
+        if (op == "and" || op == "or") {
+            // false and x / true or x: x is never evaluated
+            if (lhsKnown && lhs.kind == Constant::Bool && lhs.b == (op == "or")) {
+                result = lhs;
+                return true;
+            }
+            if (!lhsKnown || !evaluate(*expr.args[1], rhs) || rhs.kind != Constant::Bool) {
+                return false;
+            }
+            result = rhs;
+            return true;
+        }
+        if (!lhsKnown || !evaluate(*expr.args[1], rhs)) {
+            return false;
+        }
+        bool numeric = lhs.kind != Constant::Bool && rhs.kind != Constant::Bool;
+        int order = 0;
+        if (lhs.kind == Constant::Int && rhs.kind == Constant::Int) {
+            order = lhs.i < rhs.i ? -1 : lhs.i > rhs.i ? 1 : 0;
+        } else if (numeric) {
+            double a = lhs.asFloat(), b = rhs.asFloat();
+            if (a != a || b != b) {
+                return false;
+            }
+            order = a < b ? -1 : a > b ? 1 : 0;
+        } else if (lhs.kind == Constant::Bool && rhs.kind == Constant::Bool && (op == "==" || op == "!=")) {
+            order = lhs.b == rhs.b ? 0 : 1;
+        } else {
+            return false;
+        }
+        bool value;
+        if (op == "==") {
+            value = order == 0;
+        } else if (op == "!=") {
+            value = order != 0;
+        } else if (op == "<" && numeric) {
+            value = order < 0;
+        } else if (op == "<=" && numeric) {
+            value = order <= 0;
+        } else if (op == ">" && numeric) {
+            value = order > 0;
+        } else if (op == ">=" && numeric) {
+            value = order >= 0;
+        } else {
+            return false;  // Arithmetic is left to the C++ compiler
+        }
+        result = Constant{ Constant::Bool, value, 0, 0.0 };
+        return true;
+    }
+
+    // ----- Repeated conditions -----
+
+    /**
+     * Collect variables read by `expr`; false if it calls a function
+     */
+    static bool collectNames(const Expr& expr, std::set<std::string>& names) {
+        if (expr.kind == ExprKind::Call) {
+            return false;
+        }
+        if (expr.kind == ExprKind::Identifier) {
+            names.insert(expr.text);
+        }
+        for (const auto& arg : expr.args) {
+            if (!collectNames(*arg, names)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    static const Expr* rootVariable(const Expr& expr) {
+        const Expr* node = &expr;
+        while (node->kind == ExprKind::Index || node->kind == ExprKind::Member) {
+            node = node->args[0].get();
+        }
+        return node->kind == ExprKind::Identifier ? node : nullptr;
+    }
+
+    static void collectAssigned(const Expr& expr, std::set<std::string>& names) {
+        if (expr.kind == ExprKind::Call && (expr.text == "push" || expr.text == "remove") && !expr.args.empty()) {
+            if (const Expr* root = rootVariable(*expr.args[0])) {
+                names.insert(root->text);
+            }
+        }
+        for (const auto& arg : expr.args) {
+            collectAssigned(*arg, names);
+        }
+    }
+
+    /**
+     * Variables `stmt` may change, including loop variables that shadow
+     * outer names inside the loop body
+     */
+    static void collectAssigned(const Stmt& stmt, std::set<std::string>& names) {
+        if (stmt.kind == StmtKind::Assign) {
+            if (const Expr* root = rootVariable(*stmt.target)) {
+                names.insert(root->text);
+            }
+        } else if (stmt.kind == StmtKind::Let || stmt.kind == StmtKind::Free || stmt.kind == StmtKind::For) {
+            names.insert(stmt.name);
+        }
+        for (const Expr* expr : { stmt.target.get(), stmt.value.get(), stmt.limit.get() }) {
+            if (expr) {
+                collectAssigned(*expr, names);
+            }
+        }
+        for (const auto& arg : stmt.args) {
+            collectAssigned(*arg, names);
+        }
+        for (const auto& s : stmt.body) {
+            collectAssigned(*s, names);
+        }
+        for (const auto& s : stmt.elseBody) {
+            collectAssigned(*s, names);
+        }
+    }
+
+    static void kill(std::vector<Fact>& facts, const std::set<std::string>& assigned) {
+        facts.erase(std::remove_if(facts.begin(), facts.end(), [&](const Fact& fact) {
+            for (const auto& name : fact.names) {
+                if (assigned.count(name)) {
+                    return true;
+                }
+            }
+            return false;
+        }), facts.end());
+    }
+
+    static bool leavesBlock(const StmtList& block) {
+        if (block.empty()) {
+            return false;
+        }
+        StmtKind last = block.back()->kind;
+        return last == StmtKind::Return || last == StmtKind::Break || last == StmtKind::Continue;
+    }
+
+    // ----- Traversal -----
+
+    void visitFilter(Stmt& stmt, std::vector<Fact>& facts) {
+        Constant value;
+        std::string condition = stmt.value->str();
+        if (evaluate(*stmt.value, value) && value.kind == Constant::Bool) {
+            stmt.filterFact = value.b ? FilterFact::AlwaysTrue : FilterFact::AlwaysFalse;
+            if (value.b) {
+                remarks.push_back(OptRemark{ stmt.line, "filter", "condition is always true; pass block always runs", false });
+                visitBlock(stmt.body, facts);
+            } else {
+                remarks.push_back(OptRemark{ stmt.line, "filter", "removed filter: condition is always false", true });
+                removed++;
+            }
+            return;
+        }
+        for (const auto& fact : facts) {
+            if (fact.condition == condition) {
+                stmt.filterFact = FilterFact::AlwaysFalse;
+                remarks.push_back(OptRemark{ stmt.line, "filter",
+                    "removed filter: condition already failed at line " + std::to_string(fact.line), true });
+                removed++;
+                return;
+            }
+        }
+        visitBlock(stmt.body, facts);
+        Fact fact{ condition, {}, stmt.line };
+        if (leavesBlock(stmt.body) && collectNames(*stmt.value, fact.names)) {
+            facts.push_back(fact);
+        }
+    }
+
+    /**
+     * `facts` is a copy: what holds inside a block does not hold after it
+     */
+    void visitBlock(StmtList& block, std::vector<Fact> facts) {
+        for (auto& stmt : block) {
+            std::set<std::string> assigned;
+            switch (stmt->kind) {
+            case StmtKind::Filter:
+                visitFilter(*stmt, facts);
+                break;
+            case StmtKind::If:
+                visitBlock(stmt->body, facts);
+                visitBlock(stmt->elseBody, facts);
+                collectAssigned(*stmt, assigned);
+                break;
+            case StmtKind::For:
+                collectAssigned(*stmt, assigned);
+                kill(facts, assigned);  // The body runs after its own assignments
+                visitBlock(stmt->body, facts);
+                break;
+            default:
+                collectAssigned(*stmt, assigned);
+                break;
+            }
+            kill(facts, assigned);
+        }
+    }
+
+public:
+    explicit FilterOptimizer(std::vector<OptRemark>& remarks) : remarks(remarks) {}
+
+    /**
+     * Annotate every filter; returns the number of filters removed
+     */
+    int run(Program& program) {
+        removed = 0;
+        for (auto& fn : program.functions) {
+            if (!fn.evaluated) {
+                visitBlock(fn.body, {});
+            }
+        }
+        visitBlock(program.topLevel, {});
+        return removed;
+    }
+};
+
+// ----- Benchmark -----
+
+namespace FilterBench {
+
+/**
+ * The loop `for i in range 0 to len(x): s = s + x[i] / y[i];` guarded by
+ * `filter y[i] == 0 pass: print "zero divisor at", i; return -1;` as each
+ * lowering emits it. The divisor is never zero, so only the happy path runs.
+ */
+MYA_NOINLINE inline int64_t unguarded(const Runtime::List<int64_t>& x, const Runtime::List<int64_t>& y) {
+    int64_t s = 0;
+    for (int64_t i = 0; i < Runtime::len(x); i++) {
+        s = s + Runtime::divide(Runtime::at(x, i, 3), Runtime::at(y, i, 3), 3);
+    }
+    return s;
+}
+
+MYA_NOINLINE inline int64_t plainIf(const Runtime::List<int64_t>& x, const Runtime::List<int64_t>& y) {
+    int64_t s = 0;
+    for (int64_t i = 0; i < Runtime::len(x); i++) {
+        if (Runtime::at(y, i, 2) == 0) {
+            Runtime::printParts(Runtime::text("zero divisor at "), i, Runtime::text("\n"));
+            return -1;
+        }
+        s = s + Runtime::divide(Runtime::at(x, i, 3), Runtime::at(y, i, 3), 3);
+    }
+    return s;
+}
+
+MYA_NOINLINE inline int64_t filter(const Runtime::List<int64_t>& x, const Runtime::List<int64_t>& y) {
+    int64_t s = 0;
+    for (int64_t i = 0; i < Runtime::len(x); i++) {
+        if (MYA_UNLIKELY(Runtime::at(y, i, 2) == 0)) {
+            Runtime::coldPath();
+            Runtime::printParts(Runtime::text("zero divisor at "), i, Runtime::text("\n"));
+            return -1;
+        }
+        s = s + Runtime::divide(Runtime::at(x, i, 3), Runtime::at(y, i, 3), 3);
+    }
+    return s;
+}
+
+} // namespace FilterBench
+
+/**
+ * Compare a guarded integer division loop over `count` elements with no
+ * guard, an `if` guard and the filter lowering
+ */
+inline void runFilterBenchmark(size_t count) {
+    typedef int64_t (*Loop)(const Runtime::List<int64_t>&, const Runtime::List<int64_t>&);
+    const int repeats = std::max(3, static_cast<int>(20000000 / std::max<size_t>(count, 1)));
+    Runtime::List<int64_t> x(count), y(count);
+    for (size_t i = 0; i < count; i++) {
+        x[i] = static_cast<int64_t>(i * 7 + 3);
+        y[i] = static_cast<int64_t>(1 + i % 13);
+    }
+    std::cout << "Filter benchmark: " << count << " guarded divisions x " << repeats << " passes" << std::endl;
+
+    volatile int64_t sink = 0;
+    size_t items = count * static_cast<size_t>(repeats);
+    auto time = [&](Loop loop) {
+        return bestOf(5, [&] {
+            for (int r = 0; r < repeats; r++) {
+                sink = sink + loop(x, y);
+            }
+        });
+    };
+    reportBenchmark("no guard", time(FilterBench::unguarded), items);
+    reportBenchmark("if guard", time(FilterBench::plainIf), items);
+    reportBenchmark("filter guard (unlikely, cold)", time(FilterBench::filter), items);
+}
+
+} // namespace MYA
+
+#endif // MYA_FILTER_OPTIMIZER_H
@@ -0,0 +1,116 @@
+/**
+ * MYA Language - Source Formatter
+ *
+ * Re-indents a file straight from its token stream and trivia table
+ * (MYAIndentationPreprocessor.h), without re-reading or re-lexing it:
+ * - Code lines get `indentWidth` spaces per block level and lose trailing
+ *   spaces; a CRLF line end is kept
+ * - Comment lines take the level of the code line that follows them
+ * - Blank lines lose their whitespace; `$$` block comments are copied as is
+ *
+ * Line numbers and the block structure are unchanged, so the formatted file
+ * parses to the same AST. Files with indentation errors are left alone:
+ * their block structure is what the error is about.
+ */
+
+#ifndef MYA_FORMATTER_H
+#define MYA_FORMATTER_H
+
+#include <string>
+#include <vector>
+#include "MYAIndentationPreprocessor.h"
+
+namespace MYA {
+
+/**
+ * SourceFormatter - Canonical indentation for a preprocessed file
+ */
+class SourceFormatter {
+private:
+    int indentWidth;
+
+    /**
+     * Append `text` without trailing spaces and tabs, keeping a final '\r'
+     */
+    static void appendTrimmed(std::string& out, const std::string& text, size_t begin, size_t end) {
+        bool carriageReturn = end > begin && text[end - 1] == '\r';
+        if (carriageReturn) {
+            end--;
+        }
+        while (end > begin && (text[end - 1] == ' ' || text[end - 1] == '\t')) {
+            end--;
+        }
+        out.append(text, begin, end - begin);
+        if (carriageReturn) {
+            out += '\r';
+        }
+    }
+
+public:
+    explicit SourceFormatter(int indentWidth = 4) : indentWidth(indentWidth) {}
+
+    /**
+     * Format the source `preprocessor` last processed into `out`; returns
+     * false (leaving `out` empty) when the file has indentation errors
+     */
+    bool format(const IndentationPreprocessor& preprocessor, const std::vector<Token>& tokens,
+                std::string& out) const {
+        out.clear();
+        if (!preprocessor.getDiagnostics().empty()) {
+            return false;
+        }
+        const TriviaTable& trivia = preprocessor.getTrivia();
+
+        // Block depth of every CODE token
+        std::vector<int> depths(tokens.size(), 0);
+        int depth = 0;
+        for (size_t i = 0; i < tokens.size(); i++) {
+            if (tokens[i].type == TokenType::INDENT) {
+                depth++;
+            } else if (tokens[i].type == TokenType::DEDENT) {
+                depth--;
+            }
+            depths[i] = depth;
+        }
+
+        // Comment lines are indented like the next code line
+        std::vector<int> lineDepths(trivia.lineCount(), 0);
+        int next = 0;
+        for (size_t i = trivia.lineCount(); i-- > 0;) {
+            const TriviaTable::Line& line = trivia.at(static_cast<int>(i + 1));
+            if (line.token != TriviaTable::kNone) {
+                next = depths[line.token];
+            }
+            lineDepths[i] = next;
+        }
+
+        for (size_t i = 0; i < trivia.lineCount(); i++) {
+            const TriviaTable::Line& line = trivia.at(static_cast<int>(i + 1));
+            if (line.kind == TriviaTable::LineKind::BlockComment) {
+                out += trivia.triviaText(line);
+            } else if (line.kind == TriviaTable::LineKind::Blank) {
+                std::string text = trivia.triviaText(line);
+                if (!text.empty() && text.back() == '\r') {
+                    out += '\r';
+                }
+            } else {
+                out.append(static_cast<size_t>(lineDepths[i] * indentWidth), ' ');
+                if (line.kind == TriviaTable::LineKind::Code) {
+                    const std::string& code = tokens[line.token].value;
+                    appendTrimmed(out, code, 0, code.size());
+                } else {
+                    std::string text = trivia.triviaText(line);
+                    appendTrimmed(out, text, text.find_first_not_of(" \t"), text.size());
+                }
+            }
+            if (i + 1 < trivia.lineCount() || trivia.endsWithNewline()) {
+                out += '\n';
+            }
+        }
+        return true;
+    }
+};
+
+} // namespace MYA
+
+#endif // MYA_FORMATTER_H
@@ -0,0 +1,821 @@
+/**
+ * MYA Language - Fuzzing and Differential Testing
+ *
+ * Fuzz targets for the front end, each a function from arbitrary bytes to
+ * "no crash, no exception, invariants hold":
+ * - preprocessor: IndentationPreprocessor::process; INDENT/DEDENT balance,
+ *   line order, CODE text, lossless reconstruction from the trivia table,
+ *   a second run on the same instance must give the same tokens, and with
+ *   the tab width fixed the tokens must match the previous implementation
+ * - format: SourceFormatter; the output parses to the same AST and
+ *   formatting it again changes nothing
+ * - lexer: lexLine over every CODE line (the stage MYATokenSource performs
+ *   with the ANTLR lexer); lexemes are in order and match the source text
+ * - parser: ASTBuilder over the preprocessed tokens; diagnostics stay in
+ *   range and the error cap holds
+ * - pipeline: parse, struct layout, optimizer and C++ code generation
+ * - diff: the DifferentialHarness (below)
+ * - token-source: MYATokenSource, only when built with MYA_ANTLR_AVAILABLE
+ *
+ * The DifferentialHarness runs a baseline front-end path and candidate
+ * paths on the same input and compares token streams and AST dumps; a
+ * rewrite of the preprocessor or parser registers as a candidate. The
+ * built-in candidates feed the production path equivalent inputs: leading
+ * tabs expanded to spaces (same tokens and tree) and CRLF line ends (same
+ * tree).
+ *
+ * `MYACompiler.exe --fuzz <target> [n] [seed.mya]` replays the seed corpus
+ * (built-in example plus the given file), then runs n grammar-aware
+ * generated or mutated inputs: mixed tab/space indentation, `$$` comments,
+ * CR, deep nesting and splices of real code. A failing input is written to
+ * crash-<target>-<hash>.mya (also on a fatal signal), and an input that
+ * takes longer than the per-input budget (`--fuzz-budget <ms>`, default
+ * 200) is written to slow-<target>-<hash>.mya as a performance bug. Set
+ * MYA_FUZZ_SEED to reproduce a run. With n = 0 only the seeds run, which
+ * replays a saved crash.
+ *
+ * For coverage-guided fuzzing the same targets build as libFuzzer binaries:
+ *   clang++ -std=c++14 -g -O1 -fsanitize=fuzzer,address -pthread
+ *       -DMYA_LIBFUZZER_TARGET='"parser"' -x c++ MYAFuzz.h -o fuzz-parser
+ *   ./fuzz-parser -timeout=1 -report_slow_units=1 corpus/
+ */
+
+#ifndef MYA_FUZZ_H
+#define MYA_FUZZ_H
+
+#include <algorithm>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "MYABenchmark.h"
+#include "MYAIndentationPreprocessor.h"
+#include "MYAASTBuilder.h"
+#include "MYAStructLayout.h"
+#include "MYAOptimizer.h"
+#include "MYACodegen.h"
+#include "MYAFormatter.h"
+#ifdef MYA_ANTLR_AVAILABLE
+#include "MYACustomTokenStream.h"
+#endif
+
+namespace MYA {
+
+/**
+ * Invariant violated by a fuzz input
+ */
+class FuzzFailure : public std::runtime_error {
+public:
+    explicit FuzzFailure(const std::string& what) : std::runtime_error(what) {}
+};
+
+inline void fuzzCheck(bool condition, const std::string& what) {
+    if (!condition) {
+        throw FuzzFailure(what);
+    }
+}
+
+/**
+ * Number of lines the preprocessor sees (std::getline semantics)
+ */
+inline int countSourceLines(const std::string& source) {
+    int lines = static_cast<int>(std::count(source.begin(), source.end(), '\n'));
+    if (!source.empty() && source.back() != '\n') {
+        lines++;
+    }
+    return lines;
+}
+
+inline std::string describeToken(const Token& token) {
+    static const char* names[] = { "INDENT", "DEDENT", "NEWLINE", "CODE", "EOF" };
+    std::string text = names[static_cast<int>(token.type)];
+    text += " line " + std::to_string(token.line) + " column " + std::to_string(token.column);
+    if (token.type == TokenType::CODE) {
+        text += " '" + token.value + "'";
+    }
+    return text;
+}
+
+/**
+ * Structural invariants of a preprocessed token stream
+ */
+inline void checkTokenStream(const std::string& source, const std::vector<Token>& tokens) {
+    int lines = countSourceLines(source);
+    fuzzCheck(!tokens.empty() && tokens.back().type == TokenType::END_OF_FILE, "token stream does not end in EOF");
+    int depth = 0;
+    int lastLine = 0;
+    for (size_t i = 0; i + 1 < tokens.size(); i++) {
+        const Token& token = tokens[i];
+        fuzzCheck(token.type != TokenType::END_OF_FILE, "EOF before the end of the stream");
+        fuzzCheck(token.line >= lastLine, "token lines go backwards at " + describeToken(token));
+        lastLine = token.line;
+        if (token.type == TokenType::INDENT) {
+            depth++;
+        } else if (token.type == TokenType::DEDENT) {
+            fuzzCheck(--depth >= 0, "DEDENT without INDENT at " + describeToken(token));
+        } else if (token.type == TokenType::CODE) {
+            fuzzCheck(token.line >= 1 && token.line <= lines, "CODE line out of range: " + describeToken(token));
+            fuzzCheck(!token.value.empty() && token.value.find('\n') == std::string::npos,
+                      "CODE text is empty or spans lines: " + describeToken(token));
+            fuzzCheck(token.value[0] != ' ' && token.value[0] != '\t',
+                      "CODE text keeps indentation: " + describeToken(token));
+        }
+    }
+    fuzzCheck(depth == 0, "unbalanced INDENT/DEDENT (" + std::to_string(depth) + " left open)");
+}
+
+/**
+ * Everything the front end produced for one input, in comparable form
+ */
+struct FrontEndResult {
+    std::vector<Token> tokens;
+    std::string tree;             // ASTPrinter dump
+    std::vector<int> errorLines;  // Indentation and parse diagnostics, in order
+};
+
+/**
+ * The line-at-a-time preprocessor that IndentationPreprocessor replaced
+ * (std::getline, fixed tab width), kept as the differential baseline for
+ * its token stream
+ */
+inline std::vector<Token> legacyPreprocess(const std::string& source, int tabWidth,
+                                           std::vector<IndentationDiagnostic>& diagnostics) {
+    std::vector<Token> tokens;
+    std::vector<int> levels(1, 0);
+    std::vector<bool> aliases(1, false);
+    std::istringstream stream(source);
+    std::string line;
+    int currentLine = 1, previousIndent = 0;
+    bool inBlockComment = false;
+    for (; std::getline(stream, line); currentLine++) {
+        size_t start = line.find_first_not_of(" \t");
+        if (inBlockComment || (start != std::string::npos && line.compare(start, 2, "$$") == 0)) {
+            size_t pos = line.find("$$");
+            if (!inBlockComment) {
+                pos = line.find("$$", pos + 2);
+            }
+            inBlockComment = pos == std::string::npos;
+            continue;
+        }
+        if (line.find_first_not_of(" \t\r\n") == std::string::npos || line[start] == '$') {
+            continue;
+        }
+        int indent = 0;
+        for (size_t i = 0; i < start; i++) {
+            indent += line[i] == '\t' ? tabWidth : 1;
+        }
+        if (indent > previousIndent) {
+            levels.push_back(indent);
+            aliases.push_back(false);
+            tokens.push_back(Token(TokenType::INDENT, "<INDENT>", currentLine, 0));
+        } else if (indent < previousIndent) {
+            while (levels.size() > 1 && levels.back() > indent) {
+                if (!aliases.back()) {
+                    tokens.push_back(Token(TokenType::DEDENT, "<DEDENT>", currentLine, 0));
+                }
+                levels.pop_back();
+                aliases.pop_back();
+            }
+            if (levels.back() != indent) {
+                diagnostics.push_back(
+                    IndentationDiagnostic{ currentLine, indent, "unindent does not match any outer indentation level" });
+                levels.push_back(indent);
+                aliases.push_back(true);
+            }
+        }
+        tokens.push_back(Token(TokenType::CODE, line.substr(start), currentLine, indent));
+        previousIndent = indent;
+    }
+    for (; levels.size() > 1; levels.pop_back(), aliases.pop_back()) {
+        if (!aliases.back()) {
+            tokens.push_back(Token(TokenType::DEDENT, "<DEDENT>", currentLine, 0));
+        }
+    }
+    tokens.push_back(Token(TokenType::END_OF_FILE, "<EOF>", currentLine, 0));
+    return tokens;
+}
+
+inline void collectFrontEnd(FrontEndResult& result, const std::vector<IndentationDiagnostic>& indentation) {
+    ASTBuilder builder;
+    Program program = builder.build(result.tokens);
+    std::ostringstream tree;
+    ASTPrinter(tree).print(program);
+    result.tree = tree.str();
+    for (const auto& error : indentation) {
+        result.errorLines.push_back(error.line);
+    }
+    for (const auto& error : builder.getDiagnostics()) {
+        result.errorLines.push_back(error.line);
+    }
+}
+
+/**
+ * Production front end with a fixed tab width of 4, so that paths feeding
+ * equivalent inputs are comparable
+ */
+inline FrontEndResult runFrontEnd(const std::string& source) {
+    FrontEndResult result;
+    IndentationPreprocessor preprocessor(4);
+    preprocessor.setDetectTabWidth(false);
+    result.tokens = preprocessor.process(source);
+    collectFrontEnd(result, preprocessor.getDiagnostics());
+    return result;
+}
+
+/**
+ * One way of running the front end. `sameTokens` is false for paths whose
+ * token text legitimately differs (CRLF keeps the '\r'); their trees and
+ * error lines must still match.
+ */
+struct FrontEndPath {
+    std::string name;
+    std::function<FrontEndResult(const std::string&)> run;
+    bool sameTokens;
+};
+
+/**
+ * DifferentialHarness - Runs candidate front-end paths against a baseline
+ * and reports the first difference in tokens, tree or error lines
+ */
+class DifferentialHarness {
+private:
+    FrontEndPath baseline;
+    std::vector<FrontEndPath> candidates;
+
+    static std::string firstTreeDifference(const std::string& a, const std::string& b) {
+        std::istringstream left(a), right(b);
+        std::string x, y;
+        for (int line = 1;; line++) {
+            bool moreLeft = static_cast<bool>(std::getline(left, x));
+            bool moreRight = static_cast<bool>(std::getline(right, y));
+            if (!moreLeft && !moreRight) {
+                return "";
+            }
+            if (!moreLeft || !moreRight || x != y) {
+                return "tree line " + std::to_string(line) + ": '" + (moreLeft ? x : "<end>") + "' vs '" +
+                       (moreRight ? y : "<end>") + "'";
+            }
+        }
+    }
+
+public:
+    explicit DifferentialHarness(FrontEndPath baseline) : baseline(std::move(baseline)) {}
+
+    void addCandidate(FrontEndPath path) {
+        candidates.push_back(std::move(path));
+    }
+
+    /**
+     * Harness with the built-in equivalent-input candidates
+     */
+    static DifferentialHarness standard() {
+        DifferentialHarness harness(FrontEndPath{ "front end", runFrontEnd, true });
+        harness.addCandidate(FrontEndPath{ "tabs expanded", [](const std::string& source) {
+            std::string expanded;
+            bool leading = true;
+            for (char c : source) {
+                if (c == '\n') {
+                    leading = true;
+                } else if (leading && c == '\t') {
+                    expanded += "    ";
+                    continue;
+                } else if (c != ' ') {
+                    leading = false;
+                }
+                expanded += c;
+            }
+            return runFrontEnd(expanded);
+        }, true });
+        harness.addCandidate(FrontEndPath{ "CRLF", [](const std::string& source) {
+            std::string crlf;
+            for (char c : source) {
+                if (c == '\n') {
+                    crlf += '\r';
+                }
+                crlf += c;
+            }
+            return runFrontEnd(crlf);
+        }, false });
+        harness.addCandidate(FrontEndPath{ "legacy preprocessor", [](const std::string& source) {
+            FrontEndResult result;
+            std::vector<IndentationDiagnostic> diagnostics;
+            result.tokens = legacyPreprocess(source, 4, diagnostics);
+            collectFrontEnd(result, diagnostics);
+            return result;
+        }, true });
+        return harness;
+    }
+
+    void check(const std::string& source) const {
+        FrontEndResult expected = baseline.run(source);
+        for (const auto& candidate : candidates) {
+            FrontEndResult actual = candidate.run(source);
+            std::string prefix = "'" + candidate.name + "' differs from '" + baseline.name + "': ";
+            if (candidate.sameTokens) {
+                size_t count = std::min(expected.tokens.size(), actual.tokens.size());
+                for (size_t i = 0; i < count; i++) {
+                    const Token& a = expected.tokens[i];
+                    const Token& b = actual.tokens[i];
+                    fuzzCheck(a.type == b.type && a.line == b.line && a.column == b.column && a.value == b.value,
+                              prefix + "token " + std::to_string(i) + ": " + describeToken(a) + " vs " + describeToken(b));
+                }
+                fuzzCheck(expected.tokens.size() == actual.tokens.size(),
+                          prefix + std::to_string(expected.tokens.size()) + " vs " +
+                              std::to_string(actual.tokens.size()) + " tokens");
+            }
+            std::string tree = firstTreeDifference(expected.tree, actual.tree);
+            fuzzCheck(tree.empty(), prefix + tree);
+            fuzzCheck(expected.errorLines == actual.errorLines,
+                      prefix + std::to_string(expected.errorLines.size()) + " vs " +
+                          std::to_string(actual.errorLines.size()) + " errors, or on different lines");
+        }
+    }
+};
+
+// ----- Fuzz targets -----
+
+inline void fuzzPreprocessor(const std::string& source) {
+    IndentationPreprocessor preprocessor(4);
+    std::vector<Token> tokens = preprocessor.process(source);
+    checkTokenStream(source, tokens);
+    int lines = countSourceLines(source);
+    for (const auto& error : preprocessor.getDiagnostics()) {
+        fuzzCheck(error.line >= 1 && error.line <= lines && error.column >= 0, "indentation diagnostic out of range");
+    }
+    fuzzCheck(static_cast<int>(preprocessor.getTrivia().lineCount()) == lines, "trivia table misses lines");
+    fuzzCheck(preprocessor.getTrivia().reconstruct(tokens) == source, "source does not round-trip through the trivia table");
+    const IndentationStyle& style = preprocessor.getStyle();
+    fuzzCheck(style.indentUnit >= 1 && style.indentUnit <= 16, "indent unit out of range");
+
+    std::vector<Token> again = preprocessor.process(source);
+    fuzzCheck(again.size() == tokens.size(), "second process() on the same preprocessor differs");
+    for (size_t i = 0; i < tokens.size(); i++) {
+        fuzzCheck(again[i].type == tokens[i].type && again[i].line == tokens[i].line &&
+                      again[i].column == tokens[i].column && again[i].value == tokens[i].value,
+                  "second process() differs at " + describeToken(tokens[i]));
+    }
+
+    // With the tab width fixed, tokens must match the previous implementation
+    std::vector<IndentationDiagnostic> legacyDiagnostics;
+    std::vector<Token> legacy = legacyPreprocess(source, 4, legacyDiagnostics);
+    preprocessor.setDetectTabWidth(false);
+    std::vector<Token> fixed = preprocessor.process(source);
+    fuzzCheck(fixed.size() == legacy.size(), "token count differs from the legacy preprocessor");
+    for (size_t i = 0; i < fixed.size(); i++) {
+        fuzzCheck(fixed[i].type == legacy[i].type && fixed[i].line == legacy[i].line &&
+                      fixed[i].column == legacy[i].column && fixed[i].value == legacy[i].value,
+                  "differs from the legacy preprocessor at " + describeToken(legacy[i]) + " vs " + describeToken(fixed[i]));
+    }
+    fuzzCheck(preprocessor.getDiagnostics().size() == legacyDiagnostics.size(),
+              "indentation diagnostics differ from the legacy preprocessor");
+}
+
+inline void fuzzFormatter(const std::string& source) {
+    IndentationPreprocessor preprocessor(4);
+    FrontEndResult before;
+    before.tokens = preprocessor.process(source);
+    std::string formatted;
+    if (!SourceFormatter().format(preprocessor, before.tokens, formatted)) {
+        return;
+    }
+    collectFrontEnd(before, preprocessor.getDiagnostics());
+    IndentationPreprocessor again(4);
+    FrontEndResult after;
+    after.tokens = again.process(formatted);
+    collectFrontEnd(after, again.getDiagnostics());
+    fuzzCheck(before.tree == after.tree, "formatting changed the AST");
+    fuzzCheck(before.errorLines == after.errorLines, "formatting changed the errors");
+    std::string twice;
+    fuzzCheck(SourceFormatter().format(again, after.tokens, twice) && twice == formatted,
+              "formatting is not idempotent");
+}
+
+inline void fuzzLexer(const std::string& source) {
+    for (const auto& token : IndentationPreprocessor(4).process(source)) {
+        if (token.type != TokenType::CODE) {
+            continue;
+        }
+        std::string error;
+        int end = token.column;
+        for (const auto& lexeme : lexLine(token.value, token.column, error)) {
+            int offset = lexeme.column - token.column;
+            fuzzCheck(lexeme.column >= end && !lexeme.text.empty(),
+                      "lexemes overlap or are empty on line " + std::to_string(token.line));
+            fuzzCheck(token.value.compare(static_cast<size_t>(offset), lexeme.text.size(), lexeme.text) == 0,
+                      "lexeme '" + lexeme.text + "' does not match the source on line " + std::to_string(token.line));
+            end = lexeme.column + static_cast<int>(lexeme.text.size());
+        }
+    }
+}
+
+inline void fuzzParser(const std::string& source) {
+    std::vector<Token> tokens = IndentationPreprocessor(4).process(source);
+    const size_t limit = 20;
+    ASTBuilder builder;
+    builder.setErrorLimit(limit);
+    Program program = builder.build(tokens);
+    int lines = countSourceLines(source);
+    fuzzCheck(builder.getDiagnostics().size() <= limit, "parser exceeded its error limit");
+    for (const auto& error : builder.getDiagnostics()) {
+        fuzzCheck(error.line >= 1 && error.line <= lines + 1 && error.column >= 0,
+                  "parse diagnostic out of range: line " + std::to_string(error.line) + ": " + error.message);
+    }
+    for (const auto& fn : program.functions) {
+        fuzzCheck(fn.line >= 1 && fn.line <= lines, "function '" + fn.name + "' has line " + std::to_string(fn.line));
+    }
+    std::ostringstream tree;
+    ASTPrinter(tree).print(program);
+}
+
+inline void fuzzPipeline(const std::string& source) {
+    std::vector<Token> tokens = IndentationPreprocessor(4).process(source);
+    ASTBuilder builder;
+    Program program = builder.build(tokens);
+    if (!builder.getDiagnostics().empty()) {
+        return;
+    }
+    StructLayoutEngine layouts;
+    if (!layouts.computeAll(collectStructDefs(tokens))) {
+        return;
+    }
+    Optimizer(OptimizerOptions()).run(program);
+    std::string cpp;
+    CppCodegen codegen(program, layouts);
+    bool ok = codegen.generate(cpp);
+    fuzzCheck(ok == codegen.getDiagnostics().empty(), "code generator result disagrees with its diagnostics");
+}
+
+inline void fuzzDifferential(const std::string& source) {
+    static const DifferentialHarness harness = DifferentialHarness::standard();
+    harness.check(source);
+}
+
+#ifdef MYA_ANTLR_AVAILABLE
+inline void fuzzTokenSource(const std::string& source) {
+    MYATokenSource tokenSource(IndentationPreprocessor(4).process(source), "fuzz");
+    size_t lastLine = 0;
+    for (antlr4::Token* token = tokenSource.nextToken(); token->getType() != antlr4::Token::EOF;
+         token = tokenSource.nextToken()) {
+        fuzzCheck(token->getLine() >= lastLine, "ANTLR token lines go backwards");
+        lastLine = token->getLine();
+    }
+}
+#endif
+
+/**
+ * Benchmark: the previous and current preprocessor on the same generated
+ * file of about `lines` lines, plus reconstruction and formatting
+ */
+inline void runPreprocessorBenchmark(size_t lines) {
+    std::string source;
+    size_t count = 0;
+    for (size_t f = 0; count < lines; f++) {
+        source += "$ function " + std::to_string(f) + "\n"
+                  "fn step" + std::to_string(f) + "(a: int, b: int) -> int:\n"
+                  "    let s: int = a;   $ running sum\n"
+                  "    for i in range 0 to b:\n"
+                  "        s = s + i * b;\n"
+                  "\n"
+                  "        filter s > 1000 pass:\n"
+                  "            s = s - 1000;\n"
+                  "    return s;\n";
+        count += 9;
+    }
+    std::cout << "Preprocessor benchmark: " << count << " lines, " << source.size() / 1024 << " KiB" << std::endl;
+
+    size_t tokenCount = 0;
+    double legacy = bestOf(3, [&] {
+        std::vector<IndentationDiagnostic> diagnostics;
+        tokenCount = legacyPreprocess(source, 4, diagnostics).size();
+    });
+    reportBenchmark("getline reference (tokens only)", legacy, count);
+
+    IndentationPreprocessor preprocessor(4);
+    std::vector<Token> tokens;
+    double scanned = bestOf(3, [&] { tokens = preprocessor.process(source); });
+    reportBenchmark("table-driven + trivia", scanned, count);
+    std::cout << "    " << tokens.size() << " tokens (reference: " << tokenCount << "), "
+              << preprocessor.getTrivia().size() / 1024 << " KiB of trivia" << std::endl;
+
+    std::string rebuilt;
+    double reconstructing = bestOf(3, [&] { rebuilt = preprocessor.getTrivia().reconstruct(tokens); });
+    reportBenchmark("reconstruct source", reconstructing, count);
+    std::cout << "    " << (rebuilt == source ? "identical to the input" : "DIFFERS from the input") << std::endl;
+
+    std::string formatted;
+    double formatting = bestOf(3, [&] { SourceFormatter().format(preprocessor, tokens, formatted); });
+    reportBenchmark("format from tokens", formatting, count);
+}
+
+struct FuzzTarget {
+    const char* name;
+    void (*run)(const std::string&);
+};
+
+inline const std::vector<FuzzTarget>& fuzzTargets() {
+    static const std::vector<FuzzTarget> targets = {
+        { "preprocessor", fuzzPreprocessor },
+        { "format", fuzzFormatter },
+        { "lexer", fuzzLexer },
+        { "parser", fuzzParser },
+        { "pipeline", fuzzPipeline },
+        { "diff", fuzzDifferential },
+#ifdef MYA_ANTLR_AVAILABLE
+        { "token-source", fuzzTokenSource },
+#endif
+    };
+    return targets;
+}
+
+inline const FuzzTarget* findFuzzTarget(const std::string& name) {
+    for (const auto& target : fuzzTargets()) {
+        if (name == target.name) {
+            return &target;
+        }
+    }
+    return nullptr;
+}
+
+// ----- Built-in driver -----
+
+/**
+ * FuzzInputGenerator - Grammar-aware generation and mutation of MYA source
+ */
+class FuzzInputGenerator {
+private:
+    uint64_t state;
+    const std::vector<std::string>& corpus;
+
+    static const std::vector<std::string>& fragments() {
+        static const std::vector<std::string> lines = {
+            "Main() fn:", "fn f(a: int, b: int) -> int:", "fn g() -> float:", "fn h(xs: list<int>):",
+            "struct Point:", "x: int", "y: float", "end", "render:", "viewport: 800x600", "object: cube",
+            "asm:", "mov eax, 1", "add eax, ebx", "let x: int = 1;", "let s: str = \"a\\tb\";",
+            "let xs: list<int> = [1, 2, 3];", "let p: Point = Point(1, 2.5);", "x = x + f(x, 2) * 3;",
+            "if x > 0 and not (y < 1):", "else:", "for i in range 0 to 10:", "pfor i in range 0 to n:",
+            "filter x == 0 pass:", "print \"value:\", x;", "return x;", "return f(a - 1, b * a);", "break;",
+            "continue;", "push(xs, 4);", "free xs;", "let t: task<int> = spawn g();", "let c: chan<int> = channel(4);",
+            "send(c, 1);", "let v: int = recv(c);", "await t;", "$ comment", "$$ block", "comment $$", "$$ one line $$",
+            "xs[i] = xs[i - 1] + 1;", "p.x = p.y;", "let q: int = ((((1))));", "\"unterminated", "let @ = 1;",
+        };
+        return lines;
+    }
+
+public:
+    FuzzInputGenerator(uint64_t seed, const std::vector<std::string>& corpus) : state(seed), corpus(corpus) {}
+
+    uint64_t next() {
+        // splitmix64
+        uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+
+    size_t below(size_t n) {
+        return n ? static_cast<size_t>(next() % n) : 0;
+    }
+
+    /**
+     * Leading whitespace for nesting `depth`, often mixing tabs and spaces
+     */
+    std::string indentation(int depth) {
+        static const char* units[] = { "    ", "    ", "\t", "  ", " \t", "\t ", "        ", "   " };
+        std::string text;
+        for (int i = 0; i < depth; i++) {
+            text += units[below(8)];
+        }
+        return text;
+    }
+
+    std::string generate() {
+        std::string source;
+        int depth = 0;
+        size_t lines = 1 + below(40);
+        for (size_t i = 0; i < lines; i++) {
+            const std::string& fragment = fragments()[below(fragments().size())];
+            if (below(6) == 0) {
+                depth = static_cast<int>(below(static_cast<size_t>(depth) + 2));
+            }
+            source += indentation(depth) + fragment + (below(16) == 0 ? "\r\n" : "\n");
+            if (!fragment.empty() && fragment.back() == ':') {
+                depth++;
+            }
+            if (below(8) == 0) {
+                source += "\n";
+            }
+        }
+        return source;
+    }
+
+    std::string mutate(std::string input) {
+        size_t rounds = 1 + below(4);
+        for (size_t round = 0; round < rounds; round++) {
+            size_t pos = below(input.size() + 1);
+            switch (below(9)) {
+            case 0:  // Replace a byte
+                if (!input.empty()) {
+                    static const char bytes[] = " \t\n\r$:;()\"\\x0";
+                    input[below(input.size())] = below(4) ? bytes[below(sizeof(bytes) - 1)] : static_cast<char>(next());
+                }
+                break;
+            case 1:  // Insert a fragment
+                input.insert(pos, fragments()[below(fragments().size())] + "\n");
+                break;
+            case 2: {  // Delete a range
+                size_t length = below(32);
+                if (pos < input.size()) {
+                    input.erase(pos, length);
+                }
+                break;
+            }
+            case 3: {  // Re-indent the line containing pos with a random tab/space mix
+                size_t start = input.rfind('\n', pos ? pos - 1 : 0);
+                start = start == std::string::npos || pos == 0 ? 0 : start + 1;
+                size_t code = input.find_first_not_of(" \t", start);
+                input.replace(start, (code == std::string::npos ? input.size() : code) - start,
+                              indentation(static_cast<int>(below(5))));
+                break;
+            }
+            case 4:  // Duplicate a chunk
+                if (!input.empty()) {
+                    size_t start = below(input.size());
+                    input.insert(pos, input.substr(start, below(256)));
+                }
+                break;
+            case 5:  // Splice in part of another corpus entry
+                if (!corpus.empty()) {
+                    const std::string& other = corpus[below(corpus.size())];
+                    size_t start = below(other.size());
+                    input.insert(pos, other.substr(start, below(512)));
+                }
+                break;
+            case 6: {  // Deep nesting: parentheses or a staircase of blocks
+                size_t depth = 1 + below(below(2) ? 300 : 3000);
+                if (below(2)) {
+                    input.insert(pos, "let d: int = " + std::string(depth, '(') + "1" + std::string(depth, ')') + ";\n");
+                } else {
+                    std::string stair;
+                    for (size_t i = 0; i < depth && i < 400; i++) {
+                        stair += std::string(i * 4, ' ') + "if x > 0:\n";
+                    }
+                    input.insert(pos, stair);
+                }
+                break;
+            }
+            case 7:  // Comment markers
+                input.insert(pos, below(2) ? "$$" : "$");
+                break;
+            default:  // Line end variants
+                input.insert(pos, below(2) ? "\r" : "\n");
+                break;
+            }
+        }
+        if (input.size() > 65536) {
+            input.resize(65536);
+        }
+        return input;
+    }
+};
+
+namespace FuzzState {
+inline const std::string*& currentInput() {
+    static const std::string* input = nullptr;
+    return input;
+}
+
+inline std::string& currentTarget() {
+    static std::string target;
+    return target;
+}
+} // namespace FuzzState
+
+/**
+ * Whether `input` preprocesses and parses without errors
+ */
+inline bool fuzzParserAccepts(const std::string& input) {
+    IndentationPreprocessor preprocessor(4);
+    std::vector<Token> tokens = preprocessor.process(input);
+    ASTBuilder builder;
+    builder.build(tokens);
+    return preprocessor.getDiagnostics().empty() && builder.getDiagnostics().empty();
+}
+
+/**
+ * Write `input` to <kind>-<target>-<hash>.mya and return the file name
+ */
+inline std::string saveFuzzInput(const char* kind, const std::string& target, const std::string& input) {
+    uint64_t hash = 1469598103934665603ull;  // FNV-1a
+    for (char c : input) {
+        hash = (hash ^ static_cast<unsigned char>(c)) * 1099511628211ull;
+    }
+    char name[128];
+    std::snprintf(name, sizeof(name), "%s-%s-%016llx.mya", kind, target.c_str(), static_cast<unsigned long long>(hash));
+    std::ofstream(name, std::ios::binary) << input;
+    return name;
+}
+
+inline void fuzzFatalSignal(int signal) {
+    // Best effort: save the input that killed the process, then die as before
+    if (FuzzState::currentInput()) {
+        std::string name = saveFuzzInput("crash", FuzzState::currentTarget(), *FuzzState::currentInput());
+        std::fprintf(stderr, "\nFatal signal %d; input written to %s\n", signal, name.c_str());
+    }
+    std::signal(signal, SIG_DFL);
+    std::raise(signal);
+}
+
+/**
+ * Run a fuzz target: seed corpus first, then `iterations` generated or
+ * mutated inputs. Returns 0 when no input failed.
+ */
+inline int runFuzzer(const std::string& targetName, size_t iterations, std::vector<std::string> corpus,
+                     double budgetMs) {
+    const FuzzTarget* target = findFuzzTarget(targetName);
+    if (!target) {
+        std::cerr << "Unknown fuzz target: " << targetName << " (";
+        for (size_t i = 0; i < fuzzTargets().size(); i++) {
+            std::cerr << (i ? ", " : "") << fuzzTargets()[i].name;
+        }
+        std::cerr << ")" << std::endl;
+        return 1;
+    }
+    const char* seedVariable = std::getenv("MYA_FUZZ_SEED");
+    uint64_t seed = seedVariable ? std::strtoull(seedVariable, nullptr, 10) : static_cast<uint64_t>(std::time(nullptr));
+    std::cout << "Fuzzing '" << target->name << "': " << corpus.size() << " seeds, " << iterations
+              << " inputs, seed " << seed << ", budget " << budgetMs << " ms/input" << std::endl;
+
+    FuzzState::currentTarget() = target->name;
+    std::signal(SIGSEGV, fuzzFatalSignal);
+    std::signal(SIGABRT, fuzzFatalSignal);
+    std::signal(SIGFPE, fuzzFatalSignal);
+
+    FuzzInputGenerator generator(seed, corpus);
+    size_t slow = 0, kept = 0, seeds = corpus.size();
+    size_t bytes = 0;
+    double slowest = 0.0;
+    Stopwatch total;
+    for (size_t i = 0; i < seeds + iterations; i++) {
+        std::string input;
+        if (i < seeds) {
+            input = corpus[i];
+        } else if (corpus.empty() || generator.below(4) == 0) {
+            input = generator.generate();
+        } else {
+            input = generator.mutate(corpus[generator.below(corpus.size())]);
+        }
+        bytes += input.size();
+        FuzzState::currentInput() = &input;
+        Stopwatch watch;
+        try {
+            target->run(input);
+        } catch (const std::exception& e) {
+            FuzzState::currentInput() = nullptr;
+            std::string name = saveFuzzInput("crash", target->name, input);
+            std::cerr << "Fuzz failure on input " << i << " (" << input.size() << " bytes): " << e.what() << std::endl;
+            std::cerr << "Input written to " << name << "; replay with --fuzz " << target->name << " 0 " << name
+                      << std::endl;
+            return 1;
+        }
+        FuzzState::currentInput() = nullptr;
+        double ms = watch.elapsedSeconds() * 1000;
+        slowest = std::max(slowest, ms);
+        if (ms > budgetMs) {
+            slow++;
+            std::string name = saveFuzzInput("slow", target->name, input);
+            std::cerr << "Performance bug: input " << i << " (" << input.size() << " bytes) took "
+                      << static_cast<int>(ms) << " ms; written to " << name << std::endl;
+        }
+        // Inputs that still parse cleanly reach the later phases: keep them as seeds
+        if (i >= seeds && corpus.size() < 512 && generator.below(8) == 0 && fuzzParserAccepts(input)) {
+            corpus.push_back(input);
+            kept++;
+        }
+    }
+    double seconds = total.elapsedSeconds();
+    std::cout << "No failures in " << seeds + iterations << " inputs (" << bytes / 1024 << " KiB, "
+              << static_cast<int>((seeds + iterations) / std::max(seconds, 1e-9)) << " inputs/s); slowest "
+              << static_cast<int>(slowest) << " ms, " << slow << " over budget, " << kept << " added to corpus"
+              << std::endl;
+    return 0;
+}
+
+} // namespace MYA
+
+#ifdef MYA_LIBFUZZER_TARGET
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    static const MYA::FuzzTarget* target = MYA::findFuzzTarget(MYA_LIBFUZZER_TARGET);
+    target->run(std::string(reinterpret_cast<const char*>(data), size));
+    return 0;
+}
+#endif
+
+#endif // MYA_FUZZ_H
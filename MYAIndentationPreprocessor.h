@@ -8,16 +8,24 @@
  * - Recursive linear parsing (sequential processing)
  * - Non-linear lateral recursion (sibling scope exploration)
  * - Scope ledger tracking for contextual awareness
+ * - Per-file indentation style: the tab width is detected when a file mixes
+ *   tabs and spaces, and the indent unit is reported for formatters
+ * - Lossless trivia: whitespace and comment lines are kept in a side table,
+ *   so the exact source can be rebuilt from the token stream
+ *
+ * The source is scanned once in place; a byte-class table drives the
+ * line splitting and the indentation measurement.
  */
 
 #ifndef MYA_INDENTATION_PREPROCESSOR_H
 #define MYA_INDENTATION_PREPROCESSOR_H
 
+#include <cctype>
+#include <cstdint>
+#include <iostream>
+#include <stack>
 #include <string>
 #include <vector>
-#include <stack>
-#include <sstream>
-#include <iostream>
 
 namespace MYA {
 
@@ -57,151 +65,507 @@ struct ScopeInfo {
       : indentLevel(level), line(ln), scopeType(type) {}
 };
 
+/**
+ * Indentation problem found while preprocessing; columns are 0-based
+ */
+struct IndentationDiagnostic {
+    int line;
+    int column;
+    std::string message;
+};
+
+/**
+ * Indentation conventions of one file
+ */
+struct IndentationStyle {
+    int tabWidth = 4;           // Columns per tab used for this file
+    bool tabWidthDetected = false;  // tabWidth was chosen from the file, not configured
+    int indentUnit = 4;         // Most common indent step, in columns
+    bool usesTabs = false;      // Some code line indents with a tab
+    bool usesSpaces = false;    // Some code line indents with a space
+};
+
+/**
+ * TriviaTable - Everything the token stream leaves out, per source line
+ *
+ * For code lines that is the leading whitespace (the CODE token holds the
+ * rest of the line, trailing comment included); blank, comment and block
+ * comment lines are trivia as a whole. The text lives in one buffer that
+ * lines refer to by offset.
+ */
+class TriviaTable {
+public:
+    enum class LineKind : uint8_t { Code, Blank, Comment, BlockComment };
+
+    static const uint32_t kNone = 0xFFFFFFFFu;
+
+    struct Line {
+        uint32_t offset;   // Start of the line's trivia in text()
+        uint32_t length;
+        uint32_t token;    // Index of the line's CODE token, or kNone
+        uint32_t comment;  // Offset of a trailing `$` comment in the CODE text, or kNone
+        LineKind kind;
+    };
+
+private:
+    std::string text;
+    std::vector<Line> lines;
+    bool finalNewline = false;
+
+    friend class IndentationPreprocessor;
+
+public:
+    size_t lineCount() const { return lines.size(); }
+
+    /**
+     * Line `line` (1-based)
+     */
+    const Line& at(int line) const { return lines[static_cast<size_t>(line - 1)]; }
+
+    std::string triviaText(const Line& line) const { return text.substr(line.offset, line.length); }
+
+    bool endsWithNewline() const { return finalNewline; }
+
+    /**
+     * Bytes of trivia kept (whitespace and comment lines)
+     */
+    size_t size() const { return text.size(); }
+
+    /**
+     * Rebuild the exact source from the token stream it was produced with
+     */
+    std::string reconstruct(const std::vector<Token>& tokens) const {
+        std::string out;
+        size_t bytes = text.size() + lines.size();
+        for (const auto& line : lines) {
+            if (line.token != kNone) {
+                bytes += tokens[line.token].value.size();
+            }
+        }
+        out.reserve(bytes);
+        for (size_t i = 0; i < lines.size(); i++) {
+            out.append(text, lines[i].offset, lines[i].length);
+            if (lines[i].token != kNone) {
+                out += tokens[lines[i].token].value;
+            }
+            if (i + 1 < lines.size() || finalNewline) {
+                out += '\n';
+            }
+        }
+        return out;
+    }
+};
+
 /**
  * IndentationPreprocessor - Handles conversion of whitespace to INDENT/DEDENT tokens
  * 
  * This preprocessor maintains a scope ledger for lateral recursion support,
  * allowing sibling scopes to be processed non-linearly while maintaining
  * contextual relationships.
+ *
+ * A dedent to a column that matches no enclosing level is reported once and
+ * the column becomes an alias of the level it fell back to: later lines at
+ * that column continue the same block, and leaving it emits no DEDENT, so
+ * INDENT/DEDENT stay balanced and the parser sees one error, not a cascade.
  */
 class IndentationPreprocessor {
 private:
     std::vector<Token> tokens;
     std::stack<int> indentStack;
+    std::stack<bool> aliasStack;         // Parallel to indentStack: level is an alias (no INDENT was emitted)
+    std::vector<IndentationDiagnostic> diagnostics;
     std::vector<ScopeInfo> scopeLedger;  // Tracks all scopes for lateral navigation
 int currentLine;
     int tabWidth;
-    
+    bool detectTabWidth = true;
+    IndentationStyle style;
+    TriviaTable trivia;
+
+    enum CharClass : uint8_t { Other, Space, Tab, Return, Dollar, Quote, Backslash };
+
+    static const uint8_t* charClasses() {
+        static const struct Table {
+            uint8_t classes[256];
+            Table() : classes() {
+                classes[static_cast<unsigned char>(' ')] = Space;
+                classes[static_cast<unsigned char>('\t')] = Tab;
+                classes[static_cast<unsigned char>('\r')] = Return;
+                classes[static_cast<unsigned char>('$')] = Dollar;
+                classes[static_cast<unsigned char>('"')] = Quote;
+                classes[static_cast<unsigned char>('\\')] = Backslash;
+            }
+        } table;
+        return table.classes;
+    }
+
+    /**
+     * One source line: [begin, end) without the '\n'; code is the first byte
+     * after the leading spaces and tabs
+     */
+    struct ScannedLine {
+        size_t begin;
+        size_t code;
+        size_t end;
+        int spaces;
+        int tabs;
+        TriviaTable::LineKind kind;
+        uint32_t comment;  // Trailing comment offset from `code` (code lines)
+        bool opensBlock;   // Code line ends with ':'
+    };
+
+    /**
+     * Whether `$$` occurs in [from, end)
+     */
+    static bool hasMarker(const std::string& source, size_t from, size_t end) {
+        for (size_t i = from; i + 1 < end; i++) {
+            if (source[i] == '$' && source[i + 1] == '$') {
+                return true;
+            }
+        }
+        return false;
+    }
+
     /**
-     * Calculate indentation level from leading whitespace
+     * Scan the line starting at `pos` (std::getline semantics) and classify it;
+     * `blockComment` carries an open `$$` block from line to line
      */
-    int calculateIndentLevel(const std::string& line) {
-   int level = 0;
-     for (char c : line) {
- if (c == ' ') {
-       level++;
- } else if (c == '\t') {
-        level += tabWidth;
+    static ScannedLine scanLine(const std::string& source, size_t pos, bool& blockComment) {
+        const uint8_t* classes = charClasses();
+        size_t end = source.find('\n', pos);
+        end = end == std::string::npos ? source.size() : end;
+        ScannedLine line{ pos, pos, end, 0, 0, TriviaTable::LineKind::Code, TriviaTable::kNone, false };
+        for (; line.code < end; line.code++) {
+            uint8_t type = classes[static_cast<unsigned char>(source[line.code])];
+            if (type == Space) {
+                line.spaces++;
+            } else if (type == Tab) {
+                line.tabs++;
             } else {
-       break;
+                break;
+            }
+        }
+        // `$$ ... $$` blocks may span lines; the closing marker ends the line's comment
+        bool opens = !blockComment && end - line.code >= 2 && source.compare(line.code, 2, "$$") == 0;
+        if (blockComment || opens) {
+            blockComment = !hasMarker(source, opens ? line.code + 2 : pos, end);
+            line.kind = TriviaTable::LineKind::BlockComment;
+            return line;
+        }
+        size_t first = line.code;
+        while (first < end && classes[static_cast<unsigned char>(source[first])] != Other &&
+               classes[static_cast<unsigned char>(source[first])] <= Return) {
+            first++;
+        }
+        if (first == end) {
+            line.kind = TriviaTable::LineKind::Blank;
+        } else if (line.code == first && classes[static_cast<unsigned char>(source[first])] == Dollar) {
+            line.kind = TriviaTable::LineKind::Comment;
+        } else {
+            line.comment = commentOffset(source, line.code, end);
+            size_t last = line.comment == TriviaTable::kNone ? end : line.code + line.comment;
+            while (last > line.code && classes[static_cast<unsigned char>(source[last - 1])] != Other &&
+                   classes[static_cast<unsigned char>(source[last - 1])] <= Return) {
+                last--;
             }
+            line.opensBlock = last > line.code && source[last - 1] == ':';
         }
-  return level;
+        return line;
     }
-    
+
     /**
-     * Detect scope type from line content
+     * Offset of a trailing `$` comment in a code line (outside string
+     * literals), or TriviaTable::kNone
      */
-    std::string detectScopeType(const std::string& line) {
-        std::string trimmed = line;
-        // Remove leading whitespace
-    size_t start = trimmed.find_first_not_of(" \t");
-        if (start != std::string::npos) {
-         trimmed = trimmed.substr(start);
-  }
-        
-     if (trimmed.find("fn ") == 0 || trimmed.find("Main") == 0) {
-return "function";
-    } else if (trimmed.find("render") == 0) {
-     return "render";
-        } else if (trimmed.find("asm") == 0) {
-            return "asm";
-     } else if (trimmed.find("struct") == 0) {
-       return "struct";
-        } else if (trimmed.find("if ") == 0) {
-     return "conditional";
-        } else if (trimmed.find("for ") == 0) {
-      return "loop";
-  } else if (trimmed.find("filter") == 0) {
-            return "filter";
+    static uint32_t commentOffset(const std::string& source, size_t begin, size_t end) {
+        const uint8_t* classes = charClasses();
+        bool inString = false;
+        for (size_t i = begin; i < end; i++) {
+            uint8_t type = classes[static_cast<unsigned char>(source[i])];
+            if (inString) {
+                if (type == Backslash) {
+                    i++;
+                } else if (type == Quote) {
+                    inString = false;
+                }
+            } else if (type == Quote) {
+                inString = true;
+            } else if (type == Dollar) {
+                return static_cast<uint32_t>(i - begin);
+            }
         }
-  return "block";
+        return TriviaTable::kNone;
     }
-    
+
     /**
-     * Check if line is empty or whitespace only
+     * Leading whitespace of a code line, as the tab width detection sees it
      */
-    bool isEmptyLine(const std::string& line) {
-        return line.find_first_not_of(" \t\r\n") == std::string::npos;
+    struct IndentSample {
+        int spaces;
+        int tabs;
+        bool opensBlock;
+    };
+
+    /**
+     * Indentation the code lines would get wrong with `width` columns per
+     * tab: dedents matching no outer level, and indents after a line that
+     * does not end with ':'
+     */
+    static int countMismatches(const std::vector<IndentSample>& samples, int width) {
+        std::vector<int> levels(1, 0);
+        int mismatches = 0;
+        bool opensBlock = false;
+        for (const auto& sample : samples) {
+            int level = sample.spaces + sample.tabs * width;
+            bool opened = opensBlock;
+            opensBlock = sample.opensBlock;
+            if (level > levels.back()) {
+                mismatches += opened ? 0 : 1;
+                levels.push_back(level);
+                continue;
+            }
+            while (levels.size() > 1 && levels.back() > level) {
+                levels.pop_back();
+            }
+            if (levels.back() != level) {
+                mismatches++;
+                levels.push_back(level);
+            }
+        }
+        return mismatches;
+    }
+
+    /**
+     * Whether some lines start with a tab and others with a space; only
+     * such files depend on the tab width
+     */
+    static bool mixesTabsAndSpaces(const std::string& source) {
+        bool tabs = false;
+        bool spaces = false;
+        for (size_t pos = 0; pos < source.size() && !(tabs && spaces);) {
+            tabs = tabs || source[pos] == '\t';
+            spaces = spaces || source[pos] == ' ';
+            pos = source.find('\n', pos);
+            pos = pos == std::string::npos ? source.size() : pos + 1;
+        }
+        return tabs && spaces;
+    }
+
+    /**
+     * Tab width for a file that mixes tabs and spaces: the candidate
+     * (configured first, then 8, 4, 2) that leaves the fewest indentation
+     * mistakes in its code lines
+     */
+    int chooseTabWidth(const std::string& source) const {
+        std::vector<IndentSample> samples;
+        bool blockComment = false;
+        for (size_t pos = 0; pos < source.size();) {
+            ScannedLine line = scanLine(source, pos, blockComment);
+            if (line.kind == TriviaTable::LineKind::Code) {
+                samples.push_back(IndentSample{ line.spaces, line.tabs, line.opensBlock });
+            }
+            pos = line.end + 1;
+        }
+        int chosen = tabWidth;
+        int best = countMismatches(samples, tabWidth);
+        for (int width : { 8, 4, 2 }) {
+            int mismatches = best ? countMismatches(samples, width) : best;
+            if (mismatches < best) {
+                best = mismatches;
+                chosen = width;
+            }
+        }
+        return chosen;
     }
     
     /**
-     * Check if line is a comment
+     * Check that `text` has `keyword` at `start` as a whole word, so that
+     * identifiers such as `asmResult` or `renderScene` are not keywords
      */
-    bool isComment(const std::string& line) {
-std::string trimmed = line;
-     size_t start = trimmed.find_first_not_of(" \t");
-        if (start != std::string::npos) {
-    trimmed = trimmed.substr(start);
-            return trimmed[0] == '$';
+    static bool startsWithKeyword(const std::string& text, size_t start, const char* keyword) {
+        size_t length = std::char_traits<char>::length(keyword);
+        if (text.compare(start, length, keyword) != 0) {
+            return false;
         }
-        return false;
+        if (text.size() == start + length) {
+            return true;
+        }
+        char next = text[start + length];
+        return !(std::isalnum(static_cast<unsigned char>(next)) || next == '_');
     }
- 
+
+    /**
+     * Check that `text` has the prefix `prefix` at `start`
+     */
+    static bool startsWith(const std::string& text, size_t start, const char* prefix) {
+        return text.compare(start, std::char_traits<char>::length(prefix), prefix) == 0;
+    }
+
+public:
+    /**
+     * Detect scope type from line content ("function", "struct", "render",
+     * "asm", "loop", ...); also used by the parser to find top-level
+     * boundaries for error recovery
+     */
+    static std::string detectScopeType(const std::string& line) {
+        size_t start = line.find_first_not_of(" \t");
+        return detectScopeType(line, start == std::string::npos ? line.size() : start);
+    }
+
+    /**
+     * Scope type of the code starting at `start` in `text`
+     */
+    static std::string detectScopeType(const std::string& text, size_t start) {
+        if (startsWith(text, start, "fn ") || startsWithKeyword(text, start, "Main")) {
+            return "function";
+        } else if (startsWithKeyword(text, start, "render")) {
+            return "render";
+        } else if (startsWithKeyword(text, start, "asm")) {
+            return "asm";
+        } else if (startsWithKeyword(text, start, "struct")) {
+            return "struct";
+        } else if (startsWith(text, start, "if ")) {
+            return "conditional";
+        } else if (startsWith(text, start, "for ")) {
+            return "loop";
+        } else if (startsWith(text, start, "pfor ")) {
+            return "parallel-loop";
+        } else if (startsWithKeyword(text, start, "filter")) {
+            return "filter";
+        }
+        return "block";
+    }
+    
 public:
     IndentationPreprocessor(int tabWidth = 4)
         : currentLine(1), tabWidth(tabWidth) {
      indentStack.push(0);  // Base indentation level
+        aliasStack.push(false);
     }
     
+    /**
+     * Use the configured tab width even for files that mix tabs and spaces
+     */
+    void setDetectTabWidth(bool detect) {
+        detectTabWidth = detect;
+    }
+
     /**
      * Process source code and generate tokens with INDENT/DEDENT markers
      */
     std::vector<Token> process(const std::string& source) {
-      tokens.clear();
-   scopeLedger.clear();
+        tokens.clear();
+        scopeLedger.clear();
+        diagnostics.clear();
+        trivia = TriviaTable();
         currentLine = 1;
-   
-      std::istringstream stream(source);
-    std::string line;
- int previousIndent = 0;
-     
-        while (std::getline(stream, line)) {
-    // Skip empty lines and comments
-     if (isEmptyLine(line) || isComment(line)) {
-currentLine++;
-      continue;
-   }
-            
-            int currentIndent = calculateIndentLevel(line);
-         std::string scopeType = detectScopeType(line);
-      
-    // Handle indentation changes
-if (currentIndent > previousIndent) {
-     // Entering new scope - INDENT
-     indentStack.push(currentIndent);
-     tokens.push_back(Token(TokenType::INDENT, "<INDENT>", currentLine, 0));
-                scopeLedger.push_back(ScopeInfo(currentIndent, currentLine, scopeType));
-   } else if (currentIndent < previousIndent) {
-// Exiting scope(s) - DEDENT
-    while (!indentStack.empty() && indentStack.top() > currentIndent) {
-        indentStack.pop();
-            tokens.push_back(Token(TokenType::DEDENT, "<DEDENT>", currentLine, 0));
-      }
-    
-        // Verify indent level matches a previous level
-    if (indentStack.empty() || indentStack.top() != currentIndent) {
-      std::cerr << "Indentation error at line " << currentLine << std::endl;
-      }
-   }
-          
-     // Add the actual code line
-  std::string code = line.substr(currentIndent);
-tokens.push_back(Token(TokenType::CODE, code, currentLine, currentIndent));
-          
+
+        style = IndentationStyle();
+        style.tabWidth = detectTabWidth && mixesTabsAndSpaces(source) ? chooseTabWidth(source) : tabWidth;
+        style.tabWidthDetected = style.tabWidth != tabWidth;
+        int steps[17] = {};  // Indent steps of 1..16 columns, for style.indentUnit
+        size_t estimate = source.size() / 24 + 1;
+        tokens.reserve(estimate + estimate / 2);
+        trivia.lines.reserve(estimate);
+        trivia.text.reserve(source.size() / 8);
+        trivia.finalNewline = !source.empty() && source.back() == '\n';
+        int previousIndent = 0;
+        bool blockComment = false;
+
+        for (size_t pos = 0; pos < source.size();) {
+            ScannedLine line = scanLine(source, pos, blockComment);
+            pos = line.end + 1;
+            TriviaTable::Line entry{ static_cast<uint32_t>(trivia.text.size()), 0, TriviaTable::kNone,
+                                     TriviaTable::kNone, line.kind };
+            if (line.kind != TriviaTable::LineKind::Code) {
+                // Blank lines, comments and `$$` blocks are trivia only
+                trivia.text.append(source, line.begin, line.end - line.begin);
+                entry.length = static_cast<uint32_t>(line.end - line.begin);
+                trivia.lines.push_back(entry);
+                currentLine++;
+                continue;
+            }
+            trivia.text.append(source, line.begin, line.code - line.begin);
+            entry.length = static_cast<uint32_t>(line.code - line.begin);
+            style.usesTabs = style.usesTabs || line.tabs > 0;
+            style.usesSpaces = style.usesSpaces || line.spaces > 0;
+
+            int currentIndent = line.spaces + line.tabs * style.tabWidth;
+            if (currentIndent > previousIndent && currentIndent - previousIndent <= 16) {
+                steps[currentIndent - previousIndent]++;
+            }
+
+            // Handle indentation changes
+            if (currentIndent > previousIndent) {
+                // Entering new scope - INDENT
+                indentStack.push(currentIndent);
+                aliasStack.push(false);
+                tokens.push_back(Token(TokenType::INDENT, "<INDENT>", currentLine, 0));
+                scopeLedger.push_back(ScopeInfo(currentIndent, currentLine, detectScopeType(source, line.code)));
+            } else if (currentIndent < previousIndent) {
+                // Exiting scope(s) - DEDENT
+                while (indentStack.size() > 1 && indentStack.top() > currentIndent) {
+                    indentStack.pop();
+                    bool alias = aliasStack.top();
+                    aliasStack.pop();
+                    if (!alias) {
+                        tokens.push_back(Token(TokenType::DEDENT, "<DEDENT>", currentLine, 0));
+                    }
+                }
+
+                // Verify indent level matches a previous level
+                if (indentStack.top() != currentIndent) {
+                    diagnostics.push_back(IndentationDiagnostic{ currentLine, currentIndent,
+                        "unindent does not match any outer indentation level" });
+                    indentStack.push(currentIndent);
+                    aliasStack.push(true);
+                }
+            }
+
+            // The code line itself; a tab counts tabWidth columns but is one character
+            entry.token = static_cast<uint32_t>(tokens.size());
+            entry.comment = line.comment;
+            trivia.lines.push_back(entry);
+            tokens.push_back(Token(TokenType::CODE, "", currentLine, currentIndent));
+            tokens.back().value.assign(source, line.code, line.end - line.code);
+
             previousIndent = currentIndent;
-      currentLine++;
+            currentLine++;
         }
-   
-    // Close all remaining scopes
+
+        // Close all remaining scopes
         while (indentStack.size() > 1) {
-indentStack.pop();
-            tokens.push_back(Token(TokenType::DEDENT, "<DEDENT>", currentLine, 0));
+            indentStack.pop();
+            bool alias = aliasStack.top();
+            aliasStack.pop();
+            if (!alias) {
+                tokens.push_back(Token(TokenType::DEDENT, "<DEDENT>", currentLine, 0));
+            }
         }
-        
+
         tokens.push_back(Token(TokenType::END_OF_FILE, "<EOF>", currentLine, 0));
+
+        for (int step = 1; step <= 16; step++) {
+            if (steps[step] > steps[style.indentUnit]) {
+                style.indentUnit = step;
+            }
+        }
         return tokens;
     }
+
+    /**
+     * Indentation style detected for the last process() call
+     */
+    const IndentationStyle& getStyle() const {
+        return style;
+    }
+
+    /**
+     * Whitespace and comments of the last process() call; with the returned
+     * tokens it rebuilds the source exactly
+     */
+    const TriviaTable& getTrivia() const {
+        return trivia;
+    }
     
  /**
      * Get the scope ledger for lateral navigation
@@ -210,6 +574,13 @@ indentStack.pop();
     const std::vector<ScopeInfo>& getScopeLedger() const {
         return scopeLedger;
     }
+
+    /**
+     * Indentation errors of the last process() call
+     */
+    const std::vector<IndentationDiagnostic>& getDiagnostics() const {
+        return diagnostics;
+    }
     
     /**
      * Pretty print tokens for debugging
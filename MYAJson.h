@@ -0,0 +1,506 @@
+/**
+ * MYA Language - JSON Values
+ *
+ * Small JSON reader/writer for the tool-facing protocols (the language
+ * server's JSON-RPC messages). Objects keep their members in insertion
+ * order; numbers are doubles, written without a fraction when integral.
+ */
+
+#ifndef MYA_JSON_H
+#define MYA_JSON_H
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace MYA {
+
+/**
+ * Json - A null, bool, number, string, array or object
+ */
+class Json {
+public:
+    enum class Type { Null, Bool, Number, String, Array, Object, Raw };  // Raw: JSON text written verbatim
+
+private:
+    Type kind = Type::Null;
+    bool boolean = false;
+    double number = 0.0;
+    std::string text;
+    std::vector<Json> items;
+    std::vector<std::pair<std::string, Json>> members;
+
+    static void writeNumber(double value, std::string& out) {
+        if (std::isfinite(value) && value == std::floor(value) && std::fabs(value) < 1e15) {
+            // Integers (line numbers, ids) are the common case; skip printf
+            char digits[24];
+            char* end = digits + sizeof(digits);
+            char* p = end;
+            int64_t n = static_cast<int64_t>(value);
+            uint64_t magnitude = n < 0 ? static_cast<uint64_t>(-n) : static_cast<uint64_t>(n);
+            do {
+                *--p = static_cast<char>('0' + magnitude % 10);
+                magnitude /= 10;
+            } while (magnitude);
+            if (n < 0) {
+                *--p = '-';
+            }
+            out.append(p, end);
+            return;
+        }
+        char buffer[32];
+        std::snprintf(buffer, sizeof(buffer), "%.17g", std::isfinite(value) ? value : 0.0);
+        out += buffer;
+    }
+
+    // ----- Parsing -----
+
+    struct Reader {
+        const std::string& source;
+        size_t pos;
+        std::string error;
+
+        void skipSpace() {
+            while (pos < source.size() && (source[pos] == ' ' || source[pos] == '\t' || source[pos] == '\n' ||
+                                           source[pos] == '\r')) {
+                pos++;
+            }
+        }
+
+        bool fail(const std::string& message) {
+            if (error.empty()) {
+                error = message + " at offset " + std::to_string(pos);
+            }
+            return false;
+        }
+
+        bool literal(const char* word) {
+            size_t length = std::char_traits<char>::length(word);
+            if (source.compare(pos, length, word) != 0) {
+                return fail("invalid literal");
+            }
+            pos += length;
+            return true;
+        }
+
+        static void appendUtf8(unsigned code, std::string& out) {
+            if (code < 0x80) {
+                out += static_cast<char>(code);
+            } else if (code < 0x800) {
+                out += static_cast<char>(0xC0 | (code >> 6));
+                out += static_cast<char>(0x80 | (code & 0x3F));
+            } else if (code < 0x10000) {
+                out += static_cast<char>(0xE0 | (code >> 12));
+                out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+                out += static_cast<char>(0x80 | (code & 0x3F));
+            } else {
+                out += static_cast<char>(0xF0 | (code >> 18));
+                out += static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+                out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+                out += static_cast<char>(0x80 | (code & 0x3F));
+            }
+        }
+
+        bool hex4(unsigned& code) {
+            if (pos + 4 > source.size()) {
+                return fail("truncated \\u escape");
+            }
+            code = static_cast<unsigned>(std::strtoul(source.substr(pos, 4).c_str(), nullptr, 16));
+            pos += 4;
+            return true;
+        }
+
+        bool string(std::string& out) {
+            pos++;  // Opening quote
+            while (pos < source.size() && source[pos] != '"') {
+                char c = source[pos++];
+                if (c != '\\') {
+                    out += c;
+                    continue;
+                }
+                if (pos >= source.size()) {
+                    break;
+                }
+                char escape = source[pos++];
+                switch (escape) {
+                case 'n': out += '\n'; break;
+                case 'r': out += '\r'; break;
+                case 't': out += '\t'; break;
+                case 'b': out += '\b'; break;
+                case 'f': out += '\f'; break;
+                case 'u': {
+                    unsigned code = 0;
+                    if (!hex4(code)) {
+                        return false;
+                    }
+                    if (code >= 0xD800 && code < 0xDC00 && source.compare(pos, 2, "\\u") == 0) {
+                        unsigned low = 0;
+                        pos += 2;
+                        if (!hex4(low)) {
+                            return false;
+                        }
+                        code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                    }
+                    appendUtf8(code, out);
+                    break;
+                }
+                default:
+                    out += escape;  // \" \\ \/
+                }
+            }
+            if (pos >= source.size()) {
+                return fail("unterminated string");
+            }
+            pos++;
+            return true;
+        }
+
+        bool value(Json& out, int depth) {
+            if (depth > 256) {
+                return fail("nesting too deep");
+            }
+            skipSpace();
+            if (pos >= source.size()) {
+                return fail("unexpected end of input");
+            }
+            char c = source[pos];
+            if (c == '{') {
+                out.kind = Type::Object;
+                pos++;
+                skipSpace();
+                if (pos < source.size() && source[pos] == '}') {
+                    pos++;
+                    return true;
+                }
+                while (true) {
+                    skipSpace();
+                    if (pos >= source.size() || source[pos] != '"') {
+                        return fail("expected member name");
+                    }
+                    std::string key;
+                    if (!string(key)) {
+                        return false;
+                    }
+                    skipSpace();
+                    if (pos >= source.size() || source[pos] != ':') {
+                        return fail("expected ':'");
+                    }
+                    pos++;
+                    out.members.emplace_back(std::move(key), Json());
+                    if (!value(out.members.back().second, depth + 1)) {
+                        return false;
+                    }
+                    skipSpace();
+                    if (pos < source.size() && source[pos] == ',') {
+                        pos++;
+                    } else if (pos < source.size() && source[pos] == '}') {
+                        pos++;
+                        return true;
+                    } else {
+                        return fail("expected ',' or '}'");
+                    }
+                }
+            }
+            if (c == '[') {
+                out.kind = Type::Array;
+                pos++;
+                skipSpace();
+                if (pos < source.size() && source[pos] == ']') {
+                    pos++;
+                    return true;
+                }
+                while (true) {
+                    out.items.emplace_back();
+                    if (!value(out.items.back(), depth + 1)) {
+                        return false;
+                    }
+                    skipSpace();
+                    if (pos < source.size() && source[pos] == ',') {
+                        pos++;
+                    } else if (pos < source.size() && source[pos] == ']') {
+                        pos++;
+                        return true;
+                    } else {
+                        return fail("expected ',' or ']'");
+                    }
+                }
+            }
+            if (c == '"') {
+                out.kind = Type::String;
+                return string(out.text);
+            }
+            if (c == 't' || c == 'f') {
+                out.kind = Type::Bool;
+                out.boolean = c == 't';
+                return literal(c == 't' ? "true" : "false");
+            }
+            if (c == 'n') {
+                out.kind = Type::Null;
+                return literal("null");
+            }
+            const char* start = source.c_str() + pos;
+            char* end = nullptr;
+            out.kind = Type::Number;
+            out.number = std::strtod(start, &end);
+            if (end == start) {
+                return fail("unexpected character");
+            }
+            pos += static_cast<size_t>(end - start);
+            return true;
+        }
+    };
+
+public:
+    Json() {}
+    Json(std::nullptr_t) {}
+    Json(bool value) : kind(Type::Bool), boolean(value) {}
+    Json(int value) : kind(Type::Number), number(value) {}
+    Json(int64_t value) : kind(Type::Number), number(static_cast<double>(value)) {}
+    Json(size_t value) : kind(Type::Number), number(static_cast<double>(value)) {}
+    Json(double value) : kind(Type::Number), number(value) {}
+    Json(const char* value) : kind(Type::String), text(value) {}
+    Json(std::string value) : kind(Type::String), text(std::move(value)) {}
+
+    static Json array() {
+        Json value;
+        value.kind = Type::Array;
+        return value;
+    }
+
+    /**
+     * Already serialized JSON text, for large replies written without
+     * building a value per element; it is never parsed back
+     */
+    static Json raw(std::string json) {
+        Json value;
+        value.kind = Type::Raw;
+        value.text = std::move(json);
+        return value;
+    }
+
+    /**
+     * Append `value` as a JSON number
+     */
+    static void writeInt(int64_t value, std::string& out) {
+        writeNumber(static_cast<double>(value), out);
+    }
+
+    static Json object() {
+        Json value;
+        value.kind = Type::Object;
+        return value;
+    }
+
+    /**
+     * Parse a complete JSON text; on failure returns false and sets `error`
+     */
+    static bool parse(const std::string& source, Json& out, std::string& error) {
+        Reader reader{ source, 0, "" };
+        out = Json();
+        if (reader.value(out, 0)) {
+            reader.skipSpace();
+            if (reader.pos == source.size()) {
+                return true;
+            }
+            reader.fail("trailing characters");
+        }
+        error = reader.error;
+        return false;
+    }
+
+    /**
+     * Length of the well-formed UTF-8 sequence of two or more bytes at `i`,
+     * or 0 (truncated, overlong, a surrogate or past U+10FFFF)
+     */
+    static size_t utf8Length(const std::string& value, size_t i) {
+        static const uint32_t minimum[] = { 0, 0, 0x80, 0x800, 0x10000 };
+        unsigned char lead = static_cast<unsigned char>(value[i]);
+        size_t length = (lead & 0xE0) == 0xC0 ? 2 : (lead & 0xF0) == 0xE0 ? 3 : (lead & 0xF8) == 0xF0 ? 4 : 0;
+        if (length == 0 || i + length > value.size()) {
+            return 0;
+        }
+        uint32_t codePoint = lead & (0x7Fu >> length);
+        for (size_t k = 1; k < length; k++) {
+            unsigned char c = static_cast<unsigned char>(value[i + k]);
+            if ((c & 0xC0) != 0x80) {
+                return 0;
+            }
+            codePoint = (codePoint << 6) | (c & 0x3Fu);
+        }
+        bool valid = codePoint >= minimum[length] && codePoint <= 0x10FFFF && (codePoint < 0xD800 || codePoint > 0xDFFF);
+        return valid ? length : 0;
+    }
+
+    /**
+     * Append `value` as a quoted, escaped JSON string; bytes that are not
+     * well-formed UTF-8 become U+FFFD, so the output always decodes
+     */
+    static void writeString(const std::string& value, std::string& out) {
+        out += '"';
+        size_t run = 0;  // Start of the pending run of characters needing no escape
+        for (size_t i = 0; i < value.size(); i++) {
+            char c = value[i];
+            unsigned char byte = static_cast<unsigned char>(c);
+            if (c != '"' && c != '\\' && byte >= 0x20 && byte < 0x80) {
+                continue;
+            }
+            if (byte >= 0x80) {
+                size_t length = utf8Length(value, i);
+                if (length) {
+                    i += length - 1;
+                    continue;
+                }
+                out.append(value, run, i - run);
+                run = i + 1;
+                out += "\\ufffd";
+                continue;
+            }
+            out.append(value, run, i - run);
+            run = i + 1;
+            switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default: {
+                char escape[8];
+                std::snprintf(escape, sizeof(escape), "\\u%04x", static_cast<unsigned>(c));
+                out += escape;
+            }
+            }
+        }
+        out.append(value, run, std::string::npos);
+        out += '"';
+    }
+
+    Type type() const { return kind; }
+    bool isNull() const { return kind == Type::Null; }
+    bool isString() const { return kind == Type::String; }
+    bool isNumber() const { return kind == Type::Number; }
+    bool isArray() const { return kind == Type::Array; }
+    bool isObject() const { return kind == Type::Object; }
+
+    bool asBool() const { return kind == Type::Bool && boolean; }
+    double asNumber() const { return kind == Type::Number ? number : 0.0; }
+    int asInt() const { return static_cast<int>(asNumber()); }
+    const std::string& asString() const { return text; }
+    const std::vector<Json>& asArray() const { return items; }
+
+    size_t size() const {
+        return kind == Type::Array ? items.size() : members.size();
+    }
+
+    bool has(const std::string& key) const {
+        for (const auto& member : members) {
+            if (member.first == key) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * Member lookup; missing members (and non-objects) read as null
+     */
+    const Json& operator[](const std::string& key) const {
+        static const Json null;
+        for (const auto& member : members) {
+            if (member.first == key) {
+                return member.second;
+            }
+        }
+        return null;
+    }
+
+    const Json& operator[](size_t index) const {
+        static const Json null;
+        return index < items.size() ? items[index] : null;
+    }
+
+    /**
+     * Set (or replace) an object member; returns *this for chaining, moved
+     * out when called on a temporary so built-up messages are not copied
+     */
+    Json&& set(const std::string& key, Json value) && {
+        return std::move(set(key, std::move(value)));
+    }
+
+    Json& set(const std::string& key, Json value) & {
+        kind = Type::Object;
+        for (auto& member : members) {
+            if (member.first == key) {
+                member.second = std::move(value);
+                return *this;
+            }
+        }
+        members.emplace_back(key, std::move(value));
+        return *this;
+    }
+
+    Json&& push(Json value) && {
+        return std::move(push(std::move(value)));
+    }
+
+    Json& push(Json value) & {
+        kind = Type::Array;
+        items.push_back(std::move(value));
+        return *this;
+    }
+
+    void write(std::string& out) const {
+        switch (kind) {
+        case Type::Null:
+            out += "null";
+            break;
+        case Type::Bool:
+            out += boolean ? "true" : "false";
+            break;
+        case Type::Number:
+            writeNumber(number, out);
+            break;
+        case Type::String:
+            writeString(text, out);
+            break;
+        case Type::Raw:
+            out += text;
+            break;
+        case Type::Array:
+            out += '[';
+            for (size_t i = 0; i < items.size(); i++) {
+                if (i) {
+                    out += ',';
+                }
+                items[i].write(out);
+            }
+            out += ']';
+            break;
+        case Type::Object:
+            out += '{';
+            for (size_t i = 0; i < members.size(); i++) {
+                if (i) {
+                    out += ',';
+                }
+                writeString(members[i].first, out);
+                out += ':';
+                members[i].second.write(out);
+            }
+            out += '}';
+            break;
+        }
+    }
+
+    std::string dump() const {
+        std::string out;
+        write(out);
+        return out;
+    }
+};
+
+} // namespace MYA
+
+#endif // MYA_JSON_H
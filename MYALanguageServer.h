@@ -0,0 +1,743 @@
+/**
+ * MYA Language - Language Server
+ *
+ * `MYACompiler.exe --lsp` speaks the Language Server Protocol (JSON-RPC with
+ * Content-Length framing) over stdin/stdout:
+ * - Incremental text sync: edits are applied to the open document's text
+ *   and the document is re-analyzed; the re-analysis is per file, so an
+ *   edit never touches the rest of the workspace
+ * - Diagnostics for open documents: indentation and parse errors, struct
+ *   layout errors and the code generator's semantic errors, sorted and
+ *   deduplicated by the DiagnosticEngine, with the rule ID as `code`
+ * - Go-to-definition and find-references through the workspace SymbolIndex
+ *   (MYASymbolIndex.h), which keeps every file's index in memory
+ * - After `initialized`, every *.mya file under the workspace root is
+ *   indexed in the background on a ThreadPool; requests are answered
+ *   meanwhile from whatever has been indexed
+ *
+ * Positions are 0-based lines and UTF-16 code units within a line, or
+ * bytes when the client offers `utf-8` in initialize's positionEncodings.
+ * Open documents also keep their AST. `--bench lsp [lines]` builds a synthetic
+ * workspace in memory and times indexing and each request type.
+ */
+
+#ifndef MYA_LANGUAGE_SERVER_H
+#define MYA_LANGUAGE_SERVER_H
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "MYADiagnostics.h"
+#include "MYAJson.h"
+#include "MYASymbolIndex.h"
+#include "MYAStructLayout.h"
+#include "MYACodegen.h"
+#include "MYARuntimeParallel.h"
+#include "MYABenchmark.h"
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
+
+namespace MYA {
+
+/**
+ * `file:///dir/a%20b.mya` -> `/dir/a b.mya` (`C:/dir/...` on Windows)
+ */
+inline std::string uriToPath(const std::string& uri) {
+    std::string path;
+    size_t start = uri.compare(0, 7, "file://") == 0 ? 7 : 0;
+    for (size_t i = start; i < uri.size(); i++) {
+        if (uri[i] == '%' && i + 2 < uri.size()) {
+            path += static_cast<char>(std::strtol(uri.substr(i + 1, 2).c_str(), nullptr, 16));
+            i += 2;
+        } else {
+            path += uri[i];
+        }
+    }
+#ifdef _WIN32
+    if (path.size() > 2 && path[0] == '/' && path[2] == ':') {
+        path.erase(0, 1);
+    }
+    for (char& c : path) {
+        if (c == '\\') {
+            c = '/';
+        }
+    }
+#endif
+    return path;
+}
+
+inline std::string pathToUri(const std::string& path) {
+    std::string uri = path.empty() || path[0] != '/' ? "file:///" : "file://";
+    for (char c : path) {
+        unsigned char u = static_cast<unsigned char>(c);
+        if (std::isalnum(u) || c == '/' || c == '-' || c == '_' || c == '.' || c == '~') {
+            uri += c;
+        } else if (c == '\\') {
+            uri += '/';
+        } else {
+            char escape[4];
+            std::snprintf(escape, sizeof(escape), "%%%02X", u);
+            uri += escape;
+        }
+    }
+    return uri;
+}
+
+inline bool readTextFile(const std::string& path, std::string& text) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    text = buffer.str();
+    return true;
+}
+
+/**
+ * Collect *.mya files below `directory`, skipping hidden directories
+ */
+inline void listSourceFiles(const std::string& directory, std::vector<std::string>& out) {
+    auto isSource = [](const std::string& name) {
+        return name.size() > 4 && name.compare(name.size() - 4, 4, ".mya") == 0;
+    };
+#ifdef _WIN32
+    _finddata_t entry;
+    intptr_t handle = _findfirst((directory + "/*").c_str(), &entry);
+    if (handle == -1) {
+        return;
+    }
+    do {
+        std::string name = entry.name;
+        if (name[0] == '.') {
+            continue;
+        }
+        if (entry.attrib & _A_SUBDIR) {
+            listSourceFiles(directory + "/" + name, out);
+        } else if (isSource(name)) {
+            out.push_back(directory + "/" + name);
+        }
+    } while (_findnext(handle, &entry) == 0);
+    _findclose(handle);
+#else
+    DIR* dir = opendir(directory.c_str());
+    if (!dir) {
+        return;
+    }
+    while (dirent* entry = readdir(dir)) {
+        std::string name = entry->d_name;
+        if (name[0] == '.') {
+            continue;
+        }
+        std::string path = directory + "/" + name;
+        struct stat info;
+        if (stat(path.c_str(), &info) != 0) {
+            continue;
+        }
+        if (S_ISDIR(info.st_mode)) {
+            listSourceFiles(path, out);
+        } else if (isSource(name)) {
+            out.push_back(path);
+        }
+    }
+    closedir(dir);
+#endif
+}
+
+/**
+ * Symbol index of one source text
+ */
+inline std::shared_ptr<const FileIndex> indexSource(const std::string& text, const std::vector<Token>& tokens) {
+    FileIndex file = FileIndexer().index(tokens);
+    file.recordWideLines(text);
+    return std::make_shared<const FileIndex>(std::move(file));
+}
+
+inline std::shared_ptr<const FileIndex> indexSource(const std::string& text) {
+    IndentationPreprocessor preprocessor(4);
+    return indexSource(text, preprocessor.process(text));
+}
+
+/**
+ * Byte offset of an LSP (line, character) position, clamped to the text;
+ * `character` counts UTF-16 code units when `utf16`
+ */
+inline size_t offsetAt(const std::string& text, int line, int character, bool utf16) {
+    size_t offset = 0;
+    for (int i = 0; i < line && offset < text.size(); i++) {
+        size_t newline = text.find('\n', offset);
+        if (newline == std::string::npos) {
+            return text.size();
+        }
+        offset = newline + 1;
+    }
+    size_t lineEnd = text.find('\n', offset);
+    lineEnd = lineEnd == std::string::npos ? text.size() : lineEnd;
+    if (utf16) {
+        character = utf8Column(text.substr(offset, lineEnd - offset), character);
+    }
+    return std::min(offset + static_cast<size_t>(std::max(0, character)), lineEnd);
+}
+
+/**
+ * LanguageServer - Protocol handling, open documents and background indexing
+ */
+class LanguageServer {
+private:
+    struct Document {
+        std::string uri;
+        std::string text;
+        Program ast;
+    };
+
+    SymbolIndex index;
+    std::map<std::string, Document> documents;  // Open documents by path
+    std::vector<std::string> outbox;            // Serialized outgoing messages
+    std::string rootPath;
+    std::thread indexer;
+    std::atomic<bool> stopping{ false };
+    bool shutdownRequested = false;
+    bool exitRequested = false;
+    bool utf16 = true;  // Position encoding agreed in initialize
+
+    static Json position(int line, int character) {
+        return Json::object().set("line", line).set("character", character);
+    }
+
+    static Json range(int line, int start, int end) {
+        return Json::object().set("start", position(line, start)).set("end", position(line, end));
+    }
+
+    /**
+     * Location array, written as JSON text: a references reply can hold
+     * thousands of locations, and a value tree per location dominated it
+     */
+    Json locations(const std::vector<SymbolLocation>& found) const {
+        std::string out = "[";
+        out.reserve(found.size() * 120);
+        const std::string* uri = nullptr;
+        std::string quotedUri;
+        std::shared_ptr<const FileIndex> file;
+        for (const auto& location : found) {
+            if (!uri || *uri != location.uri) {
+                uri = &location.uri;
+                quotedUri.clear();
+                Json::writeString(location.uri, quotedUri);
+                file = utf16 ? index.file(uriToPath(location.uri)) : nullptr;
+            }
+            int start = location.column, end = location.column + location.length;
+            if (file) {
+                start = file->toUtf16(location.line, start);
+                end = file->toUtf16(location.line, end);
+            }
+            out += out.size() > 1 ? ",{\"uri\":" : "{\"uri\":";
+            out += quotedUri;
+            out += ",\"range\":{\"start\":{\"line\":";
+            Json::writeInt(location.line - 1, out);
+            out += ",\"character\":";
+            Json::writeInt(start, out);
+            out += "},\"end\":{\"line\":";
+            Json::writeInt(location.line - 1, out);
+            out += ",\"character\":";
+            Json::writeInt(end, out);
+            out += "}}}";
+        }
+        out += ']';
+        return Json::raw(std::move(out));
+    }
+
+    void send(const Json& message) {
+        outbox.push_back(message.dump());
+    }
+
+    void reply(const Json& id, Json result) {
+        send(Json::object().set("jsonrpc", "2.0").set("id", id).set("result", std::move(result)));
+    }
+
+    void replyError(const Json& id, int code, const std::string& message) {
+        send(Json::object()
+                 .set("jsonrpc", "2.0")
+                 .set("id", id)
+                 .set("error", Json::object().set("code", code).set("message", message)));
+    }
+
+    void notify(const std::string& method, Json params) {
+        send(Json::object().set("jsonrpc", "2.0").set("method", method).set("params", std::move(params)));
+    }
+
+    /**
+     * Diagnostic on 1-based `line`: from `column` to the end of the word
+     * there, or the whole line when column is -1 (line-only diagnostics)
+     */
+    static Json diagnostic(const std::string& text, const std::vector<size_t>& lineStarts, const DiagnosticView& view,
+                           bool utf16) {
+        int line = view.line, column = view.column;
+        int start = 0, end = 1;
+        if (line >= 1 && static_cast<size_t>(line) <= lineStarts.size()) {
+            size_t begin = lineStarts[line - 1];
+            size_t finish = text.find('\n', begin);
+            finish = finish == std::string::npos ? text.size() : finish;
+            while (finish > begin && (text[finish - 1] == '\r' || text[finish - 1] == ' ')) {
+                finish--;
+            }
+            int length = static_cast<int>(finish - begin);
+            if (column < 0) {
+                start = static_cast<int>(text.find_first_not_of(" \t", begin) - begin);
+                end = std::max(start + 1, length);
+            } else {
+                start = std::min(column, length);
+                end = start;
+                while (end < length && (std::isalnum(static_cast<unsigned char>(text[begin + end])) || text[begin + end] == '_')) {
+                    end++;
+                }
+                end = std::max(std::max(end, start + 1), std::min(start + view.length, length));
+            }
+            if (utf16) {
+                std::string lineText = text.substr(begin, finish - begin);
+                start = utf16Column(lineText, start);
+                end = utf16Column(lineText, end);
+            }
+        }
+        return Json::object()
+            .set("range", range(line - 1, start, end))
+            .set("severity", 1)
+            .set("code", diagnosticRule(view.kind).id)
+            .set("source", "mya")
+            .set("message", DiagnosticEngine::message(view));
+    }
+
+    /**
+     * Re-index an open document and publish its diagnostics
+     */
+    void analyze(const std::string& path) {
+        Document& document = documents[path];
+        IndentationPreprocessor preprocessor(4);
+        std::vector<Token> tokens = preprocessor.process(document.text);
+        index.update(path, document.uri, indexSource(document.text, tokens), true);
+
+        std::vector<size_t> lineStarts(1, 0);
+        for (size_t i = 0; i < document.text.size(); i++) {
+            if (document.text[i] == '\n') {
+                lineStarts.push_back(i + 1);
+            }
+        }
+
+        DiagnosticBuffer buffer(path);
+        for (const auto& error : preprocessor.getDiagnostics()) {
+            buffer.report(DiagnosticKind::Indentation, error.line, error.column, error.message);
+        }
+        ASTBuilder builder;
+        document.ast = builder.build(tokens);
+        for (const auto& error : builder.getDiagnostics()) {
+            buffer.report(DiagnosticKind::Parse, error.line, error.column, error.message);
+        }
+        if (buffer.empty()) {
+            StructLayoutEngine layouts;
+            bool structsOk = layouts.computeAll(collectStructDefs(tokens));
+            for (const auto& error : layouts.getDiagnostics()) {
+                buffer.report(DiagnosticKind::Struct, error.line, -1, error.message);
+            }
+            if (structsOk) {
+                CppCodegen codegen(document.ast, layouts);
+                std::string source;
+                codegen.generate(source);
+                for (const auto& error : codegen.getDiagnostics()) {
+                    buffer.report(error.message, error.line, -1, error.args);
+                }
+            }
+        }
+
+        DiagnosticEngine engine;
+        engine.merge(std::move(buffer));
+        Json diagnostics = Json::array();
+        for (const auto& view : engine.collect()) {
+            diagnostics.push(diagnostic(document.text, lineStarts, view, utf16));
+        }
+        notify("textDocument/publishDiagnostics",
+               Json::object().set("uri", document.uri).set("diagnostics", std::move(diagnostics)));
+    }
+
+    void didOpen(const Json& params) {
+        const Json& item = params["textDocument"];
+        std::string path = uriToPath(item["uri"].asString());
+        Document& document = documents[path];
+        document.uri = item["uri"].asString();
+        document.text = item["text"].asString();
+        analyze(path);
+    }
+
+    void didChange(const Json& params) {
+        std::string path = uriToPath(params["textDocument"]["uri"].asString());
+        auto it = documents.find(path);
+        if (it == documents.end()) {
+            return;
+        }
+        std::string& text = it->second.text;
+        for (const Json& change : params["contentChanges"].asArray()) {
+            if (!change.has("range")) {
+                text = change["text"].asString();
+                continue;
+            }
+            const Json& start = change["range"]["start"];
+            const Json& end = change["range"]["end"];
+            size_t from = offsetAt(text, start["line"].asInt(), start["character"].asInt(), utf16);
+            size_t to = std::max(from, offsetAt(text, end["line"].asInt(), end["character"].asInt(), utf16));
+            text.replace(from, to - from, change["text"].asString());
+        }
+        analyze(path);
+    }
+
+    void didClose(const Json& params) {
+        std::string uri = params["textDocument"]["uri"].asString();
+        std::string path = uriToPath(uri);
+        documents.erase(path);
+        index.unpin(path);
+        std::string text;
+        if (readTextFile(path, text)) {
+            index.update(path, uri, indexSource(text), false);
+        }
+        notify("textDocument/publishDiagnostics", Json::object().set("uri", uri).set("diagnostics", Json::array()));
+    }
+
+    void startIndexing() {
+        if (rootPath.empty() || indexer.joinable()) {
+            return;
+        }
+        indexer = std::thread([this] {
+            Stopwatch watch;
+            std::vector<std::string> paths;
+            listSourceFiles(rootPath, paths);
+            size_t lines = indexFiles(paths, readTextFile);
+            std::cerr << "MYA language server: indexed " << paths.size() << " files (" << lines << " lines) in "
+                      << static_cast<int>(watch.elapsedSeconds() * 1000) << " ms" << std::endl;
+        });
+    }
+
+    void stopIndexing() {
+        stopping = true;
+        if (indexer.joinable()) {
+            indexer.join();
+        }
+    }
+
+    static bool readMessage(std::FILE* in, std::string& body) {
+        size_t length = 0;
+        bool sawLength = false;
+        std::string header;
+        int c;
+        while ((c = std::fgetc(in)) != EOF) {
+            if (c == '\r') {
+                continue;
+            }
+            if (c != '\n') {
+                header += static_cast<char>(c);
+                continue;
+            }
+            if (header.empty()) {
+                if (!sawLength) {
+                    continue;  // Stray blank line between messages
+                }
+                body.assign(length, '\0');
+                return std::fread(&body[0], 1, length, in) == length;
+            }
+            if (header.compare(0, 15, "Content-Length:") == 0) {
+                length = static_cast<size_t>(std::strtoul(header.c_str() + 15, nullptr, 10));
+                sawLength = true;
+            }
+            header.clear();
+        }
+        return false;
+    }
+
+public:
+    LanguageServer() {}
+
+    ~LanguageServer() {
+        stopIndexing();
+    }
+
+    LanguageServer(const LanguageServer&) = delete;
+    LanguageServer& operator=(const LanguageServer&) = delete;
+
+    /**
+     * Index files on the shared work-stealing pool; open documents keep
+     * their editor text. Returns the number of lines indexed.
+     */
+    size_t indexFiles(const std::vector<std::string>& paths,
+                      const std::function<bool(const std::string&, std::string&)>& read) {
+        std::atomic<size_t> lines{ 0 };
+        Runtime::ThreadPool pool;
+        pool.parallelFor(0, static_cast<int64_t>(paths.size()), [&](int64_t lo, int64_t hi) {
+            for (int64_t i = lo; i < hi && !stopping; i++) {
+                std::string text;
+                if (read(paths[i], text)) {
+                    std::shared_ptr<const FileIndex> file = indexSource(text);
+                    lines += static_cast<size_t>(file->lineCount);
+                    index.update(paths[i], pathToUri(paths[i]), std::move(file), false);
+                }
+            }
+        });
+        return lines;
+    }
+
+    /**
+     * Handle one JSON-RPC message; responses and notifications go to the
+     * outbox (see takeOutput)
+     */
+    void handle(const Json& message) {
+        const std::string& method = message["method"].asString();
+        const Json& params = message["params"];
+        const Json& id = message["id"];
+        bool isRequest = message.has("id");
+
+        if (method == "initialize") {
+            if (params["rootUri"].isString()) {
+                rootPath = uriToPath(params["rootUri"].asString());
+            } else if (params["rootPath"].isString()) {
+                rootPath = params["rootPath"].asString();
+            }
+            utf16 = true;
+            for (const Json& encoding : params["capabilities"]["general"]["positionEncodings"].asArray()) {
+                utf16 = utf16 && !(encoding.isString() && encoding.asString() == "utf-8");
+            }
+            Json capabilities = Json::object()
+                .set("positionEncoding", utf16 ? "utf-16" : "utf-8")
+                .set("textDocumentSync", Json::object().set("openClose", true).set("change", 2))
+                .set("definitionProvider", true)
+                .set("referencesProvider", true);
+            reply(id, Json::object()
+                          .set("capabilities", std::move(capabilities))
+                          .set("serverInfo", Json::object().set("name", "mya").set("version", "0.1")));
+        } else if (method == "initialized") {
+            startIndexing();
+        } else if (method == "textDocument/didOpen") {
+            didOpen(params);
+        } else if (method == "textDocument/didChange") {
+            didChange(params);
+        } else if (method == "textDocument/didClose") {
+            didClose(params);
+        } else if (method == "textDocument/definition" || method == "textDocument/references") {
+            std::string path = uriToPath(params["textDocument"]["uri"].asString());
+            int line = params["position"]["line"].asInt() + 1;
+            int column = params["position"]["character"].asInt();
+            std::shared_ptr<const FileIndex> file = utf16 ? index.file(path) : nullptr;
+            if (file) {
+                column = file->fromUtf16(line, column);
+            }
+            if (method == "textDocument/definition") {
+                reply(id, locations(index.definition(path, line, column)));
+            } else {
+                bool declarations = params["context"]["includeDeclaration"].asBool();
+                reply(id, locations(index.references(path, line, column, declarations)));
+            }
+        } else if (method == "shutdown") {
+            shutdownRequested = true;
+            stopIndexing();
+            reply(id, Json());
+        } else if (method == "exit") {
+            exitRequested = true;
+        } else if (isRequest) {
+            replyError(id, -32601, "Unhandled method " + method);
+        }
+    }
+
+    std::vector<std::string> takeOutput() {
+        std::vector<std::string> messages;
+        messages.swap(outbox);
+        return messages;
+    }
+
+    const SymbolIndex& getIndex() const {
+        return index;
+    }
+
+    /**
+     * Serve stdin/stdout until `exit`; returns the process exit code
+     */
+    int run() {
+#ifdef _WIN32
+        _setmode(_fileno(stdin), _O_BINARY);
+        _setmode(_fileno(stdout), _O_BINARY);
+#endif
+        std::string body;
+        while (!exitRequested && readMessage(stdin, body)) {
+            Json message;
+            std::string error;
+            if (Json::parse(body, message, error)) {
+                handle(message);
+            } else {
+                replyError(Json(), -32700, "Parse error: " + error);
+            }
+            for (const auto& out : takeOutput()) {
+                std::fprintf(stdout, "Content-Length: %zu\r\n\r\n", out.size());
+                std::fwrite(out.data(), 1, out.size(), stdout);
+            }
+            std::fflush(stdout);
+        }
+        stopIndexing();
+        return shutdownRequested ? 0 : 1;
+    }
+};
+
+/**
+ * Benchmark: a synthetic workspace of 1000-line files that all use a
+ * function and a struct defined in file 0, indexed in memory; then the
+ * latency of each request type against the full index
+ */
+inline void runLanguageServerBenchmark(size_t lines) {
+    struct Site {
+        size_t file;
+        int line;  // 0-based
+        int column;
+    };
+    const int functionLines = 8;
+    size_t fileCount = std::max<size_t>(1, lines / 1000);
+    std::vector<std::string> paths, texts;
+    std::unordered_map<std::string, size_t> byPath;
+    std::vector<Site> calls, locals;
+    size_t totalLines = 0;
+    for (size_t f = 0; f < fileCount; f++) {
+        std::ostringstream text;
+        int line = 0;
+        text << "$ Generated file " << f << "\n";
+        line++;
+        if (f == 0) {
+            text << "struct Particle:\n    mass: int\n    speed: int\nend\n\n"
+                 << "fn scale(x: int) -> int:\n    return x * 3;\n\n";
+            line += 8;
+        }
+        for (int j = 0; line + functionLines <= 1000; j++) {
+            bool callsScale = j % 25 == 0;
+            text << "fn step_" << f << "_" << j << "(a: int, b: int) -> int:\n"
+                 << "    let s: int = a;\n"
+                 << "    for i in range 0 to b:\n"
+                 << "        s = s + i * b;\n"
+                 << "        filter s > 1000 pass:\n"
+                 << "            s = s - 1000;\n"
+                 << "    let p: Particle = Particle(s, b);\n"
+                 << "    return " << (callsScale ? "scale(s)" : "s * 3") << " + p.mass;\n";
+            locals.push_back(Site{ f, line + 3, 8 });
+            if (callsScale) {
+                calls.push_back(Site{ f, line + 7, 11 });
+            }
+            line += functionLines;
+        }
+        paths.push_back("/bench/file" + std::to_string(f) + ".mya");
+        texts.push_back(text.str());
+        byPath[paths.back()] = f;
+        totalLines += static_cast<size_t>(line);
+    }
+    auto read = [&](const std::string& path, std::string& text) {
+        text = texts[byPath[path]];
+        return true;
+    };
+    auto request = [](const std::string& method, Json params) {
+        return Json::object().set("jsonrpc", "2.0").set("id", 1).set("method", method).set("params", std::move(params));
+    };
+    auto at = [&](const Site& site) {
+        return Json::object()
+            .set("textDocument", Json::object().set("uri", pathToUri(paths[site.file])))
+            .set("position", Json::object().set("line", site.line).set("character", site.column));
+    };
+
+    std::cout << "Language server benchmark: " << fileCount << " files, " << totalLines << " lines" << std::endl;
+    LanguageServer server;
+    double indexing = bestOf(3, [&] { server.indexFiles(paths, read); });
+    Runtime::ThreadPool pool;
+    reportBenchmark("index workspace (" + std::to_string(pool.size()) + " threads)", indexing, totalLines);
+
+    auto perRequest = [](double seconds, size_t count) {
+        std::cout << "    per request: " << std::fixed << std::setprecision(3) << seconds / count * 1000 << " ms"
+                  << std::endl;
+        std::cout.unsetf(std::ios::floatfield);
+    };
+
+    // Open file 0 (parse, semantic diagnostics, re-index), then edit it
+    Json open = Json::object().set("jsonrpc", "2.0").set("method", "textDocument/didOpen").set(
+        "params", Json::object().set("textDocument", Json::object()
+                                                         .set("uri", pathToUri(paths[0]))
+                                                         .set("languageId", "mya")
+                                                         .set("version", 1)
+                                                         .set("text", texts[0])));
+    double opened = bestOf(3, [&] {
+        server.handle(open);
+        server.takeOutput();
+    });
+    reportBenchmark("didOpen + diagnostics", opened, 1);
+
+    const size_t edits = 20;  // Even, so each round leaves the text as it found it
+    double changed = bestOf(3, [&] {
+        for (size_t i = 0; i < edits; i++) {
+            // Type a character into a variable name in the first function, then delete it
+            Json start = Json::object().set("line", 10).set("character", 9);
+            Json end = Json::object().set("line", 10).set("character", i % 2 ? 10 : 9);
+            Json insert = Json::object()
+                .set("range", Json::object().set("start", std::move(start)).set("end", std::move(end)))
+                .set("text", i % 2 ? "" : "x");
+            Json params = Json::object()
+                .set("textDocument", Json::object().set("uri", pathToUri(paths[0])).set("version", static_cast<int>(i + 2)))
+                .set("contentChanges", Json::array().push(std::move(insert)));
+            server.handle(Json::object()
+                              .set("jsonrpc", "2.0")
+                              .set("method", "textDocument/didChange")
+                              .set("params", std::move(params)));
+            server.takeOutput();
+        }
+    });
+    reportBenchmark("didChange + diagnostics", changed, edits);
+    perRequest(changed, edits);
+
+    // Definitions: cross-file calls resolve through the name index
+    double definitions = bestOf(3, [&] {
+        for (size_t i = 0; i < calls.size(); i++) {
+            server.handle(request("textDocument/definition", at(calls[i])));
+            server.takeOutput();
+        }
+    });
+    reportBenchmark("definition (cross-file)", definitions, calls.size());
+    perRequest(definitions, calls.size());
+
+    size_t sample = std::min<size_t>(locals.size(), 100000);
+    double localDefinitions = bestOf(3, [&] {
+        for (size_t i = 0; i < sample; i++) {
+            server.handle(request("textDocument/definition", at(locals[i * (locals.size() / sample)])));
+            server.takeOutput();
+        }
+    });
+    reportBenchmark("definition (local)", localDefinitions, sample);
+    perRequest(localDefinitions, sample);
+
+    // References to `scale` from its definition: every file that calls it
+    Json references = at(Site{ 0, 6, 3 });
+    references.set("context", Json::object().set("includeDeclaration", true));
+    std::string result;
+    double referenced = bestOf(3, [&] {
+        server.handle(request("textDocument/references", references));
+        result = server.takeOutput().back();
+    });
+    Json parsed;
+    std::string error;
+    Json::parse(result, parsed, error);
+    reportBenchmark("references to scale (" + std::to_string(parsed["result"].size()) + " hits)", referenced, 1);
+}
+
+} // namespace MYA
+
+#endif // MYA_LANGUAGE_SERVER_H
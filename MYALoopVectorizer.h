@@ -0,0 +1,514 @@
+/**
+ * MYA Language - Loop Vectorizer
+ *
+ * Finds counted `for i in range a to b:` loops whose bodies are element-wise
+ * list arithmetic or sum reductions and attaches a VectorLoopPlan that the
+ * code generator turns into SIMD kernels:
+ *
+ *     for i in range 0 to n:          y[i] = a * x[i] + y[i];   (store)
+ *                                     s = s + x[i] * y[i];      (reduction)
+ *
+ * Every list index must be exactly the loop variable, other scalars must be
+ * loop invariant, and all elements share one type (float, or int with + and -
+ * only). Each plan gets an AVX2 and an SSE2 kernel selected by a runtime CPU
+ * check, one bounds check hoisted in front of the kernel, and the original
+ * scalar loop as epilogue. Floating-point reductions are reassociated.
+ */
+
+#ifndef MYA_LOOP_VECTORIZER_H
+#define MYA_LOOP_VECTORIZER_H
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "MYAAST.h"
+#include "MYABenchmark.h"
+#include "MYARuntime.h"
+#include "MYARuntimeSimd.h"
+
+namespace MYA {
+
+/**
+ * One vectorized statement: `list[i] = value` or `acc = acc +/- value`
+ */
+struct VectorOp {
+    bool reduction;
+    std::string target;
+    char op;  // '+' or '-' for reductions
+    ExprPtr value;
+};
+
+/**
+ * How a loop is vectorized; shared by clones of the loop statement
+ */
+struct VectorLoopPlan {
+    int id;
+    std::string elementType;  // "int" or "float"
+    std::vector<VectorOp> ops;
+    std::vector<std::string> readLists;
+    std::vector<std::string> writtenLists;
+    std::vector<std::string> invariants;
+    std::vector<std::string> reductions;
+};
+
+/**
+ * LoopVectorizer - Attaches VectorLoopPlans to innermost counted loops
+ */
+class LoopVectorizer {
+private:
+    std::vector<OptRemark>& remarks;
+    ScopeStack scope;
+    int nextId = 0;
+    int vectorized = 0;
+
+    static void addUnique(std::vector<std::string>& names, const std::string& name) {
+        if (std::find(names.begin(), names.end(), name) == names.end()) {
+            names.push_back(name);
+        }
+    }
+
+    static bool isVariable(const Expr& expr, const std::string& loopVar) {
+        return expr.kind == ExprKind::Identifier && expr.text == loopVar;
+    }
+
+    /**
+     * Check that `expr` has a lane-wise form; records lists and invariants read
+     */
+    bool checkExpr(const Expr& expr, const std::string& loopVar, VectorLoopPlan& plan, std::string& reason) const {
+        bool isFloat = plan.elementType == "float";
+        switch (expr.kind) {
+        case ExprKind::Number:
+            if (!isFloat && expr.isFloatLiteral()) {
+                reason = "float literal in int loop";
+                return false;
+            }
+            return true;
+        case ExprKind::Identifier: {
+            if (expr.text == loopVar) {
+                reason = "loop index '" + loopVar + "' used as a value";
+                return false;
+            }
+            const TypeRef* type = scope.lookup(expr.text);
+            if (!type || !(type->name == plan.elementType || (isFloat && type->name == "int"))) {
+                reason = "'" + expr.text + "' is not a " + plan.elementType + " scalar";
+                return false;
+            }
+            addUnique(plan.invariants, expr.text);
+            return true;
+        }
+        case ExprKind::Index: {
+            const Expr& base = *expr.args[0];
+            const TypeRef* type = base.kind == ExprKind::Identifier ? scope.lookup(base.text) : nullptr;
+            if (!type || !type->isList()) {
+                reason = "indexed value is not a list variable";
+                return false;
+            }
+            if (!isVariable(*expr.args[1], loopVar)) {
+                reason = "index of '" + base.text + "' is not the loop variable";
+                return false;
+            }
+            if (type->element().name != plan.elementType) {
+                reason = "'" + base.text + "' holds " + type->element().name + ", loop computes " + plan.elementType;
+                return false;
+            }
+            addUnique(plan.readLists, base.text);
+            return true;
+        }
+        case ExprKind::Binary:
+            if (expr.text != "+" && expr.text != "-" && !(isFloat && (expr.text == "*" || expr.text == "/"))) {
+                reason = "operator '" + expr.text + "' has no " + plan.elementType + " vector form";
+                return false;
+            }
+            return checkExpr(*expr.args[0], loopVar, plan, reason) && checkExpr(*expr.args[1], loopVar, plan, reason);
+        case ExprKind::Unary:
+            if (expr.text != "-") {
+                reason = "operator '" + expr.text + "' has no vector form";
+                return false;
+            }
+            return checkExpr(*expr.args[0], loopVar, plan, reason);
+        default:
+            reason = "'" + expr.str() + "' cannot be vectorized";
+            return false;
+        }
+    }
+
+    static bool mentions(const Expr& expr, const std::string& name) {
+        if (expr.kind == ExprKind::Identifier && expr.text == name) {
+            return true;
+        }
+        for (const auto& arg : expr.args) {
+            if (mentions(*arg, name)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * Normalize one body statement into a VectorOp
+     */
+    bool matchOp(const Stmt& stmt, const std::string& loopVar, VectorLoopPlan& plan, std::string& reason) const {
+        const Expr* target = nullptr;
+        Expr named(ExprKind::Identifier, stmt.name, stmt.line);
+        if (stmt.kind == StmtKind::Assign) {
+            target = stmt.target.get();
+        } else if (stmt.kind == StmtKind::Let && scope.lookup(stmt.name)) {
+            target = &named;  // Re-let assigns the existing variable
+        } else {
+            reason = "loop body contains a statement other than list stores and reductions";
+            return false;
+        }
+
+        VectorOp op{ false, "", '+', nullptr };
+        const Expr& value = *stmt.value;
+        if (target->kind == ExprKind::Index) {
+            const Expr& base = *target->args[0];
+            const TypeRef* type = base.kind == ExprKind::Identifier ? scope.lookup(base.text) : nullptr;
+            if (!type || !type->isList() || !isVariable(*target->args[1], loopVar)) {
+                reason = "store is not to list[" + loopVar + "]";
+                return false;
+            }
+            if (plan.elementType.empty()) {
+                plan.elementType = type->element().name;
+            }
+            if (type->element().name != plan.elementType) {
+                reason = "mixed element types in loop";
+                return false;
+            }
+            op.target = base.text;
+            op.value = value.clone();
+            addUnique(plan.writtenLists, base.text);
+        } else if (target->kind == ExprKind::Identifier) {
+            const TypeRef* type = scope.lookup(target->text);
+            bool accumulates = value.kind == ExprKind::Binary && (value.text == "+" || value.text == "-") &&
+                               isVariable(*value.args[0], target->text);
+            if (!type || target->text == loopVar || !accumulates) {
+                reason = "scalar '" + target->text + "' is assigned in the loop but is not a sum reduction";
+                return false;
+            }
+            if (plan.elementType.empty()) {
+                plan.elementType = type->name;
+            }
+            if (type->name != plan.elementType) {
+                reason = "reduction '" + target->text + "' is " + type->name + ", loop computes " + plan.elementType;
+                return false;
+            }
+            if (std::find(plan.reductions.begin(), plan.reductions.end(), target->text) != plan.reductions.end()) {
+                reason = "'" + target->text + "' is updated more than once per iteration";
+                return false;
+            }
+            op.reduction = true;
+            op.target = target->text;
+            op.op = value.text[0];
+            op.value = value.args[1]->clone();
+            plan.reductions.push_back(target->text);
+        } else {
+            reason = "store is not to list[" + loopVar + "]";
+            return false;
+        }
+        if (plan.elementType != "int" && plan.elementType != "float") {
+            reason = plan.elementType + " elements have no vector form";
+            return false;
+        }
+        plan.ops.push_back(std::move(op));
+        return true;
+    }
+
+    /**
+     * Build a plan for an innermost loop, or explain why there is none
+     */
+    std::shared_ptr<VectorLoopPlan> analyze(const Stmt& loop, std::string& reason) const {
+        std::shared_ptr<VectorLoopPlan> plan(new VectorLoopPlan());
+        if (loop.body.empty()) {
+            reason = "empty loop body";
+            return nullptr;
+        }
+        for (const auto& stmt : loop.body) {
+            if (!matchOp(*stmt, loop.name, *plan, reason)) {
+                return nullptr;
+            }
+        }
+        for (const auto& op : plan->ops) {
+            if (!checkExpr(*op.value, loop.name, *plan, reason)) {
+                return nullptr;
+            }
+            for (const auto& acc : plan->reductions) {
+                if (mentions(*op.value, acc)) {
+                    reason = "reduction '" + acc + "' is read inside the loop";
+                    return nullptr;
+                }
+            }
+        }
+        for (const auto& name : plan->invariants) {
+            if (std::find(plan->reductions.begin(), plan->reductions.end(), name) != plan->reductions.end()) {
+                reason = "'" + name + "' is both read and reduced";
+                return nullptr;
+            }
+        }
+        return plan;
+    }
+
+    static bool containsLoop(const StmtList& block) {
+        for (const auto& stmt : block) {
+            if (stmt->kind == StmtKind::For || containsLoop(stmt->body) || containsLoop(stmt->elseBody)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void visitBlock(StmtList& block) {
+        scope.push();
+        for (auto& stmt : block) {
+            visitStmt(*stmt);
+        }
+        scope.pop();
+    }
+
+    void visitStmt(Stmt& stmt) {
+        switch (stmt.kind) {
+        case StmtKind::Let:
+            if (!scope.lookup(stmt.name)) {
+                scope.declare(stmt.name, stmt.type);
+            }
+            break;
+        case StmtKind::For:
+            scope.push();
+            scope.declare(stmt.name, TypeRef("int"));
+            if (!containsLoop(stmt.body)) {
+                std::string reason;
+                auto plan = analyze(stmt, reason);
+                if (plan) {
+                    plan->id = ++nextId;
+                    stmt.vectorPlan = plan;
+                    vectorized++;
+                    std::string message = "vectorized loop (" + plan->elementType + " x2 SSE2, x4 AVX2)";
+                    if (plan->elementType == "float" && !plan->reductions.empty()) {
+                        message += "; reassociates floating-point reduction";
+                    }
+                    remarks.push_back(OptRemark{ stmt.line, "vectorize", message, true });
+                } else {
+                    remarks.push_back(OptRemark{ stmt.line, "vectorize", "loop not vectorized: " + reason, false });
+                }
+            }
+            visitBlock(stmt.body);
+            scope.pop();
+            break;
+        case StmtKind::If:
+            visitBlock(stmt.body);
+            visitBlock(stmt.elseBody);
+            break;
+        case StmtKind::Filter:
+            if (stmt.filterFact != FilterFact::AlwaysFalse) {
+                visitBlock(stmt.body);
+            }
+            break;
+        default:
+            break;
+        }
+    }
+
+public:
+    explicit LoopVectorizer(std::vector<OptRemark>& remarks) : remarks(remarks) {}
+
+    /**
+     * Vectorize all eligible loops; returns the number of loops vectorized
+     */
+    int run(Program& program) {
+        vectorized = 0;
+        for (auto& fn : program.functions) {
+            if (fn.evaluated) {
+                continue;
+            }
+            scope.push();
+            for (const auto& param : fn.params) {
+                scope.declare(param.name, param.type);
+            }
+            visitBlock(fn.body);
+            scope.pop();
+        }
+        visitBlock(program.topLevel);
+        return vectorized;
+    }
+};
+
+// ----- Benchmark: scalar loops vs SSE2/AVX2 kernels -----
+
+#ifdef MYA_RUNTIME_SIMD
+
+namespace VectorBench {
+
+using Runtime::F64x2;
+using Runtime::F64x4;
+
+inline int64_t sumSse2(const double* x, double* s, int64_t i, int64_t end) {
+    F64x2 acc = F64x2::zero();
+    for (; i + F64x2::width <= end; i += F64x2::width) {
+        acc = acc + F64x2::load(x + i);
+    }
+    *s += acc.sum();
+    return i;
+}
+
+MYA_TARGET_AVX2 inline int64_t sumAvx2(const double* x, double* s, int64_t i, int64_t end) {
+    F64x4 acc = F64x4::zero();
+    for (; i + F64x4::width <= end; i += F64x4::width) {
+        acc = acc + F64x4::load(x + i);
+    }
+    *s += acc.sum();
+    return i;
+}
+
+inline int64_t dotSse2(const double* x, const double* y, double* s, int64_t i, int64_t end) {
+    F64x2 acc = F64x2::zero();
+    for (; i + F64x2::width <= end; i += F64x2::width) {
+        acc = acc + F64x2::load(x + i) * F64x2::load(y + i);
+    }
+    *s += acc.sum();
+    return i;
+}
+
+MYA_TARGET_AVX2 inline int64_t dotAvx2(const double* x, const double* y, double* s, int64_t i, int64_t end) {
+    F64x4 acc = F64x4::zero();
+    for (; i + F64x4::width <= end; i += F64x4::width) {
+        acc = acc + F64x4::load(x + i) * F64x4::load(y + i);
+    }
+    *s += acc.sum();
+    return i;
+}
+
+inline int64_t saxpySse2(double a, const double* x, double* y, int64_t i, int64_t end) {
+    const F64x2 va = F64x2::splat(a);
+    for (; i + F64x2::width <= end; i += F64x2::width) {
+        (va * F64x2::load(x + i) + F64x2::load(y + i)).store(y + i);
+    }
+    return i;
+}
+
+MYA_TARGET_AVX2 inline int64_t saxpyAvx2(double a, const double* x, double* y, int64_t i, int64_t end) {
+    const F64x4 va = F64x4::splat(a);
+    for (; i + F64x4::width <= end; i += F64x4::width) {
+        (va * F64x4::load(x + i) + F64x4::load(y + i)).store(y + i);
+    }
+    return i;
+}
+
+// Scalar loops as emitted with --no-vectorize (checked indexing)
+
+inline double sumScalar(Runtime::List<double>& x, Runtime::List<double>&) {
+    double s = 0;
+    for (int64_t i = 0; i < Runtime::len(x); i++) {
+        s = s + Runtime::at(x, i, 0);
+    }
+    return s;
+}
+
+inline double dotScalar(Runtime::List<double>& x, Runtime::List<double>& y) {
+    double s = 0;
+    for (int64_t i = 0; i < Runtime::len(x); i++) {
+        s = s + Runtime::at(x, i, 0) * Runtime::at(y, i, 0);
+    }
+    return s;
+}
+
+inline double saxpyScalar(Runtime::List<double>& x, Runtime::List<double>& y) {
+    for (int64_t i = 0; i < Runtime::len(y); i++) {
+        Runtime::at(y, i, 0) = 0.5 * Runtime::at(x, i, 0) + Runtime::at(y, i, 0);
+    }
+    return y[0];
+}
+
+// Vectorized loops: kernel, then scalar epilogue
+
+template <bool Avx2>
+inline double sumVector(Runtime::List<double>& x, Runtime::List<double>&) {
+    double s = 0;
+    int64_t n = Runtime::len(x);
+    int64_t i = Avx2 ? sumAvx2(x.data(), &s, 0, n) : sumSse2(x.data(), &s, 0, n);
+    for (; i < n; i++) {
+        s = s + x[i];
+    }
+    return s;
+}
+
+template <bool Avx2>
+inline double dotVector(Runtime::List<double>& x, Runtime::List<double>& y) {
+    double s = 0;
+    int64_t n = Runtime::len(x);
+    int64_t i = Avx2 ? dotAvx2(x.data(), y.data(), &s, 0, n) : dotSse2(x.data(), y.data(), &s, 0, n);
+    for (; i < n; i++) {
+        s = s + x[i] * y[i];
+    }
+    return s;
+}
+
+template <bool Avx2>
+inline double saxpyVector(Runtime::List<double>& x, Runtime::List<double>& y) {
+    int64_t n = Runtime::len(y);
+    int64_t i = Avx2 ? saxpyAvx2(0.5, x.data(), y.data(), 0, n) : saxpySse2(0.5, x.data(), y.data(), 0, n);
+    for (; i < n; i++) {
+        y[i] = 0.5 * x[i] + y[i];
+    }
+    return y[0];
+}
+
+} // namespace VectorBench
+
+/**
+ * Compare the scalar loops emitted with --no-vectorize (checked indexing)
+ * against the SSE2 and AVX2 kernels for sum, dot and saxpy over `count` floats
+ */
+inline void runVectorizeBenchmark(size_t count) {
+    typedef double (*Loop)(Runtime::List<double>&, Runtime::List<double>&);
+    struct Case {
+        const char* name;
+        Loop scalar, sse2, avx2;
+    };
+    const Case cases[] = {
+        { "sum", VectorBench::sumScalar, VectorBench::sumVector<false>, VectorBench::sumVector<true> },
+        { "dot", VectorBench::dotScalar, VectorBench::dotVector<false>, VectorBench::dotVector<true> },
+        { "saxpy", VectorBench::saxpyScalar, VectorBench::saxpyVector<false>, VectorBench::saxpyVector<true> }
+    };
+
+    const int repeats = std::max(3, static_cast<int>(20000000 / std::max<size_t>(count, 1)));
+    Runtime::List<double> x(count), y(count);
+    for (size_t i = 0; i < count; i++) {
+        x[i] = 0.5 + static_cast<double>(i % 100) * 0.01;
+        y[i] = 1.0 - static_cast<double>(i % 7) * 0.1;
+    }
+    bool avx2 = Runtime::cpuHasAVX2();
+    std::cout << "Vector benchmark: " << count << " floats x " << repeats << " passes ("
+              << (avx2 ? "AVX2 available" : "AVX2 not available") << ")" << std::endl;
+
+    volatile double sink = 0;
+    size_t items = count * static_cast<size_t>(repeats);
+    auto time = [&](Loop loop) {
+        return bestOf(3, [&] {
+            for (int r = 0; r < repeats; r++) {
+                sink = sink + loop(x, y);
+            }
+        });
+    };
+    for (const auto& c : cases) {
+        std::string name = c.name;
+        reportBenchmark(name + " scalar", time(c.scalar), items);
+        reportBenchmark(name + " SSE2", time(c.sse2), items);
+        if (avx2) {
+            reportBenchmark(name + " AVX2", time(c.avx2), items);
+        }
+    }
+}
+
+#else
+
+inline void runVectorizeBenchmark(size_t) {
+    std::cout << "Vector benchmark: SIMD kernels are only available on x86-64" << std::endl;
+}
+
+#endif // MYA_RUNTIME_SIMD
+
+} // namespace MYA
+
+#endif // MYA_LOOP_VECTORIZER_H
@@ -0,0 +1,217 @@
+/**
+ * MYA Language - Native Object Output
+ *
+ * In-memory object file for the native (x86-64) backend. Code producers such
+ * as the integrated assembler append machine code to the `.text` section,
+ * define symbols at offsets and record relocations against symbols that are
+ * resolved by the linker. The object can be written as an AMD64 COFF `.obj`
+ * file, the input format of the planned PE link step.
+ */
+
+#ifndef MYA_NATIVE_OBJECT_H
+#define MYA_NATIVE_OBJECT_H
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace MYA {
+
+/**
+ * A symbol in the object; undefined symbols are resolved at link time
+ */
+struct NativeSymbol {
+    std::string name;
+    uint32_t offset;
+    bool defined;
+    bool global;
+};
+
+/**
+ * PC-relative 32-bit relocation against a symbol.
+ * `trailingBytes` counts the instruction bytes that follow the 4-byte field
+ * (e.g. an immediate after a RIP-relative displacement).
+ */
+struct NativeRelocation {
+    uint32_t offset;
+    std::string symbol;
+    int trailingBytes;
+};
+
+/**
+ * NativeObject - `.text` bytes, symbols and relocations
+ */
+class NativeObject {
+private:
+    std::vector<uint8_t> text;
+    std::vector<NativeSymbol> symbols;
+    std::map<std::string, size_t> symbolIndex;
+    std::vector<NativeRelocation> relocations;
+
+    static void put16(std::vector<uint8_t>& out, uint16_t v) {
+        out.push_back(static_cast<uint8_t>(v));
+        out.push_back(static_cast<uint8_t>(v >> 8));
+    }
+
+    static void put32(std::vector<uint8_t>& out, uint32_t v) {
+        for (int i = 0; i < 4; i++) {
+            out.push_back(static_cast<uint8_t>(v >> (i * 8)));
+        }
+    }
+
+public:
+    std::vector<uint8_t>& getText() {
+        return text;
+    }
+
+    const std::vector<uint8_t>& getText() const {
+        return text;
+    }
+
+    const std::vector<NativeSymbol>& getSymbols() const {
+        return symbols;
+    }
+
+    const std::vector<NativeRelocation>& getRelocations() const {
+        return relocations;
+    }
+
+    /**
+     * Look up a symbol, creating an undefined external reference if needed
+     */
+    NativeSymbol& symbol(const std::string& name) {
+        auto it = symbolIndex.find(name);
+        if (it != symbolIndex.end()) {
+            return symbols[it->second];
+        }
+        symbolIndex[name] = symbols.size();
+        symbols.push_back(NativeSymbol{ name, 0, false, true });
+        return symbols.back();
+    }
+
+    bool isDefined(const std::string& name) const {
+        auto it = symbolIndex.find(name);
+        return it != symbolIndex.end() && symbols[it->second].defined;
+    }
+
+    /**
+     * Define a symbol at an offset in `.text`
+     */
+    void defineSymbol(const std::string& name, uint32_t offset, bool global = true) {
+        NativeSymbol& sym = symbol(name);
+        sym.offset = offset;
+        sym.defined = true;
+        sym.global = global;
+    }
+
+    void addRelocation(uint32_t offset, const std::string& name, int trailingBytes = 0) {
+        symbol(name);
+        relocations.push_back(NativeRelocation{ offset, name, trailingBytes });
+    }
+
+    /**
+     * Serialize as an AMD64 COFF object with a single `.text` section
+     */
+    std::vector<uint8_t> toCOFF() const {
+        const uint32_t headerSize = 20;
+        const uint32_t sectionHeaderSize = 40;
+        const uint32_t rawOffset = headerSize + sectionHeaderSize;
+        const uint32_t relocOffset = rawOffset + static_cast<uint32_t>(text.size());
+        const uint32_t symtabOffset = relocOffset + static_cast<uint32_t>(relocations.size()) * 10;
+
+        std::vector<uint8_t> out;
+        // File header
+        put16(out, 0x8664);  // IMAGE_FILE_MACHINE_AMD64
+        put16(out, 1);       // NumberOfSections
+        put32(out, 0);       // TimeDateStamp (reproducible output)
+        put32(out, symtabOffset);
+        put32(out, static_cast<uint32_t>(symbols.size()));
+        put16(out, 0);       // SizeOfOptionalHeader
+        put16(out, 0);       // Characteristics
+
+        // Section header
+        const char name[8] = { '.', 't', 'e', 'x', 't', 0, 0, 0 };
+        out.insert(out.end(), name, name + 8);
+        put32(out, 0);  // VirtualSize
+        put32(out, 0);  // VirtualAddress
+        put32(out, static_cast<uint32_t>(text.size()));
+        put32(out, text.empty() ? 0 : rawOffset);
+        put32(out, relocations.empty() ? 0 : relocOffset);
+        put32(out, 0);  // PointerToLinenumbers
+        put16(out, static_cast<uint16_t>(relocations.size()));
+        put16(out, 0);  // NumberOfLinenumbers
+        put32(out, 0x60500020);  // CNT_CODE | ALIGN_16BYTES | MEM_EXECUTE | MEM_READ
+
+        out.insert(out.end(), text.begin(), text.end());
+
+        // Relocations: IMAGE_REL_AMD64_REL32 .. REL32_5 encode trailing bytes
+        for (const auto& reloc : relocations) {
+            put32(out, reloc.offset);
+            put32(out, static_cast<uint32_t>(symbolIndex.at(reloc.symbol)));
+            put16(out, static_cast<uint16_t>(0x0004 + reloc.trailingBytes));
+        }
+
+        // Symbol table and string table
+        std::vector<uint8_t> strings;
+        for (const auto& sym : symbols) {
+            if (sym.name.size() <= 8) {
+                char shortName[8] = { 0 };
+                std::memcpy(shortName, sym.name.data(), sym.name.size());
+                out.insert(out.end(), shortName, shortName + 8);
+            } else {
+                put32(out, 0);
+                put32(out, static_cast<uint32_t>(strings.size()) + 4);
+                strings.insert(strings.end(), sym.name.begin(), sym.name.end());
+                strings.push_back(0);
+            }
+            put32(out, sym.defined ? sym.offset : 0);
+            put16(out, static_cast<uint16_t>(sym.defined ? 1 : 0));  // SectionNumber
+            put16(out, 0x20);  // DTYPE_FUNCTION
+            out.push_back(static_cast<uint8_t>(sym.global || !sym.defined ? 2 : 3));  // EXTERNAL / STATIC
+            out.push_back(0);  // NumberOfAuxSymbols
+        }
+        put32(out, static_cast<uint32_t>(strings.size()) + 4);
+        out.insert(out.end(), strings.begin(), strings.end());
+        return out;
+    }
+
+    bool writeCOFF(const std::string& path) const {
+        std::ofstream file(path, std::ios::binary);
+        if (!file.is_open()) {
+            return false;
+        }
+        std::vector<uint8_t> bytes = toCOFF();
+        file.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+        return file.good();
+    }
+
+    /**
+     * Print symbols and relocations for debugging
+     */
+    void printSummary() const {
+        std::cout << "\n=== Native Object (.text: " << text.size() << " bytes) ===" << std::endl;
+        for (const auto& sym : symbols) {
+            std::cout << "Symbol: " << sym.name;
+            if (sym.defined) {
+                std::cout << " @ 0x" << std::hex << std::setw(4) << std::setfill('0') << sym.offset
+                          << std::dec << std::setfill(' ') << (sym.global ? " (global)" : " (local)");
+            } else {
+                std::cout << " (external)";
+            }
+            std::cout << std::endl;
+        }
+        for (const auto& reloc : relocations) {
+            std::cout << "Relocation: 0x" << std::hex << std::setw(4) << std::setfill('0') << reloc.offset
+                      << std::dec << std::setfill(' ') << " -> " << reloc.symbol << " (REL32)" << std::endl;
+        }
+    }
+};
+
+} // namespace MYA
+
+#endif // MYA_NATIVE_OBJECT_H
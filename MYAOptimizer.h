@@ -0,0 +1,132 @@
+/**
+ * MYA Language - Optimizer
+ *
+ * Runs AST-level optimization passes between semantic checks and code
+ * generation. Each pass rewrites or annotates the Program in place and
+ * records OptRemarks (applied or missed) that --opt-report prints.
+ *
+ * Passes, in order:
+ * - consteval: runs calls to pure functions with constant arguments and
+ *   folds constant `let` bindings (MYAConstantEvaluator.h)
+ * - filter: removes filters whose condition is provably false
+ *   (MYAFilterOptimizer.h)
+ * - tailcall: self tail calls become jumps, with accumulator introduction
+ *   for `return e op f(args)` (MYATailCallOptimizer.h)
+ * - vectorize: SIMD kernels for counted list loops (MYALoopVectorizer.h)
+ * - pgo: numbers the sites an --instrument build counts and applies a
+ *   --profile-use profile to them (MYAProfileGuidedOptimizer.h)
+ */
+
+#ifndef MYA_OPTIMIZER_H
+#define MYA_OPTIMIZER_H
+
+#include <algorithm>
+#include <iostream>
+#include <vector>
+#include "MYAAST.h"
+#include "MYAConstantEvaluator.h"
+#include "MYAFilterOptimizer.h"
+#include "MYALoopVectorizer.h"
+#include "MYAProfileGuidedOptimizer.h"
+#include "MYATailCallOptimizer.h"
+
+namespace MYA {
+
+/**
+ * Pass selection (driver flags)
+ */
+struct OptimizerOptions {
+    bool evaluate = true;
+    int64_t evaluationFuel = 100000;       // Interpreter steps per evaluated call (--eval-fuel)
+    bool tailCalls = true;
+    bool vectorize = true;
+    bool instrument = false;               // Number profile sites for --instrument
+    const ProfileData* profile = nullptr;  // --profile-use
+};
+
+/**
+ * Optimizer - Pass pipeline over the AST
+ */
+class Optimizer {
+private:
+    OptimizerOptions options;
+    std::vector<OptRemark> remarks;
+    int filtersRemoved = 0;
+    int tailCallFunctions = 0;
+    int loopsVectorized = 0;
+    ProfileGuidedStats profileStats;
+    ConstantEvalStats evalStats;
+
+public:
+    explicit Optimizer(const OptimizerOptions& options = OptimizerOptions()) : options(options) {}
+
+    void run(Program& program) {
+        remarks.clear();
+        evalStats = ConstantEvalStats();
+        if (options.evaluate) {
+            ConstantEvaluator evaluator(remarks, options.evaluationFuel);
+            evalStats = evaluator.run(program);
+        }
+        FilterOptimizer filters(remarks);
+        filtersRemoved = filters.run(program);
+        tailCallFunctions = 0;
+        if (options.tailCalls) {
+            TailCallOptimizer tailCalls(remarks);
+            tailCallFunctions = tailCalls.run(program);
+        }
+        if (options.vectorize) {
+            LoopVectorizer vectorizer(remarks);
+            loopsVectorized = vectorizer.run(program);
+        }
+        profileStats = ProfileGuidedStats();
+        if (options.profile) {
+            ProfileGuidedOptimizer profileGuided(remarks, options.profile);
+            profileStats = profileGuided.run(program);
+        } else if (options.instrument) {
+            ProfileGuidedOptimizer::numberSites(program);
+        }
+        std::stable_sort(remarks.begin(), remarks.end(),
+            [](const OptRemark& a, const OptRemark& b) { return a.line < b.line; });
+    }
+
+    int getFiltersRemoved() const {
+        return filtersRemoved;
+    }
+
+    int getTailCallFunctions() const {
+        return tailCallFunctions;
+    }
+
+    int getLoopsVectorized() const {
+        return loopsVectorized;
+    }
+
+    const ProfileGuidedStats& getProfileStats() const {
+        return profileStats;
+    }
+
+    const ConstantEvalStats& getEvalStats() const {
+        return evalStats;
+    }
+
+    const std::vector<OptRemark>& getRemarks() const {
+        return remarks;
+    }
+
+    /**
+     * Print remarks by source line (--opt-report)
+     */
+    void printReport() const {
+        std::cout << "\n=== Optimization Report ===" << std::endl;
+        if (remarks.empty()) {
+            std::cout << "No optimization opportunities found." << std::endl;
+        }
+        for (const auto& remark : remarks) {
+            std::cout << "Line " << remark.line << ": [" << remark.pass << "] " << remark.message << std::endl;
+        }
+    }
+};
+
+} // namespace MYA
+
+#endif // MYA_OPTIMIZER_H
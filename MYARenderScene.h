@@ -0,0 +1,713 @@
+/**
+ * MYA Language - Render Scene Lowering
+ *
+ * Lowers `render: ... end` blocks (the Virtual Rendering Layer) into a flat,
+ * structure-of-arrays scene description:
+ * - One contiguous float array per component (position, scale, rotation)
+ * - Objects sorted by (object type, material) so consumers draw in batches
+ * - World transforms composed four objects at a time with SSE when available
+ *
+ * The scene is consumed by SoftwareRasterizer, a CPU splat renderer that can
+ * dump frames headlessly, so large scenes can be benchmarked without a GPU.
+ *
+ * Render blocks follow MYA's figurative indentation: properties belong to the
+ * most recent `object:` / `camera:` header rather than to a strict indent level.
+ */
+
+#ifndef MYA_RENDER_SCENE_H
+#define MYA_RENDER_SCENE_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <numeric>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "MYAIndentationPreprocessor.h"
+#include "MYABenchmark.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MYA_RENDER_SSE 1
+#include <emmintrin.h>
+#endif
+
+namespace MYA {
+
+/**
+ * A run of consecutive objects sharing object type and material
+ */
+struct RenderBatch {
+    uint32_t typeId;
+    uint32_t materialId;
+    size_t first;
+    size_t count;
+};
+
+/**
+ * Camera settings from a `camera:` section
+ */
+struct RenderCamera {
+    float position[3] = { 0.0f, 0.0f, 10.0f };
+    float target[3] = { 0.0f, 0.0f, 0.0f };
+    float fov = 60.0f;  // Vertical field of view in degrees
+};
+
+/**
+ * Description of a single object before it is appended to the SoA arrays
+ */
+struct RenderObjectDesc {
+    std::string type = "object";
+    std::string material;  // Empty: derived from color
+    float position[3] = { 0.0f, 0.0f, 0.0f };
+    float rotation[3] = { 0.0f, 0.0f, 0.0f };  // Degrees
+    float scale[3] = { 1.0f, 1.0f, 1.0f };
+    uint32_t color = 0xC8C8C8FF;  // RGBA
+};
+
+/**
+ * Flat structure-of-arrays scene
+ *
+ * Component arrays are indexed by object; after sortForBatching() objects of
+ * the same (type, material) pair are contiguous and listed in `batches`.
+ * composeTransforms() fills `world`, twelve arrays holding the row-major
+ * 3x4 world matrix of every object (world[row * 4 + column][object]).
+ */
+class RenderScene {
+private:
+    std::unordered_map<std::string, uint32_t> typeIndex;  // Name -> id, so addObject stays O(1)
+    std::unordered_map<std::string, uint32_t> materialIndex;
+
+    static uint32_t intern(std::vector<std::string>& names, std::unordered_map<std::string, uint32_t>& index,
+                           const std::string& name) {
+        auto inserted = index.emplace(name, static_cast<uint32_t>(names.size()));
+        if (inserted.second) {
+            names.push_back(name);
+        }
+        return inserted.first->second;
+    }
+
+    template <typename T>
+    static void permute(std::vector<T>& values, const std::vector<uint32_t>& order) {
+        std::vector<T> sorted(values.size());
+        for (size_t i = 0; i < order.size(); i++) {
+            sorted[i] = values[order[i]];
+        }
+        values.swap(sorted);
+    }
+
+    /**
+     * Compose world matrices for objects [begin, end) with scalar math
+     */
+    void composeRange(size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            float sa = std::sin(rotX[i]), ca = std::cos(rotX[i]);
+            float sb = std::sin(rotY[i]), cb = std::cos(rotY[i]);
+            float sc = std::sin(rotZ[i]), cc = std::cos(rotZ[i]);
+
+            // R = Rz * Ry * Rx, then scale columns: M = R * S
+            world[0][i] = cb * cc * scaleX[i];
+            world[1][i] = (sa * sb * cc - ca * sc) * scaleY[i];
+            world[2][i] = (ca * sb * cc + sa * sc) * scaleZ[i];
+            world[3][i] = posX[i];
+            world[4][i] = cb * sc * scaleX[i];
+            world[5][i] = (sa * sb * sc + ca * cc) * scaleY[i];
+            world[6][i] = (ca * sb * sc - sa * cc) * scaleZ[i];
+            world[7][i] = posY[i];
+            world[8][i] = -sb * scaleX[i];
+            world[9][i] = sa * cb * scaleY[i];
+            world[10][i] = ca * cb * scaleZ[i];
+            world[11][i] = posZ[i];
+        }
+    }
+
+#ifdef MYA_RENDER_SSE
+    /**
+     * Four-lane sine and cosine (Cody-Waite reduction to [-pi/4, pi/4] and
+     * minimax polynomials); accurate to ~1e-7 for rotation-sized angles.
+     */
+    static void sinCos4(__m128 x, __m128& sinOut, __m128& cosOut) {
+        const __m128i one = _mm_set1_epi32(1);
+        const __m128i two = _mm_set1_epi32(2);
+
+        __m128i quadrant = _mm_cvtps_epi32(_mm_mul_ps(x, _mm_set1_ps(0.636619772f)));
+        __m128 q = _mm_cvtepi32_ps(quadrant);
+        __m128 r = _mm_sub_ps(x, _mm_mul_ps(q, _mm_set1_ps(1.5707963705062866f)));
+        r = _mm_sub_ps(r, _mm_mul_ps(q, _mm_set1_ps(-4.371139000186241e-8f)));
+        __m128 r2 = _mm_mul_ps(r, r);
+
+        __m128 s = _mm_add_ps(_mm_mul_ps(r2, _mm_set1_ps(-1.9515295891e-4f)), _mm_set1_ps(8.3321608736e-3f));
+        s = _mm_add_ps(_mm_mul_ps(s, r2), _mm_set1_ps(-1.6666654611e-1f));
+        s = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(s, r2), r), r);
+
+        __m128 c = _mm_add_ps(_mm_mul_ps(r2, _mm_set1_ps(2.443315711809948e-5f)), _mm_set1_ps(-1.388731625493765e-3f));
+        c = _mm_add_ps(_mm_mul_ps(c, r2), _mm_set1_ps(4.166664568298827e-2f));
+        c = _mm_mul_ps(_mm_mul_ps(c, r2), r2);
+        c = _mm_add_ps(_mm_sub_ps(c, _mm_mul_ps(r2, _mm_set1_ps(0.5f))), _mm_set1_ps(1.0f));
+
+        // Odd quadrants swap sin and cos; quadrants 2-3 (sin) and 1-2 (cos) negate
+        __m128 swap = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(quadrant, one), one));
+        __m128 sinSign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(quadrant, two), 30));
+        __m128 cosSign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(_mm_add_epi32(quadrant, one), two), 30));
+        sinOut = _mm_xor_ps(_mm_or_ps(_mm_and_ps(swap, c), _mm_andnot_ps(swap, s)), sinSign);
+        cosOut = _mm_xor_ps(_mm_or_ps(_mm_and_ps(swap, s), _mm_andnot_ps(swap, c)), cosSign);
+    }
+#endif
+
+public:
+    int viewportWidth = 800;
+    int viewportHeight = 600;
+    RenderCamera camera;
+
+    std::vector<std::string> typeNames;
+    std::vector<std::string> materialNames;
+
+    std::vector<float> posX, posY, posZ;
+    std::vector<float> scaleX, scaleY, scaleZ;
+    std::vector<float> rotX, rotY, rotZ;  // Radians
+    std::vector<uint32_t> typeIds;
+    std::vector<uint32_t> materialIds;
+    std::vector<uint32_t> colors;
+
+    std::vector<RenderBatch> batches;
+    std::vector<float> world[12];
+
+    size_t size() const {
+        return posX.size();
+    }
+
+    void reserve(size_t count) {
+        for (auto* v : { &posX, &posY, &posZ, &scaleX, &scaleY, &scaleZ, &rotX, &rotY, &rotZ }) {
+            v->reserve(count);
+        }
+        typeIds.reserve(count);
+        materialIds.reserve(count);
+        colors.reserve(count);
+    }
+
+    void addObject(const RenderObjectDesc& desc) {
+        const float toRadians = 3.14159265358979f / 180.0f;
+        posX.push_back(desc.position[0]);
+        posY.push_back(desc.position[1]);
+        posZ.push_back(desc.position[2]);
+        scaleX.push_back(desc.scale[0]);
+        scaleY.push_back(desc.scale[1]);
+        scaleZ.push_back(desc.scale[2]);
+        rotX.push_back(desc.rotation[0] * toRadians);
+        rotY.push_back(desc.rotation[1] * toRadians);
+        rotZ.push_back(desc.rotation[2] * toRadians);
+        colors.push_back(desc.color);
+        typeIds.push_back(intern(typeNames, typeIndex, desc.type));
+
+        std::string material = desc.material;
+        if (material.empty()) {
+            static const char* hex = "0123456789abcdef";
+            material = "color#";
+            for (int shift = 28; shift >= 0; shift -= 4) {
+                material += hex[(desc.color >> shift) & 0xF];
+            }
+        }
+        materialIds.push_back(intern(materialNames, materialIndex, material));
+        batches.clear();
+    }
+
+    /**
+     * Stable-sort objects by (type, material) and rebuild the batch list.
+     * Source order is preserved inside a batch.
+     */
+    void sortForBatching() {
+        size_t count = size();
+        std::vector<uint64_t> keys(count);
+        for (size_t i = 0; i < count; i++) {
+            keys[i] = (static_cast<uint64_t>(typeIds[i]) << 32) | materialIds[i];
+        }
+
+        std::vector<uint32_t> order(count);
+        std::iota(order.begin(), order.end(), 0u);
+        if (!std::is_sorted(keys.begin(), keys.end())) {
+            std::stable_sort(order.begin(), order.end(),
+                [&keys](uint32_t a, uint32_t b) { return keys[a] < keys[b]; });
+
+            for (auto* v : { &posX, &posY, &posZ, &scaleX, &scaleY, &scaleZ, &rotX, &rotY, &rotZ }) {
+                permute(*v, order);
+            }
+            permute(typeIds, order);
+            permute(materialIds, order);
+            permute(colors, order);
+            for (auto& column : world) {
+                if (column.size() == count) {
+                    permute(column, order);
+                }
+            }
+        }
+
+        batches.clear();
+        for (size_t i = 0; i < count; i++) {
+            if (batches.empty() || batches.back().typeId != typeIds[i] ||
+                batches.back().materialId != materialIds[i]) {
+                batches.push_back(RenderBatch{ typeIds[i], materialIds[i], i, 0 });
+            }
+            batches.back().count++;
+        }
+    }
+
+    /**
+     * Compose world matrices with scalar code only (reference path)
+     */
+    void composeTransformsScalar() {
+        for (auto& column : world) {
+            column.resize(size());
+        }
+        composeRange(0, size());
+    }
+
+    /**
+     * Compose world matrices, four objects per SSE iteration, straight from
+     * the SoA arrays. Sines and cosines are evaluated in vector lanes too.
+     */
+    void composeTransforms() {
+#ifdef MYA_RENDER_SSE
+        size_t count = size();
+        for (auto& column : world) {
+            column.resize(count);
+        }
+
+        size_t vectorEnd = count & ~static_cast<size_t>(3);
+        for (size_t i = 0; i < vectorEnd; i += 4) {
+            __m128 sa, ca, sb, cb, sc, cc;
+            sinCos4(_mm_loadu_ps(&rotX[i]), sa, ca);
+            sinCos4(_mm_loadu_ps(&rotY[i]), sb, cb);
+            sinCos4(_mm_loadu_ps(&rotZ[i]), sc, cc);
+            __m128 sx = _mm_loadu_ps(&scaleX[i]);
+            __m128 sy = _mm_loadu_ps(&scaleY[i]);
+            __m128 sz = _mm_loadu_ps(&scaleZ[i]);
+            __m128 sasb = _mm_mul_ps(sa, sb);
+            __m128 casb = _mm_mul_ps(ca, sb);
+
+            _mm_storeu_ps(&world[0][i], _mm_mul_ps(_mm_mul_ps(cb, cc), sx));
+            _mm_storeu_ps(&world[1][i], _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(sasb, cc), _mm_mul_ps(ca, sc)), sy));
+            _mm_storeu_ps(&world[2][i], _mm_mul_ps(_mm_add_ps(_mm_mul_ps(casb, cc), _mm_mul_ps(sa, sc)), sz));
+            _mm_storeu_ps(&world[3][i], _mm_loadu_ps(&posX[i]));
+            _mm_storeu_ps(&world[4][i], _mm_mul_ps(_mm_mul_ps(cb, sc), sx));
+            _mm_storeu_ps(&world[5][i], _mm_mul_ps(_mm_add_ps(_mm_mul_ps(sasb, sc), _mm_mul_ps(ca, cc)), sy));
+            _mm_storeu_ps(&world[6][i], _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(casb, sc), _mm_mul_ps(sa, cc)), sz));
+            _mm_storeu_ps(&world[7][i], _mm_loadu_ps(&posY[i]));
+            _mm_storeu_ps(&world[8][i], _mm_mul_ps(_mm_sub_ps(_mm_setzero_ps(), sb), sx));
+            _mm_storeu_ps(&world[9][i], _mm_mul_ps(_mm_mul_ps(sa, cb), sy));
+            _mm_storeu_ps(&world[10][i], _mm_mul_ps(_mm_mul_ps(ca, cb), sz));
+            _mm_storeu_ps(&world[11][i], _mm_loadu_ps(&posZ[i]));
+        }
+
+        // Scalar epilogue for the last (count % 4) objects
+        composeRange(vectorEnd, count);
+#else
+        composeTransformsScalar();
+#endif
+    }
+
+    /**
+     * Deterministic pseudo-random scene for benchmarking
+     */
+    static RenderScene synthetic(size_t count, uint32_t seed = 1) {
+        static const char* types[] = { "cube", "sphere", "plane" };
+        static const uint32_t palette[] = {
+            0xFF6432FF, 0x3264FFFF, 0x808080FF, 0x32C850FF,
+            0xF0D020FF, 0xA040E0FF, 0x20D0D0FF, 0xFFFFFFFF
+        };
+
+        RenderScene scene;
+        scene.viewportWidth = 1280;
+        scene.viewportHeight = 720;
+        scene.camera.position[2] = 160.0f;
+        scene.reserve(count);
+
+        uint32_t state = seed ? seed : 1;
+        auto next = [&state]() {
+            state = state * 1664525u + 1013904223u;
+            return (state >> 8) * (1.0f / 16777216.0f);
+        };
+
+        for (size_t i = 0; i < count; i++) {
+            RenderObjectDesc desc;
+            desc.type = types[static_cast<size_t>(next() * 3.0f) % 3];
+            desc.color = palette[static_cast<size_t>(next() * 8.0f) % 8];
+            for (int axis = 0; axis < 3; axis++) {
+                desc.position[axis] = next() * 100.0f - 50.0f;
+                desc.rotation[axis] = next() * 360.0f;
+                desc.scale[axis] = 0.25f + next();
+            }
+            scene.addObject(desc);
+        }
+        return scene;
+    }
+
+    /**
+     * Print scene summary and batch table
+     */
+    void print() const {
+        std::cout << "\n=== Render Scene (SoA) ===" << std::endl;
+        std::cout << "Viewport: " << viewportWidth << "x" << viewportHeight << std::endl;
+        std::cout << "Camera: position=(" << camera.position[0] << ", " << camera.position[1] << ", "
+                  << camera.position[2] << "), target=(" << camera.target[0] << ", " << camera.target[1]
+                  << ", " << camera.target[2] << "), fov=" << camera.fov << std::endl;
+        std::cout << "Objects: " << size() << ", Batches: " << batches.size() << std::endl;
+        for (size_t i = 0; i < batches.size(); i++) {
+            const auto& batch = batches[i];
+            std::cout << "Batch " << i << ": Type=" << typeNames[batch.typeId]
+                      << ", Material=" << materialNames[batch.materialId]
+                      << ", First=" << batch.first << ", Count=" << batch.count << std::endl;
+        }
+    }
+};
+
+/**
+ * RenderLowering - Collects render blocks from the preprocessed token stream
+ */
+class RenderLowering {
+private:
+    enum class Section { None, Camera, Object, Other };
+
+    static std::string trim(const std::string& text) {
+        size_t start = text.find_first_not_of(" \t\r");
+        if (start == std::string::npos) {
+            return "";
+        }
+        size_t end = text.find_last_not_of(" \t\r;");
+        return end < start ? "" : text.substr(start, end - start + 1);
+    }
+
+    /**
+     * Strip a trailing `$` line comment
+     */
+    static std::string stripComment(const std::string& text) {
+        bool inString = false;
+        for (size_t i = 0; i < text.size(); i++) {
+            if (text[i] == '"') {
+                inString = !inString;
+            } else if (text[i] == '$' && !inString) {
+                return text.substr(0, i);
+            }
+        }
+        return text;
+    }
+
+    /**
+     * Parse a comma- or 'x'-separated list of numbers ("0, 5, 10", "800x600")
+     */
+    static std::vector<float> parseNumbers(const std::string& text) {
+        std::vector<float> values;
+        const char* p = text.c_str();
+        while (*p) {
+            char* end = nullptr;
+            float value = std::strtof(p, &end);
+            if (end == p) {
+                p++;
+                continue;
+            }
+            values.push_back(value);
+            p = end;
+        }
+        return values;
+    }
+
+    static void assign3(float* target, const std::vector<float>& values) {
+        if (values.size() == 1) {
+            target[0] = target[1] = target[2] = values[0];
+            return;
+        }
+        for (size_t i = 0; i < values.size() && i < 3; i++) {
+            target[i] = values[i];
+        }
+    }
+
+    static void applyObjectProperty(RenderObjectDesc& object, const std::string& key, const std::string& value) {
+        std::vector<float> numbers = parseNumbers(value);
+        if (key == "position") {
+            assign3(object.position, numbers);
+        } else if (key == "rotation") {
+            assign3(object.rotation, numbers);
+        } else if (key == "scale") {
+            assign3(object.scale, numbers);
+        } else if (key == "radius" && !numbers.empty()) {
+            assign3(object.scale, std::vector<float>{ numbers[0] });
+        } else if (key == "size" && numbers.size() >= 2) {
+            object.scale[0] = numbers[0];
+            object.scale[2] = numbers[1];
+        } else if (key == "material") {
+            object.material = value;
+        } else if (key == "color" && numbers.size() >= 3) {
+            uint32_t rgba = 0;
+            for (size_t i = 0; i < 4; i++) {
+                float channel = i < numbers.size() ? numbers[i] : 255.0f;
+                rgba = (rgba << 8) | static_cast<uint32_t>(std::min(255.0f, std::max(0.0f, channel)));
+            }
+            object.color = rgba;
+        }
+    }
+
+public:
+    /**
+     * Lower every render block in the token stream into one scene.
+     * The result is sorted for batching and has world transforms composed.
+     */
+    RenderScene lower(const std::vector<Token>& tokens) {
+        RenderScene scene;
+        RenderObjectDesc object;
+        bool hasObject = false;
+        Section section = Section::None;
+        int depth = 0;
+
+        auto flush = [&]() {
+            if (hasObject) {
+                scene.addObject(object);
+                hasObject = false;
+            }
+        };
+
+        for (const auto& token : tokens) {
+            if (token.type != TokenType::CODE) {
+                continue;
+            }
+            std::string text = trim(stripComment(token.value));
+
+            if (depth == 0) {
+                if (text == "render:") {
+                    depth = 1;
+                    section = Section::None;
+                }
+                continue;
+            }
+
+            if (text == "end") {
+                if (--depth == 0) {
+                    flush();
+                }
+                continue;
+            }
+            if (text == "render:") {
+                depth++;
+                continue;
+            }
+
+            size_t colon = text.find(':');
+            std::string key = trim(text.substr(0, colon));
+            std::string value = colon == std::string::npos ? "" : trim(text.substr(colon + 1));
+
+            if (key == "object") {
+                flush();
+                object = RenderObjectDesc();
+                object.type = value.empty() ? "object" : value;
+                hasObject = true;
+                section = Section::Object;
+            } else if (value.empty()) {
+                // New section header (camera:, lighting:, ...) ends the current object
+                flush();
+                section = key == "camera" ? Section::Camera : Section::Other;
+            } else if (section == Section::Object) {
+                applyObjectProperty(object, key, value);
+            } else if (section == Section::Camera) {
+                std::vector<float> numbers = parseNumbers(value);
+                if (key == "position") {
+                    assign3(scene.camera.position, numbers);
+                } else if (key == "target") {
+                    assign3(scene.camera.target, numbers);
+                } else if (key == "fov" && !numbers.empty()) {
+                    scene.camera.fov = numbers[0];
+                }
+            } else if (key == "viewport") {
+                std::vector<float> numbers = parseNumbers(value);
+                if (numbers.size() >= 2 && numbers[0] > 0 && numbers[1] > 0) {
+                    scene.viewportWidth = static_cast<int>(numbers[0]);
+                    scene.viewportHeight = static_cast<int>(numbers[1]);
+                }
+            }
+        }
+        flush();
+
+        scene.sortForBatching();
+        scene.composeTransforms();
+        return scene;
+    }
+};
+
+/**
+ * SoftwareRasterizer - Headless CPU consumer of RenderScene
+ *
+ * Each object is drawn as a depth-tested screen-space splat (disc for
+ * spheres, square otherwise) sized by its projected bounding radius.
+ * Shape selection happens once per batch, not once per object.
+ */
+class SoftwareRasterizer {
+private:
+    int width;
+    int height;
+    std::vector<uint32_t> colorBuffer;
+    std::vector<float> depthBuffer;
+
+    static void normalize(float* v) {
+        float length = std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+        if (length > 0.0f) {
+            v[0] /= length;
+            v[1] /= length;
+            v[2] /= length;
+        }
+    }
+
+    /**
+     * Screen coordinate clamped to +-2^29 pixels (NaN to the low end): far
+     * outside any viewport, and squares of differences still fit int64_t
+     */
+    static int64_t toPixel(float value) {
+        const float bound = 536870912.0f;
+        return static_cast<int64_t>(value >= -bound ? (value <= bound ? value : bound) : -bound);
+    }
+
+public:
+    SoftwareRasterizer(int width, int height)
+        : width(width), height(height),
+          colorBuffer(static_cast<size_t>(width) * height),
+          depthBuffer(static_cast<size_t>(width) * height) {
+        clear(0x101018FF);
+    }
+
+    void clear(uint32_t rgba) {
+        std::fill(colorBuffer.begin(), colorBuffer.end(), rgba);
+        std::fill(depthBuffer.begin(), depthBuffer.end(), 1e30f);
+    }
+
+    /**
+     * Draw a scene whose transforms have been composed.
+     * Returns the number of objects that landed on screen.
+     */
+    size_t draw(const RenderScene& scene) {
+        const RenderCamera& cam = scene.camera;
+        float forward[3] = { cam.target[0] - cam.position[0], cam.target[1] - cam.position[1],
+                             cam.target[2] - cam.position[2] };
+        normalize(forward);
+        float up[3] = { 0.0f, 1.0f, 0.0f };
+        if (std::fabs(forward[1]) > 0.999f) {
+            up[1] = 0.0f;
+            up[2] = 1.0f;
+        }
+        float right[3] = { forward[1] * up[2] - forward[2] * up[1], forward[2] * up[0] - forward[0] * up[2],
+                           forward[0] * up[1] - forward[1] * up[0] };
+        normalize(right);
+        float trueUp[3] = { right[1] * forward[2] - right[2] * forward[1],
+                            right[2] * forward[0] - right[0] * forward[2],
+                            right[0] * forward[1] - right[1] * forward[0] };
+
+        float focal = 1.0f / std::tan(cam.fov * 0.5f * 3.14159265358979f / 180.0f);
+        float halfW = width * 0.5f;
+        float halfH = height * 0.5f;
+        size_t visible = 0;
+
+        for (const auto& batch : scene.batches) {
+            bool disc = scene.typeNames[batch.typeId] == "sphere";
+            for (size_t i = batch.first; i < batch.first + batch.count; i++) {
+                float rel[3] = { scene.world[3][i] - cam.position[0], scene.world[7][i] - cam.position[1],
+                                 scene.world[11][i] - cam.position[2] };
+                float depth = rel[0] * forward[0] + rel[1] * forward[1] + rel[2] * forward[2];
+                if (depth <= 0.1f) {
+                    continue;
+                }
+                float vx = rel[0] * right[0] + rel[1] * right[1] + rel[2] * right[2];
+                float vy = rel[0] * trueUp[0] + rel[1] * trueUp[1] + rel[2] * trueUp[2];
+
+                float radius = 0.0f;
+                for (int column = 0; column < 3; column++) {
+                    float c0 = scene.world[column][i], c1 = scene.world[4 + column][i], c2 = scene.world[8 + column][i];
+                    radius = std::max(radius, c0 * c0 + c1 * c1 + c2 * c2);
+                }
+                radius = std::sqrt(radius);
+
+                // Near or huge objects project far outside the viewport: clamp
+                // before converting, and square in 64 bits
+                float scale = focal / depth * halfH;
+                int64_t cx = toPixel(halfW + vx * scale);
+                int64_t cy = toPixel(halfH - vy * scale);
+                int64_t r = std::max<int64_t>(1, toPixel(radius * scale));
+                if (cx + r < 0 || cy + r < 0 || cx - r >= width || cy - r >= height) {
+                    continue;
+                }
+                visible++;
+
+                uint32_t color = scene.colors[i];
+                int x0 = static_cast<int>(std::max<int64_t>(0, cx - r));
+                int x1 = static_cast<int>(std::min<int64_t>(width - 1, cx + r));
+                int y0 = static_cast<int>(std::max<int64_t>(0, cy - r));
+                int y1 = static_cast<int>(std::min<int64_t>(height - 1, cy + r));
+                for (int y = y0; y <= y1; y++) {
+                    size_t row = static_cast<size_t>(y) * width;
+                    int64_t dy = y - cy;
+                    for (int x = x0; x <= x1; x++) {
+                        int64_t dx = x - cx;
+                        if (disc && dx * dx + dy * dy > r * r) {
+                            continue;
+                        }
+                        if (depth < depthBuffer[row + x]) {
+                            depthBuffer[row + x] = depth;
+                            colorBuffer[row + x] = color;
+                        }
+                    }
+                }
+            }
+        }
+        return visible;
+    }
+
+    /**
+     * Write the color buffer as a binary PPM (P6) image
+     */
+    bool writePPM(const std::string& path) const {
+        std::ofstream file(path, std::ios::binary);
+        if (!file.is_open()) {
+            return false;
+        }
+        file << "P6\n" << width << " " << height << "\n255\n";
+        std::vector<unsigned char> row(static_cast<size_t>(width) * 3);
+        for (int y = 0; y < height; y++) {
+            for (int x = 0; x < width; x++) {
+                uint32_t rgba = colorBuffer[static_cast<size_t>(y) * width + x];
+                row[x * 3 + 0] = static_cast<unsigned char>(rgba >> 24);
+                row[x * 3 + 1] = static_cast<unsigned char>(rgba >> 16);
+                row[x * 3 + 2] = static_cast<unsigned char>(rgba >> 8);
+            }
+            file.write(reinterpret_cast<const char*>(row.data()), row.size());
+        }
+        return file.good();
+    }
+};
+
+/**
+ * Render pipeline benchmark: batching sort, transform composition
+ * (scalar vs SIMD) and a headless frame on a synthetic scene.
+ */
+inline void runRenderBenchmark(size_t count) {
+    std::cout << "=== Render Benchmark (" << count << " objects) ===" << std::endl;
+
+    RenderScene scene = RenderScene::synthetic(count);
+    Stopwatch watch;
+    scene.sortForBatching();
+    reportBenchmark("sort for batching", watch.elapsedSeconds(), count);
+
+    double scalar = bestOf(5, [&]() { scene.composeTransformsScalar(); });
+    reportBenchmark("compose transforms (scalar)", scalar, count);
+    double simd = bestOf(5, [&]() { scene.composeTransforms(); });
+    reportBenchmark("compose transforms (SIMD)", simd, count);
+
+    SoftwareRasterizer rasterizer(scene.viewportWidth, scene.viewportHeight);
+    size_t visible = 0;
+    double frame = bestOf(3, [&]() {
+        rasterizer.clear(0x101018FF);
+        visible = rasterizer.draw(scene);
+    });
+    reportBenchmark("rasterize frame", frame, count);
+    std::cout << "  batches: " << scene.batches.size() << ", visible objects: " << visible << std::endl;
+}
+
+} // namespace MYA
+
+#endif // MYA_RENDER_SCENE_H
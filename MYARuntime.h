@@ -0,0 +1,325 @@
+/**
+ * MYA Language - Runtime Library
+ *
+ * Support code for programs compiled by the C++ backend (MYACodegen.h).
+ * Generated sources include this header and link against nothing else:
+ * - print with MYA formatting (space separated, lists as [a, b]) through
+ *   per-thread output buffers (MYARuntimePrint.h)
+ * - list<T> values with inline storage for short lists (MYARuntimeList.h),
+ *   bounds-checked indexing and the zeros/len/push builtins, allocated from
+ *   the pool or a block's region (MYARuntimeAlloc.h)
+ * - map<K, V> hash maps (MYARuntimeMap.h), tuples and tagged any values
+ *   (MYARuntimeValue.h) with their builtins and checked conversions
+ * - checked integer division and runtime error reporting
+ * - branch hints for filter lowering (MYA_UNLIKELY, coldPath) and the
+ *   profile-guided hints (MYA_LIKELY, MYA_HOT, MYA_INLINE, MYA_UNROLL)
+ * - counters for --instrument builds (MYARuntimeProfile.h)
+ * - the work-stealing scheduler behind pfor (MYARuntimeParallel.h)
+ * - spawned tasks and chan<T> channels on an M:N scheduler (MYARuntimeTask.h)
+ *
+ * MYA values map to C++ as int -> int64_t, float -> double, bool -> bool,
+ * str -> std::string, list<T> -> List<T>, map<K, V> -> Map<K, V>,
+ * tuple<A, B> -> Tuple<A, B>, any -> Any, chan<T> -> Chan<T> and
+ * task<T> -> Task<T>.
+ */
+
+#ifndef MYA_RUNTIME_H
+#define MYA_RUNTIME_H
+
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include "MYARuntimeAlloc.h"
+#include "MYARuntimeList.h"
+#include "MYARuntimeMap.h"
+#include "MYARuntimePrint.h"
+#include "MYARuntimeParallel.h"
+#include "MYARuntimeProfile.h"
+#include "MYARuntimeTask.h"
+#include "MYARuntimeValue.h"
+
+#if defined(__GNUC__) || defined(__clang__)
+#define MYA_UNLIKELY(x) __builtin_expect(!!(x), 0)
+#define MYA_LIKELY(x) __builtin_expect(!!(x), 1)
+#define MYA_COLD __attribute__((cold, noinline))
+#define MYA_HOT __attribute__((hot))
+#define MYA_INLINE inline __attribute__((always_inline))
+#define MYA_NOINLINE __attribute__((noinline))
+#else
+#define MYA_UNLIKELY(x) (x)
+#define MYA_LIKELY(x) (x)
+#define MYA_COLD __declspec(noinline)
+#define MYA_HOT
+#define MYA_INLINE __forceinline
+#define MYA_NOINLINE __declspec(noinline)
+#endif
+
+// Unroll hint for the next loop: MYA_UNROLL(4)
+#define MYA_PRAGMA(x) _Pragma(#x)
+#if defined(__clang__)
+#define MYA_UNROLL(n) MYA_PRAGMA(unroll n)
+#elif defined(__GNUC__) && __GNUC__ >= 8
+#define MYA_UNROLL(n) MYA_PRAGMA(GCC unroll n)
+#else
+#define MYA_UNROLL(n)
+#endif
+
+namespace MYA {
+namespace Runtime {
+
+/**
+ * Report a runtime error and terminate the program
+ */
+[[noreturn]] inline void fail(int line, const std::string& message) {
+    flush();
+    std::cerr << "Runtime error at line " << line << ": " << message << std::endl;
+    std::exit(1);
+}
+
+/**
+ * First statement of a filter's pass block. A call to a cold function marks
+ * the block cold, so the compiler moves it out of the function's hot path.
+ */
+MYA_COLD inline void coldPath() {
+#if defined(__GNUC__) || defined(__clang__)
+    __asm__ volatile("");  // Keeps the empty call from being removed
+#endif
+}
+
+// ----- Lists -----
+
+/**
+ * Out of line, so the check that calls it stays small enough to inline
+ */
+[[noreturn]] MYA_COLD inline void indexError(int64_t index, size_t size, int line) {
+    fail(line, "index " + std::to_string(index) + " out of range for list of length " + std::to_string(size));
+}
+
+template <typename T>
+inline void checkIndex(const List<T>& list, int64_t index, int line) {
+    if (MYA_UNLIKELY(index < 0 || static_cast<uint64_t>(index) >= list.size())) {
+        indexError(index, list.size(), line);
+    }
+}
+
+template <typename T>
+inline T& at(List<T>& list, int64_t index, int line) {
+    checkIndex(list, index, line);
+    return list[static_cast<size_t>(index)];
+}
+
+template <typename T>
+inline const T& at(const List<T>& list, int64_t index, int line) {
+    checkIndex(list, index, line);
+    return list[static_cast<size_t>(index)];
+}
+
+/**
+ * Whether [begin, end) is in bounds; vectorized loops check once up front
+ */
+template <typename T>
+inline bool inRange(const List<T>& list, int64_t begin, int64_t end) {
+    return begin >= 0 && end >= begin && static_cast<uint64_t>(end) <= list.size();
+}
+
+template <typename T>
+inline List<T> zeros(int64_t count, int line) {
+    if (count < 0) {
+        fail(line, "zeros() called with negative length " + std::to_string(count));
+    }
+    return List<T>(static_cast<size_t>(count), T());
+}
+
+/**
+ * zeros() for a list that lives in the enclosing function or filter region
+ */
+template <typename T>
+inline List<T> zeros(int64_t count, int line, RegionScope& region) {
+    if (count < 0) {
+        fail(line, "zeros() called with negative length " + std::to_string(count));
+    }
+    return List<T>(static_cast<size_t>(count), T(), Allocator<T>(region));
+}
+
+template <typename T>
+inline int64_t len(const List<T>& list) {
+    return static_cast<int64_t>(list.size());
+}
+
+inline int64_t len(const std::string& text) {
+    return static_cast<int64_t>(text.size());
+}
+
+template <typename T, typename V>
+inline void push(List<T>& list, const V& value) {
+    list.push_back(static_cast<T>(value));
+}
+
+/**
+ * `free list;` returns the list's storage to its pool size class (or region)
+ * in O(1) and leaves the list empty
+ */
+template <typename T>
+inline void release(List<T>& list) {
+    list.reset();
+}
+
+// ----- Maps -----
+
+/**
+ * `m[key]` read: the value, or a runtime error when the key is missing
+ */
+template <typename K, typename V>
+inline V& at(Map<K, V>& map, const typename Map<K, V>::key_type& key, int line) {
+    V* value = map.find(key);
+    if (!value) {
+        fail(line, "key not in map");
+    }
+    return *value;
+}
+
+template <typename K, typename V>
+inline const V& at(const Map<K, V>& map, const typename Map<K, V>::key_type& key, int line) {
+    const V* value = map.find(key);
+    if (!value) {
+        fail(line, "key not in map");
+    }
+    return *value;
+}
+
+/**
+ * `m[key] = value` target: inserts the key when missing
+ */
+template <typename K, typename V>
+inline V& slot(Map<K, V>& map, const typename Map<K, V>::key_type& key) {
+    return map[key];
+}
+
+/**
+ * map(n): an empty map with room for n entries
+ */
+template <typename K, typename V>
+inline Map<K, V> newMap(int64_t capacity, int line) {
+    if (capacity < 0) {
+        fail(line, "map() called with negative capacity " + std::to_string(capacity));
+    }
+    Map<K, V> map;
+    map.reserve(static_cast<size_t>(capacity));
+    return map;
+}
+
+template <typename K, typename V>
+inline int64_t len(const Map<K, V>& map) {
+    return static_cast<int64_t>(map.size());
+}
+
+template <typename K, typename V>
+inline bool has(const Map<K, V>& map, const typename Map<K, V>::key_type& key) {
+    return map.contains(key);
+}
+
+template <typename K, typename V>
+inline bool remove(Map<K, V>& map, const typename Map<K, V>::key_type& key) {
+    return map.erase(key);
+}
+
+/**
+ * keys(m): the keys in table order
+ */
+template <typename K, typename V>
+inline List<K> keys(const Map<K, V>& map) {
+    List<K> result;
+    result.reserve(map.size());
+    map.forEach([&result](const K& key, const V&) { result.push_back(key); });
+    return result;
+}
+
+template <typename K, typename V>
+inline void release(Map<K, V>& map) {
+    map = Map<K, V>();
+}
+
+// ----- Dynamic values -----
+
+/**
+ * An any used where a concrete type is expected
+ */
+template <typename T>
+inline T as(const Any& value, int line);
+
+[[noreturn]] inline void failConversion(const Any& value, const char* expected, int line) {
+    fail(line, std::string("any holds ") + value.typeName() + ", expected " + expected);
+}
+
+template <>
+inline int64_t as<int64_t>(const Any& value, int line) {
+    if (value.type() != Any::Tag::Int) {
+        failConversion(value, "int", line);
+    }
+    return value.asInt();
+}
+
+template <>
+inline double as<double>(const Any& value, int line) {
+    if (!value.isNumber()) {
+        failConversion(value, "float", line);
+    }
+    return value.asFloat();
+}
+
+template <>
+inline bool as<bool>(const Any& value, int line) {
+    if (value.type() != Any::Tag::Bool) {
+        failConversion(value, "bool", line);
+    }
+    return value.asBool();
+}
+
+template <>
+inline std::string as<std::string>(const Any& value, int line) {
+    if (value.type() != Any::Tag::Str) {
+        failConversion(value, "str", line);
+    }
+    return value.asStr();
+}
+
+inline std::string typeOf(const Any& value) {
+    return value.typeName();
+}
+
+// ----- Arithmetic -----
+
+inline int64_t divide(int64_t a, int64_t b, int line) {
+    if (b == 0) {
+        fail(line, "integer division by zero");
+    }
+    return b == -1 ? static_cast<int64_t>(0 - static_cast<uint64_t>(a)) : a / b;
+}
+
+inline int64_t modulo(int64_t a, int64_t b, int line) {
+    if (b == 0) {
+        fail(line, "integer modulo by zero");
+    }
+    return b == -1 ? 0 : a % b;
+}
+
+/**
+ * Two's complement + and * for accumulators introduced by the tail call
+ * optimizer (MYATailCallOptimizer.h); reassociated products may overflow
+ * where the original order did not, but agree with it modulo 2^64
+ */
+inline int64_t wrapAdd(int64_t a, int64_t b) {
+    return static_cast<int64_t>(static_cast<uint64_t>(a) + static_cast<uint64_t>(b));
+}
+
+inline int64_t wrapMul(int64_t a, int64_t b) {
+    return static_cast<int64_t>(static_cast<uint64_t>(a) * static_cast<uint64_t>(b));
+}
+
+} // namespace Runtime
+} // namespace MYA
+
+#endif // MYA_RUNTIME_H
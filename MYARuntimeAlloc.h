@@ -0,0 +1,438 @@
+/**
+ * MYA Language - Runtime Allocation
+ *
+ * Memory model for compiled MYA programs:
+ * - PoolAllocator: per-thread size-class free lists for small blocks
+ *   (16..1024 bytes); allocation and `free` are O(1) pointer pops/pushes.
+ *   Larger blocks go to malloc.
+ * - Arena / RegionScope: bump allocation for lists that do not outlive the
+ *   function or `filter` block that creates them. Everything in the region is
+ *   released at once when the block exits.
+ * - Allocator<T>: the allocator of List<T>; draws from a region when given
+ *   one and from the thread's pool otherwise. Copies always use the pool, so
+ *   a value copied out of a region never points into it.
+ *
+ * Define MYA_RUNTIME_MALLOC to route every allocation to malloc/free, for
+ * comparing generated programs against the plain C allocator.
+ */
+
+#ifndef MYA_RUNTIME_ALLOC_H
+#define MYA_RUNTIME_ALLOC_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <vector>
+#include "MYABenchmark.h"
+
+namespace MYA {
+namespace Runtime {
+
+/**
+ * PoolAllocator - Size-class free lists, one pool per thread
+ */
+class PoolAllocator {
+public:
+    static const size_t classCount = 7;       // 16, 32, 64, 128, 256, 512, 1024
+    static const size_t maxSmall = 1024;
+    static const size_t chunkSize = 64 * 1024;
+
+private:
+    struct FreeBlock {
+        FreeBlock* next;
+    };
+
+    FreeBlock* freeLists[classCount];
+
+    /**
+     * Blocks owned by exited threads, adopted by the next pool that runs dry
+     */
+    struct Depot {
+        std::mutex lock;
+        FreeBlock* lists[classCount] = {};
+    };
+
+    static Depot& depot() {
+        static Depot instance;
+        return instance;
+    }
+
+    static size_t classOf(size_t bytes) {
+        size_t index = 0;
+        for (size_t size = 16; size < bytes; size <<= 1) {
+            index++;
+        }
+        return index;
+    }
+
+    static size_t classSize(size_t index) {
+        return size_t(16) << index;
+    }
+
+    /**
+     * Refill an empty class from the depot, or carve a fresh chunk into blocks.
+     * Chunks are never unmapped: blocks may still be in use by other threads.
+     */
+    void refill(size_t index) {
+        {
+            Depot& shared = depot();
+            std::lock_guard<std::mutex> guard(shared.lock);
+            if (shared.lists[index]) {
+                freeLists[index] = shared.lists[index];
+                shared.lists[index] = nullptr;
+                return;
+            }
+        }
+        char* chunk = static_cast<char*>(std::malloc(chunkSize));
+        if (!chunk) {
+            throw std::bad_alloc();
+        }
+        size_t size = classSize(index);
+        for (size_t offset = 0; offset + size <= chunkSize; offset += size) {
+            FreeBlock* block = reinterpret_cast<FreeBlock*>(chunk + offset);
+            block->next = freeLists[index];
+            freeLists[index] = block;
+        }
+    }
+
+public:
+    PoolAllocator() {
+        std::fill(freeLists, freeLists + classCount, nullptr);
+    }
+
+    ~PoolAllocator() {
+        Depot& shared = depot();
+        std::lock_guard<std::mutex> guard(shared.lock);
+        for (size_t i = 0; i < classCount; i++) {
+            while (FreeBlock* block = freeLists[i]) {
+                freeLists[i] = block->next;
+                block->next = shared.lists[i];
+                shared.lists[i] = block;
+            }
+        }
+    }
+
+    PoolAllocator(const PoolAllocator&) = delete;
+    PoolAllocator& operator=(const PoolAllocator&) = delete;
+
+    void* allocate(size_t bytes) {
+        if (bytes > maxSmall) {
+            void* p = std::malloc(bytes);
+            if (!p) {
+                throw std::bad_alloc();
+            }
+            return p;
+        }
+        size_t index = classOf(bytes);
+        if (!freeLists[index]) {
+            refill(index);
+        }
+        FreeBlock* block = freeLists[index];
+        freeLists[index] = block->next;
+        return block;
+    }
+
+    /**
+     * O(1) return to the size class; `bytes` is the size passed to allocate()
+     */
+    void deallocate(void* p, size_t bytes) {
+        if (!p) {
+            return;
+        }
+        if (bytes > maxSmall) {
+            std::free(p);
+            return;
+        }
+        FreeBlock* block = static_cast<FreeBlock*>(p);
+        size_t index = classOf(bytes);
+        block->next = freeLists[index];
+        freeLists[index] = block;
+    }
+
+    static PoolAllocator& local() {
+        static thread_local PoolAllocator pool;
+        return pool;
+    }
+};
+
+/**
+ * Arena - Bump allocator whose memory is released all at once
+ *
+ * Blocks come from (and return to) a per-thread cache, so entering and
+ * leaving a region does not touch malloc in steady state.
+ */
+class Arena {
+private:
+    struct Block {
+        Block* prev;
+        size_t size;
+    };
+
+    static const size_t blockSize = 64 * 1024;
+    static const size_t headerSize = (sizeof(Block) + 15) & ~size_t(15);
+
+    Block* head = nullptr;
+    char* cursor = nullptr;
+    char* limit = nullptr;
+
+    struct BlockCache {
+        std::vector<Block*> blocks;
+        ~BlockCache() {
+            for (Block* block : blocks) {
+                std::free(block);
+            }
+        }
+    };
+
+    static BlockCache& cache() {
+        static thread_local BlockCache instance;
+        return instance;
+    }
+
+    void grow(size_t bytes) {
+        size_t size = std::max(size_t(blockSize), bytes + headerSize);
+        Block* block = nullptr;
+        BlockCache& cached = cache();
+        if (size == blockSize && !cached.blocks.empty()) {
+            block = cached.blocks.back();
+            cached.blocks.pop_back();
+        } else {
+            block = static_cast<Block*>(std::malloc(size));
+            if (!block) {
+                throw std::bad_alloc();
+            }
+            block->size = size;
+        }
+        block->prev = head;
+        head = block;
+        cursor = reinterpret_cast<char*>(block) + headerSize;
+        limit = reinterpret_cast<char*>(block) + block->size;
+    }
+
+public:
+    Arena() {}
+
+    ~Arena() {
+        release();
+    }
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    void* allocate(size_t bytes) {
+        bytes = (bytes + 15) & ~size_t(15);
+        if (static_cast<size_t>(limit - cursor) < bytes) {
+            grow(bytes);
+        }
+        void* p = cursor;
+        cursor += bytes;
+        return p;
+    }
+
+    /**
+     * Only the most recent allocation is reclaimed (e.g. a list freed right
+     * after it was built); everything else waits for release()
+     */
+    void deallocate(void* p, size_t bytes) {
+        bytes = (bytes + 15) & ~size_t(15);
+        if (static_cast<char*>(p) + bytes == cursor) {
+            cursor = static_cast<char*>(p);
+        }
+    }
+
+    /**
+     * Free every allocation made from this arena
+     */
+    void release() {
+        BlockCache& cached = cache();
+        while (head) {
+            Block* block = head;
+            head = block->prev;
+            if (block->size == blockSize) {
+                cached.blocks.push_back(block);
+            } else {
+                std::free(block);
+            }
+        }
+        cursor = limit = nullptr;
+    }
+};
+
+/**
+ * RegionScope - Arena for one function or `filter` block; released at exit
+ */
+class RegionScope {
+private:
+    Arena arena;
+
+public:
+    Arena* get() {
+        return &arena;
+    }
+};
+
+/**
+ * Allocator<T> - List allocator drawing from a region or the thread's pool
+ */
+template <typename T>
+struct Allocator {
+    typedef T value_type;
+    typedef std::false_type propagate_on_container_copy_assignment;
+    typedef std::false_type propagate_on_container_move_assignment;
+    typedef std::false_type propagate_on_container_swap;
+    typedef std::false_type is_always_equal;
+
+    Arena* arena;
+
+    Allocator() : arena(nullptr) {}
+    explicit Allocator(RegionScope& region) : arena(region.get()) {}
+    explicit Allocator(Arena* arena) : arena(arena) {}
+    template <typename U>
+    Allocator(const Allocator<U>& other) : arena(other.arena) {}
+
+    T* allocate(size_t count) {
+        size_t bytes = count * sizeof(T);
+#ifdef MYA_RUNTIME_MALLOC
+        void* p = std::malloc(bytes);
+        if (!p) {
+            throw std::bad_alloc();
+        }
+        return static_cast<T*>(p);
+#else
+        return static_cast<T*>(arena ? arena->allocate(bytes) : PoolAllocator::local().allocate(bytes));
+#endif
+    }
+
+    void deallocate(T* p, size_t count) {
+#ifdef MYA_RUNTIME_MALLOC
+        (void)count;
+        std::free(p);
+#else
+        if (arena) {
+            arena->deallocate(p, count * sizeof(T));
+        } else {
+            PoolAllocator::local().deallocate(p, count * sizeof(T));
+        }
+#endif
+    }
+
+    /**
+     * Copies never inherit a region
+     */
+    Allocator select_on_container_copy_construction() const {
+        return Allocator();
+    }
+};
+
+template <typename T, typename U>
+inline bool operator==(const Allocator<T>& a, const Allocator<U>& b) {
+    return a.arena == b.arena;
+}
+
+template <typename T, typename U>
+inline bool operator!=(const Allocator<T>& a, const Allocator<U>& b) {
+    return a.arena != b.arena;
+}
+
+// ----- Benchmark: pool and regions vs malloc -----
+
+/**
+ * Compare malloc/free against the pool and region allocators on
+ * small-object churn and on building short-lived lists
+ */
+inline void runAllocBenchmark(size_t count) {
+    const size_t batch = 1000;
+    const size_t rounds = std::max<size_t>(1, count / batch);
+    const size_t items = rounds * batch;
+    std::vector<void*> ptrs(batch);
+    std::vector<size_t> sizes(batch);
+    for (size_t i = 0; i < batch; i++) {
+        sizes[i] = 16 + (i * 40) % 500;  // 16..515 bytes
+    }
+    volatile uintptr_t sink = 0;
+    std::cout << "Alloc benchmark: " << items << " allocations" << std::endl;
+
+    double mallocTime = bestOf(3, [&] {
+        for (size_t r = 0; r < rounds; r++) {
+            for (size_t i = 0; i < batch; i++) {
+                ptrs[i] = std::malloc(sizes[i]);
+            }
+            sink = sink + reinterpret_cast<uintptr_t>(ptrs[batch / 2]);
+            for (size_t i = 0; i < batch; i++) {
+                std::free(ptrs[(i * 7) % batch]);  // Interleaved free order (batch is not a multiple of 7)
+            }
+        }
+    });
+    reportBenchmark("small objects malloc/free", mallocTime, items);
+
+    PoolAllocator& pool = PoolAllocator::local();
+    double poolTime = bestOf(3, [&] {
+        for (size_t r = 0; r < rounds; r++) {
+            for (size_t i = 0; i < batch; i++) {
+                ptrs[i] = pool.allocate(sizes[i]);
+            }
+            sink = sink + reinterpret_cast<uintptr_t>(ptrs[batch / 2]);
+            for (size_t i = 0; i < batch; i++) {
+                size_t j = (i * 7) % batch;
+                pool.deallocate(ptrs[j], sizes[j]);
+            }
+        }
+    });
+    reportBenchmark("small objects pool", poolTime, items);
+
+    double arenaTime = bestOf(3, [&] {
+        for (size_t r = 0; r < rounds; r++) {
+            RegionScope region;
+            for (size_t i = 0; i < batch; i++) {
+                ptrs[i] = region.get()->allocate(sizes[i]);
+            }
+            sink = sink + reinterpret_cast<uintptr_t>(ptrs[batch / 2]);
+        }
+    });
+    reportBenchmark("small objects region", arenaTime, items);
+
+    // Temporary lists: build 16 elements, then drop the list
+    const size_t lists = items / 16;
+    double vectorTime = bestOf(3, [&] {
+        for (size_t r = 0; r < lists; r++) {
+            std::vector<int64_t> list;
+            for (int64_t v = 0; v < 16; v++) {
+                list.push_back(v);
+            }
+            sink = sink + static_cast<uintptr_t>(list[r % 16]);
+        }
+    });
+    reportBenchmark("temporary lists std::allocator", vectorTime, lists);
+
+    double poolListTime = bestOf(3, [&] {
+        for (size_t r = 0; r < lists; r++) {
+            std::vector<int64_t, Allocator<int64_t>> list;
+            for (int64_t v = 0; v < 16; v++) {
+                list.push_back(v);
+            }
+            sink = sink + static_cast<uintptr_t>(list[r % 16]);
+        }
+    });
+    reportBenchmark("temporary lists pool", poolListTime, lists);
+
+    double regionListTime = bestOf(3, [&] {
+        for (size_t r = 0; r < lists; r++) {
+            RegionScope region;
+            std::vector<int64_t, Allocator<int64_t>> list((Allocator<int64_t>(region)));
+            for (int64_t v = 0; v < 16; v++) {
+                list.push_back(v);
+            }
+            sink = sink + static_cast<uintptr_t>(list[r % 16]);
+        }
+    });
+    reportBenchmark("temporary lists region", regionListTime, lists);
+}
+
+} // namespace Runtime
+} // namespace MYA
+
+#endif // MYA_RUNTIME_ALLOC_H
@@ -0,0 +1,313 @@
+/**
+ * MYA Language - Runtime Lists
+ *
+ * List<T>, the representation of `list<T>`: one contiguous array whose first
+ * few elements are stored inside the list value (small-buffer optimization):
+ * - Up to 32 bytes of elements (4 ints or floats, 32 bools, 1 str) need no
+ *   allocation, so short temporary lists and their copies never reach the
+ *   allocator; the list itself is 64 bytes
+ * - Longer lists move to a block from Allocator<T> (MYARuntimeAlloc.h): the
+ *   thread's pool, or the region of the block that created the list
+ * - Elements stay contiguous, so data() feeds the vectorizer's kernels, and
+ *   list<bool> holds one byte per element (pfor may write neighbours)
+ * - Copies allocate from the pool, never a region; moves take over an
+ *   allocated block when both lists use the same allocator
+ */
+
+#ifndef MYA_RUNTIME_LIST_H
+#define MYA_RUNTIME_LIST_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include "MYARuntimeAlloc.h"
+#include "MYARuntimePrint.h"
+
+namespace MYA {
+namespace Runtime {
+
+/**
+ * List<T> - Contiguous list with inline storage for its first 32 bytes
+ */
+template <typename T>
+class List {
+public:
+    typedef T value_type;
+    typedef Allocator<T> allocator_type;
+    typedef T* iterator;
+    typedef const T* const_iterator;
+
+    static constexpr size_t inlineCapacity = sizeof(T) <= 32 ? 32 / sizeof(T) : 0;
+
+private:
+    // Bounds as pointers, like std::vector: stores to int elements cannot
+    // alias them, so loops keep the bounds in registers
+    T* items;
+    T* last;
+    T* storageEnd;
+    Allocator<T> allocator;
+    typename std::aligned_storage<inlineCapacity ? inlineCapacity * sizeof(T) : 1, alignof(T)>::type buffer;
+
+    T* inlineItems() {
+        return reinterpret_cast<T*>(&buffer);
+    }
+
+    bool isInline() const {
+        return items == reinterpret_cast<const T*>(&buffer);
+    }
+
+    void destroyItems() {
+        for (T* item = items; item != last; item++) {
+            item->~T();
+        }
+        last = items;
+    }
+
+    void releaseBlock() {
+        if (!isInline()) {
+            allocator.deallocate(items, capacity());
+            items = last = inlineItems();
+            storageEnd = items + inlineCapacity;
+        }
+    }
+
+    void becomeEmpty() {
+        items = last = inlineItems();
+        storageEnd = items + inlineCapacity;
+    }
+
+    /**
+     * Move the elements to a block of `capacity` elements
+     */
+    void moveTo(size_t capacity) {
+        size_t count = size();
+        T* block = allocator.allocate(capacity);
+        for (size_t i = 0; i < count; i++) {
+            new (block + i) T(std::move(items[i]));
+            items[i].~T();
+        }
+        releaseBlock();
+        items = block;
+        last = block + count;
+        storageEnd = block + capacity;
+    }
+
+    size_t grownCapacity() const {
+        return capacity() < 4 ? 4 : capacity() * 2;
+    }
+
+    /**
+     * Take `other`'s elements: its block when the allocators agree, else
+     * element-wise into this list's storage
+     */
+    void take(List& other) {
+        if (!other.isInline() && other.allocator == allocator) {
+            items = other.items;
+            last = other.last;
+            storageEnd = other.storageEnd;
+            other.becomeEmpty();
+            return;
+        }
+        reserve(other.size());
+        for (T* item = other.items; item != other.last; item++) {
+            new (last++) T(std::move(*item));
+        }
+        other.destroyItems();
+    }
+
+    void copyFrom(const List& other) {
+        reserve(other.size());
+        last = std::uninitialized_copy(other.items, other.last, items);
+    }
+
+public:
+    List() {
+        becomeEmpty();
+    }
+
+    explicit List(const Allocator<T>& allocator) : allocator(allocator) {
+        becomeEmpty();
+    }
+
+    explicit List(size_t size, const T& value = T(), const Allocator<T>& allocator = Allocator<T>())
+        : allocator(allocator) {
+        becomeEmpty();
+        resize(size, value);
+    }
+
+    List(const List& other) {
+        becomeEmpty();
+        copyFrom(other);
+    }
+
+    List(List&& other) : allocator(other.allocator) {
+        becomeEmpty();
+        take(other);
+    }
+
+    List& operator=(const List& other) {
+        if (this != &other) {
+            destroyItems();
+            copyFrom(other);
+        }
+        return *this;
+    }
+
+    /**
+     * Keeps this list's allocator, like std::vector with a non-propagating one
+     */
+    List& operator=(List&& other) {
+        if (this != &other) {
+            destroyItems();
+            if (!other.isInline() && other.allocator == allocator) {
+                releaseBlock();
+            }
+            take(other);
+        }
+        return *this;
+    }
+
+    ~List() {
+        destroyItems();
+        releaseBlock();
+    }
+
+    size_t size() const {
+        return static_cast<size_t>(last - items);
+    }
+
+    bool empty() const {
+        return last == items;
+    }
+
+    size_t capacity() const {
+        return static_cast<size_t>(storageEnd - items);
+    }
+
+    Allocator<T> get_allocator() const {
+        return allocator;
+    }
+
+    T* data() {
+        return items;
+    }
+
+    const T* data() const {
+        return items;
+    }
+
+    T& operator[](size_t index) {
+        return items[index];
+    }
+
+    const T& operator[](size_t index) const {
+        return items[index];
+    }
+
+    T& back() {
+        return last[-1];
+    }
+
+    iterator begin() {
+        return items;
+    }
+
+    iterator end() {
+        return last;
+    }
+
+    const_iterator begin() const {
+        return items;
+    }
+
+    const_iterator end() const {
+        return last;
+    }
+
+    void reserve(size_t capacity) {
+        if (capacity > this->capacity()) {
+            moveTo(capacity);
+        }
+    }
+
+    void push_back(const T& value) {
+        if (last == storageEnd) {
+            // Construct first: `value` may be an element of this list
+            size_t count = size(), capacity = grownCapacity();
+            T* block = allocator.allocate(capacity);
+            new (block + count) T(value);
+            for (size_t i = 0; i < count; i++) {
+                new (block + i) T(std::move(items[i]));
+                items[i].~T();
+            }
+            releaseBlock();
+            items = block;
+            last = block + count;
+            storageEnd = block + capacity;
+        } else {
+            new (last) T(value);
+        }
+        last++;
+    }
+
+    void push_back(T&& value) {
+        if (last == storageEnd) {
+            T moved(std::move(value));
+            moveTo(grownCapacity());
+            new (last) T(std::move(moved));
+        } else {
+            new (last) T(std::move(value));
+        }
+        last++;
+    }
+
+    void pop_back() {
+        (--last)->~T();
+    }
+
+    void resize(size_t size, const T& value = T()) {
+        reserve(size);
+        while (this->size() < size) {
+            new (last) T(value);
+            last++;
+        }
+        while (this->size() > size) {
+            pop_back();
+        }
+    }
+
+    void clear() {
+        destroyItems();
+    }
+
+    /**
+     * Empty the list and return an allocated block to the pool or region
+     */
+    void reset() {
+        destroyItems();
+        releaseBlock();
+    }
+};
+
+template <typename T>
+constexpr size_t List<T>::inlineCapacity;
+
+template <typename T>
+inline void writeValue(OutputBuffer& out, const List<T>& list) {
+    out.put('[');
+    for (size_t i = 0; i < list.size(); i++) {
+        if (i) {
+            out.write(text(", "));
+        }
+        writeValue(out, list[i]);
+    }
+    out.put(']');
+}
+
+} // namespace Runtime
+} // namespace MYA
+
+#endif // MYA_RUNTIME_LIST_H
@@ -0,0 +1,544 @@
+/**
+ * MYA Language - Runtime Maps
+ *
+ * Map<K, V>, the representation of `map<K, V>`: an open-addressing hash
+ * table in the SwissTable layout:
+ * - One control byte per slot: empty, deleted, or the low 7 bits of the
+ *   key's hash (H2) when full. The high bits (H1) pick the first group.
+ * - Lookups scan a group of 16 control bytes at once with SSE2 (8 with
+ *   plain 64-bit arithmetic elsewhere): one compare yields every slot whose
+ *   H2 matches, so most probes compare one key and touch one cache line
+ * - Groups are probed triangularly; the control array repeats its first
+ *   group after the end so a group can start at any slot
+ * - Slots hold key and value inline and are rehashed at 7/8 load; removal
+ *   leaves a tombstone that the next rehash clears
+ * - Keys are int, float, bool, str, any and tuples of those (Hash<K>)
+ *
+ * Maps are values like lists: copying one copies its table (control bytes
+ * with memcpy, full slots in place, without rehashing).
+ */
+
+#ifndef MYA_RUNTIME_MAP_H
+#define MYA_RUNTIME_MAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <string>
+#include <utility>
+#include "MYARuntimeAlloc.h"
+#include "MYARuntimePrint.h"
+#include "MYARuntimeSimd.h"
+
+namespace MYA {
+namespace Runtime {
+
+// ----- Hashing -----
+
+/**
+ * Finalizer that spreads every input bit over the whole word, so both H1
+ * (high bits) and H2 (low 7 bits) are usable
+ */
+inline uint64_t mixHash(uint64_t x) {
+    x ^= x >> 32;
+    x *= 0xd6e8feb86659fd93ull;
+    x ^= x >> 32;
+    x *= 0xd6e8feb86659fd93ull;
+    x ^= x >> 32;
+    return x;
+}
+
+inline uint64_t hashBytes(const char* bytes, size_t size) {
+    uint64_t hash = 0x9e3779b97f4a7c15ull ^ size;
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t word;
+        std::memcpy(&word, bytes + i, 8);
+        hash = (hash ^ word) * 0xff51afd7ed558ccdull;
+        hash = (hash << 29) | (hash >> 35);
+    }
+    // Fixed-size loads: a memcpy of a variable length is a library call
+    uint64_t tail = 0;
+    size_t left = size - i;
+    if (left >= 4) {
+        uint32_t low, high;
+        std::memcpy(&low, bytes + i, 4);
+        std::memcpy(&high, bytes + i + left - 4, 4);
+        tail = static_cast<uint64_t>(high) << 32 | low;
+    } else if (left) {
+        tail = static_cast<uint64_t>(static_cast<unsigned char>(bytes[i])) << 16 |
+               static_cast<uint64_t>(static_cast<unsigned char>(bytes[i + left / 2])) << 8 |
+               static_cast<unsigned char>(bytes[i + left - 1]);
+    }
+    return mixHash(hash ^ tail);
+}
+
+/**
+ * Hash<K> - Specialized for every key type a map accepts
+ */
+template <typename K>
+struct Hash;
+
+template <>
+struct Hash<int64_t> {
+    uint64_t operator()(int64_t key) const {
+        return mixHash(static_cast<uint64_t>(key));
+    }
+};
+
+template <>
+struct Hash<double> {
+    uint64_t operator()(double key) const {
+        if (key == 0.0) {
+            key = 0.0;  // -0.0 == 0.0
+        }
+        uint64_t bits;
+        std::memcpy(&bits, &key, 8);
+        return mixHash(bits);
+    }
+};
+
+template <>
+struct Hash<bool> {
+    uint64_t operator()(bool key) const {
+        return mixHash(key ? 1 : 2);
+    }
+};
+
+template <>
+struct Hash<std::string> {
+    uint64_t operator()(const std::string& key) const {
+        return hashBytes(key.data(), key.size());
+    }
+};
+
+// ----- Control groups -----
+
+namespace Control {
+
+const int8_t Empty = -128;   // 0b10000000
+const int8_t Deleted = -2;   // 0b11111110; full slots hold H2 in 0..127
+
+inline unsigned lowestBit(uint64_t bits) {
+#if defined(__GNUC__) || defined(__clang__)
+    return static_cast<unsigned>(__builtin_ctzll(bits));
+#else
+    unsigned long index;
+    _BitScanForward64(&index, bits);
+    return static_cast<unsigned>(index);
+#endif
+}
+
+/**
+ * Set of slots within a group; `shift` converts a bit to a slot offset
+ */
+template <unsigned Shift>
+struct GroupMask {
+    uint64_t bits;
+
+    explicit operator bool() const {
+        return bits != 0;
+    }
+
+    size_t lowest() const {
+        return lowestBit(bits) >> Shift;
+    }
+
+    void dropLowest() {
+        bits &= bits - 1;
+    }
+};
+
+#ifdef MYA_RUNTIME_SIMD
+
+/**
+ * 16 control bytes compared with SSE2 (every x86-64 CPU)
+ */
+struct Group {
+    static const size_t width = 16;
+    typedef GroupMask<0> Mask;
+    __m128i bytes;
+
+    explicit Group(const int8_t* control)
+        : bytes(_mm_loadu_si128(reinterpret_cast<const __m128i*>(control))) {}
+
+    Mask match(int8_t h2) const {
+        return Mask{ static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(h2)))) };
+    }
+
+    Mask matchEmpty() const {
+        return match(Empty);
+    }
+
+    /**
+     * Empty or deleted: the only control values with the top bit set
+     */
+    Mask matchFree() const {
+        return Mask{ static_cast<uint32_t>(_mm_movemask_epi8(bytes)) };
+    }
+};
+
+#else
+
+/**
+ * 8 control bytes compared as one 64-bit word (little-endian targets).
+ * match() may report a false positive next to a true match; callers
+ * compare keys anyway.
+ */
+struct Group {
+    static const size_t width = 8;
+    typedef GroupMask<3> Mask;
+    uint64_t bytes;
+
+    static const uint64_t lsbs = 0x0101010101010101ull;
+    static const uint64_t msbs = 0x8080808080808080ull;
+
+    explicit Group(const int8_t* control) {
+        std::memcpy(&bytes, control, 8);
+    }
+
+    Mask match(int8_t h2) const {
+        uint64_t x = bytes ^ (lsbs * static_cast<uint8_t>(h2));
+        return Mask{ (x - lsbs) & ~x & msbs };
+    }
+
+    Mask matchEmpty() const {
+        return Mask{ bytes & ~(bytes << 6) & msbs };  // Bit 1 is clear only in Empty
+    }
+
+    Mask matchFree() const {
+        return Mask{ bytes & msbs };
+    }
+};
+
+#endif
+
+/**
+ * Control bytes of a map without a table; lookups find Empty and stop
+ */
+inline int8_t* emptyGroup() {
+    alignas(16) static int8_t group[Group::width] = {
+        Empty, Empty, Empty, Empty, Empty, Empty, Empty, Empty,
+#ifdef MYA_RUNTIME_SIMD
+        Empty, Empty, Empty, Empty, Empty, Empty, Empty, Empty
+#endif
+    };
+    return group;
+}
+
+} // namespace Control
+
+// ----- Map -----
+
+/**
+ * Map<K, V> - SwissTable-style hash map with values stored in the table
+ */
+template <typename K, typename V>
+class Map {
+public:
+    typedef K key_type;
+    typedef V mapped_type;
+
+    struct Slot {
+        K key;
+        V value;
+    };
+
+private:
+    typedef Control::Group Group;
+    static const size_t notFound = ~static_cast<size_t>(0);
+
+    int8_t* control;    // capacity + Group::width bytes; the last group mirrors the first
+    Slot* slots;
+    size_t capacity;    // 0, or a power of two >= Group::width
+    size_t count;
+    size_t growthLeft;  // Empty slots that may still be filled before a rehash
+
+    static_assert(alignof(Slot) <= 16, "map slots must fit the allocator's 16-byte alignment");
+
+    static size_t maxLoad(size_t capacity) {
+        return capacity - capacity / 8;
+    }
+
+    static size_t capacityFor(size_t size) {
+        size_t capacity = 16;  // At least one group
+        while (maxLoad(capacity) < size) {
+            capacity *= 2;
+        }
+        return capacity;
+    }
+
+    static size_t controlBytes(size_t capacity) {
+        return (capacity + Group::width + 15) / 16 * 16;
+    }
+
+    static int8_t h2(uint64_t hash) {
+        return static_cast<int8_t>(hash & 0x7F);
+    }
+
+    size_t mask() const {
+        return capacity ? capacity - 1 : 0;
+    }
+
+    void setControl(size_t index, int8_t value) {
+        control[index] = value;
+        if (index < Group::width) {
+            control[capacity + index] = value;
+        }
+    }
+
+    void allocateTable(size_t size) {
+        size_t bytes = controlBytes(size) + size * sizeof(Slot);
+        unsigned char* block = Allocator<unsigned char>().allocate(bytes);
+        control = reinterpret_cast<int8_t*>(block);
+        slots = reinterpret_cast<Slot*>(block + controlBytes(size));
+        capacity = size;
+        std::memset(control, static_cast<unsigned char>(Control::Empty), size + Group::width);
+        growthLeft = maxLoad(size);
+    }
+
+    void freeTable() {
+        if (capacity) {
+            Allocator<unsigned char>().deallocate(reinterpret_cast<unsigned char*>(control),
+                                                  controlBytes(capacity) + capacity * sizeof(Slot));
+        }
+        control = Control::emptyGroup();
+        slots = nullptr;
+        capacity = 0;
+        growthLeft = 0;
+    }
+
+    void destroySlots() {
+        for (size_t i = 0; i < capacity; i++) {
+            if (control[i] >= 0) {
+                slots[i].~Slot();
+            }
+        }
+    }
+
+    size_t indexOf(const K& key, uint64_t hash) const {
+        size_t position = (hash >> 7) & mask();
+#if defined(__GNUC__) || defined(__clang__)
+        __builtin_prefetch(slots + position);  // Most hits are in the first group: overlap both misses
+#endif
+        for (size_t step = Group::width;; step += Group::width) {
+            Group group(control + position);
+            for (auto match = group.match(h2(hash)); match; match.dropLowest()) {
+                size_t index = (position + match.lowest()) & mask();
+                if (slots[index].key == key) {
+                    return index;
+                }
+            }
+            if (group.matchEmpty()) {
+                return notFound;
+            }
+            position = (position + step) & mask();
+        }
+    }
+
+    /**
+     * First empty or deleted slot on the probe sequence of `hash`
+     */
+    size_t findFree(uint64_t hash) const {
+        size_t position = (hash >> 7) & mask();
+        for (size_t step = Group::width;; step += Group::width) {
+            auto free = Group(control + position).matchFree();
+            if (free) {
+                return (position + free.lowest()) & mask();
+            }
+            position = (position + step) & mask();
+        }
+    }
+
+    /**
+     * Rebuild the table at `size` slots, dropping tombstones
+     */
+    void rehash(size_t size) {
+        int8_t* oldControl = control;
+        Slot* oldSlots = slots;
+        size_t oldCapacity = capacity;
+        allocateTable(size);
+        for (size_t i = 0; i < oldCapacity; i++) {
+            if (oldControl[i] >= 0) {
+                uint64_t hash = Hash<K>()(oldSlots[i].key);
+                size_t index = findFree(hash);
+                setControl(index, h2(hash));
+                new (slots + index) Slot(std::move(oldSlots[i]));
+                oldSlots[i].~Slot();
+            }
+        }
+        growthLeft -= count;
+        if (oldCapacity) {
+            Allocator<unsigned char>().deallocate(reinterpret_cast<unsigned char*>(oldControl),
+                                                  controlBytes(oldCapacity) + oldCapacity * sizeof(Slot));
+        }
+    }
+
+    void copyFrom(const Map& other) {
+        if (!other.count) {
+            return;
+        }
+        allocateTable(other.capacity);
+        std::memcpy(control, other.control, capacity + Group::width);
+        for (size_t i = 0; i < capacity; i++) {
+            if (control[i] >= 0) {
+                new (slots + i) Slot(other.slots[i]);
+            }
+        }
+        count = other.count;
+        growthLeft = other.growthLeft;
+    }
+
+    void takeFrom(Map& other) {
+        control = other.control;
+        slots = other.slots;
+        capacity = other.capacity;
+        count = other.count;
+        growthLeft = other.growthLeft;
+        other.control = Control::emptyGroup();
+        other.slots = nullptr;
+        other.capacity = other.count = other.growthLeft = 0;
+    }
+
+public:
+    Map() : control(Control::emptyGroup()), slots(nullptr), capacity(0), count(0), growthLeft(0) {}
+
+    Map(const Map& other) : Map() {
+        copyFrom(other);
+    }
+
+    Map(Map&& other) : Map() {
+        takeFrom(other);
+    }
+
+    Map& operator=(const Map& other) {
+        if (this != &other) {
+            clear();
+            freeTable();
+            copyFrom(other);
+        }
+        return *this;
+    }
+
+    Map& operator=(Map&& other) {
+        if (this != &other) {
+            clear();
+            freeTable();
+            takeFrom(other);
+        }
+        return *this;
+    }
+
+    ~Map() {
+        destroySlots();
+        freeTable();
+    }
+
+    size_t size() const {
+        return count;
+    }
+
+    bool empty() const {
+        return count == 0;
+    }
+
+    /**
+     * Room for `size` entries without rehashing
+     */
+    void reserve(size_t size) {
+        if (size > count + growthLeft) {
+            rehash(capacityFor(size));
+        }
+    }
+
+    V* find(const K& key) {
+        size_t index = indexOf(key, Hash<K>()(key));
+        return index == notFound ? nullptr : &slots[index].value;
+    }
+
+    const V* find(const K& key) const {
+        size_t index = indexOf(key, Hash<K>()(key));
+        return index == notFound ? nullptr : &slots[index].value;
+    }
+
+    bool contains(const K& key) const {
+        return indexOf(key, Hash<K>()(key)) != notFound;
+    }
+
+    /**
+     * The value of `key`, inserted as V() when missing
+     */
+    V& operator[](const K& key) {
+        uint64_t hash = Hash<K>()(key);
+        size_t index = indexOf(key, hash);
+        if (index != notFound) {
+            return slots[index].value;
+        }
+        index = findFree(hash);
+        if (growthLeft == 0 && control[index] != Control::Deleted) {
+            rehash(capacityFor(count + 1));  // Grows, or only clears tombstones
+            index = findFree(hash);
+        }
+        if (control[index] == Control::Empty) {
+            growthLeft--;
+        }
+        new (slots + index) Slot{ key, V() };
+        setControl(index, h2(hash));
+        count++;
+        return slots[index].value;
+    }
+
+    bool erase(const K& key) {
+        size_t index = indexOf(key, Hash<K>()(key));
+        if (index == notFound) {
+            return false;
+        }
+        slots[index].~Slot();
+        setControl(index, Control::Deleted);
+        count--;
+        return true;
+    }
+
+    void clear() {
+        if (count) {
+            destroySlots();
+            std::memset(control, static_cast<unsigned char>(Control::Empty), capacity + Group::width);
+            count = 0;
+        }
+        growthLeft = maxLoad(capacity);
+    }
+
+    /**
+     * Call f(key, value) for every entry, in table order
+     */
+    template <typename F>
+    void forEach(F f) const {
+        for (size_t i = 0; i < capacity; i++) {
+            if (control[i] >= 0) {
+                f(slots[i].key, slots[i].value);
+            }
+        }
+    }
+};
+
+template <typename K, typename V>
+inline void writeValue(OutputBuffer& out, const Map<K, V>& map) {
+    out.put('{');
+    bool first = true;
+    map.forEach([&](const K& key, const V& value) {
+        if (!first) {
+            out.write(text(", "));
+        }
+        first = false;
+        writeValue(out, key);
+        out.write(text(": "));
+        writeValue(out, value);
+    });
+    out.put('}');
+}
+
+} // namespace Runtime
+} // namespace MYA
+
+#endif // MYA_RUNTIME_MAP_H
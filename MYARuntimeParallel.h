@@ -0,0 +1,339 @@
+/**
+ * MYA Language - Runtime Parallel Loops
+ *
+ * Scheduler behind `pfor i in range a to b:`. A ThreadPool owns one worker
+ * thread per core (the calling thread is worker 0) and one task deque per
+ * worker. A task is a half-open index range:
+ * - Owners pop from the back of their deque; idle workers steal from the
+ *   front of a random victim's deque
+ * - Adaptive chunking (lazy binary splitting): a worker runs its range one
+ *   grain at a time, and splits off the upper half for thieves only when its
+ *   own deque is empty, so splitting follows actual demand rather than a
+ *   fixed chunk count
+ * - A pfor nested inside another runs sequentially on its worker
+ *
+ * MYA_THREADS overrides the thread count (default: hardware concurrency).
+ * Workers flush their print buffers before reporting a range done, so
+ * output from a pfor body is written before the loop returns. Runtime
+ * errors inside a pfor body terminate the program as usual.
+ */
+
+#ifndef MYA_RUNTIME_PARALLEL_H
+#define MYA_RUNTIME_PARALLEL_H
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "MYABenchmark.h"
+#include "MYARuntimePrint.h"
+
+namespace MYA {
+namespace Runtime {
+
+/**
+ * ThreadPool - Work-stealing workers for parallel loops
+ */
+class ThreadPool {
+private:
+    struct Job {
+        const std::function<void(int64_t, int64_t)>* body;
+        int64_t grain;
+        std::atomic<int64_t> remaining;  // Iterations not yet run
+    };
+
+    struct Task {
+        int64_t lo;
+        int64_t hi;
+        Job* job;
+    };
+
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+        std::atomic<size_t> size{ 0 };
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues;  // [0] belongs to the calling thread
+    std::vector<std::thread> workers;
+    std::mutex stateMutex;
+    std::condition_variable wake;
+    int activeJobs = 0;
+    bool stopping = false;
+    std::mutex callerMutex;  // One top-level loop at a time
+
+    /**
+     * Pool and queue index of the current thread while it runs pool work
+     */
+    struct Current {
+        const ThreadPool* pool;
+        unsigned index;
+    };
+
+    static Current& current() {
+        thread_local Current state{ nullptr, 0 };
+        return state;
+    }
+
+    void push(unsigned index, const Task& task) {
+        Queue& queue = *queues[index];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.tasks.push_back(task);
+        queue.size.store(queue.tasks.size(), std::memory_order_relaxed);
+    }
+
+    bool popOwn(unsigned index, Task& task) {
+        Queue& queue = *queues[index];
+        if (queue.size.load(std::memory_order_relaxed) == 0) {
+            return false;
+        }
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.tasks.empty()) {
+            return false;
+        }
+        task = queue.tasks.back();
+        queue.tasks.pop_back();
+        queue.size.store(queue.tasks.size(), std::memory_order_relaxed);
+        return true;
+    }
+
+    bool steal(unsigned thief, Task& task) {
+        thread_local uint32_t seed = 2463534242u + thief;
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        size_t count = queues.size();
+        for (size_t k = 0; k < count; k++) {
+            size_t victim = (seed + k) % count;
+            if (victim == thief) {
+                continue;
+            }
+            Queue& queue = *queues[victim];
+            if (queue.size.load(std::memory_order_relaxed) == 0) {
+                continue;
+            }
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (!queue.tasks.empty()) {
+                task = queue.tasks.front();
+                queue.tasks.pop_front();
+                queue.size.store(queue.tasks.size(), std::memory_order_relaxed);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool findTask(unsigned index, Task& task) {
+        return popOwn(index, task) || steal(index, task);
+    }
+
+    /**
+     * Run a range one grain at a time, splitting off the upper half
+     * whenever this worker's deque has run dry
+     */
+    void run(unsigned index, Task task) {
+        Job& job = *task.job;
+        int64_t lo = task.lo, hi = task.hi;
+        int64_t done = 0;
+        while (lo < hi) {
+            if (hi - lo > 2 * job.grain && queues[index]->size.load(std::memory_order_relaxed) == 0) {
+                int64_t mid = lo + (hi - lo) / 2;
+                push(index, Task{ mid, hi, &job });
+                wake.notify_one();
+                hi = mid;
+                continue;
+            }
+            int64_t stop = std::min(hi, lo + job.grain);
+            (*job.body)(lo, stop);
+            done += stop - lo;
+            lo = stop;
+        }
+        if (index != 0) {
+            output().flush();
+        }
+        job.remaining.fetch_sub(done, std::memory_order_acq_rel);
+    }
+
+    void workerLoop(unsigned index) {
+        current() = Current{ this, index };
+        for (;;) {
+            Task task;
+            if (findTask(index, task)) {
+                run(index, task);
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(stateMutex);
+            if (stopping) {
+                return;
+            }
+            if (activeJobs > 0) {
+                lock.unlock();
+                std::this_thread::yield();  // A loop is running; keep looking for work
+                continue;
+            }
+            wake.wait(lock, [this] { return stopping || activeJobs > 0; });
+        }
+    }
+
+public:
+    /**
+     * `threads` counts the calling thread; 0 picks MYA_THREADS or the
+     * hardware concurrency
+     */
+    explicit ThreadPool(unsigned threads = 0) {
+        if (threads == 0) {
+            const char* env = std::getenv("MYA_THREADS");
+            threads = env ? static_cast<unsigned>(std::max(1, std::atoi(env))) : std::thread::hardware_concurrency();
+        }
+        threads = std::max(1u, threads);
+        for (unsigned i = 0; i < threads; i++) {
+            queues.emplace_back(new Queue());
+        }
+        for (unsigned i = 1; i < threads; i++) {
+            workers.emplace_back(&ThreadPool::workerLoop, this, i);
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(stateMutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    unsigned size() const {
+        return static_cast<unsigned>(queues.size());
+    }
+
+    /**
+     * Pool used by generated code. Never destroyed: a runtime error may
+     * call exit() from a worker, which must not wait for the other workers.
+     */
+    static ThreadPool& shared() {
+        static ThreadPool* pool = new ThreadPool();
+        return *pool;
+    }
+
+    /**
+     * Call body(lo, hi) on disjoint subranges covering [begin, end) and
+     * return once all of them have finished
+     */
+    void parallelFor(int64_t begin, int64_t end, const std::function<void(int64_t, int64_t)>& body) {
+        if (end <= begin) {
+            return;
+        }
+        int64_t count = end - begin;
+        if (size() == 1 || count == 1 || current().pool) {
+            body(begin, end);  // Single thread, or nested inside a running loop
+            return;
+        }
+        std::lock_guard<std::mutex> callerLock(callerMutex);
+        output().flush();  // Keep earlier prints ahead of the workers' output
+        Job job;
+        job.body = &body;
+        job.grain = std::max<int64_t>(1, count / (static_cast<int64_t>(size()) * 16));
+        job.remaining.store(count, std::memory_order_relaxed);
+
+        current() = Current{ this, 0 };
+        {
+            std::lock_guard<std::mutex> lock(stateMutex);
+            activeJobs++;
+        }
+        wake.notify_all();
+        run(0, Task{ begin, end, &job });
+        while (job.remaining.load(std::memory_order_acquire) > 0) {
+            Task task;
+            if (findTask(0, task)) {
+                run(0, task);
+            } else {
+                std::this_thread::yield();
+            }
+        }
+        {
+            std::lock_guard<std::mutex> lock(stateMutex);
+            activeJobs--;
+        }
+        current() = Current{ nullptr, 0 };
+    }
+};
+
+/**
+ * Lowered `pfor`: body(lo, hi) runs the loop body for lo <= i < hi
+ */
+inline void parallelFor(int64_t begin, int64_t end, const std::function<void(int64_t, int64_t)>& body) {
+    ThreadPool::shared().parallelFor(begin, end, body);
+}
+
+/**
+ * Benchmark: a uniform and an irregular loop (iteration cost grows with
+ * i % 64) on 1, 2, 4, ... threads up to the core count, with speedup
+ * relative to one thread
+ */
+inline void runParallelBenchmark(size_t count) {
+    unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<double> out(count);
+    std::cout << "Parallel benchmark: " << count << " iterations, " << cores << " hardware threads" << std::endl;
+
+    auto uniform = [&](int64_t lo, int64_t hi) {
+        for (int64_t i = lo; i < hi; i++) {
+            double x = static_cast<double>(i);
+            for (int k = 0; k < 64; k++) {
+                x = std::sqrt(x * 0.5 + 1.0);
+            }
+            out[static_cast<size_t>(i)] = x;
+        }
+    };
+    auto irregular = [&](int64_t lo, int64_t hi) {
+        for (int64_t i = lo; i < hi; i++) {
+            double x = static_cast<double>(i);
+            for (int64_t k = 0; k < 2 * (i % 64); k++) {
+                x = std::sqrt(x * 0.5 + 1.0);
+            }
+            out[static_cast<size_t>(i)] = x;
+        }
+    };
+
+    std::vector<unsigned> counts;
+    for (unsigned t = 1; t < cores; t *= 2) {
+        counts.push_back(t);
+    }
+    counts.push_back(cores);
+
+    double uniformBase = 0.0, irregularBase = 0.0;
+    for (unsigned threads : counts) {
+        ThreadPool pool(threads);
+        double u = bestOf(3, [&] { pool.parallelFor(0, static_cast<int64_t>(count), uniform); });
+        double r = bestOf(3, [&] { pool.parallelFor(0, static_cast<int64_t>(count), irregular); });
+        if (threads == 1) {
+            uniformBase = u;
+            irregularBase = r;
+        }
+        std::string suffix = " (" + std::to_string(threads) + " threads)";
+        reportBenchmark("uniform" + suffix, u, count);
+        std::cout << "    speedup " << std::fixed << std::setprecision(2) << uniformBase / u << "x" << std::endl;
+        reportBenchmark("irregular" + suffix, r, count);
+        std::cout << "    speedup " << std::fixed << std::setprecision(2) << irregularBase / r << "x" << std::endl;
+        std::cout.unsetf(std::ios::floatfield);
+    }
+}
+
+} // namespace Runtime
+} // namespace MYA
+
+#endif // MYA_RUNTIME_PARALLEL_H
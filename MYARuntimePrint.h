@@ -0,0 +1,401 @@
+/**
+ * MYA Language - Runtime Output
+ *
+ * Buffered output for `print`. Each thread formats into its own 64 KiB
+ * buffer, which is written to stdout in one call when it fills up, when the
+ * thread exits and when the program ends, instead of one write per print:
+ * - Integers are converted two digits at a time, and floats in fixed
+ *   notation by a locale-free digit loop; the rest (exponent notation,
+ *   near rounding ties) use std::to_chars under C++17, else snprintf
+ * - The code generator folds literal arguments, separators and the newline
+ *   into precomputed Text pieces, so `print "Iteration:", i;` copies one
+ *   constant and converts one integer
+ * - Buffers flush at line boundaries under a lock, so lines printed by
+ *   different threads never interleave (lines over 16 KiB excepted)
+ * - When stdout is a terminal every line is flushed, so interactive output
+ *   still appears as it is printed
+ */
+
+#ifndef MYA_RUNTIME_PRINT_H
+#define MYA_RUNTIME_PRINT_H
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <type_traits>
+#include "MYABenchmark.h"
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+// Floating-point std::to_chars needs C++17 and a recent standard library;
+// otherwise the values OutputBuffer::formatFixed leaves go to snprintf
+#if defined(__has_include) && ((defined(_MSVC_LANG) && _MSVC_LANG >= 201703L) || __cplusplus >= 201703L)
+#if __has_include(<charconv>)
+#include <charconv>
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+#define MYA_RUNTIME_FLOAT_TO_CHARS 1
+#endif
+#endif
+#endif
+
+namespace MYA {
+namespace Runtime {
+
+/**
+ * Constant text with its length known at compile time
+ */
+struct Text {
+    const char* data;
+    size_t size;
+};
+
+template <size_t N>
+constexpr Text text(const char (&literal)[N]) {
+    return Text{ literal, N - 1 };
+}
+
+/**
+ * OutputBuffer - Per-thread formatting buffer in front of a FILE*
+ */
+class OutputBuffer {
+public:
+    static const size_t capacity = 64 * 1024;
+    static const size_t flushAt = 48 * 1024;  // Leaves 16 KiB for the next line
+
+private:
+    FILE* sink;
+    bool lineFlush;
+    size_t used = 0;
+    char data[capacity];
+
+    static std::mutex& sinkMutex() {
+        static std::mutex mutex;
+        return mutex;
+    }
+
+    void writeOut(const char* bytes, size_t size) {
+        std::lock_guard<std::mutex> lock(sinkMutex());
+        std::fwrite(bytes, 1, size, sink);
+        std::fflush(sink);
+    }
+
+public:
+    OutputBuffer(FILE* sink, bool lineFlush) : sink(sink), lineFlush(lineFlush) {}
+
+    ~OutputBuffer() {
+        flush();
+    }
+
+    OutputBuffer(const OutputBuffer&) = delete;
+    OutputBuffer& operator=(const OutputBuffer&) = delete;
+
+    void flush() {
+        if (used) {
+            writeOut(data, used);
+            used = 0;
+        }
+    }
+
+    void write(const char* bytes, size_t size) {
+        if (size > capacity - used) {
+            flush();
+            if (size >= capacity) {
+                writeOut(bytes, size);
+                return;
+            }
+        }
+        std::memcpy(data + used, bytes, size);
+        used += size;
+    }
+
+    void write(Text piece) {
+        write(piece.data, piece.size);
+    }
+
+    void put(char c) {
+        if (used == capacity) {
+            flush();
+        }
+        data[used++] = c;
+    }
+
+    void writeInt(int64_t value) {
+        static const char pairs[] =
+            "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+            "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+            "8081828384858687888990919293949596979899";
+        if (capacity - used < 20) {
+            flush();
+        }
+        uint64_t magnitude = value < 0 ? 0 - static_cast<uint64_t>(value) : static_cast<uint64_t>(value);
+        char digits[20];
+        char* end = digits + sizeof(digits);
+        char* p = end;
+        while (magnitude >= 100) {
+            const char* pair = pairs + (magnitude % 100) * 2;
+            magnitude /= 100;
+            *--p = pair[1];
+            *--p = pair[0];
+        }
+        if (magnitude >= 10) {
+            *--p = pairs[magnitude * 2 + 1];
+            *--p = pairs[magnitude * 2];
+        } else {
+            *--p = static_cast<char>('0' + magnitude);
+        }
+        if (value < 0) {
+            data[used++] = '-';
+        }
+        std::memcpy(data + used, p, static_cast<size_t>(end - p));
+        used += static_cast<size_t>(end - p);
+    }
+
+    /**
+     * %g for values it prints in fixed notation (about 1e-4 <= |value| <
+     * 1e6), without snprintf's locale and format parsing. Returns the
+     * length, or 0 for exponent notation, zero, NaN, infinities and values
+     * within 1e-6 of a rounding tie, which double arithmetic cannot decide
+     */
+    static size_t formatFixed(double value, char* text) {
+        static const double powers[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9 };
+        double magnitude = value < 0 ? -value : value;
+        if (!(magnitude > 0.0 && magnitude < 1e6)) {
+            return 0;
+        }
+        // Scale to six digits before the point: shift = 5 - decimal exponent
+        int shift = 0;
+        double scaled = magnitude;
+        while (scaled < 100000.0) {
+            if (++shift == 10) {
+                return 0;  // Below 1e-4: exponent notation
+            }
+            scaled = magnitude * powers[shift];  // Powers up to 1e9 are exact
+        }
+        double fraction = scaled - static_cast<double>(static_cast<uint32_t>(scaled));
+        if (fraction > 0.5 - 1e-6 && fraction < 0.5 + 1e-6) {
+            return 0;
+        }
+        uint32_t digits = static_cast<uint32_t>(scaled + 0.5);
+        if (digits == 1000000) {
+            if (--shift < 0) {
+                return 0;  // Rounds to 1e+06
+            }
+            digits = 100000;
+        }
+        char six[6];
+        for (int i = 5; i >= 0; i--) {
+            six[i] = static_cast<char>('0' + digits % 10);
+            digits /= 10;
+        }
+        int last = 5;
+        while (last > 0 && six[last] == '0') {
+            last--;  // %g drops trailing zeros
+        }
+        int exponent = 5 - shift;
+        char* p = text;
+        if (value < 0) {
+            *p++ = '-';
+        }
+        if (exponent < 0) {
+            *p++ = '0';
+            *p++ = '.';
+            for (int i = -1; i > exponent; i--) {
+                *p++ = '0';
+            }
+            std::memcpy(p, six, static_cast<size_t>(last + 1));
+            p += last + 1;
+        } else {
+            std::memcpy(p, six, static_cast<size_t>(exponent + 1));
+            p += exponent + 1;
+            if (last > exponent) {
+                *p++ = '.';
+                std::memcpy(p, six + exponent + 1, static_cast<size_t>(last - exponent));
+                p += last - exponent;
+            }
+        }
+        return static_cast<size_t>(p - text);
+    }
+
+    /**
+     * Same text as `std::cout << value` (%g, six significant digits)
+     */
+    void writeFloat(double value) {
+        if (capacity - used < 32) {
+            flush();
+        }
+        size_t length = formatFixed(value, data + used);
+        if (length) {
+            used += length;
+            return;
+        }
+#ifdef MYA_RUNTIME_FLOAT_TO_CHARS
+        used = static_cast<size_t>(
+            std::to_chars(data + used, data + capacity, value, std::chars_format::general, 6).ptr - data);
+#else
+        used += static_cast<size_t>(std::snprintf(data + used, 32, "%g", value));
+#endif
+    }
+
+    /**
+     * Called after the newline of each print
+     */
+    void endLine() {
+        if (lineFlush || used >= flushAt) {
+            flush();
+        }
+    }
+};
+
+inline bool isTerminal(FILE* file) {
+#ifdef _WIN32
+    return _isatty(_fileno(file)) != 0;
+#else
+    return isatty(fileno(file)) != 0;
+#endif
+}
+
+/**
+ * The calling thread's stdout buffer; flushed by its destructor when the
+ * thread exits or the program returns from main / calls exit()
+ */
+inline OutputBuffer& output() {
+    static const bool terminal = isTerminal(stdout);
+    thread_local OutputBuffer buffer(stdout, terminal);
+    return buffer;
+}
+
+// ----- Formatting -----
+
+template <typename T>
+inline typename std::enable_if<std::is_integral<T>::value && !std::is_same<T, bool>::value>::type
+writeValue(OutputBuffer& out, T value) {
+    out.writeInt(static_cast<int64_t>(value));
+}
+
+inline void writeValue(OutputBuffer& out, double value) {
+    out.writeFloat(value);
+}
+
+inline void writeValue(OutputBuffer& out, bool value) {
+    out.write(value ? text("true") : text("false"));
+}
+
+inline void writeValue(OutputBuffer& out, const std::string& value) {
+    out.write(value.data(), value.size());
+}
+
+inline void writeValue(OutputBuffer& out, const char* value) {
+    out.write(value, std::strlen(value));
+}
+
+inline void writeValue(OutputBuffer& out, Text value) {
+    out.write(value);
+}
+
+/**
+ * Lowered `print`: the pieces already include separators and the trailing
+ * newline, e.g. printParts(text("Iteration: "), i, text("\n"))
+ */
+template <typename... Parts>
+inline void printParts(const Parts&... parts) {
+    OutputBuffer& out = output();
+    int expand[] = { 0, (writeValue(out, parts), 0)... };
+    (void)expand;
+    out.endLine();
+}
+
+/**
+ * `print a, b, c;` writes the values separated by spaces and a newline
+ */
+template <typename First, typename... Rest>
+inline void print(const First& first, const Rest&... rest) {
+    OutputBuffer& out = output();
+    writeValue(out, first);
+    int expand[] = { 0, (out.put(' '), writeValue(out, rest), 0)... };
+    (void)expand;
+    out.put('\n');
+    out.endLine();
+}
+
+inline void print() {
+    output().put('\n');
+    output().endLine();
+}
+
+inline void flush() {
+    output().flush();
+}
+
+/**
+ * Benchmark: log-style lines ("Iteration: <i> value: <x>") through
+ * printf, iostream and the runtime buffer, written to the null device
+ */
+inline void runPrintBenchmark(size_t count) {
+#ifdef _WIN32
+    const char* nullDevice = "NUL";
+#else
+    const char* nullDevice = "/dev/null";
+#endif
+    FILE* sink = std::fopen(nullDevice, "wb");
+    if (!sink) {
+        std::cerr << "Print benchmark: cannot open " << nullDevice << std::endl;
+        return;
+    }
+    std::cout << "Print benchmark: " << count << " lines" << std::endl;
+
+    double printfTime = bestOf(3, [&] {
+        for (size_t i = 0; i < count; i++) {
+            std::fprintf(sink, "Iteration: %lld value: %g\n", static_cast<long long>(i), i * 0.25);
+        }
+        std::fflush(sink);
+    });
+    reportBenchmark("fprintf", printfTime, count);
+
+    // The previous runtime printed through std::cout synchronized with stdio,
+    // which hands every character to the C library; modelled with a streambuf
+    // that calls fputc/fwrite, since std::cout itself cannot target /dev/null
+    struct StdioBuf : std::streambuf {
+        FILE* file;
+        explicit StdioBuf(FILE* file) : file(file) {}
+        int overflow(int c) override {
+            return c == EOF ? 0 : std::fputc(c, file);
+        }
+        std::streamsize xsputn(const char* s, std::streamsize n) override {
+            return static_cast<std::streamsize>(std::fwrite(s, 1, static_cast<size_t>(n), file));
+        }
+    } stdioBuf(sink);
+    std::ostream stream(&stdioBuf);
+    double streamTime = bestOf(3, [&] {
+        for (size_t i = 0; i < count; i++) {
+            stream << "Iteration:" << ' ' << static_cast<int64_t>(i) << ' ' << "value:" << ' ' << i * 0.25 << '\n';
+        }
+        stream.flush();
+    });
+    reportBenchmark("ostream over fputc streambuf", streamTime, count);
+
+    OutputBuffer buffer(sink, false);
+    double bufferTime = bestOf(3, [&] {
+        for (size_t i = 0; i < count; i++) {
+            writeValue(buffer, text("Iteration: "));
+            buffer.writeInt(static_cast<int64_t>(i));
+            writeValue(buffer, text(" value: "));
+            buffer.writeFloat(i * 0.25);
+            buffer.put('\n');
+            buffer.endLine();
+        }
+        buffer.flush();
+    });
+    reportBenchmark("runtime buffer", bufferTime, count);
+    std::fclose(sink);
+}
+
+} // namespace Runtime
+} // namespace MYA
+
+#endif // MYA_RUNTIME_PRINT_H
@@ -0,0 +1,284 @@
+/**
+ * MYA Language - Runtime Profile Counters
+ *
+ * Counters for programs compiled with --instrument. The code generator
+ * numbers every function, `if`, `filter` and counted loop (a site) and emits
+ * a table of (kind, line) pairs; the program counts into it and writes a
+ * profile when it exits, which --profile-use feeds back into the optimizer
+ * (MYAProfileGuidedOptimizer.h):
+ * - Every site has two counters: calls / executions / loop entries, and
+ *   branches taken / filter passes / loop iterations
+ * - Each thread counts into its own block, so pfor bodies and tasks count
+ *   without atomics; blocks are summed when the profile is written
+ * - The profile goes to MYA_PROFILE_FILE or the name given at compile time;
+ *   runs of the same program add to an existing profile, so a profile can
+ *   be collected over many runs (delete the file to start over)
+ *
+ * Profile file, little-endian:
+ *     "MYAPROF1", u64 site table hash, u64 runs, u32 sites,
+ *     then per site: u8 kind, u32 line, u64 count, u64 taken
+ */
+
+#ifndef MYA_RUNTIME_PROFILE_H
+#define MYA_RUNTIME_PROFILE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace MYA {
+namespace Runtime {
+
+/**
+ * Counted site: kind (see ProfileSiteKind in MYAAST.h) and source line
+ */
+struct ProfileSite {
+    uint8_t kind;
+    uint32_t line;
+};
+
+/**
+ * Counts of one site in a profile file
+ */
+struct ProfileRecord {
+    uint8_t kind;
+    uint32_t line;
+    uint64_t count;  // Calls, executions or loop entries
+    uint64_t taken;  // Branches taken, filter passes or loop iterations
+};
+
+/**
+ * A profile file: its records in site table order
+ */
+struct ProfileFile {
+    uint64_t hash = 0;
+    uint64_t runs = 0;
+    std::vector<ProfileRecord> records;
+};
+
+/**
+ * FNV-1a over the site table; a profile only merges into (and is only
+ * trusted by) a program with the same sites
+ */
+inline uint64_t profileSiteHash(const ProfileSite* sites, size_t count) {
+    uint64_t hash = 14695981039346656037ull;
+    auto mix = [&hash](uint32_t value, int bytes) {
+        for (int i = 0; i < bytes; i++) {
+            hash = (hash ^ ((value >> (8 * i)) & 0xFF)) * 1099511628211ull;
+        }
+    };
+    for (size_t i = 0; i < count; i++) {
+        mix(sites[i].kind, 1);
+        mix(sites[i].line, 4);
+    }
+    return hash;
+}
+
+namespace ProfileFormat {
+
+static const char magic[8] = { 'M', 'Y', 'A', 'P', 'R', 'O', 'F', '1' };
+
+inline void put(std::string& out, uint64_t value, int bytes) {
+    for (int i = 0; i < bytes; i++) {
+        out += static_cast<char>((value >> (8 * i)) & 0xFF);
+    }
+}
+
+inline uint64_t get(const unsigned char*& in, int bytes) {
+    uint64_t value = 0;
+    for (int i = 0; i < bytes; i++) {
+        value |= static_cast<uint64_t>(*in++) << (8 * i);
+    }
+    return value;
+}
+
+} // namespace ProfileFormat
+
+/**
+ * Read a profile file; false if it is missing or malformed
+ */
+inline bool readProfileFile(const std::string& path, ProfileFile& profile) {
+    FILE* file = std::fopen(path.c_str(), "rb");
+    if (!file) {
+        return false;
+    }
+    std::string data;
+    char chunk[4096];
+    for (size_t n; (n = std::fread(chunk, 1, sizeof(chunk), file)) > 0;) {
+        data.append(chunk, n);
+    }
+    std::fclose(file);
+
+    const size_t header = 8 + 8 + 8 + 4, record = 1 + 4 + 8 + 8;
+    if (data.size() < header || std::memcmp(data.data(), ProfileFormat::magic, 8) != 0) {
+        return false;
+    }
+    const unsigned char* in = reinterpret_cast<const unsigned char*>(data.data()) + 8;
+    profile.hash = ProfileFormat::get(in, 8);
+    profile.runs = ProfileFormat::get(in, 8);
+    size_t count = static_cast<size_t>(ProfileFormat::get(in, 4));
+    if (data.size() != header + count * record) {
+        return false;
+    }
+    profile.records.resize(count);
+    for (auto& entry : profile.records) {
+        entry.kind = static_cast<uint8_t>(ProfileFormat::get(in, 1));
+        entry.line = static_cast<uint32_t>(ProfileFormat::get(in, 4));
+        entry.count = ProfileFormat::get(in, 8);
+        entry.taken = ProfileFormat::get(in, 8);
+    }
+    return true;
+}
+
+inline bool writeProfileFile(const std::string& path, const ProfileFile& profile) {
+    std::string data(ProfileFormat::magic, 8);
+    ProfileFormat::put(data, profile.hash, 8);
+    ProfileFormat::put(data, profile.runs, 8);
+    ProfileFormat::put(data, profile.records.size(), 4);
+    for (const auto& entry : profile.records) {
+        ProfileFormat::put(data, entry.kind, 1);
+        ProfileFormat::put(data, entry.line, 4);
+        ProfileFormat::put(data, entry.count, 8);
+        ProfileFormat::put(data, entry.taken, 8);
+    }
+    FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file) {
+        return false;
+    }
+    bool written = std::fwrite(data.data(), 1, data.size(), file) == data.size();
+    return std::fclose(file) == 0 && written;
+}
+
+/**
+ * Profiler - Site table, per-thread counter blocks and the exit hook
+ */
+class Profiler {
+private:
+    const ProfileSite* sites = nullptr;
+    size_t siteCount = 0;
+    std::string path;
+    std::mutex mutex;
+    std::vector<std::unique_ptr<uint64_t[]>> blocks;  // Kept after their thread exits
+
+    static void writeAtExit() {
+        instance().write();
+    }
+
+public:
+    static Profiler& instance() {
+        static Profiler* profiler = new Profiler();  // Outlives every thread's counters
+        return *profiler;
+    }
+
+    /**
+     * Called first thing in main() of an instrumented program; with an
+     * empty `defaultPath` the counts are never written (benchmarks)
+     */
+    void start(const ProfileSite* table, size_t count, const char* defaultPath) {
+        sites = table;
+        siteCount = count;
+        if (!*defaultPath) {
+            return;
+        }
+        const char* configured = std::getenv("MYA_PROFILE_FILE");
+        path = configured && *configured ? configured : defaultPath;
+        std::atexit(writeAtExit);
+    }
+
+    /**
+     * A zeroed block of two counters per site for the calling thread
+     */
+    uint64_t* attach() {
+        std::lock_guard<std::mutex> lock(mutex);
+        blocks.emplace_back(new uint64_t[2 * siteCount + 2]());  // Never empty, even without sites
+        return blocks.back().get();
+    }
+
+    /**
+     * Sum the blocks and add them to the profile file (replacing a profile
+     * of a different program)
+     */
+    void write() {
+        std::lock_guard<std::mutex> lock(mutex);
+        ProfileFile profile;
+        uint64_t hash = profileSiteHash(sites, siteCount);
+        if (!readProfileFile(path, profile) || profile.hash != hash || profile.records.size() != siteCount) {
+            profile = ProfileFile();
+            profile.hash = hash;
+            profile.records.resize(siteCount);
+            for (size_t i = 0; i < siteCount; i++) {
+                profile.records[i] = ProfileRecord{ sites[i].kind, sites[i].line, 0, 0 };
+            }
+        }
+        profile.runs++;
+        for (const auto& block : blocks) {
+            for (size_t i = 0; i < siteCount; i++) {
+                profile.records[i].count += block[2 * i];
+                profile.records[i].taken += block[2 * i + 1];
+            }
+        }
+        if (!writeProfileFile(path, profile)) {
+            std::fprintf(stderr, "MYA profile: could not write %s\n", path.c_str());
+        }
+    }
+};
+
+/**
+ * The calling thread's counter block
+ */
+inline uint64_t* profileCounters() {
+    static thread_local uint64_t* counters = nullptr;
+    if (!counters) {
+        counters = Profiler::instance().attach();
+    }
+    return counters;
+}
+
+inline void startProfile(const ProfileSite* sites, size_t count, const char* defaultPath) {
+    Profiler::instance().start(sites, count, defaultPath);
+}
+
+/**
+ * Function entry
+ */
+inline void profileCall(size_t site) {
+    profileCounters()[2 * site]++;
+}
+
+/**
+ * `if` / `filter` condition: counts the execution and whether it was taken
+ */
+inline bool profileBranch(size_t site, bool taken) {
+    uint64_t* counters = profileCounters();
+    counters[2 * site]++;
+    counters[2 * site + 1] += taken ? 1 : 0;
+    return taken;
+}
+
+/**
+ * Loop entry with a trip count known up front (vectorized and parallel
+ * loops); other loops pass 0 and count iterations with profileIteration
+ */
+inline void profileLoop(size_t site, int64_t trips) {
+    uint64_t* counters = profileCounters();
+    counters[2 * site]++;
+    counters[2 * site + 1] += trips > 0 ? static_cast<uint64_t>(trips) : 0;
+}
+
+/**
+ * Loop condition: counts an iteration when it holds
+ */
+inline bool profileIteration(size_t site, bool more) {
+    profileCounters()[2 * site + 1] += more ? 1 : 0;
+    return more;
+}
+
+} // namespace Runtime
+} // namespace MYA
+
+#endif // MYA_RUNTIME_PROFILE_H
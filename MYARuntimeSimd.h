@@ -0,0 +1,147 @@
+/**
+ * MYA Language - Runtime SIMD Support
+ *
+ * Vector types used by loops that the loop vectorizer (MYALoopVectorizer.h)
+ * turned into SIMD kernels, and the CPU feature check that picks a kernel:
+ * - F64x2 / I64x2: SSE2, available on every x86-64 CPU
+ * - F64x4 / I64x4: AVX2, used only when cpuHasAVX2() reports support
+ *
+ * AVX2 code is compiled per function with MYA_TARGET_AVX2, so the same binary
+ * runs on machines without AVX2. On non-x86 targets MYA_RUNTIME_SIMD is left
+ * undefined and generated code keeps its scalar loops.
+ */
+
+#ifndef MYA_RUNTIME_SIMD_H
+#define MYA_RUNTIME_SIMD_H
+
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define MYA_RUNTIME_SIMD 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(MYA_RUNTIME_SIMD) && (defined(__GNUC__) || defined(__clang__))
+#define MYA_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define MYA_TARGET_AVX2
+#endif
+
+namespace MYA {
+namespace Runtime {
+
+#ifdef MYA_RUNTIME_SIMD
+
+/**
+ * Whether the CPU and OS support AVX2 (checked once, then cached)
+ */
+inline bool cpuHasAVX2() {
+#if defined(__GNUC__) || defined(__clang__)
+    static const bool supported = __builtin_cpu_supports("avx2") != 0;
+#else
+    static const bool supported = [] {
+        int info[4];
+        __cpuid(info, 0);
+        if (info[0] < 7) {
+            return false;
+        }
+        __cpuid(info, 1);
+        bool osxsave = (info[2] & (1 << 27)) != 0;
+        bool avx = (info[2] & (1 << 28)) != 0;
+        if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6) {
+            return false;  // OS does not save YMM state
+        }
+        __cpuidex(info, 7, 0);
+        return (info[1] & (1 << 5)) != 0;
+    }();
+#endif
+    return supported;
+}
+
+// ----- SSE2: two lanes -----
+
+struct F64x2 {
+    static const int width = 2;
+    __m128d v;
+
+    static F64x2 zero() { return F64x2{ _mm_setzero_pd() }; }
+    static F64x2 splat(double x) { return F64x2{ _mm_set1_pd(x) }; }
+    static F64x2 load(const double* p) { return F64x2{ _mm_loadu_pd(p) }; }
+    void store(double* p) const { _mm_storeu_pd(p, v); }
+
+    double sum() const {
+        return _mm_cvtsd_f64(_mm_add_sd(v, _mm_unpackhi_pd(v, v)));
+    }
+};
+
+inline F64x2 operator+(F64x2 a, F64x2 b) { return F64x2{ _mm_add_pd(a.v, b.v) }; }
+inline F64x2 operator-(F64x2 a, F64x2 b) { return F64x2{ _mm_sub_pd(a.v, b.v) }; }
+inline F64x2 operator*(F64x2 a, F64x2 b) { return F64x2{ _mm_mul_pd(a.v, b.v) }; }
+inline F64x2 operator/(F64x2 a, F64x2 b) { return F64x2{ _mm_div_pd(a.v, b.v) }; }
+
+struct I64x2 {
+    static const int width = 2;
+    __m128i v;
+
+    static I64x2 zero() { return I64x2{ _mm_setzero_si128() }; }
+    static I64x2 splat(int64_t x) { return I64x2{ _mm_set1_epi64x(x) }; }
+    static I64x2 load(const int64_t* p) { return I64x2{ _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)) }; }
+    void store(int64_t* p) const { _mm_storeu_si128(reinterpret_cast<__m128i*>(p), v); }
+
+    int64_t sum() const {
+        return _mm_cvtsi128_si64(_mm_add_epi64(v, _mm_unpackhi_epi64(v, v)));
+    }
+};
+
+inline I64x2 operator+(I64x2 a, I64x2 b) { return I64x2{ _mm_add_epi64(a.v, b.v) }; }
+inline I64x2 operator-(I64x2 a, I64x2 b) { return I64x2{ _mm_sub_epi64(a.v, b.v) }; }
+
+// ----- AVX2: four lanes -----
+
+struct F64x4 {
+    static const int width = 4;
+    __m256d v;
+
+    MYA_TARGET_AVX2 static F64x4 zero() { return F64x4{ _mm256_setzero_pd() }; }
+    MYA_TARGET_AVX2 static F64x4 splat(double x) { return F64x4{ _mm256_set1_pd(x) }; }
+    MYA_TARGET_AVX2 static F64x4 load(const double* p) { return F64x4{ _mm256_loadu_pd(p) }; }
+    MYA_TARGET_AVX2 void store(double* p) const { _mm256_storeu_pd(p, v); }
+
+    MYA_TARGET_AVX2 double sum() const {
+        __m128d half = _mm_add_pd(_mm256_castpd256_pd128(v), _mm256_extractf128_pd(v, 1));
+        return _mm_cvtsd_f64(_mm_add_sd(half, _mm_unpackhi_pd(half, half)));
+    }
+};
+
+MYA_TARGET_AVX2 inline F64x4 operator+(F64x4 a, F64x4 b) { return F64x4{ _mm256_add_pd(a.v, b.v) }; }
+MYA_TARGET_AVX2 inline F64x4 operator-(F64x4 a, F64x4 b) { return F64x4{ _mm256_sub_pd(a.v, b.v) }; }
+MYA_TARGET_AVX2 inline F64x4 operator*(F64x4 a, F64x4 b) { return F64x4{ _mm256_mul_pd(a.v, b.v) }; }
+MYA_TARGET_AVX2 inline F64x4 operator/(F64x4 a, F64x4 b) { return F64x4{ _mm256_div_pd(a.v, b.v) }; }
+
+struct I64x4 {
+    static const int width = 4;
+    __m256i v;
+
+    MYA_TARGET_AVX2 static I64x4 zero() { return I64x4{ _mm256_setzero_si256() }; }
+    MYA_TARGET_AVX2 static I64x4 splat(int64_t x) { return I64x4{ _mm256_set1_epi64x(x) }; }
+    MYA_TARGET_AVX2 static I64x4 load(const int64_t* p) { return I64x4{ _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)) }; }
+    MYA_TARGET_AVX2 void store(int64_t* p) const { _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), v); }
+
+    MYA_TARGET_AVX2 int64_t sum() const {
+        __m128i half = _mm_add_epi64(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+        return _mm_cvtsi128_si64(_mm_add_epi64(half, _mm_unpackhi_epi64(half, half)));
+    }
+};
+
+MYA_TARGET_AVX2 inline I64x4 operator+(I64x4 a, I64x4 b) { return I64x4{ _mm256_add_epi64(a.v, b.v) }; }
+MYA_TARGET_AVX2 inline I64x4 operator-(I64x4 a, I64x4 b) { return I64x4{ _mm256_sub_epi64(a.v, b.v) }; }
+
+#endif // MYA_RUNTIME_SIMD
+
+} // namespace Runtime
+} // namespace MYA
+
+#endif // MYA_RUNTIME_SIMD_H
@@ -0,0 +1,932 @@
+/**
+ * MYA Language - Runtime Tasks and Channels
+ *
+ * Support for `spawn f(args)`, `await t` and `chan<T>` channels:
+ * - A spawned function is compiled to a stackless coroutine: a frame object
+ *   holding its parameters and locals, whose resume() is a switch over the
+ *   points where it may wait (MYACodegen.h). A parked task costs its frame,
+ *   typically under 200 bytes, so hundreds of thousands can be live at once
+ * - An M:N scheduler runs frames on one worker thread per core, each with
+ *   its own run queue; idle workers steal from the others, then sleep
+ * - Channels are bounded lock-free MPMC ring buffers (Vyukov's sequence
+ *   numbered cells). Only a task that finds a channel full or empty takes
+ *   the small lock of the channel's wait list to park itself
+ * - Main and top-level code are not coroutines: when they block on a
+ *   channel or task they run queued tasks on their own thread meanwhile,
+ *   and report a deadlock when nothing else can run
+ *
+ * MYA_THREADS overrides the worker count (default: hardware concurrency).
+ * Tasks still running when Main returns are abandoned, as in Go. Channel
+ * operations, spawn and await flush the calling thread's print buffer, so
+ * output follows the order the tasks communicate in.
+ */
+
+#ifndef MYA_RUNTIME_TASK_H
+#define MYA_RUNTIME_TASK_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "MYABenchmark.h"
+#include "MYARuntimePrint.h"
+
+namespace MYA {
+namespace Runtime {
+
+[[noreturn]] inline void fail(int line, const std::string& message);  // MYARuntime.h
+
+/**
+ * Result of resuming a coroutine
+ */
+enum class Step {
+    Done,
+    Blocked  // Registered on a wait list; resumed at the same point when woken
+};
+
+class Coroutine;
+
+/**
+ * SpinLock - Guards wait lists, which are held for a few instructions
+ */
+class SpinLock {
+private:
+    std::atomic<bool> locked{ false };
+
+public:
+    void lock() {
+        while (locked.exchange(true, std::memory_order_acquire)) {
+            while (locked.load(std::memory_order_relaxed)) {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    void unlock() {
+        locked.store(false, std::memory_order_release);
+    }
+};
+
+/**
+ * WaitList - Tasks parked until a channel or task changes state, linked
+ * through the tasks themselves (a task waits on one list at a time)
+ */
+class WaitList {
+private:
+    SpinLock mutex;
+    Coroutine* first = nullptr;
+    Coroutine* last = nullptr;
+    std::atomic<size_t> count{ 0 };
+
+    Coroutine* popFirst();
+
+public:
+    ~WaitList();
+
+    /**
+     * Register `task`; the caller must retry its operation afterwards, since
+     * the state may have changed before registration
+     */
+    void add(Coroutine* task);
+
+    /**
+     * Undo add() after the retry succeeded. If a waker already took `task`
+     * off the list, its wake-up is passed on to the next waiter.
+     */
+    void remove(Coroutine* task);
+
+    void wakeOne();
+    void wakeAll();
+};
+
+/**
+ * Coroutine - Frame of a spawned function (generated code derives from
+ * TaskFrame<T>)
+ */
+class Coroutine {
+private:
+    friend class Scheduler;
+    friend class WaitList;
+
+    enum RunState { Running, Parked, Notified };
+
+    std::atomic<int> refs{ 1 };  // The scheduler's reference
+    std::atomic<int> runState{ Running };
+    std::atomic<bool> done{ false };
+    Coroutine* nextWaiter = nullptr;
+
+public:
+    int mya_state = 0;  // Resume point
+    WaitList completion;
+
+    Coroutine() {}
+    Coroutine(const Coroutine&) = delete;
+    Coroutine& operator=(const Coroutine&) = delete;
+    virtual ~Coroutine() {}
+
+    virtual Step resume() = 0;
+
+    void retain() {
+        refs.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void drop() {
+        if (refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            delete this;
+        }
+    }
+
+    bool finished() const {
+        return done.load(std::memory_order_acquire);
+    }
+};
+
+template <typename T>
+class TaskFrame : public Coroutine {
+public:
+    using Result = T;
+    T mya_result{};
+};
+
+template <>
+class TaskFrame<void> : public Coroutine {
+public:
+    using Result = void;
+};
+
+/**
+ * Scheduler - Worker threads with per-core run queues
+ */
+class Scheduler {
+private:
+    struct RunQueue {
+        std::mutex mutex;
+        std::deque<Coroutine*> tasks;
+        std::atomic<size_t> size{ 0 };
+    };
+
+    std::vector<std::unique_ptr<RunQueue>> queues;  // [0]: Main and other threads outside the pool
+    std::vector<std::thread> workers;
+    std::atomic<size_t> runnable{ 0 };  // Queued tasks
+    std::atomic<size_t> running{ 0 };   // Threads looking for or running a task
+    std::atomic<int> sleepers{ 0 };
+    std::mutex sleepMutex;
+    std::condition_variable wake;
+
+    static unsigned& currentIndex() {
+        thread_local unsigned index = 0;
+        return index;
+    }
+
+    void push(unsigned index, Coroutine* task) {
+        RunQueue& queue = *queues[index];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.tasks.push_back(task);
+        queue.size.store(queue.tasks.size(), std::memory_order_relaxed);
+    }
+
+    bool pop(unsigned index, Coroutine*& task) {
+        size_t count = queues.size();
+        for (size_t k = 0; k < count; k++) {
+            size_t victim = (index + k) % count;
+            RunQueue& queue = *queues[victim];
+            if (queue.size.load(std::memory_order_relaxed) == 0) {
+                continue;
+            }
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (queue.tasks.empty()) {
+                continue;
+            }
+            if (k == 0) {
+                task = queue.tasks.front();  // Own queue in FIFO order
+                queue.tasks.pop_front();
+            } else {
+                task = queue.tasks.back();  // Steal the newest task
+                queue.tasks.pop_back();
+            }
+            queue.size.store(queue.tasks.size(), std::memory_order_relaxed);
+            runnable.fetch_sub(1);
+            return true;
+        }
+        return false;
+    }
+
+    void run(Coroutine* task) {
+        Step step = task->resume();
+        output().flush();
+        if (step == Step::Done) {
+            task->done.store(true, std::memory_order_release);
+            task->completion.wakeAll();
+            task->drop();
+            return;
+        }
+        int expected = Coroutine::Running;
+        if (!task->runState.compare_exchange_strong(expected, Coroutine::Parked)) {
+            task->runState.store(Coroutine::Running);  // Woken while it was running
+            schedule(task);
+        }
+    }
+
+    void workerLoop(unsigned index) {
+        currentIndex() = index;
+        for (;;) {
+            if (runOne()) {
+                continue;
+            }
+            for (int spin = 0; spin < 64 && runnable.load() == 0; spin++) {
+                std::this_thread::yield();
+            }
+            if (runnable.load() > 0) {
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(sleepMutex);
+            sleepers.fetch_add(1);
+            wake.wait(lock, [this] { return runnable.load() > 0; });
+            sleepers.fetch_sub(1);
+        }
+    }
+
+    explicit Scheduler(unsigned threads) {
+        queues.emplace_back(new RunQueue());
+        for (unsigned i = 0; i < threads; i++) {
+            queues.emplace_back(new RunQueue());
+        }
+        for (unsigned i = 1; i <= threads; i++) {
+            workers.emplace_back(&Scheduler::workerLoop, this, i);
+        }
+    }
+
+public:
+    /**
+     * Started on first use and never destroyed: workers may still be
+     * running abandoned tasks when the program exits
+     */
+    static Scheduler& instance() {
+        static Scheduler* scheduler = [] {
+            const char* env = std::getenv("MYA_THREADS");
+            unsigned threads = env ? static_cast<unsigned>(std::max(1, std::atoi(env)))
+                                   : std::max(1u, std::thread::hardware_concurrency());
+            return new Scheduler(threads);
+        }();
+        return *scheduler;
+    }
+
+    /**
+     * Queue a runnable task on the calling thread's run queue
+     */
+    void schedule(Coroutine* task) {
+        runnable.fetch_add(1);
+        push(currentIndex(), task);
+        if (sleepers.load() > 0) {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            wake.notify_one();
+        }
+    }
+
+    /**
+     * Make a parked task runnable again; a task that is still running
+     * retries its operation once instead of parking
+     */
+    void wakeUp(Coroutine* task) {
+        int state = task->runState.load();
+        for (;;) {
+            if (state == Coroutine::Parked) {
+                if (task->runState.compare_exchange_weak(state, Coroutine::Running)) {
+                    schedule(task);
+                    return;
+                }
+            } else if (state == Coroutine::Running) {
+                if (task->runState.compare_exchange_weak(state, Coroutine::Notified)) {
+                    return;
+                }
+            } else {
+                return;
+            }
+        }
+    }
+
+    /**
+     * Run one queued task on the calling thread; false if none was found
+     */
+    bool runOne() {
+        running.fetch_add(1);
+        Coroutine* task;
+        bool found = pop(currentIndex(), task);
+        if (found) {
+            run(task);
+        }
+        running.fetch_sub(1);
+        return found;
+    }
+
+    /**
+     * Block a thread outside the pool (Main) until ready() holds, running
+     * queued tasks meanwhile. ready() may be a channel operation that
+     * completes when it returns true, so it is not called again after that.
+     */
+    template <typename Ready>
+    void waitUntil(Ready ready, const char* what, int line) {
+        output().flush();
+        for (;;) {
+            if (ready()) {
+                return;
+            }
+            if (runOne()) {
+                continue;
+            }
+            if (runnable.load() == 0 && running.load() == 0) {
+                if (ready()) {
+                    return;
+                }
+                fail(line, std::string("deadlock: Main is blocked ") + what + " and no task can run");
+            }
+            std::this_thread::yield();
+        }
+    }
+};
+
+// ----- Wait lists -----
+
+inline WaitList::~WaitList() {
+    while (Coroutine* task = popFirst()) {
+        task->drop();
+    }
+}
+
+inline Coroutine* WaitList::popFirst() {
+    Coroutine* task = first;
+    if (task) {
+        first = task->nextWaiter;
+        if (!first) {
+            last = nullptr;
+        }
+        task->nextWaiter = nullptr;
+        count.fetch_sub(1);
+    }
+    return task;
+}
+
+inline void WaitList::add(Coroutine* task) {
+    task->retain();
+    mutex.lock();
+    if (last) {
+        last->nextWaiter = task;
+    } else {
+        first = task;
+    }
+    last = task;
+    count.fetch_add(1);
+    mutex.unlock();
+    std::atomic_thread_fence(std::memory_order_seq_cst);  // Publish before the caller retries
+}
+
+inline void WaitList::remove(Coroutine* task) {
+    mutex.lock();
+    Coroutine* previous = nullptr;
+    Coroutine* node = first;
+    while (node && node != task) {
+        previous = node;
+        node = node->nextWaiter;
+    }
+    if (node) {
+        (previous ? previous->nextWaiter : first) = node->nextWaiter;
+        if (last == node) {
+            last = previous;
+        }
+        node->nextWaiter = nullptr;
+        count.fetch_sub(1);
+    }
+    mutex.unlock();
+    if (node) {
+        task->drop();
+    } else {
+        wakeOne();
+    }
+}
+
+inline void WaitList::wakeOne() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);  // Pairs with add()
+    if (count.load(std::memory_order_relaxed) == 0) {
+        return;
+    }
+    mutex.lock();
+    Coroutine* task = popFirst();
+    mutex.unlock();
+    if (task) {
+        Scheduler::instance().wakeUp(task);
+        task->drop();
+    }
+}
+
+inline void WaitList::wakeAll() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (count.load(std::memory_order_relaxed) == 0) {
+        return;
+    }
+    mutex.lock();
+    Coroutine* task = first;
+    first = last = nullptr;
+    count.store(0);
+    mutex.unlock();
+    while (task) {
+        Coroutine* next = task->nextWaiter;
+        task->nextWaiter = nullptr;
+        Scheduler::instance().wakeUp(task);
+        task->drop();
+        task = next;
+    }
+}
+
+// ----- Tasks -----
+
+/**
+ * Handle returned by spawn; `await` reads the result once the task is done
+ */
+template <typename T>
+class Task {
+private:
+    TaskFrame<T>* frame = nullptr;
+
+public:
+    Task() {}
+
+    explicit Task(TaskFrame<T>* frame) : frame(frame) {
+        frame->retain();
+    }
+
+    Task(const Task& other) : frame(other.frame) {
+        if (frame) {
+            frame->retain();
+        }
+    }
+
+    Task& operator=(Task other) {
+        std::swap(frame, other.frame);
+        return *this;
+    }
+
+    ~Task() {
+        if (frame) {
+            frame->drop();
+        }
+    }
+
+    TaskFrame<T>* get() const {
+        return frame;
+    }
+};
+
+/**
+ * Lowered `spawn f(args)`: `frame` is the new coroutine frame of f
+ */
+template <typename Frame>
+inline Task<typename Frame::Result> spawn(Frame* frame) {
+    output().flush();
+    Task<typename Frame::Result> task(frame);
+    Scheduler::instance().schedule(frame);
+    return task;
+}
+
+template <typename T>
+inline TaskFrame<T>& checkedTask(const Task<T>& task, int line) {
+    if (!task.get()) {
+        fail(line, "await of a task that was never spawned");
+    }
+    return *task.get();
+}
+
+/**
+ * `await t` in a spawned function: false after registering `self` to be
+ * woken when t finishes
+ */
+template <typename T>
+inline bool awaitFrom(Coroutine& self, TaskFrame<T>& frame) {
+    if (frame.finished()) {
+        return true;
+    }
+    frame.completion.add(&self);
+    if (!frame.finished()) {
+        return false;
+    }
+    frame.completion.remove(&self);
+    return true;
+}
+
+template <typename T, typename U>
+inline bool await(Coroutine& self, const Task<T>& task, U& out, int line) {
+    TaskFrame<T>& frame = checkedTask(task, line);
+    if (!awaitFrom(self, frame)) {
+        return false;
+    }
+    out = frame.mya_result;
+    return true;
+}
+
+template <typename T>
+inline bool await(Coroutine& self, const Task<T>& task, int line) {
+    return awaitFrom(self, checkedTask(task, line));
+}
+
+/**
+ * `await t` in Main and top-level code
+ */
+template <typename T>
+inline T await(const Task<T>& task, int line) {
+    TaskFrame<T>& frame = checkedTask(task, line);
+    Scheduler::instance().waitUntil([&] { return frame.finished(); }, "in await", line);
+    return frame.mya_result;
+}
+
+inline void await(const Task<void>& task, int line) {
+    TaskFrame<void>& frame = checkedTask(task, line);
+    Scheduler::instance().waitUntil([&] { return frame.finished(); }, "in await", line);
+}
+
+// ----- Channels -----
+
+/**
+ * Channel - Bounded lock-free multi-producer multi-consumer queue
+ */
+template <typename T>
+class Channel {
+private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    std::unique_ptr<Cell[]> cells;
+    size_t cellCount;  // At least two: with one cell, "full" and "free" sequences coincide
+    size_t capacity;
+    std::atomic<size_t> tail{ 0 };  // Next position to send to
+    char pad[64];                   // Senders and receivers touch different lines
+    std::atomic<size_t> head{ 0 };  // Next position to receive from
+
+public:
+    WaitList senders;    // Tasks waiting for space
+    WaitList receivers;  // Tasks waiting for a value
+
+    explicit Channel(size_t capacity)
+        : cells(new Cell[std::max<size_t>(capacity, 2)]), cellCount(std::max<size_t>(capacity, 2)), capacity(capacity) {
+        (void)pad;
+        for (size_t i = 0; i < cellCount; i++) {
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    Channel(const Channel&) = delete;
+    Channel& operator=(const Channel&) = delete;
+
+    /**
+     * A cell at position p is free for sending when its sequence is p and
+     * holds a value when it is p + 1; receiving sets it to p + cellCount
+     */
+    bool trySend(const T& value) {
+        size_t pos = tail.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = cells[pos % cellCount];
+            size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (capacity < cellCount && pos - head.load(std::memory_order_acquire) >= capacity) {
+                    return false;  // channel(1): full while the other cell is still free
+                }
+                if (tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    cell.value = value;
+                    cell.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;  // Full
+            } else {
+                pos = tail.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool tryRecv(T& out) {
+        size_t pos = head.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = cells[pos % cellCount];
+            size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos + 1);
+            if (diff == 0) {
+                if (head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    out = std::move(cell.value);
+                    cell.sequence.store(pos + cellCount, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;  // Empty
+            } else {
+                pos = head.load(std::memory_order_relaxed);
+            }
+        }
+    }
+};
+
+/**
+ * `chan<T>` values share one channel
+ */
+template <typename T>
+using Chan = std::shared_ptr<Channel<T>>;
+
+/**
+ * `channel(n)`: a channel buffering up to n values (at least one)
+ */
+template <typename T>
+inline Chan<T> channel(int64_t capacity, int line) {
+    if (capacity < 0) {
+        fail(line, "channel capacity " + std::to_string(capacity) + " is negative");
+    }
+    return std::make_shared<Channel<T>>(static_cast<size_t>(std::max<int64_t>(capacity, 1)));
+}
+
+template <typename T>
+inline Channel<T>& checkedChannel(const Chan<T>& channel, int line) {
+    if (!channel) {
+        fail(line, "use of a channel that was never created");
+    }
+    return *channel;
+}
+
+/**
+ * `send(c, v)` in a spawned function: false after registering `self` to be
+ * woken when c has space
+ */
+template <typename T, typename U>
+inline bool send(Coroutine& self, const Chan<T>& channel, const U& value, int line) {
+    Channel<T>& c = checkedChannel(channel, line);
+    output().flush();
+    if (!c.trySend(value)) {
+        c.senders.add(&self);
+        if (!c.trySend(value)) {
+            return false;
+        }
+        c.senders.remove(&self);
+    }
+    c.receivers.wakeOne();
+    return true;
+}
+
+/**
+ * `recv(c)` in a spawned function: false after registering `self` to be
+ * woken when c has a value
+ */
+template <typename T, typename U>
+inline bool recv(Coroutine& self, const Chan<T>& channel, U& out, int line) {
+    Channel<T>& c = checkedChannel(channel, line);
+    output().flush();
+    T value;
+    if (!c.tryRecv(value)) {
+        c.receivers.add(&self);
+        if (!c.tryRecv(value)) {
+            return false;
+        }
+        c.receivers.remove(&self);
+    }
+    out = std::move(value);
+    c.senders.wakeOne();
+    return true;
+}
+
+/**
+ * `send(c, v)` in Main and top-level code
+ */
+template <typename T, typename U>
+inline void send(const Chan<T>& channel, const U& value, int line) {
+    Channel<T>& c = checkedChannel(channel, line);
+    T converted = value;
+    if (!c.trySend(converted)) {
+        Scheduler::instance().waitUntil([&] { return c.trySend(converted); }, "in send", line);
+    }
+    c.receivers.wakeOne();
+}
+
+/**
+ * `recv(c)` in Main and top-level code
+ */
+template <typename T>
+inline T recv(const Chan<T>& channel, int line) {
+    Channel<T>& c = checkedChannel(channel, line);
+    T value;
+    if (!c.tryRecv(value)) {
+        Scheduler::instance().waitUntil([&] { return c.tryRecv(value); }, "in recv", line);
+    }
+    c.senders.wakeOne();
+    return value;
+}
+
+// ----- Benchmark -----
+
+namespace TaskBench {
+
+/**
+ * Generated-style frames for
+ *
+ *     fn pingPong(in: chan<int>, out: chan<int>, rounds: int):
+ *         for r in range 0 to rounds:
+ *             let v: int = recv(in);
+ *             send(out, v + 1);
+ */
+struct PingPong : TaskFrame<void> {
+    Chan<int64_t> in, out;
+    int64_t rounds, r = 0, v = 0, mya_send1 = 0;
+
+    PingPong(Chan<int64_t> in, Chan<int64_t> out, int64_t rounds)
+        : in(std::move(in)), out(std::move(out)), rounds(rounds) {}
+
+    Step resume() override {
+        switch (mya_state) {
+        case 0:
+            for (r = 0; r < rounds; r++) {
+                mya_state = 1;
+                // fallthrough
+            case 1:
+                if (!Runtime::recv(*this, in, v, 0)) {
+                    return Step::Blocked;
+                }
+                mya_send1 = v + 1;
+                mya_state = 2;
+                // fallthrough
+            case 2:
+                if (!Runtime::send(*this, out, mya_send1, 0)) {
+                    return Step::Blocked;
+                }
+            }
+        }
+        return Step::Done;
+    }
+};
+
+/**
+ * fn square(jobs: chan<int>, results: chan<int>, count: int): receives
+ * `count` values and sends back their squares
+ */
+struct Square : TaskFrame<void> {
+    Chan<int64_t> jobs, results;
+    int64_t count, k = 0, x = 0, mya_send1 = 0;
+
+    Square(Chan<int64_t> jobs, Chan<int64_t> results, int64_t count)
+        : jobs(std::move(jobs)), results(std::move(results)), count(count) {}
+
+    Step resume() override {
+        switch (mya_state) {
+        case 0:
+            for (k = 0; k < count; k++) {
+                mya_state = 1;
+                // fallthrough
+            case 1:
+                if (!Runtime::recv(*this, jobs, x, 0)) {
+                    return Step::Blocked;
+                }
+                mya_send1 = x * x;
+                mya_state = 2;
+                // fallthrough
+            case 2:
+                if (!Runtime::send(*this, results, mya_send1, 0)) {
+                    return Step::Blocked;
+                }
+            }
+        }
+        return Step::Done;
+    }
+};
+
+/**
+ * fn produce(jobs: chan<int>, count: int): sends 0 .. count - 1
+ */
+struct Produce : TaskFrame<void> {
+    Chan<int64_t> jobs;
+    int64_t count, i = 0;
+
+    Produce(Chan<int64_t> jobs, int64_t count) : jobs(std::move(jobs)), count(count) {}
+
+    Step resume() override {
+        switch (mya_state) {
+        case 0:
+            for (i = 0; i < count; i++) {
+                mya_state = 1;
+                // fallthrough
+            case 1:
+                if (!Runtime::send(*this, jobs, i, 0)) {
+                    return Step::Blocked;
+                }
+            }
+        }
+        return Step::Done;
+    }
+};
+
+/**
+ * fn waiter(gate: chan<int>) -> int: return recv(gate) + 1;
+ */
+struct Waiter : TaskFrame<int64_t> {
+    Chan<int64_t> gate;
+    int64_t value = 0;
+
+    explicit Waiter(Chan<int64_t> gate) : gate(std::move(gate)) {}
+
+    Step resume() override {
+        switch (mya_state) {
+        case 0:
+            mya_state = 1;
+            // fallthrough
+        case 1:
+            if (!Runtime::recv(*this, gate, value, 0)) {
+                return Step::Blocked;
+            }
+            mya_result = value + 1;
+        }
+        return Step::Done;
+    }
+};
+
+} // namespace TaskBench
+
+/**
+ * Ping-pong latency between two tasks, fan-out/fan-in throughput through
+ * worker tasks, and the cost of many parked tasks
+ */
+inline void runChannelBenchmark(size_t count) {
+    int64_t n = static_cast<int64_t>(count);
+    std::cout << "Channel benchmark: " << count << " messages" << std::endl;
+
+    // Ping-pong: Main sends into `a`, a task bounces each value back on `b`
+    double pingPong = bestOf(3, [&] {
+        Chan<int64_t> a = channel<int64_t>(1, 0), b = channel<int64_t>(1, 0);
+        Task<void> task = spawn(new TaskBench::PingPong(a, b, n));
+        for (int64_t i = 0; i < n; i++) {
+            send(a, i, 0);
+            recv(b, 0);
+        }
+        await(task, 0);
+    });
+    reportBenchmark("ping-pong (Main <-> task)", pingPong, count);
+    std::cout << "    round trip: " << std::fixed << std::setprecision(0) << pingPong / n * 1e9 << " ns" << std::endl;
+    std::cout.unsetf(std::ios::floatfield);
+
+    double taskPingPong = bestOf(3, [&] {
+        Chan<int64_t> a = channel<int64_t>(1, 0), b = channel<int64_t>(1, 0);
+        send(a, 0, 0);
+        Task<void> first = spawn(new TaskBench::PingPong(a, b, n));
+        Task<void> second = spawn(new TaskBench::PingPong(b, a, n));
+        await(first, 0);
+        await(second, 0);
+        recv(a, 0);
+    });
+    reportBenchmark("ping-pong (task <-> task)", taskPingPong, 2 * count);
+
+    // Fan-out/fan-in: a producer task feeds 64 workers, Main sums the results
+    const int64_t workers = 64;
+    int64_t perWorker = std::max<int64_t>(1, n / workers), total = workers * perWorker;
+    double fan = bestOf(3, [&] {
+        Chan<int64_t> jobs = channel<int64_t>(1024, 0), results = channel<int64_t>(1024, 0);
+        spawn(new TaskBench::Produce(jobs, total));
+        for (int64_t w = 0; w < workers; w++) {
+            spawn(new TaskBench::Square(jobs, results, perWorker));
+        }
+        int64_t sum = 0;
+        for (int64_t i = 0; i < total; i++) {
+            sum += recv(results, 0);
+        }
+        volatile int64_t sink = sum;
+        (void)sink;
+    });
+    reportBenchmark("fan-out/fan-in (64 workers)", fan, static_cast<size_t>(total));
+
+    // Many parked tasks: spawn them all, then release them through one channel
+    Chan<int64_t> gate = channel<int64_t>(1024, 0);
+    std::vector<Task<int64_t>> waiters;
+    waiters.reserve(count);
+    Stopwatch watch;
+    for (size_t i = 0; i < count; i++) {
+        waiters.push_back(spawn(new TaskBench::Waiter(gate)));
+    }
+    double spawned = watch.elapsedSeconds();
+    int64_t sum = 0;
+    for (size_t i = 0; i < count; i++) {
+        send(gate, 1, 0);
+    }
+    for (const auto& task : waiters) {
+        sum += await(task, 0);
+    }
+    double completed = watch.elapsedSeconds();
+    reportBenchmark("spawn", spawned, count);
+    reportBenchmark("spawn + park + release + await", completed, count);
+    std::cout << "    frame size: " << sizeof(TaskBench::Waiter) << " bytes per task"
+              << (sum == 2 * n ? "" : " (wrong result)") << std::endl;
+}
+
+} // namespace Runtime
+} // namespace MYA
+
+#endif // MYA_RUNTIME_TASK_H
@@ -0,0 +1,516 @@
+/**
+ * MYA Language - Runtime Tuples and Dynamic Values
+ *
+ * Representations of `tuple<...>` and `any`:
+ * - Tuple<Ts...>: an unboxed value type holding its elements in declaration
+ *   order (nested first/rest members), trivially copyable when its elements
+ *   are, so tuple<int, float> is passed and returned in registers.
+ *   get<I>(t) is the element access `t[I]`.
+ * - Any: a 16-byte tagged value. int, float and bool live in the value
+ *   itself; only str allocates. An any compares and hashes numerically
+ *   (1 == 1.0), so it can key a map (MYARuntimeMap.h).
+ *
+ * `--bench containers` compares List, Map and Any against std::vector,
+ * std::unordered_map and heap-boxed values.
+ */
+
+#ifndef MYA_RUNTIME_VALUE_H
+#define MYA_RUNTIME_VALUE_H
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "MYABenchmark.h"
+#include "MYARuntimeList.h"
+#include "MYARuntimeMap.h"
+#include "MYARuntimePrint.h"
+
+namespace MYA {
+namespace Runtime {
+
+// ----- Tuples -----
+
+template <typename... Ts>
+struct Tuple;
+
+template <typename T>
+struct Tuple<T> {
+    T first;
+
+    Tuple() : first() {}
+    Tuple(const T& first) : first(first) {}
+};
+
+template <typename T, typename Next, typename... Rest>
+struct Tuple<T, Next, Rest...> {
+    T first;
+    Tuple<Next, Rest...> rest;
+
+    Tuple() : first(), rest() {}
+    Tuple(const T& first, const Next& next, const Rest&... more) : first(first), rest(next, more...) {}
+};
+
+template <size_t I>
+struct TupleElement {
+    template <typename T>
+    static auto& from(T& tuple) {
+        return TupleElement<I - 1>::from(tuple.rest);
+    }
+};
+
+template <>
+struct TupleElement<0> {
+    template <typename T>
+    static auto& from(T& tuple) {
+        return tuple.first;
+    }
+};
+
+/**
+ * `t[I]`
+ */
+template <size_t I, typename... Ts>
+inline auto& get(Tuple<Ts...>& tuple) {
+    return TupleElement<I>::from(tuple);
+}
+
+template <size_t I, typename... Ts>
+inline const auto& get(const Tuple<Ts...>& tuple) {
+    return TupleElement<I>::from(tuple);
+}
+
+template <typename T>
+inline bool operator==(const Tuple<T>& a, const Tuple<T>& b) {
+    return a.first == b.first;
+}
+
+template <typename T, typename Next, typename... Rest>
+inline bool operator==(const Tuple<T, Next, Rest...>& a, const Tuple<T, Next, Rest...>& b) {
+    return a.first == b.first && a.rest == b.rest;
+}
+
+template <typename... Ts>
+inline bool operator!=(const Tuple<Ts...>& a, const Tuple<Ts...>& b) {
+    return !(a == b);
+}
+
+template <typename T>
+struct Hash<Tuple<T>> {
+    uint64_t operator()(const Tuple<T>& tuple) const {
+        return Hash<T>()(tuple.first);
+    }
+};
+
+template <typename T, typename Next, typename... Rest>
+struct Hash<Tuple<T, Next, Rest...>> {
+    uint64_t operator()(const Tuple<T, Next, Rest...>& tuple) const {
+        return mixHash(Hash<T>()(tuple.first) * 31 + Hash<Tuple<Next, Rest...>>()(tuple.rest));
+    }
+};
+
+template <typename T>
+inline void writeTupleItems(OutputBuffer& out, const Tuple<T>& tuple) {
+    writeValue(out, tuple.first);
+}
+
+template <typename T, typename Next, typename... Rest>
+inline void writeTupleItems(OutputBuffer& out, const Tuple<T, Next, Rest...>& tuple) {
+    writeValue(out, tuple.first);
+    out.write(text(", "));
+    writeTupleItems(out, tuple.rest);
+}
+
+template <typename... Ts>
+inline void writeValue(OutputBuffer& out, const Tuple<Ts...>& tuple) {
+    out.put('(');
+    writeTupleItems(out, tuple);
+    out.put(')');
+}
+
+// ----- Any -----
+
+/**
+ * Any - Tagged int, float, bool or str; defaults to the int 0
+ */
+class Any {
+public:
+    enum class Tag : uint8_t { Int, Float, Bool, Str };
+
+private:
+    Tag tag;
+    union {
+        int64_t integer;
+        double number;
+        bool flag;
+        std::string* text;  // Owned
+    };
+
+    void release() {
+        if (tag == Tag::Str) {
+            delete text;
+        }
+    }
+
+    void copyFrom(const Any& other) {
+        tag = other.tag;
+        if (tag == Tag::Str) {
+            text = new std::string(*other.text);
+        } else {
+            integer = other.integer;  // Copies whichever scalar is set
+        }
+    }
+
+public:
+    Any() : tag(Tag::Int), integer(0) {}
+
+    template <typename T, typename std::enable_if<std::is_integral<T>::value && !std::is_same<T, bool>::value,
+                                                  int>::type = 0>
+    Any(T value) : tag(Tag::Int), integer(static_cast<int64_t>(value)) {}
+
+    Any(double value) : tag(Tag::Float), number(value) {}
+    Any(bool value) : tag(Tag::Bool), flag(value) {}
+    Any(const std::string& value) : tag(Tag::Str), text(new std::string(value)) {}
+    Any(std::string&& value) : tag(Tag::Str), text(new std::string(std::move(value))) {}
+    Any(const char* value) : tag(Tag::Str), text(new std::string(value)) {}
+
+    Any(const Any& other) {
+        copyFrom(other);
+    }
+
+    Any(Any&& other) : tag(other.tag), integer(other.integer) {
+        other.tag = Tag::Int;  // The string, if any, now belongs to this value
+    }
+
+    Any& operator=(const Any& other) {
+        if (this != &other) {
+            release();
+            copyFrom(other);
+        }
+        return *this;
+    }
+
+    Any& operator=(Any&& other) {
+        if (this != &other) {
+            release();
+            tag = other.tag;
+            integer = other.integer;
+            other.tag = Tag::Int;
+        }
+        return *this;
+    }
+
+    ~Any() {
+        release();
+    }
+
+    Tag type() const {
+        return tag;
+    }
+
+    /**
+     * MYA name of the held type, for typeof()
+     */
+    const char* typeName() const {
+        static const char* names[] = { "int", "float", "bool", "str" };
+        return names[static_cast<int>(tag)];
+    }
+
+    int64_t asInt() const {
+        return integer;
+    }
+
+    double asFloat() const {
+        return tag == Tag::Int ? static_cast<double>(integer) : number;
+    }
+
+    bool asBool() const {
+        return flag;
+    }
+
+    const std::string& asStr() const {
+        return *text;
+    }
+
+    bool isNumber() const {
+        return tag == Tag::Int || tag == Tag::Float;
+    }
+
+    friend bool operator==(const Any& a, const Any& b) {
+        if (a.tag == Tag::Int && b.tag == Tag::Int) {
+            return a.integer == b.integer;
+        }
+        if (a.isNumber() && b.isNumber()) {
+            return a.asFloat() == b.asFloat();
+        }
+        if (a.tag != b.tag) {
+            return false;
+        }
+        return a.tag == Tag::Bool ? a.flag == b.flag : *a.text == *b.text;
+    }
+
+    friend bool operator!=(const Any& a, const Any& b) {
+        return !(a == b);
+    }
+};
+
+template <>
+struct Hash<Any> {
+    uint64_t operator()(const Any& value) const {
+        switch (value.type()) {
+        case Any::Tag::Int:
+            return Hash<int64_t>()(value.asInt());
+        case Any::Tag::Float: {
+            // Whole floats hash as the equal int
+            double number = value.asFloat();
+            if (number >= -9.2e18 && number <= 9.2e18 && number == std::floor(number)) {
+                return Hash<int64_t>()(static_cast<int64_t>(number));
+            }
+            return Hash<double>()(number);
+        }
+        case Any::Tag::Bool:
+            return Hash<bool>()(value.asBool());
+        case Any::Tag::Str:
+            break;
+        }
+        return Hash<std::string>()(value.asStr());
+    }
+};
+
+inline void writeValue(OutputBuffer& out, const Any& value) {
+    switch (value.type()) {
+    case Any::Tag::Int:
+        out.writeInt(value.asInt());
+        break;
+    case Any::Tag::Float:
+        out.writeFloat(value.asFloat());
+        break;
+    case Any::Tag::Bool:
+        writeValue(out, value.asBool());
+        break;
+    case Any::Tag::Str:
+        writeValue(out, value.asStr());
+        break;
+    }
+}
+
+// ----- Benchmark: containers against the standard library -----
+
+namespace ContainerBench {
+
+/**
+ * A dynamic value as a boxing runtime stores it: one heap object per value
+ */
+struct Boxed {
+    virtual ~Boxed() {}
+    virtual int64_t number() const = 0;
+};
+
+struct BoxedInt : Boxed {
+    int64_t value;
+    explicit BoxedInt(int64_t value) : value(value) {}
+    int64_t number() const override {
+        return value;
+    }
+};
+
+} // namespace ContainerBench
+
+/**
+ * Temporary and growing lists against std::vector, maps of int and str
+ * keys against std::unordered_map, and any against boxed values
+ */
+inline void runContainerBenchmark(size_t count) {
+    using namespace ContainerBench;
+    volatile int64_t sink = 0;
+    std::cout << "Container benchmark: " << count << " items" << std::endl;
+
+    // Short temporary lists: the common case of building 4 values and dropping them
+    const size_t lists = count / 4;
+    double vectorTemps = bestOf(3, [&] {
+        for (size_t r = 0; r < lists; r++) {
+            std::vector<int64_t> list;
+            for (int64_t v = 0; v < 4; v++) {
+                list.push_back(v + static_cast<int64_t>(r));
+            }
+            sink = sink + list[r % 4];
+        }
+    });
+    reportBenchmark("4-element lists std::vector", vectorTemps, lists);
+    double listTemps = bestOf(3, [&] {
+        for (size_t r = 0; r < lists; r++) {
+            List<int64_t> list;
+            for (int64_t v = 0; v < 4; v++) {
+                list.push_back(v + static_cast<int64_t>(r));
+            }
+            sink = sink + list[r % 4];
+        }
+    });
+    reportBenchmark("4-element lists List", listTemps, lists);
+
+    std::vector<int64_t> smallVector(4, 1);
+    List<int64_t> smallList(4, 1);
+    double vectorCopies = bestOf(3, [&] {
+        for (size_t r = 0; r < lists; r++) {
+            std::vector<int64_t> copy(smallVector);
+            sink = sink + copy[r % 4];
+        }
+    });
+    reportBenchmark("4-element copies std::vector", vectorCopies, lists);
+    double listCopies = bestOf(3, [&] {
+        for (size_t r = 0; r < lists; r++) {
+            List<int64_t> copy(smallList);
+            sink = sink + copy[r % 4];
+        }
+    });
+    reportBenchmark("4-element copies List", listCopies, lists);
+
+    double vectorPush = bestOf(3, [&] {
+        std::vector<int64_t> list;
+        for (size_t i = 0; i < count; i++) {
+            list.push_back(static_cast<int64_t>(i));
+        }
+        sink = sink + (list.empty() ? 0 : list.back());
+    });
+    reportBenchmark("push std::vector", vectorPush, count);
+    double listPush = bestOf(3, [&] {
+        List<int64_t> list;
+        for (size_t i = 0; i < count; i++) {
+            list.push_back(static_cast<int64_t>(i));
+        }
+        sink = sink + (list.empty() ? 0 : list.back());
+    });
+    reportBenchmark("push List", listPush, count);
+
+    // Maps: random int keys, then hits and misses
+    std::mt19937_64 random(42);
+    std::vector<int64_t> keys(count), misses(count);
+    for (size_t i = 0; i < count; i++) {
+        keys[i] = static_cast<int64_t>(random() >> 1);
+        misses[i] = static_cast<int64_t>(random() >> 1);
+    }
+    std::unordered_map<int64_t, int64_t> stdMap;
+    Map<int64_t, int64_t> map;
+    double stdInsert = bestOf(3, [&] {
+        stdMap = std::unordered_map<int64_t, int64_t>();
+        for (size_t i = 0; i < count; i++) {
+            stdMap[keys[i]] = static_cast<int64_t>(i);
+        }
+    });
+    reportBenchmark("int insert std::unordered_map", stdInsert, count);
+    double mapInsert = bestOf(3, [&] {
+        map = Map<int64_t, int64_t>();
+        for (size_t i = 0; i < count; i++) {
+            map[keys[i]] = static_cast<int64_t>(i);
+        }
+    });
+    reportBenchmark("int insert Map", mapInsert, count);
+
+    double stdHits = bestOf(3, [&] {
+        int64_t total = 0;
+        for (size_t i = 0; i < count; i++) {
+            total += stdMap.find(keys[(i * 7919) % count])->second;
+        }
+        sink = sink + total;
+    });
+    reportBenchmark("int lookup hit std::unordered_map", stdHits, count);
+    double mapHits = bestOf(3, [&] {
+        int64_t total = 0;
+        for (size_t i = 0; i < count; i++) {
+            total += *map.find(keys[(i * 7919) % count]);
+        }
+        sink = sink + total;
+    });
+    reportBenchmark("int lookup hit Map", mapHits, count);
+
+    double stdMisses = bestOf(3, [&] {
+        int64_t found = 0;
+        for (size_t i = 0; i < count; i++) {
+            found += stdMap.count(misses[i]);
+        }
+        sink = sink + found;
+    });
+    reportBenchmark("int lookup miss std::unordered_map", stdMisses, count);
+    double mapMisses = bestOf(3, [&] {
+        int64_t found = 0;
+        for (size_t i = 0; i < count; i++) {
+            found += map.contains(misses[i]);
+        }
+        sink = sink + found;
+    });
+    reportBenchmark("int lookup miss Map", mapMisses, count);
+
+    double stdErase = bestOf(1, [&] {
+        for (size_t i = 0; i < count; i += 2) {
+            stdMap.erase(keys[i]);
+        }
+    });
+    reportBenchmark("int erase std::unordered_map", stdErase, count / 2);
+    double mapErase = bestOf(1, [&] {
+        for (size_t i = 0; i < count; i += 2) {
+            map.erase(keys[i]);
+        }
+    });
+    reportBenchmark("int erase Map", mapErase, count / 2);
+
+    // Word counts: str keys with many repeats
+    std::vector<std::string> words(count);
+    for (size_t i = 0; i < count; i++) {
+        words[i] = "word" + std::to_string((i * 2654435761u) % (count / 8 + 1));
+    }
+    double stdWords = bestOf(3, [&] {
+        std::unordered_map<std::string, int64_t> counts;
+        for (const auto& word : words) {
+            counts[word]++;
+        }
+        sink = sink + static_cast<int64_t>(counts.size());
+    });
+    reportBenchmark("str count std::unordered_map", stdWords, count);
+    double mapWords = bestOf(3, [&] {
+        Map<std::string, int64_t> counts;
+        for (const auto& word : words) {
+            counts[word]++;
+        }
+        sink = sink + static_cast<int64_t>(counts.size());
+    });
+    reportBenchmark("str count Map", mapWords, count);
+
+    // any: a list of dynamic ints, boxed one heap object each or tagged in place
+    double boxedTime = bestOf(3, [&] {
+        std::vector<std::unique_ptr<Boxed>> values;
+        values.reserve(count);
+        for (size_t i = 0; i < count; i++) {
+            values.emplace_back(new BoxedInt(static_cast<int64_t>(i)));
+        }
+        int64_t total = 0;
+        for (const auto& value : values) {
+            total += value->number();
+        }
+        sink = sink + total;
+    });
+    reportBenchmark("dynamic ints heap-boxed", boxedTime, count);
+    double anyTime = bestOf(3, [&] {
+        List<Any> values;
+        values.reserve(count);
+        for (size_t i = 0; i < count; i++) {
+            values.push_back(Any(static_cast<int64_t>(i)));
+        }
+        int64_t total = 0;
+        for (const auto& value : values) {
+            total += value.asInt();
+        }
+        sink = sink + total;
+    });
+    reportBenchmark("dynamic ints Any", anyTime, count);
+}
+
+} // namespace Runtime
+} // namespace MYA
+
+#endif // MYA_RUNTIME_VALUE_H
@@ -0,0 +1,558 @@
+/**
+ * MYA Language - Struct Layout
+ *
+ * Computes the memory layout of `struct Name: ... end` value types:
+ * - Packed, aligned layouts (fields ordered by decreasing alignment so padding
+ *   is minimal; field offsets are still reported per declared field)
+ * - Register passing classification for small structs (Win64 and System V)
+ * - Opt-in structure-of-arrays (SoA) representation for lists of a struct,
+ *   so loops over `point.x` touch one contiguous column
+ *
+ * Scalar sizes: int and float are 64-bit, bool is 1 byte, str is a
+ * (pointer, length) pair, list is 64 bytes (three pointers, the allocator and
+ * 32 bytes of inline elements), map is 40 bytes (control and slot pointers and
+ * three counts) and any is a 16-byte tagged value. A tuple is laid out like the
+ * runtime's Tuple: its first element, then the tuple of the rest.
+ */
+
+#ifndef MYA_STRUCT_LAYOUT_H
+#define MYA_STRUCT_LAYOUT_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+#include "MYAIndentationPreprocessor.h"
+#include "MYABenchmark.h"
+
+namespace MYA {
+
+/**
+ * Register class of one eightbyte when a struct is passed by value
+ */
+enum class RegisterClass {
+    Integer,
+    SSE,
+    Memory
+};
+
+/**
+ * Calling convention used for struct passing decisions
+ */
+enum class TargetABI {
+    Win64,
+    SysV
+};
+
+inline TargetABI defaultTargetABI() {
+#ifdef _WIN32
+    return TargetABI::Win64;
+#else
+    return TargetABI::SysV;
+#endif
+}
+
+struct StructField {
+    std::string name;
+    std::string type;
+    int line;
+};
+
+struct StructDef {
+    std::string name;
+    std::vector<StructField> fields;
+    int line;
+};
+
+struct FieldLayout {
+    std::string name;
+    std::string type;
+    size_t offset;
+    size_t size;
+    size_t align;
+};
+
+/**
+ * Computed layout of one struct
+ */
+struct StructLayout {
+    std::string name;
+    size_t size = 0;
+    size_t align = 1;
+    size_t declaredOrderSize = 0;      // Size had fields been kept in declaration order
+    std::vector<FieldLayout> fields;   // Declaration order
+    std::vector<size_t> memoryOrder;   // Indices into `fields` by ascending offset
+    std::vector<RegisterClass> eightbytes;  // Empty when passed in memory
+    bool passedInRegisters = false;
+
+    const FieldLayout* field(const std::string& fieldName) const {
+        for (const auto& f : fields) {
+            if (f.name == fieldName) {
+                return &f;
+            }
+        }
+        return nullptr;
+    }
+};
+
+/**
+ * Struct-related compile error
+ */
+struct StructDiagnostic {
+    int line;
+    std::string message;
+};
+
+/**
+ * Collect struct definitions from the preprocessed token stream
+ */
+inline std::vector<StructDef> collectStructDefs(const std::vector<Token>& tokens) {
+    std::vector<StructDef> defs;
+    bool inStruct = false;
+    for (const auto& token : tokens) {
+        if (token.type != TokenType::CODE) {
+            continue;
+        }
+        std::string text = token.value.substr(0, token.value.find('$'));
+        size_t start = text.find_first_not_of(" \t\r");
+        size_t end = text.find_last_not_of(" \t\r");
+        text = start == std::string::npos ? "" : text.substr(start, end - start + 1);
+
+        if (!inStruct) {
+            if (text.compare(0, 7, "struct ") == 0 && text.back() == ':') {
+                std::string name = text.substr(7, text.size() - 8);
+                name.erase(std::remove(name.begin(), name.end(), ' '), name.end());
+                defs.push_back(StructDef{ name, {}, token.line });
+                inStruct = true;
+            }
+        } else if (text == "end") {
+            inStruct = false;
+        } else {
+            size_t colon = text.find(':');
+            if (colon != std::string::npos) {
+                std::string name = text.substr(0, colon);
+                std::string type = text.substr(colon + 1);
+                name.erase(std::remove(name.begin(), name.end(), ' '), name.end());
+                type.erase(std::remove(type.begin(), type.end(), ' '), type.end());
+                defs.back().fields.push_back(StructField{ name, type, token.line });
+            }
+        }
+    }
+    return defs;
+}
+
+/**
+ * StructLayoutEngine - Resolves struct layouts, including nested structs
+ */
+class StructLayoutEngine {
+private:
+    TargetABI abi;
+    std::map<std::string, StructDef> defs;
+    std::map<std::string, StructLayout> layouts;
+    std::set<std::string> inProgress;
+    std::vector<StructDiagnostic> diagnostics;
+
+    static bool scalarInfo(const std::string& type, size_t& size, size_t& align) {
+        static const std::map<std::string, std::pair<size_t, size_t>> scalars = {
+            { "int", { 8, 8 } }, { "float", { 8, 8 } }, { "bool", { 1, 1 } }, { "str", { 16, 8 } },
+            { "list", { 64, 8 } }, { "map", { 40, 8 } }, { "any", { 16, 8 } }
+        };
+        std::vector<std::string> elements;
+        if (tupleElements(type, elements)) {
+            std::vector<size_t> offsets;
+            return tupleInfo(elements, size, align, offsets);
+        }
+        auto it = scalars.find(type.substr(0, type.find('<')));  // Any list<T> or map<K, V>
+        if (it == scalars.end()) {
+            return false;
+        }
+        size = it->second.first;
+        align = it->second.second;
+        return true;
+    }
+
+    /**
+     * Element types of `tuple<A, B, ...>`, split at top-level commas
+     */
+    static bool tupleElements(const std::string& type, std::vector<std::string>& elements) {
+        if (type.compare(0, 6, "tuple<") != 0 || type.back() != '>') {
+            return false;
+        }
+        int depth = 0;
+        std::string current;
+        for (size_t i = 6; i + 1 < type.size(); i++) {
+            char c = type[i];
+            depth += c == '<' ? 1 : c == '>' ? -1 : 0;
+            if (c == ',' && depth == 0) {
+                elements.push_back(current);
+                current.clear();
+            } else if (c != ' ') {
+                current += c;
+            }
+        }
+        elements.push_back(current);
+        return true;
+    }
+
+    /**
+     * Tuple<A, B, C> is { A first; Tuple<B, C> rest; }: `offsets` receives
+     * each element's offset
+     */
+    static bool tupleInfo(const std::vector<std::string>& elements, size_t& size, size_t& align,
+                          std::vector<size_t>& offsets, size_t from = 0) {
+        size_t firstSize = 0, firstAlign = 1;
+        if (!scalarInfo(elements[from], firstSize, firstAlign)) {
+            return false;
+        }
+        offsets.push_back(0);
+        size = firstSize;
+        align = firstAlign;
+        if (from + 1 < elements.size()) {
+            size_t restSize = 0, restAlign = 1;
+            std::vector<size_t> restOffsets;
+            if (!tupleInfo(elements, restSize, restAlign, restOffsets, from + 1)) {
+                return false;
+            }
+            size_t rest = alignUp(firstSize, restAlign);
+            for (size_t offset : restOffsets) {
+                offsets.push_back(rest + offset);
+            }
+            size = rest + restSize;
+            align = std::max(align, restAlign);
+        }
+        size = alignUp(size, align);
+        return true;
+    }
+
+    static size_t alignUp(size_t value, size_t align) {
+        return (value + align - 1) / align * align;
+    }
+
+    /**
+     * Mark the eightbytes covered by [offset, offset + size) for System V
+     * classification; nested structs are flattened.
+     */
+    void classify(const std::string& type, size_t offset, std::vector<RegisterClass>& classes) {
+        auto nested = layouts.find(type);
+        if (nested != layouts.end()) {
+            for (const auto& f : nested->second.fields) {
+                classify(f.type, offset + f.offset, classes);
+            }
+            return;
+        }
+        size_t size = 0, align = 0;
+        std::vector<std::string> elements;
+        std::vector<size_t> offsets;
+        if (tupleElements(type, elements) && tupleInfo(elements, size, align, offsets)) {
+            for (size_t i = 0; i < elements.size(); i++) {
+                classify(elements[i], offset + offsets[i], classes);
+            }
+            return;
+        }
+        scalarInfo(type, size, align);
+        RegisterClass cls = type == "float" ? RegisterClass::SSE : RegisterClass::Integer;
+        for (size_t byte = offset; byte < offset + size; byte += 8) {
+            RegisterClass& slot = classes[byte / 8];
+            // INTEGER wins over SSE when both share an eightbyte
+            if (slot == RegisterClass::Memory || cls == RegisterClass::Integer) {
+                slot = cls;
+            }
+        }
+    }
+
+    void decidePassing(StructLayout& layout) {
+        layout.eightbytes.clear();
+        if (abi == TargetABI::Win64) {
+            // Win64: only 1, 2, 4 or 8 byte aggregates travel in a GPR
+            if (layout.size == 1 || layout.size == 2 || layout.size == 4 || layout.size == 8) {
+                layout.passedInRegisters = true;
+                layout.eightbytes.push_back(RegisterClass::Integer);
+            }
+            return;
+        }
+        // System V: up to two eightbytes, each classified INTEGER or SSE
+        if (layout.size == 0 || layout.size > 16) {
+            return;
+        }
+        std::vector<RegisterClass> classes((layout.size + 7) / 8, RegisterClass::Memory);
+        for (const auto& f : layout.fields) {
+            classify(f.type, f.offset, classes);
+        }
+        for (auto& cls : classes) {
+            if (cls == RegisterClass::Memory) {
+                cls = RegisterClass::Integer;  // Padding-only eightbyte
+            }
+        }
+        layout.eightbytes = classes;
+        layout.passedInRegisters = true;
+    }
+
+    bool compute(const std::string& name, int line) {
+        if (layouts.count(name)) {
+            return true;
+        }
+        auto def = defs.find(name);
+        if (def == defs.end()) {
+            return false;
+        }
+        if (inProgress.count(name)) {
+            diagnostics.push_back(StructDiagnostic{ line, "struct '" + name + "' contains itself by value" });
+            return false;
+        }
+        inProgress.insert(name);
+
+        StructLayout layout;
+        layout.name = name;
+        bool ok = true;
+        std::set<std::string> seen;
+        for (const auto& field : def->second.fields) {
+            size_t size = 0, align = 1;
+            if (!seen.insert(field.name).second) {
+                diagnostics.push_back(StructDiagnostic{ field.line, "duplicate field '" + field.name + "' in struct '" + name + "'" });
+                ok = false;
+            }
+            if (!scalarInfo(field.type, size, align)) {
+                if (defs.count(field.type) && compute(field.type, field.line)) {
+                    size = layouts[field.type].size;
+                    align = layouts[field.type].align;
+                } else {
+                    if (!defs.count(field.type)) {
+                        diagnostics.push_back(StructDiagnostic{ field.line, "unknown type '" + field.type + "' for field '" + field.name + "'" });
+                    }
+                    ok = false;
+                    continue;
+                }
+            }
+            layout.fields.push_back(FieldLayout{ field.name, field.type, 0, size, align });
+            layout.declaredOrderSize = alignUp(layout.declaredOrderSize, align) + size;
+            layout.align = std::max(layout.align, align);
+        }
+        layout.declaredOrderSize = alignUp(layout.declaredOrderSize, layout.align);
+
+        // Packed order: decreasing alignment, declaration order among equals
+        layout.memoryOrder.resize(layout.fields.size());
+        for (size_t i = 0; i < layout.fields.size(); i++) {
+            layout.memoryOrder[i] = i;
+        }
+        std::stable_sort(layout.memoryOrder.begin(), layout.memoryOrder.end(),
+            [&layout](size_t a, size_t b) { return layout.fields[a].align > layout.fields[b].align; });
+
+        size_t offset = 0;
+        for (size_t index : layout.memoryOrder) {
+            FieldLayout& f = layout.fields[index];
+            offset = alignUp(offset, f.align);
+            f.offset = offset;
+            offset += f.size;
+        }
+        layout.size = alignUp(offset, layout.align);
+        decidePassing(layout);
+
+        inProgress.erase(name);
+        if (ok) {
+            layouts[name] = layout;
+        }
+        return ok;
+    }
+
+public:
+    explicit StructLayoutEngine(TargetABI abi = defaultTargetABI()) : abi(abi) {}
+
+    /**
+     * Compute layouts for all definitions; returns false on any error
+     */
+    bool computeAll(const std::vector<StructDef>& structDefs) {
+        size_t errorsBefore = diagnostics.size();
+        for (const auto& def : structDefs) {
+            if (defs.count(def.name)) {
+                diagnostics.push_back(StructDiagnostic{ def.line, "struct '" + def.name + "' is already defined" });
+                continue;
+            }
+            defs[def.name] = def;
+        }
+        for (const auto& def : structDefs) {
+            compute(def.name, def.line);
+        }
+        return diagnostics.size() == errorsBefore;
+    }
+
+    const StructLayout* layout(const std::string& name) const {
+        auto it = layouts.find(name);
+        return it == layouts.end() ? nullptr : &it->second;
+    }
+
+    const std::map<std::string, StructLayout>& getLayouts() const {
+        return layouts;
+    }
+
+    const std::vector<StructDiagnostic>& getDiagnostics() const {
+        return diagnostics;
+    }
+
+    /**
+     * Print layouts with offsets, padding savings and passing convention
+     */
+    void printLayouts() const {
+        std::cout << "\n=== Struct Layouts (" << (abi == TargetABI::Win64 ? "Win64" : "System V") << ") ===" << std::endl;
+        for (const auto& entry : layouts) {
+            const StructLayout& l = entry.second;
+            std::cout << "Struct " << l.name << ": Size=" << l.size << ", Align=" << l.align;
+            if (l.declaredOrderSize != l.size) {
+                std::cout << " (declaration order: " << l.declaredOrderSize << ")";
+            }
+            std::cout << ", Passing=";
+            if (!l.passedInRegisters) {
+                std::cout << "memory";
+            }
+            for (size_t i = 0; i < l.eightbytes.size(); i++) {
+                std::cout << (i ? "+" : "") << (l.eightbytes[i] == RegisterClass::SSE ? "SSE" : "INTEGER");
+            }
+            std::cout << std::endl;
+            for (size_t index : l.memoryOrder) {
+                const FieldLayout& f = l.fields[index];
+                std::cout << "  +" << std::setw(3) << std::left << f.offset << std::right << " "
+                          << f.name << ": " << f.type << " (" << f.size << " bytes)" << std::endl;
+            }
+        }
+    }
+};
+
+/**
+ * StructArray - Storage for a `list` of one struct type
+ *
+ * Array-of-structs (default) stores elements back to back with the struct's
+ * layout as stride. Structure-of-arrays (opt-in) stores one 64-byte aligned
+ * column per field, so a loop over `points[i].x` is a unit-stride scan.
+ */
+class StructArray {
+private:
+    const StructLayout* layout;
+    bool soa;
+    size_t count;
+    std::vector<unsigned char> storage;
+    std::vector<size_t> columnOffsets;  // SoA only, per field
+    size_t baseAdjust = 0;
+
+    static size_t alignUp(size_t value, size_t align) {
+        return (value + align - 1) / align * align;
+    }
+
+public:
+    StructArray(const StructLayout& layout, size_t count, bool structOfArrays)
+        : layout(&layout), soa(structOfArrays), count(count) {
+        size_t bytes = 0;
+        if (soa) {
+            for (const auto& f : layout.fields) {
+                bytes = alignUp(bytes, 64);
+                columnOffsets.push_back(bytes);
+                bytes += f.size * count;
+            }
+        } else {
+            bytes = layout.size * count;
+        }
+        storage.assign(bytes + 64, 0);
+        // Align the base so SoA columns start on cache lines
+        baseAdjust = (64 - reinterpret_cast<uintptr_t>(storage.data()) % 64) % 64;
+    }
+
+    bool isStructOfArrays() const {
+        return soa;
+    }
+
+    size_t size() const {
+        return count;
+    }
+
+    unsigned char* base() {
+        return storage.data() + baseAdjust;
+    }
+
+    /**
+     * Address of field `fieldIndex` (declaration order) of element `index`
+     */
+    unsigned char* fieldPointer(size_t index, size_t fieldIndex) {
+        const FieldLayout& f = layout->fields[fieldIndex];
+        if (soa) {
+            return base() + columnOffsets[fieldIndex] + index * f.size;
+        }
+        return base() + index * layout->size + f.offset;
+    }
+
+    /**
+     * Distance in bytes between the same field of consecutive elements
+     */
+    size_t fieldStride(size_t fieldIndex) const {
+        return soa ? layout->fields[fieldIndex].size : layout->size;
+    }
+};
+
+/**
+ * Strided column kernels; `UnitStride` is what generated code gets for an
+ * SoA list, where the field stride is known to be one element.
+ */
+template <bool UnitStride>
+int64_t sumField(const int64_t* xs, size_t stride, size_t count) {
+    int64_t total = 0;
+    for (size_t i = 0; i < count; i++) {
+        total += xs[i * (UnitStride ? 1 : stride)];
+    }
+    return total;
+}
+
+template <bool UnitStride>
+void addField(int64_t* xs, const int64_t* ys, size_t stride, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        xs[i * (UnitStride ? 1 : stride)] += ys[i * (UnitStride ? 1 : stride)];
+    }
+}
+
+/**
+ * AoS vs SoA benchmark: a loop over one million `Point { x, y, z: int }`
+ * values that reads `point.x` (sum) and updates `point.x += point.y`.
+ */
+inline void runStructLayoutBenchmark(size_t count) {
+    std::cout << "=== Struct Layout Benchmark (" << count << " points) ===" << std::endl;
+
+    StructLayoutEngine engine;
+    engine.computeAll({ StructDef{ "Point", { { "x", "int", 0 }, { "y", "int", 0 }, { "z", "int", 0 } }, 0 } });
+    const StructLayout& point = *engine.layout("Point");
+
+    for (int mode = 0; mode < 2; mode++) {
+        bool soa = mode == 1;
+        StructArray points(point, count, soa);
+        for (size_t i = 0; i < count; i++) {
+            for (size_t f = 0; f < 3; f++) {
+                int64_t value = static_cast<int64_t>(i * 3 + f);
+                std::memcpy(points.fieldPointer(i, f), &value, sizeof(value));
+            }
+        }
+
+        const size_t stride = points.fieldStride(0) / sizeof(int64_t);
+        int64_t* xs = reinterpret_cast<int64_t*>(points.fieldPointer(0, 0));
+        int64_t* ys = reinterpret_cast<int64_t*>(points.fieldPointer(0, 1));
+
+        volatile int64_t sink = 0;
+        double sum = bestOf(5, [&]() {
+            sink = soa ? sumField<true>(xs, stride, count) : sumField<false>(xs, stride, count);
+        });
+        reportBenchmark(soa ? "sum point.x (SoA)" : "sum point.x (AoS)", sum, count);
+
+        double update = bestOf(5, [&]() {
+            if (soa) {
+                addField<true>(xs, ys, stride, count);
+            } else {
+                addField<false>(xs, ys, stride, count);
+            }
+        });
+        reportBenchmark(soa ? "point.x += point.y (SoA)" : "point.x += point.y (AoS)", update, count);
+        (void)sink;
+    }
+}
+
+} // namespace MYA
+
+#endif // MYA_STRUCT_LAYOUT_H
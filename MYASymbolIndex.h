@@ -0,0 +1,607 @@
+/**
+ * MYA Language - Symbol Index
+ *
+ * Name resolution for editor tooling, built on the indentation
+ * preprocessor's token stream and the AST builder's line lexer:
+ * - FileIndexer walks one file's INDENT/DEDENT structure and records every
+ *   definition (functions, structs, fields, parameters, variables, loop
+ *   variables) and every identifier occurrence, resolving block-scoped
+ *   names in the same pass
+ * - SymbolIndex holds the per-file indexes of a whole workspace and answers
+ *   go-to-definition and find-references; names that are not local to a
+ *   block (functions, struct types, `.field` members) resolve through an
+ *   inverted index from name to the files mentioning or defining it, so a
+ *   query only visits files that can contain an answer
+ *
+ * Each MYA file is a program of its own, so a file's own definition of a
+ * global name wins; other files' definitions are used only when the file
+ * has none.
+ */
+
+#ifndef MYA_SYMBOL_INDEX_H
+#define MYA_SYMBOL_INDEX_H
+
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "MYAIndentationPreprocessor.h"
+#include "MYAASTBuilder.h"
+
+namespace MYA {
+
+enum class SymbolKind {
+    Function,
+    Struct,
+    Field,
+    Parameter,
+    Variable,
+    LoopVariable
+};
+
+/**
+ * UTF-16 code units in the first `column` bytes of a UTF-8 line (LSP
+ * clients count characters in UTF-16 unless they agree to UTF-8)
+ */
+inline int utf16Column(const std::string& line, int column) {
+    int size = static_cast<int>(line.size());
+    int units = 0;
+    for (int i = 0; i < column && i < size; i++) {
+        unsigned char c = static_cast<unsigned char>(line[i]);
+        units += (c & 0xC0) == 0x80 ? 0 : c >= 0xF0 ? 2 : 1;
+    }
+    return units + std::max(0, column - size);
+}
+
+/**
+ * Byte column of UTF-16 position `character` in a UTF-8 line
+ */
+inline int utf8Column(const std::string& line, int character) {
+    int size = static_cast<int>(line.size());
+    int i = 0, units = 0;
+    while (i < size && units < character) {
+        units += static_cast<unsigned char>(line[i]) >= 0xF0 ? 2 : 1;  // 4-byte sequences are surrogate pairs
+        i++;
+        while (i < size && (static_cast<unsigned char>(line[i]) & 0xC0) == 0x80) {
+            i++;
+        }
+    }
+    return i + std::max(0, character - units);
+}
+
+/**
+ * One definition; lines are 1-based, columns 0-based
+ */
+struct IndexedSymbol {
+    int name;       // Index into FileIndex::names
+    SymbolKind kind;
+    int line;
+    int column;
+    int container;  // Enclosing function or struct symbol, -1 at top level
+};
+
+/**
+ * One identifier occurrence. `symbol` is the definition it resolves to
+ * within the file, or -1 for a global name resolved workspace-wide.
+ */
+struct Occurrence {
+    int line;
+    int column;
+    int name;
+    int symbol;
+    bool member;      // `.field` access or field definition
+    bool definition;  // The defining occurrence of `symbol`
+};
+
+/**
+ * Occurrences of one global key within a file: its posting list there
+ */
+struct GlobalPostings {
+    std::string key;
+    std::vector<int> occurrences;  // Indices into FileIndex::occurrences, in source order
+    bool defined = false;          // The file defines the key
+};
+
+/**
+ * Symbols and occurrences of one file, occurrences in source order
+ */
+class FileIndex {
+public:
+    std::vector<std::string> names;
+    std::vector<IndexedSymbol> symbols;
+    std::vector<Occurrence> occurrences;
+    std::vector<std::vector<int>> nameOccurrences;  // Name -> occurrence indices
+    std::vector<GlobalPostings> globals;            // Global keys used or defined here, sorted by key
+    int lineCount = 0;
+    std::unordered_map<int, std::string> wideLines;  // Lines with non-ASCII bytes, for UTF-16 positions
+
+    /**
+     * Keep the lines of `text` whose byte and UTF-16 columns differ
+     */
+    void recordWideLines(const std::string& text) {
+        int line = 1;
+        size_t start = 0;
+        bool wide = false;
+        for (size_t i = 0; i <= text.size(); i++) {
+            if (i == text.size() || text[i] == '\n') {
+                if (wide) {
+                    wideLines[line] = text.substr(start, i - start);
+                }
+                line++;
+                start = i + 1;
+                wide = false;
+            } else if (static_cast<unsigned char>(text[i]) >= 0x80) {
+                wide = true;
+            }
+        }
+    }
+
+    int toUtf16(int line, int column) const {
+        auto it = wideLines.find(line);
+        return it == wideLines.end() ? column : utf16Column(it->second, column);
+    }
+
+    int fromUtf16(int line, int character) const {
+        auto it = wideLines.find(line);
+        return it == wideLines.end() ? character : utf8Column(it->second, character);
+    }
+
+    static bool isGlobalKind(SymbolKind kind) {
+        return kind == SymbolKind::Function || kind == SymbolKind::Struct || kind == SymbolKind::Field;
+    }
+
+    /**
+     * Workspace key of a global name: `name`, or `.name` for fields
+     */
+    static std::string key(const std::string& name, bool member) {
+        return member ? "." + name : name;
+    }
+
+    int findName(const std::string& name) const {
+        auto it = nameIds.find(name);
+        return it == nameIds.end() ? -1 : it->second;
+    }
+
+    int internName(const std::string& name) {
+        auto inserted = nameIds.emplace(name, static_cast<int>(names.size()));
+        if (inserted.second) {
+            names.push_back(name);
+            nameOccurrences.emplace_back();
+        }
+        return inserted.first->second;
+    }
+
+    bool isGlobal(const Occurrence& occurrence) const {
+        return occurrence.symbol < 0 || isGlobalKind(symbols[occurrence.symbol].kind);
+    }
+
+    /**
+     * Occurrence covering (line, column); the position just past the end
+     * of a name also counts, as editors place the cursor there
+     */
+    const Occurrence* occurrenceAt(int line, int column) const {
+        auto it = std::upper_bound(occurrences.begin(), occurrences.end(), std::make_pair(line, column),
+                                   [](const std::pair<int, int>& position, const Occurrence& occurrence) {
+                                       return position.first < occurrence.line ||
+                                              (position.first == occurrence.line && position.second < occurrence.column);
+                                   });
+        if (it == occurrences.begin()) {
+            return nullptr;
+        }
+        --it;
+        int end = it->column + static_cast<int>(names[it->name].size());
+        return it->line == line && column <= end ? &*it : nullptr;
+    }
+
+private:
+    std::unordered_map<std::string, int> nameIds;
+};
+
+/**
+ * FileIndexer - Builds a FileIndex from preprocessed tokens
+ *
+ * Blocks follow INDENT/DEDENT; a column-0 line ends the current function.
+ * `let` of a name already visible is an assignment and resolves to the
+ * earlier definition. Parameters and loop variables belong to the block
+ * opened by their header line.
+ */
+class FileIndexer {
+private:
+    FileIndex* file = nullptr;
+    std::vector<std::unordered_map<int, int>> blocks;  // Name -> symbol, innermost last
+    std::vector<std::pair<int, int>> pending;          // Definitions for the next block
+    int function = -1;
+    std::string opaqueKind;                            // Inside struct/render/asm until `end`
+    int opaqueDepth = 0;
+    int currentStruct = -1;
+
+    int lookup(int name) const {
+        for (size_t i = blocks.size(); i-- > 0;) {
+            auto it = blocks[i].find(name);
+            if (it != blocks[i].end()) {
+                return it->second;
+            }
+        }
+        return -1;
+    }
+
+    void occur(const Lexeme& l, int line, int name, int symbol, bool member, bool definition) {
+        file->nameOccurrences[name].push_back(static_cast<int>(file->occurrences.size()));
+        file->occurrences.push_back(Occurrence{ line, l.column, name, symbol, member, definition });
+    }
+
+    int define(const Lexeme& l, int line, SymbolKind kind, int container) {
+        int name = file->internName(l.text);
+        int symbol = static_cast<int>(file->symbols.size());
+        file->symbols.push_back(IndexedSymbol{ name, kind, line, l.column, container });
+        occur(l, line, name, symbol, kind == SymbolKind::Field, true);
+        return symbol;
+    }
+
+    void reference(const Lexeme& l, int line, bool member, bool call) {
+        int name = file->internName(l.text);
+        int symbol = member || call ? -1 : lookup(name);
+        occur(l, line, name, symbol, member, false);
+    }
+
+    static bool isName(const std::vector<Lexeme>& lex, size_t i) {
+        return i < lex.size() && lex[i].kind == Lexeme::Word && !isReservedWord(lex[i].text);
+    }
+
+    /**
+     * References in a type or expression span [from, to)
+     */
+    void scanNames(const std::vector<Lexeme>& lex, size_t from, size_t to, int line) {
+        for (size_t i = from; i < to; i++) {
+            if (isName(lex, i)) {
+                bool member = i > 0 && lex[i - 1].text == ".";
+                bool call = i + 1 < lex.size() && lex[i + 1].text == "(";
+                reference(lex[i], line, member, call);
+            }
+        }
+    }
+
+    void scanFunctionHeader(const std::vector<Lexeme>& lex, int line) {
+        if (lex[0].text == "Main") {
+            function = define(lex[0], line, SymbolKind::Function, -1);
+            return;
+        }
+        if (!isName(lex, 1)) {
+            return;
+        }
+        function = define(lex[1], line, SymbolKind::Function, -1);
+        size_t i = 2;
+        bool inParams = i < lex.size() && lex[i].text == "(";
+        for (; i < lex.size(); i++) {
+            if (lex[i].text == ")") {
+                inParams = false;
+            } else if (inParams && isName(lex, i) && i + 1 < lex.size() && lex[i + 1].text == ":") {
+                int symbol = define(lex[i], line, SymbolKind::Parameter, function);
+                pending.emplace_back(file->symbols[symbol].name, symbol);
+            } else if (isName(lex, i)) {
+                reference(lex[i], line, false, false);  // Parameter and return types
+            }
+        }
+    }
+
+    void scanStatements(const std::vector<Lexeme>& lex, int line) {
+        size_t i = 0;
+        while (i < lex.size()) {
+            const Lexeme& l = lex[i];
+            if (l.text == "let" && isName(lex, i + 1)) {
+                int name = file->internName(lex[i + 1].text);
+                int existing = lookup(name);
+                if (existing >= 0) {
+                    occur(lex[i + 1], line, name, existing, false, false);
+                } else {
+                    int symbol = define(lex[i + 1], line, SymbolKind::Variable, function);
+                    blocks.back()[name] = symbol;
+                }
+                i += 2;
+            } else if ((l.text == "for" || l.text == "pfor") && isName(lex, i + 1)) {
+                int symbol = define(lex[i + 1], line, SymbolKind::LoopVariable, function);
+                pending.emplace_back(file->symbols[symbol].name, symbol);
+                i += 2;
+            } else {
+                scanNames(lex, i, i + 1, line);
+                i++;
+            }
+        }
+    }
+
+    void scanOpaqueLine(const std::vector<Lexeme>& lex, int line) {
+        if (lex.size() == 1 && lex[0].text == "end") {
+            if (--opaqueDepth == 0) {
+                opaqueKind.clear();
+                currentStruct = -1;
+            }
+        } else if (opaqueKind == "render" && lex.size() == 2 && lex[0].text == "render" && lex[1].text == ":") {
+            opaqueDepth++;
+        } else if (opaqueKind == "struct" && lex.size() >= 3 && lex[1].text == ":" && lex[0].kind == Lexeme::Word) {
+            define(lex[0], line, SymbolKind::Field, currentStruct);
+            scanNames(lex, 2, lex.size(), line);
+        }
+    }
+
+    void scanLine(const Token& token) {
+        std::string error;
+        std::vector<Lexeme> lex = lexLine(token.value, token.column, error);
+        pending.clear();  // A header's definitions only carry into an INDENT that follows it directly
+        if (lex.empty()) {
+            return;
+        }
+        if (!opaqueKind.empty()) {
+            scanOpaqueLine(lex, token.line);
+            return;
+        }
+        if (token.column == 0) {
+            function = -1;
+        }
+        const std::string& first = lex[0].text;
+        if (first == "fn" || (first == "Main" && lex.size() > 1 && lex[1].text == "(")) {
+            scanFunctionHeader(lex, token.line);
+        } else if ((first == "struct" || first == "render" || first == "asm") && lex.back().text == ":") {
+            opaqueKind = first;
+            opaqueDepth = 1;
+            if (first == "struct" && isName(lex, 1)) {
+                currentStruct = define(lex[1], token.line, SymbolKind::Struct, -1);
+            }
+        } else {
+            scanStatements(lex, token.line);
+        }
+    }
+
+public:
+    FileIndex index(const std::vector<Token>& tokens) {
+        FileIndex result;
+        file = &result;
+        blocks.assign(1, std::unordered_map<int, int>());
+        pending.clear();
+        function = -1;
+        opaqueKind.clear();
+        opaqueDepth = 0;
+        currentStruct = -1;
+
+        for (const Token& token : tokens) {
+            if (token.type == TokenType::INDENT) {
+                blocks.emplace_back();
+                for (const auto& definition : pending) {
+                    blocks.back()[definition.first] = definition.second;
+                }
+                pending.clear();
+            } else if (token.type == TokenType::DEDENT) {
+                if (blocks.size() > 1) {
+                    blocks.pop_back();
+                }
+            } else if (token.type == TokenType::CODE) {
+                scanLine(token);
+                result.lineCount = token.line;
+            }
+        }
+
+        // Posting lists, one per global name and namespace
+        std::map<std::string, GlobalPostings> globals;
+        for (size_t i = 0; i < result.occurrences.size(); i++) {
+            const Occurrence& occurrence = result.occurrences[i];
+            if (result.isGlobal(occurrence)) {
+                std::string key = FileIndex::key(result.names[occurrence.name], occurrence.member);
+                GlobalPostings& postings = globals[key];
+                postings.occurrences.push_back(static_cast<int>(i));
+                postings.defined = postings.defined || occurrence.definition;
+            }
+        }
+        for (auto& global : globals) {
+            global.second.key = global.first;
+            result.globals.push_back(std::move(global.second));
+        }
+        file = nullptr;
+        return result;
+    }
+};
+
+/**
+ * Location of a name in the workspace
+ */
+struct SymbolLocation {
+    std::string uri;
+    int line;    // 1-based
+    int column;  // 0-based
+    int length;
+};
+
+/**
+ * SymbolIndex - Per-file indexes of a workspace plus the global name index
+ *
+ * Files are keyed by path. Open documents are pinned: their index comes
+ * from the editor's text, and background indexing of the file on disk
+ * must not replace it. All members are safe to call from several threads.
+ */
+class SymbolIndex {
+private:
+    struct Entry {
+        std::string uri;
+        std::shared_ptr<const FileIndex> index;
+        bool pinned;
+    };
+
+    mutable std::mutex mutex;
+    std::unordered_map<std::string, int> ids;
+    std::vector<Entry> entries;
+    // Key -> files using or defining it -> the file's posting list for it
+    std::unordered_map<std::string, std::map<int, const GlobalPostings*>> postings;
+    std::unordered_map<std::string, std::set<int>> definitions;  // Key -> files defining it
+
+    void location(int id, const Occurrence& occurrence, std::vector<SymbolLocation>& out) const {
+        const FileIndex& file = *entries[id].index;
+        out.push_back(SymbolLocation{ entries[id].uri, occurrence.line, occurrence.column,
+                                      static_cast<int>(file.names[occurrence.name].size()) });
+    }
+
+    void unlink(int id) {
+        const auto& old = entries[id].index;
+        if (!old) {
+            return;
+        }
+        for (const auto& global : old->globals) {
+            postings[global.key].erase(id);
+            if (global.defined) {
+                definitions[global.key].erase(id);
+            }
+        }
+    }
+
+    const Occurrence* find(const std::string& path, int line, int column, int& id) const {
+        auto it = ids.find(path);
+        if (it == ids.end() || !entries[it->second].index) {
+            return nullptr;
+        }
+        id = it->second;
+        return entries[id].index->occurrenceAt(line, column);
+    }
+
+public:
+    /**
+     * Replace a file's index. Unpinned updates (from disk) are ignored
+     * while the file is open; a pinned update pins it.
+     */
+    void update(const std::string& path, const std::string& uri, std::shared_ptr<const FileIndex> index, bool pin) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto inserted = ids.emplace(path, static_cast<int>(entries.size()));
+        if (inserted.second) {
+            entries.push_back(Entry{ uri, nullptr, false });
+        }
+        int id = inserted.first->second;
+        Entry& entry = entries[id];
+        if (entry.pinned && !pin) {
+            return;
+        }
+        unlink(id);
+        entry.uri = uri;
+        entry.index = std::move(index);
+        entry.pinned = pin;
+        for (const auto& global : entry.index->globals) {
+            postings[global.key][id] = &global;
+            if (global.defined) {
+                definitions[global.key].insert(id);
+            }
+        }
+    }
+
+    void unpin(const std::string& path) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = ids.find(path);
+        if (it != ids.end()) {
+            entries[it->second].pinned = false;
+        }
+    }
+
+    /**
+     * Index of `path`, or null when the file is not indexed
+     */
+    std::shared_ptr<const FileIndex> file(const std::string& path) const {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = ids.find(path);
+        return it == ids.end() ? nullptr : entries[it->second].index;
+    }
+
+    size_t fileCount() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return ids.size();
+    }
+
+    size_t lineCount() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        size_t lines = 0;
+        for (const auto& entry : entries) {
+            lines += entry.index ? static_cast<size_t>(entry.index->lineCount) : 0;
+        }
+        return lines;
+    }
+
+    /**
+     * Definitions of the name at (line, column) in `path`
+     */
+    std::vector<SymbolLocation> definition(const std::string& path, int line, int column) const {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::vector<SymbolLocation> result;
+        int id = -1;
+        const Occurrence* occurrence = find(path, line, column, id);
+        if (!occurrence) {
+            return result;
+        }
+        const FileIndex& file = *entries[id].index;
+        if (occurrence->symbol >= 0) {
+            const IndexedSymbol& symbol = file.symbols[occurrence->symbol];
+            result.push_back(SymbolLocation{ entries[id].uri, symbol.line, symbol.column,
+                                             static_cast<int>(file.names[symbol.name].size()) });
+            return result;
+        }
+        std::string key = FileIndex::key(file.names[occurrence->name], occurrence->member);
+        auto owners = definitions.find(key);
+        if (owners == definitions.end()) {
+            return result;
+        }
+        const auto& files = postings.at(key);
+        for (int owner : owners->second) {
+            const FileIndex& other = *entries[owner].index;
+            for (int index : files.at(owner)->occurrences) {
+                if (other.occurrences[index].definition) {
+                    location(owner, other.occurrences[index], result);
+                }
+            }
+        }
+        return result;
+    }
+
+    /**
+     * Occurrences of the symbol at (line, column) in `path`. A local
+     * resolves within its file; a global name defined in this file
+     * covers this file plus the files that do not define it themselves.
+     */
+    std::vector<SymbolLocation> references(const std::string& path, int line, int column, bool includeDeclaration) const {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::vector<SymbolLocation> result;
+        int id = -1;
+        const Occurrence* target = find(path, line, column, id);
+        if (!target) {
+            return result;
+        }
+        const FileIndex& file = *entries[id].index;
+        if (!file.isGlobal(*target)) {
+            for (int index : file.nameOccurrences[target->name]) {
+                const Occurrence& occurrence = file.occurrences[index];
+                if (occurrence.symbol == target->symbol && (includeDeclaration || !occurrence.definition)) {
+                    location(id, occurrence, result);
+                }
+            }
+            return result;
+        }
+
+        auto users = postings.find(FileIndex::key(file.names[target->name], target->member));
+        if (users == postings.end()) {
+            return result;
+        }
+        bool owned = users->second.at(id)->defined;
+        for (const auto& user : users->second) {
+            if (owned && user.first != id && user.second->defined) {
+                continue;  // Resolves to that file's own definition
+            }
+            const FileIndex& other = *entries[user.first].index;
+            for (int index : user.second->occurrences) {
+                const Occurrence& occurrence = other.occurrences[index];
+                if (includeDeclaration || !occurrence.definition) {
+                    location(user.first, occurrence, result);
+                }
+            }
+        }
+        return result;
+    }
+};
+
+} // namespace MYA
+
+#endif // MYA_SYMBOL_INDEX_H
@@ -0,0 +1,324 @@
+/**
+ * MYA Language - Tail Call Optimizer
+ *
+ * Turns self-recursive calls in tail position into jumps back to the top of
+ * the function, so deep recursion runs in constant stack space:
+ *
+ *     fn gcd(a: int, b: int) -> int:        int64_t mya_gcd(int64_t a, int64_t b) {
+ *         filter b == 0 pass:               mya_tail:;
+ *             return a;                         if (...) { return a; }
+ *         return gcd(b, a % b);                 { new a, b; goto mya_tail; }
+ *
+ * Accumulator introduction extends this to int functions that combine one
+ * recursive result with + or *:
+ *
+ *     return n * factorial(n - 1);    ->   acc = acc * n; n = n - 1; jump
+ *     return 1;                       ->   return acc * 1;
+ *
+ * The accumulator wraps on overflow (mod 2^64), so results equal the
+ * original evaluation order whenever that does not overflow. A
+ * `let t: int = f(args);` immediately returned as `e op t` is folded into
+ * the return first, which covers the factorial in example.mya.
+ *
+ * Tail position: any `return f(args)`, and `f(args)` as the last statement
+ * of a void function (or of an if/filter block that ends it).
+ */
+
+#ifndef MYA_TAIL_CALL_OPTIMIZER_H
+#define MYA_TAIL_CALL_OPTIMIZER_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "MYAAST.h"
+#include "MYABenchmark.h"
+#include "MYARuntime.h"
+
+namespace MYA {
+
+/**
+ * TailCallOptimizer - Marks self tail calls and introduces accumulators
+ */
+class TailCallOptimizer {
+private:
+    std::vector<OptRemark>& remarks;
+    int functionsOptimized = 0;
+
+    static bool isSelfCall(const Expr& expr, const FunctionDecl& fn) {
+        return expr.kind == ExprKind::Call && expr.text == fn.name && expr.args.size() == fn.params.size();
+    }
+
+    static bool callsSelf(const Expr& expr, const FunctionDecl& fn) {
+        if (expr.kind == ExprKind::Call && expr.text == fn.name) {
+            return true;
+        }
+        for (const auto& arg : expr.args) {
+            if (callsSelf(*arg, fn)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    static bool containsCall(const Expr& expr) {
+        if (expr.kind == ExprKind::Call) {
+            return true;
+        }
+        for (const auto& arg : expr.args) {
+            if (containsCall(*arg)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    static bool mentions(const Expr& expr, const std::string& name) {
+        if (expr.kind == ExprKind::Identifier && expr.text == name) {
+            return true;
+        }
+        for (const auto& arg : expr.args) {
+            if (mentions(*arg, name)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    static bool isAccumulatorOp(const std::string& op) {
+        return op == "+" || op == "*";
+    }
+
+    /**
+     * The operand of `return e op f(args)` that is the self call, or -1
+     */
+    static int accumulatedCall(const Expr& value, const FunctionDecl& fn) {
+        if (value.kind != ExprKind::Binary || !isAccumulatorOp(value.text)) {
+            return -1;
+        }
+        for (int side = 0; side < 2; side++) {
+            if (isSelfCall(*value.args[side], fn) && !callsSelf(*value.args[1 - side], fn)) {
+                return side;
+            }
+        }
+        return -1;
+    }
+
+    /**
+     * `let t: T = f(args); return e op t;` -> `return e op f(args);` when
+     * e is call-free (so evaluation order is unobservable) and T is the
+     * return type
+     */
+    void foldForwardingLets(StmtList& block, const FunctionDecl& fn) {
+        for (size_t i = 0; i < block.size(); i++) {
+            Stmt& stmt = *block[i];
+            foldForwardingLets(stmt.body, fn);
+            foldForwardingLets(stmt.elseBody, fn);
+            if (stmt.kind != StmtKind::Let || !isSelfCall(*stmt.value, fn) || !(stmt.type == fn.returnType) ||
+                i + 1 >= block.size()) {
+                continue;
+            }
+            Stmt& next = *block[i + 1];
+            if (next.kind != StmtKind::Return || !next.value || next.value->kind != ExprKind::Binary ||
+                !isAccumulatorOp(next.value->text)) {
+                continue;
+            }
+            for (int side = 0; side < 2; side++) {
+                Expr& operand = *next.value->args[side];
+                const Expr& other = *next.value->args[1 - side];
+                if (operand.kind == ExprKind::Identifier && operand.text == stmt.name &&
+                    !mentions(other, stmt.name) && !containsCall(other)) {
+                    next.value->args[side] = std::move(stmt.value);
+                    remarks.push_back(OptRemark{ stmt.line, "tailcall",
+                        "folded '" + stmt.name + "' into the return at line " + std::to_string(next.line), true });
+                    block.erase(block.begin() + static_cast<std::ptrdiff_t>(i));
+                    break;
+                }
+            }
+        }
+    }
+
+    void markBlock(StmtList& block, FunctionDecl& fn, bool tail) {
+        bool returnsValue = !fn.returnType.empty();
+        for (size_t i = 0; i < block.size(); i++) {
+            Stmt& stmt = *block[i];
+            bool last = tail && i + 1 == block.size();
+            switch (stmt.kind) {
+            case StmtKind::Return:
+                if (stmt.value && isSelfCall(*stmt.value, fn)) {
+                    stmt.tailCall = TailCall::Jump;
+                } else if (stmt.value && returnsValue && fn.returnType.name == "int" &&
+                           accumulatedCall(*stmt.value, fn) >= 0 &&
+                           (fn.accumulatorOp.empty() || fn.accumulatorOp == stmt.value->text)) {
+                    stmt.tailCall = TailCall::Accumulate;
+                    fn.accumulatorOp = stmt.value->text;
+                } else if (stmt.value && callsSelf(*stmt.value, fn)) {
+                    remarks.push_back(OptRemark{ stmt.line, "tailcall",
+                        "recursive call to '" + fn.name + "' is not in tail position", false });
+                }
+                break;
+            case StmtKind::ExprStmt:
+                if (last && !returnsValue && isSelfCall(*stmt.value, fn)) {
+                    stmt.tailCall = TailCall::Jump;
+                }
+                break;
+            case StmtKind::If:
+                markBlock(stmt.body, fn, last);
+                markBlock(stmt.elseBody, fn, last);
+                break;
+            case StmtKind::Filter:
+                if (stmt.filterFact != FilterFact::AlwaysFalse) {
+                    markBlock(stmt.body, fn, last);
+                }
+                break;
+            case StmtKind::For:
+                markBlock(stmt.body, fn, false);
+                break;
+            default:
+                break;
+            }
+            if (stmt.tailCall != TailCall::None) {
+                fn.tailCalls++;
+                remarks.push_back(OptRemark{ stmt.line, "tailcall", stmt.tailCall == TailCall::Jump
+                    ? "self call to '" + fn.name + "' turned into a jump"
+                    : "self call to '" + fn.name + "' turned into a jump with a '" + fn.accumulatorOp + "' accumulator",
+                    true });
+            }
+        }
+    }
+
+public:
+    explicit TailCallOptimizer(std::vector<OptRemark>& remarks) : remarks(remarks) {}
+
+    /**
+     * Mark tail calls in every function; returns the number of functions
+     * that now loop instead of recursing
+     */
+    int run(Program& program) {
+        functionsOptimized = 0;
+        for (auto& fn : program.functions) {
+            if (fn.isMain) {
+                continue;
+            }
+            fn.tailCalls = 0;
+            fn.accumulatorOp.clear();
+            if (fn.evaluated) {
+                continue;  // Not emitted; a remark would describe code that does not exist
+            }
+            foldForwardingLets(fn.body, fn);
+            markBlock(fn.body, fn, true);
+            if (fn.tailCalls > 0) {
+                functionsOptimized++;
+            }
+        }
+        return functionsOptimized;
+    }
+};
+
+// ----- Benchmark -----
+
+namespace TailCallBench {
+
+/**
+ * `fn sumTo(n: int) -> int: filter n == 0 pass: return 0; return n + sumTo(n - 1);`
+ * as emitted without and with the optimizer. GCC and Clang already remove
+ * this recursion at -O2, so the recursive version is built without sibling
+ * call optimization, which is what the emitted code gets at -O0, from MSVC,
+ * and whenever a local with a destructor (a region, a str) is live across
+ * the call.
+ */
+inline uintptr_t& stackLow() {
+    static uintptr_t low = 0;
+    return low;
+}
+
+MYA_NOINLINE inline void noteStack() {
+    char marker;
+    uintptr_t here = reinterpret_cast<uintptr_t>(&marker);
+    if (stackLow() == 0 || here < stackLow()) {
+        stackLow() = here;
+    }
+}
+
+#if defined(__clang__)
+#define MYA_NO_TAIL_CALLS __attribute__((disable_tail_calls))
+#elif defined(__GNUC__)
+#define MYA_NO_TAIL_CALLS __attribute__((optimize("no-optimize-sibling-calls")))
+#else
+#define MYA_NO_TAIL_CALLS
+#endif
+
+MYA_NO_TAIL_CALLS MYA_NOINLINE inline int64_t sumToRecursive(int64_t n) {
+    if (MYA_UNLIKELY(n == 0)) {
+        noteStack();
+        return 0;
+    }
+    return n + sumToRecursive(n - 1);
+}
+
+MYA_NOINLINE inline int64_t sumToLoop(int64_t n) {
+    int64_t mya_acc = 0;
+mya_tail:;
+    if (MYA_UNLIKELY(n == 0)) {
+        noteStack();
+        return MYA::Runtime::wrapAdd(mya_acc, 0);
+    }
+    {
+        mya_acc = MYA::Runtime::wrapAdd(mya_acc, n);
+        int64_t mya_arg0 = (n - 1);
+        n = mya_arg0;
+        goto mya_tail;
+    }
+}
+
+} // namespace TailCallBench
+
+/**
+ * Time sumTo(depth) recursive vs. looped and report the stack each used.
+ * Depths beyond roughly 100000 overflow the default stack when recursive,
+ * so the recursive run is capped there.
+ */
+inline void runTailCallBenchmark(size_t depth) {
+    const int64_t recursiveDepth = static_cast<int64_t>(std::min<size_t>(depth, 100000));
+    const int64_t loopDepth = static_cast<int64_t>(depth);
+    const int repeats = std::max(3, static_cast<int>(20000000 / std::max<int64_t>(recursiveDepth, 1)));
+    std::cout << "Tail call benchmark: sumTo(" << recursiveDepth << ") x " << repeats << " calls" << std::endl;
+
+    volatile int64_t sink = 0;
+    char base;
+    auto stackBytes = [&] {
+        return static_cast<size_t>(reinterpret_cast<uintptr_t>(&base) - TailCallBench::stackLow());
+    };
+    size_t items = static_cast<size_t>(recursiveDepth) * static_cast<size_t>(repeats);
+
+    TailCallBench::stackLow() = 0;
+    double recursive = bestOf(3, [&] {
+        for (int r = 0; r < repeats; r++) {
+            sink = sink + TailCallBench::sumToRecursive(recursiveDepth);
+        }
+    });
+    reportBenchmark("recursive", recursive, items);
+    std::cout << "    stack used: " << stackBytes() << " bytes" << std::endl;
+
+    TailCallBench::stackLow() = 0;
+    double looped = bestOf(3, [&] {
+        for (int r = 0; r < repeats; r++) {
+            sink = sink + TailCallBench::sumToLoop(recursiveDepth);
+        }
+    });
+    reportBenchmark("tail call + accumulator", looped, items);
+    std::cout << "    stack used: " << stackBytes() << " bytes" << std::endl;
+
+    if (loopDepth > recursiveDepth) {
+        TailCallBench::stackLow() = 0;
+        Stopwatch watch;
+        sink = sink + TailCallBench::sumToLoop(loopDepth);
+        reportBenchmark("tail call, depth " + std::to_string(loopDepth), watch.elapsedSeconds(), depth);
+        std::cout << "    stack used: " << stackBytes() << " bytes" << std::endl;
+    }
+}
+
+} // namespace MYA
+
+#endif // MYA_TAIL_CALL_OPTIMIZER_H